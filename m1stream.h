@@ -21,48 +21,100 @@
 /*--- Defines ---*/
 
 /* Possible SMI's and SVI's (ATTENTION: SMI numbers must be even!) */
-#define M1STREAM_PROC_APPSTAT    100  /* SVI example */
-#define M1STREAM_PROC_DEMOCALL   102  /* SMI example */
+#define M1STREAM_PROC_APPSTAT    100  /* Streaming statistics */
+
+/* Clients and object pools reported by M1STREAM_PROC_APPSTAT */
+#define M1STREAM_STAT_CLIENTS   32
+#define M1STREAM_STAT_POOLS     3
 
 /* Possible error codes of software module */
 #define M1STREAM_E_OK            0    /* Everything ok */
 #define M1STREAM_E_FAILED       -1    /* General error */
+#define M1STREAM_E_OVERRUN      -2    /* Sample ring: samples were overwritten before being read */
+#define M1STREAM_E_NORING       -3    /* Sample ring: switched off or module not running */
+#define M1STREAM_E_READERS      -4    /* Sample ring: all M1STREAM_SHM_READERS are in use */
 
 
 /*--- Structures ---*/
 
-/* Structure for SVI-call M1STREAM_PROC_APPSTAT */
+/* Structure for SMI-call M1STREAM_PROC_APPSTAT */
 typedef struct
 {
-    BOOL8   Stop;                       /* Stop application ? */
+    UINT32  Interval;                   /* 0: timing since start,
+                                         * 1: since the last call with 1 */
 }
 M1STREAM_APPSTAT_C;
 
-/* Structure for SVI-Reply M1STREAM_PROC_APPSTAT */
+/* Distribution of a time of the control task */
 typedef struct
 {
-    UINT32  RetCode;                    /* Return code */
-    UINT32  EventCount;                 /* Event counter */
-    UINT32  DelayTime;                  /* Delay for chaser light */
-    BOOL8   Stop;                       /* Stop chaser light */
+    UINT32  Count;                      /* Cycles measured */
+    UINT32  P50_us;                     /* Percentiles in us */
+    UINT32  P90_us;
+    UINT32  P99_us;
+    UINT32  P999_us;
+    UINT32  Max_us;                     /* Maximum, always since start */
 }
-M1STREAM_APPSTAT_R;
+M1STREAM_TIMING;
 
-/* Structure for SVI-call M1STREAM_DEMOCALL */
+/* One connected client */
 typedef struct
 {
-    UINT32  Spare;                      /* Not used, 0 for now */
+    UINT32  SocketId;                   /* Socket of the client */
+    UINT32  QueueDepth;                 /* Bytes waiting in its send buffer */
+    UINT32  FramesSent;                 /* Frames sent to it */
+    UINT32  BytesSent;                  /* Bytes sent to it */
+    UINT32  FramesSkipped;              /* Frames skipped, its send buffer was full */
+    UINT32  Rtt_us;                     /* Average round trip time, 0 = unknown */
+    UINT32  Channels;                   /* Bit n set: channel n subscribed */
+    UINT32  RateDivider;                /* It gets every n-th frame of the stream */
+    UINT32  Rate;                       /* Frames of the stream per second it gets */
 }
-M1STREAM_DEMOCALL_C;
+M1STREAM_CLIENTSTAT;
 
-/* Structure for SVI-Reply M1STREAM_DEMOCALL */
+/* Object pool of the websocket server */
 typedef struct
 {
-    SINT32  RetCode;                    /* OK or error code */
-    UINT32  CallCount;                  /* Number of calls */
-    CHAR    String[128];                /* String */
+    UINT32  Size;                       /* Objects allocated at start */
+    UINT32  Used;                       /* Objects in use */
+    UINT32  High;                       /* Most objects in use at the same time */
+    UINT32  Fallback;                   /* Objects taken from the heap, pool empty */
 }
-M1STREAM_DEMOCALL_R;
+M1STREAM_POOLSTAT;
+
+/* Structure for SMI-Reply M1STREAM_PROC_APPSTAT, all counters since start */
+typedef struct
+{
+    SINT32  RetCode;                    /* Return code */
+    UINT32  Clients;                    /* Connected clients */
+    UINT32  Handshakes;                 /* Clients connected */
+    UINT32  HandshakesFailed;           /* Upgrade requests refused */
+    UINT32  FramesSent;                 /* Frames sent to all clients */
+    UINT32  BytesSent;                  /* Bytes sent to all clients */
+    UINT32  FramesSkipped;              /* Frames skipped, send buffer full */
+    UINT32  SendErrors;                 /* Clients dropped, send failed */
+    UINT32  Evicted;                    /* Clients dropped, missed pongs */
+    UINT32  Connections;                /* Connections open, handshakes included */
+    UINT32  ConnectionsHigh;            /* Most connections open at the same time */
+    UINT32  RefusedFull;                /* Connections refused, MaxConnections open */
+    UINT32  RefusedPerIp;               /* Connections refused, MaxPerIp open */
+    UINT32  RefusedRate;                /* Connections refused, HandshakeRate exceeded */
+    UINT32  HandshakeTimeouts;          /* Headers not in within HandshakeTimeout */
+    UINT32  AcceptErrors;               /* accept() failed, e.g. out of descriptors */
+    UINT32  HttpRequests;               /* Plain HTTP requests answered */
+    UINT32  HttpNotModified;            /* Answered with 304, the client has the file */
+    UINT32  HttpNotFound;               /* Answered with 404 */
+    UINT32  HttpBytes;                  /* Bytes sent to HTTP requests */
+    UINT32  RecDropped;                 /* Records lost by the recorder */
+    UINT32  CmdRejected;                /* Invalid client commands */
+    UINT32  CmdDropped;                 /* Client commands lost, queue full */
+    M1STREAM_TIMING CycleExec;          /* Run time of the control cycle */
+    M1STREAM_TIMING CyclePeriod;        /* Time between two cycle starts */
+    M1STREAM_POOLSTAT Pool[M1STREAM_STAT_POOLS];  /* Clients, headers, messages */
+    UINT32  NbOfClients;                /* Valid entries in Client[] */
+    M1STREAM_CLIENTSTAT Client[M1STREAM_STAT_CLIENTS];
+}
+M1STREAM_APPSTAT_R;
 
 
 /*--- Function prototyping ---*/
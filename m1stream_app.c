@@ -41,9 +41,22 @@
 #include "m1stream_int.h"
 #include <aic2xx.h>
 #include "server.h"
+#include "m1stream_rec.h"
+#include "m1stream_play.h"
+#include "m1stream_game.h"
+#include "m1stream_lvc.h"
+#include "m1stream_cmd.h"
+#include "m1stream_blk.h"
+#include "m1stream_stat.h"
+#include "m1stream_shm.h"
+#include "m1stream_udp.h"
+#include "m1stream_cond.h"
+#include "m1stream_assets.h"
+#include "ws/Log.h"
 
 #define MESSAGE_BUFFER_SIZE (1024 * 1024 * 5)
 #define CHANNEL_ARRAY_LENGHT  16
+#define PLAY_AFAP_LOAD        80        /* percent of the replay task cycle used at Speed 0 */
 
 /* Functions: administration, to be called from outside this file */
 SINT32  m1stream_AppEOI(VOID);
@@ -59,6 +72,14 @@ MLOCAL VOID m1stream_CfgInit(VOID);
 MLOCAL SINT32 Task_CreateAll(VOID);
 MLOCAL VOID Task_DeleteAll(VOID);
 MLOCAL SINT32 Task_CfgRead(VOID);
+MLOCAL SINT32 Server_CfgRead(VOID);
+MLOCAL SINT32 Rec_CfgRead(VOID);
+MLOCAL SINT32 Play_CfgRead(VOID);
+MLOCAL SINT32 Game_CfgRead(VOID);
+MLOCAL SINT32 Stream_CfgRead(VOID);
+MLOCAL SINT32 Shm_CfgRead(VOID);
+MLOCAL SINT32 Udp_CfgRead(VOID);
+MLOCAL SINT32 Server_CfgGetInt(CHAR * pSection, CHAR * pGroup, CHAR * pKey, int * pValue);
 MLOCAL SINT32 Task_InitTiming(TASK_PROPERTIES * pTaskData);
 MLOCAL SINT32 Task_InitTiming_Tick(TASK_PROPERTIES * pTaskData);
 MLOCAL SINT32 Task_InitTiming_Sync(TASK_PROPERTIES * pTaskData);
@@ -70,6 +91,26 @@ MLOCAL VOID Control_CycleInit(VOID);
 MLOCAL VOID Control_CycleStart(VOID);
 MLOCAL VOID Control_Cycle(UINT32 cycles_per_sec);
 MLOCAL VOID Control_CycleEnd(TASK_PROPERTIES * pTaskData);
+MLOCAL VOID Stream_Send(const REC_RECORD * pRec);
+MLOCAL VOID Stream_SendTo(UINT32 Stream, const REC_RECORD * pRec);
+MLOCAL VOID Stream_Commands(VOID);
+MLOCAL int Stream_Format(const REC_RECORD * pRec, UINT32 Channels, char * buffer, int size);
+MLOCAL int Stream_FormatView(uint32_t channels, void * arg, char * buffer, int size);
+MLOCAL int Stream_Snapshot(int stream, uint32_t channels, char * buffer, int size);
+MLOCAL uint32_t Stream_Subscribe(int stream, const char * list);
+MLOCAL uint32_t Stream_ParseList(const char * list);
+MLOCAL VOID Stream_SendSchema(UINT32 Stream);
+
+/* Functions: worker task "Log" */
+MLOCAL VOID Log_Main(TASK_PROPERTIES * pTaskData);
+MLOCAL VOID Log_Sink(const ws_log_record * pRec, VOID * pArg);
+MLOCAL SINT32 Server_CfgGetStrg(CHAR * pSection, CHAR * pGroup, CHAR * pKey, CHAR * pValue, UINT32 Size);
+
+/* Functions: worker task "Rec" */
+MLOCAL VOID Rec_Main(TASK_PROPERTIES * pTaskData);
+
+/* Functions: worker task "Play" */
+MLOCAL VOID Play_Main(TASK_PROPERTIES * pTaskData);
 
 /* Global variables: data structure for mconfig parameters */
 M1STREAM_BASE_PARMS m1stream_BaseParams;
@@ -78,6 +119,39 @@ M1STREAM_BASE_PARMS m1stream_BaseParams;
 /* Global variables: miscellaneous */
 MLOCAL UINT32 CycleCount = 0;
 MLOCAL UINT32 SampleReadLastCycle= 0;
+MLOCAL REC_RECORD LiveRecord;           /* values of the cycle if not recorded */
+MLOCAL UINT32 PlaySeek = 0;             /* SVI: cycle to jump to in the replay */
+MLOCAL UINT32 StreamCycle_us = 1000;    /* time between two cycles sent */
+
+/*
+ * One stream of the module. Its clients connect to its own resource path,
+ * get its channels at its own rate, or the state of its own game. Stream 0
+ * is at "/" with the (Game) settings, the others come from the (Stream$)
+ * groups. All streams share the cycle, the server and its threads.
+ */
+typedef struct STREAM
+{
+    CHAR        List[64];               /* channel list as in a subscription, "" = all */
+    UINT32      Channels;               /* bit n: channel n of AllChannels[] is part of the stream */
+    UINT32      Divider;                /* only every n-th cycle goes to the clients */
+    GAME_CONFIG *pGameCfg;              /* settings of the game, stream 0: m1stream_GameCfg */
+    GAME_CONFIG GameCfg;                /* of the other streams */
+    GAME_STATE  Game;                   /* game driven by the values sent */
+    UINT32      GameTime_us;            /* game time not stepped yet */
+} STREAM;
+
+/* The values of a cycle for the subscriptions of one stream, see Stream_FormatView */
+typedef struct STREAM_VIEW
+{
+    const REC_RECORD *pRec;
+    UINT32      Channels;               /* of the stream */
+} STREAM_VIEW;
+
+MLOCAL STREAM Streams[SERVER_STREAMS];
+MLOCAL UINT32 NbOfStreams = 1;
+
+/* each stream has its own entry in the last-value cache */
+typedef char LvcStreamsCheck[(LVC_STREAMS >= SERVER_STREAMS) ? 1 : -1];
 
 /*
  * Global variables: Settings for application task
@@ -98,12 +172,54 @@ MLOCAL TASK_PROPERTIES TaskProperties_aControl = {
     TRUE                                /* task uses floating point operations */
 };
 
+MLOCAL TASK_PROPERTIES TaskProperties_aLog = {
+    "aM1STREAM_Log",                    /* unique task name, maximum length 14 */
+    "LogTask",                          /* configuration group name */
+    Log_Main,                           /* task entry function (function pointer) */
+    250,                                /* default task priority (->Task_CfgRead) */
+    20.0,                               /* default task cycle time in ms (->Task_CfgRead) */
+    0,                                  /* default task time base (->Task_CfgRead, 0=tick, 1=sync) */
+    0,                                  /* default ratio of watchdog time / cycle time
+                                         * (->Task_CfgRead) */
+    10000,                              /* task stack size in bytes, standard size is 10000 */
+    FALSE                               /* task uses floating point operations */
+};
+
+MLOCAL TASK_PROPERTIES TaskProperties_aRec = {
+    "aM1STREAM_Rec",                    /* unique task name, maximum length 14 */
+    "RecordTask",                       /* configuration group name */
+    Rec_Main,                           /* task entry function (function pointer) */
+    240,                                /* default task priority (->Task_CfgRead) */
+    10.0,                               /* default task cycle time in ms (->Task_CfgRead) */
+    0,                                  /* default task time base (->Task_CfgRead, 0=tick, 1=sync) */
+    0,                                  /* default ratio of watchdog time / cycle time
+                                         * (->Task_CfgRead) */
+    10000,                              /* task stack size in bytes, standard size is 10000 */
+    FALSE                               /* task uses floating point operations */
+};
+
+MLOCAL TASK_PROPERTIES TaskProperties_aPlay = {
+    "aM1STREAM_Play",                   /* unique task name, maximum length 14 */
+    "ReplayTask",                       /* configuration group name */
+    Play_Main,                          /* task entry function (function pointer) */
+    200,                                /* default task priority (->Task_CfgRead) */
+    1.0,                                /* default task cycle time in ms (->Task_CfgRead) */
+    0,                                  /* default task time base (->Task_CfgRead, 0=tick, 1=sync) */
+    0,                                  /* default ratio of watchdog time / cycle time
+                                         * (->Task_CfgRead) */
+    10000,                              /* task stack size in bytes, standard size is 10000 */
+    TRUE                                /* task uses floating point operations */
+};
+
 /*
  * Global variables: List of all application tasks
  * TaskList[] is being used for all task administration functions.
  */
 MLOCAL TASK_PROPERTIES *TaskList[] = {
-    &TaskProperties_aControl
+    &TaskProperties_aControl,
+    &TaskProperties_aLog,
+    &TaskProperties_aRec,
+    &TaskProperties_aPlay
 };
 
 /*
@@ -120,6 +236,26 @@ MLOCAL TASK_PROPERTIES *TaskList[] = {
 MLOCAL SVI_GLOBVAR SviGlobVarList[] = {
     {"CycleCounter", SVI_F_INOUT | SVI_F_UINT32, sizeof(UINT32), (UINT32 *) & CycleCount, 0, NULL, NULL},
     {"SampleReadLastCycle", SVI_F_OUT | SVI_F_UINT32, sizeof(UINT32), (UINT32 *) &SampleReadLastCycle, 0, NULL, NULL},
+    {"RecRecords", SVI_F_OUT | SVI_F_UINT32, sizeof(UINT32), (UINT32 *) &m1stream_RecRecords, 0, NULL, NULL},
+    {"RecDropped", SVI_F_OUT | SVI_F_UINT32, sizeof(UINT32), (UINT32 *) &m1stream_RecDropped, 0, NULL, NULL},
+    {"PlaySpeed", SVI_F_INOUT | SVI_F_SINT32, sizeof(SINT32), (UINT32 *) &m1stream_PlayCfg.Speed, 0, NULL, NULL},
+    {"PlaySeek", SVI_F_INOUT | SVI_F_UINT32, sizeof(UINT32), (UINT32 *) &PlaySeek, 0, NULL, NULL},
+    {"PlayCycle", SVI_F_OUT | SVI_F_UINT32, sizeof(UINT32), (UINT32 *) &m1stream_PlayCycle, 0, NULL, NULL},
+    {"PlayRecords", SVI_F_OUT | SVI_F_UINT32, sizeof(UINT32), (UINT32 *) &m1stream_PlayRecords, 0, NULL, NULL},
+    {"PlayRate", SVI_F_OUT | SVI_F_UINT32, sizeof(UINT32), (UINT32 *) &m1stream_PlayRate, 0, NULL, NULL},
+    {"Snapshot", SVI_F_OUT | SVI_F_BLK, sizeof(BLK_SNAPSHOT), (UINT32 *) &m1stream_Blk, 0, Blk_SviStart, NULL},
+    {"ChannelValues", SVI_F_OUT | SVI_F_BLK, sizeof(m1stream_Blk.Value), (UINT32 *) m1stream_Blk.Value, 0, Blk_SviStart, NULL},
+    {"ChannelTimes", SVI_F_OUT | SVI_F_BLK, sizeof(m1stream_Blk.Time_us), (UINT32 *) m1stream_Blk.Time_us, 0, Blk_SviStart, NULL},
+    {"StreamStats", SVI_F_OUT | SVI_F_BLK, sizeof(BLK_STATS), (UINT32 *) &m1stream_Blk.Stats, 0, Blk_SviStart, NULL},
+    {"CmdReceived", SVI_F_OUT | SVI_F_UINT32, sizeof(UINT32), (UINT32 *) &m1stream_CmdReceived, 0, NULL, NULL},
+    {"CmdRejected", SVI_F_OUT | SVI_F_UINT32, sizeof(UINT32), (UINT32 *) &m1stream_CmdRejected, 0, NULL, NULL},
+    {"CmdDropped", SVI_F_OUT | SVI_F_UINT32, sizeof(UINT32), (UINT32 *) &m1stream_CmdDropped, 0, NULL, NULL},
+    {"GameLeftScore", SVI_F_OUT | SVI_F_UINT32, sizeof(UINT32), (UINT32 *) &Streams[0].Game.Score[GAME_LEFT], 0, NULL, NULL},
+    {"GameRightScore", SVI_F_OUT | SVI_F_UINT32, sizeof(UINT32), (UINT32 *) &Streams[0].Game.Score[GAME_RIGHT], 0, NULL, NULL},
+    {"ShmReaders", SVI_F_OUT | SVI_F_UINT32, sizeof(UINT32), (UINT32 *) &m1stream_ShmReaders, 0, NULL, NULL},
+    {"ShmOverruns", SVI_F_OUT | SVI_F_UINT32, sizeof(UINT32), (UINT32 *) &m1stream_ShmOverruns, 0, NULL, NULL},
+    {"UdpSent", SVI_F_OUT | SVI_F_UINT32, sizeof(UINT32), (UINT32 *) &m1stream_UdpSent, 0, NULL, NULL},
+    {"UdpErrors", SVI_F_OUT | SVI_F_UINT32, sizeof(UINT32), (UINT32 *) &m1stream_UdpErrors, 0, NULL, NULL},
     {"ModuleVersion", SVI_F_OUT | SVI_F_STRING, sizeof(m1stream_Version),
      (UINT32 *) m1stream_Version, 0, NULL, NULL}
 };
@@ -141,14 +277,32 @@ struct Channels{
     SINT32 value;
 };
 
-MLOCAL char* BuildString(char *paddleString, char SearchChar, int loopCount);
-MLOCAL VOID GetMCONFIG_Data();
-
-
 typedef struct Globals Globals;
 typedef struct Channels Channels;
 
-MLOCAL Channels AllChannels[CHANNEL_ARRAY_LENGHT] = {0};
+/* The channels of the (PaddleConfig$) groups, with their conditioning */
+typedef struct ChannelTable
+{
+    Channels Channel[CHANNEL_ARRAY_LENGHT];     /* drvId 0: not configured */
+    COND_CONFIG Cond[CHANNEL_ARRAY_LENGHT];
+} ChannelTable;
+
+MLOCAL VOID GetMCONFIG_Data(ChannelTable * pTable);
+MLOCAL VOID Channel_Swap(ChannelTable * pTable);
+MLOCAL uint32_t Channel_MapMask(uint32_t channels, void * arg);
+
+/*
+ * Two tables: the control task reads the current one, a new configuration
+ * is built in the other one by the bTask and taken over by the control
+ * task at the start of a cycle.
+ */
+MLOCAL ChannelTable ChannelTables[2];
+MLOCAL Channels *AllChannels = ChannelTables[0].Channel;   /* of the current table */
+MLOCAL ChannelTable * volatile pChannelNew = NULL;          /* built, not taken over yet */
+MLOCAL SINT32 RawValues[CHANNEL_ARRAY_LENGHT];     /* last value read of each channel */
+
+/* a record holds exactly the channels of AllChannels[] */
+typedef char RecChannelsCheck[(REC_CHANNELS == CHANNEL_ARRAY_LENGHT) ? 1 : -1];
 
 Globals globals;
 
@@ -213,7 +367,18 @@ MLOCAL VOID Control_Main(TASK_PROPERTIES * pTaskData)
 *******************************************************************************/
 MLOCAL VOID Control_CycleInit(VOID)
 {
-    GetMCONFIG_Data();
+    GetMCONFIG_Data(&ChannelTables[0]);
+    Channel_Swap(&ChannelTables[0]);
+
+    /* new clients get the last values right away */
+    server_cfg.snapshot = Stream_Snapshot;
+    server_cfg.input = Cmd_Input;
+    Cmd_Init();
+    server_cfg.subscribe = Stream_Subscribe;
+
+    /* the page of the displays comes from the module itself */
+    server_cfg.assets = m1stream_Assets;
+    server_cfg.asset_count = m1stream_NbOfAssets;
 
     globals.serverTaskId = sys_TaskSpawn(m1stream_AppName, "myserver", 130, VX_FP_TASK, 10000, server_main);
     globals.messageBuffer = sys_MemAlloc(MESSAGE_BUFFER_SIZE);
@@ -231,7 +396,21 @@ MLOCAL VOID Control_CycleInit(VOID)
 MLOCAL VOID Control_CycleStart(VOID)
 {
 
-    /* TODO: add what is necessary at each cycle start */
+    /* timing of the cycle for M1STREAM_PROC_APPSTAT */
+    Stat_CycleStart();
+
+    /* channels changed by SMI_PROC_NEWCFG, between two cycles */
+    if (pChannelNew)
+    {
+        __sync_synchronize();
+        Channel_Swap(pChannelNew);
+        __sync_synchronize();
+        pChannelNew = NULL;
+    }
+
+    /* while a session is replayed, the replay task takes the commands */
+    if (!m1stream_PlayCfg.Enable)
+        Stream_Commands();
 
 }
 
@@ -247,10 +426,18 @@ MLOCAL VOID Control_CycleStart(VOID)
 MLOCAL VOID Control_Cycle(UINT32 cycles_per_sec)
 {
     int ret = 0;
-    BOOL firstChannel = TRUE;
-    char buffer[1024] =
-    { '\0' };
-    int bufferLength = 0;
+    REC_RECORD *pRec;
+    REC_RECORD *pClaimed;
+    SINT32 values[CHANNEL_ARRAY_LENGHT];
+
+    CycleCount++;
+
+    /* NULL if recording is off or the record task lags behind */
+    pClaimed = Rec_Claim();
+    pRec = pClaimed ? pClaimed : &LiveRecord;
+    pRec->Cycle = CycleCount;
+    pRec->Valid = 0;
+
     //read data from AIO
     for (int i = 0; i < CHANNEL_ARRAY_LENGHT; ++i)
     {
@@ -259,52 +446,385 @@ MLOCAL VOID Control_Cycle(UINT32 cycles_per_sec)
             // Get the value for the channel
             ret = mio_GetValue(AllChannels[i].drvId, AllChannels[i].chan, &AllChannels[i].value);
 
+            pRec->Channel[i].CardNb = AllChannels[i].cardNb;
+            pRec->Channel[i].Chan = AllChannels[i].chan;
             if (ret == OK)
             {
-                if (!firstChannel)
-                {
-                    buffer[bufferLength++] = ','; // Add a comma separator if not the first channel
-                }
-                firstChannel = FALSE;
-                int charsWritten = snprintf(buffer + bufferLength, sizeof(buffer) - bufferLength,
-                        "{\"CardNb\": %d, \"ChannelNb\": %d, \"Value\": %d}", AllChannels[i].cardNb,
-                        AllChannels[i].chan, AllChannels[i].value);
-                bufferLength += charsWritten;
-            }
-            else
-            {
-                send_to_all("{\"Exception\":\"Error: Could not read data\"}");
+                RawValues[i] = AllChannels[i].value;
+                pRec->Valid |= 1 << i;
             }
         }
+        else
+        {
+            /* CardNb 0 marks a channel which is not configured */
+            memset(&pRec->Channel[i], 0, sizeof(pRec->Channel[i]));
+        }
+    }
+
+    /* the filters go on with the last good value of a channel not read */
+    memcpy(values, RawValues, sizeof(values));
+    Cond_Run(values, CHANNEL_ARRAY_LENGHT);
+    for (int i = 0; i < CHANNEL_ARRAY_LENGHT; ++i)
+        pRec->Channel[i].Value = values[i];
+
+    /* the SVI blocks always show the live values */
+    Blk_Update(pRec);
+
+    /* as do the modules reading the sample ring */
+    Shm_Write(pRec);
+
+    /* while a session is replayed, the replay task feeds the clients */
+    if (!m1stream_PlayCfg.Enable)
+        Stream_Send(pRec);
+
+    if (pClaimed)
+        Rec_Commit();
+
+}
+
+/**
+********************************************************************************
+* @brief Sends the values of one cycle to the clients of all streams.
+*        With (Multicast) Enable = 1 the channels also go out as datagram,
+*        at the frame rate of stream 0.
+*        Used for the live values as well as for the replay.
+*
+* @param[in]  pRec    values of one cycle
+* @param[out] N/A
+*
+* @retval     N/A
+*******************************************************************************/
+MLOCAL VOID Stream_Send(const REC_RECORD * pRec)
+{
+    /* once for all receivers on the LAN */
+    if (pRec->Cycle % Streams[0].Divider == 0)
+        Udp_Send(pRec);
+
+    for (UINT32 s = 0; s < NbOfStreams; s++)
+        Stream_SendTo(s, pRec);
+}
+
+/**
+********************************************************************************
+* @brief Sends the values of one cycle to the clients of one stream, as JSON
+*        array of its channels read successfully. Each of them which could
+*        not be read is reported by a separate exception message before.
+*        With the game of the stream enabled the values move its paddles,
+*        the game advances in fixed steps of GAME_STEP_US, and the clients
+*        get the game state instead of the channels.
+*
+* @param[in]  Stream  0 .. NbOfStreams-1
+* @param[in]  pRec    values of one cycle
+* @param[out] N/A
+*
+* @retval     N/A
+*******************************************************************************/
+MLOCAL VOID Stream_SendTo(UINT32 Stream, const REC_RECORD * pRec)
+{
+    STREAM *pStream = &Streams[Stream];
+    const GAME_CONFIG *pGameCfg = pStream->pGameCfg;
+    STREAM_VIEW View;
+    char buffer[128];
+
+    if (pGameCfg->Enable)
+    {
+        for (pStream->GameTime_us += StreamCycle_us; pStream->GameTime_us >= GAME_STEP_US;
+             pStream->GameTime_us -= GAME_STEP_US)
+            Game_Step(&pStream->Game, pGameCfg, pRec->Channel[pGameCfg->LeftPaddle].Value,
+                      pRec->Channel[pGameCfg->RightPaddle].Value);
+    }
+
+    /* clients connecting from now on start with these values */
+    Lvc_Update(Stream, pRec, &pStream->Game);
+
+    /* frame rate requested by CMD_RATE */
+    if (pRec->Cycle % pStream->Divider != 0)
+        return;
+
+    for (int i = 0; i < REC_CHANNELS; ++i)
+    {
+        if ((pStream->Channels & (1 << i)) && pRec->Channel[i].CardNb != 0 && !(pRec->Valid & (1 << i)))
+            send_to_all(Stream, "{\"Exception\":\"Error: Could not read data\"}");
+    }
+
+    if (pGameCfg->Enable)
+    {
+        /* only the game state, the paddle channels are part of it */
+        Game_Format(&pStream->Game, buffer, sizeof(buffer));
+        send_to_all(Stream, buffer);
+        return;
+    }
+
+    /* one frame per distinct subscription, see Stream_FormatView */
+    View.pRec = pRec;
+    View.Channels = pStream->Channels;
+    send_channels(Stream, Stream_FormatView, &View);
+}
+
+/**
+********************************************************************************
+* @brief Carries out the commands the clients have sent since the last call.
+*        Called by the task feeding the clients before it sends, so that a
+*        command takes effect in the same cycle. Each command is for the
+*        stream of the client which sent it.
+*
+* @param[in]  N/A
+* @param[out] N/A
+*
+* @retval     N/A
+*******************************************************************************/
+MLOCAL VOID Stream_Commands(VOID)
+{
+    CMD_COMMAND Cmd;
+    REC_RECORD Rec;
+    GAME_STATE State;
+    STREAM *pStream;
+    GAME_CONFIG *pGameCfg;
+    SINT32  Value;
+    CHAR    Func[] = "Stream_Commands";
+
+    while (Cmd_Get(&Cmd))
+    {
+        if (Cmd.Stream >= NbOfStreams)
+            continue;
+        pStream = &Streams[Cmd.Stream];
+        pGameCfg = pStream->pGameCfg;
+
+        switch (Cmd.Code)
+        {
+            case CMD_START:
+            case CMD_RESET:
+                Game_Init(&pStream->Game, 1);
+                pStream->GameTime_us = 0;
+                if (Cmd.Code == CMD_START)
+                    pGameCfg->Enable = 1;
+                LOG_I(1, Func, "New game on stream %u", Cmd.Stream);
+                break;
+
+            case CMD_STOP:
+                pGameCfg->Enable = 0;
+                LOG_I(1, Func, "Game on stream %u stopped", Cmd.Stream);
+                break;
+
+            case CMD_CALIBRATE:
+                /* the values sent last, this task is the only writer */
+                if (Lvc_Read(Cmd.Stream, &Rec, &State) == 0)
+                    break;
+                Value = Rec.Channel[Cmd.Side == GAME_LEFT ? pGameCfg->LeftPaddle : pGameCfg->RightPaddle].Value;
+                if (Cmd.End)
+                    pGameCfg->InputMax = Value;
+                else
+                    pGameCfg->InputMin = Value;
+                LOG_I(1, Func, "Paddle range of stream %u is now %d .. %d", Cmd.Stream, pGameCfg->InputMin,
+                      pGameCfg->InputMax);
+                break;
+
+            case CMD_RATE:
+                pStream->Divider = 1;
+                if (Cmd.Value > 0 && Cmd.Value * StreamCycle_us < 1000000)
+                    pStream->Divider = 1000000 / (Cmd.Value * StreamCycle_us);
+                LOG_I(1, Func, "Sending every %u. cycle on stream %u", pStream->Divider, Cmd.Stream);
+                break;
+        }
+    }
+}
+
+/**
+********************************************************************************
+* @brief Builds the JSON array of the channels read successfully in a cycle.
+*
+* @param[in]  pRec      values of one cycle
+* @param[in]  Channels  bit n set: channel n is included
+* @param[out] buffer  JSON text, zero terminated
+* @param[in]  size    size of buffer, at least 2
+*
+* @retval     length of the JSON text
+*******************************************************************************/
+MLOCAL int Stream_Format(const REC_RECORD * pRec, UINT32 Channels, char * buffer, int size)
+{
+    BOOL firstChannel = TRUE;
+    int bufferLength = 0;
+
+    buffer[bufferLength++] = '[';
+    for (int i = 0; i < REC_CHANNELS && bufferLength < size - 2; ++i)
+    {
+        if (pRec->Channel[i].CardNb == 0 || !(pRec->Valid & Channels & (1 << i)))
+            continue;
+
+        if (!firstChannel)
+        {
+            buffer[bufferLength++] = ','; // Add a comma separator if not the first channel
+        }
+        int charsWritten = snprintf(buffer + bufferLength, size - 1 - bufferLength,
+                "{\"CardNb\": %d, \"ChannelNb\": %d, \"Value\": %d}", pRec->Channel[i].CardNb,
+                pRec->Channel[i].Chan, pRec->Channel[i].Value);
+        if (charsWritten >= size - 1 - bufferLength)
+        {
+            /* truncated, drop the incomplete channel and its comma */
+            bufferLength -= firstChannel ? 0 : 1;
+            break;
+        }
+        bufferLength += charsWritten;
+        firstChannel = FALSE;
     }
     buffer[bufferLength++] = ']';
     buffer[bufferLength] = '\0';
-    memmove(buffer + 1, buffer, bufferLength); // Shift content to make space for [
-    buffer[0] = '[';
-    send_to_all(buffer);
 
+    return bufferLength;
 }
 
 /**
 ********************************************************************************
-* @brief Administration code to be called at each task cycle end
+* @brief Builds the frame a client gets right after the handshake or a new
+*        subscription, from the last-value cache. It has the same format as
+*        each cycle's frame.
+*        Called by the client threads of the server, see server_cfg.snapshot.
 *
-* @param[in]  pointer to task properties data structure
-* @param[out] N/A
+* @param[in]  stream    stream of the client
+* @param[in]  channels  channels subscribed by the client
+* @param[out] buffer  JSON text, zero terminated
+* @param[in]  size    size of buffer
+*
+* @retval     > 0 .. length of the JSON text
+* @retval     = 0 .. no values yet
+*******************************************************************************/
+MLOCAL int Stream_Snapshot(int stream, uint32_t channels, char * buffer, int size)
+{
+    REC_RECORD Rec;
+    GAME_STATE State;
+
+    if (Lvc_Read(stream, &Rec, &State) == 0)
+        return 0;
+
+    if (Streams[stream].pGameCfg->Enable)
+        return Game_Format(&State, buffer, size);
+
+    return Stream_Format(&Rec, channels & Streams[stream].Channels, buffer, size);
+}
+
+/**
+********************************************************************************
+* @brief Builds the frame of a cycle for one subscription.
+*        Called by send_channels() once per distinct subscription.
+*
+* @param[in]  channels  subscribed channels
+* @param[in]  arg       values of the cycle and channels of the stream (STREAM_VIEW)
+* @param[out] buffer    JSON text, zero terminated
+* @param[in]  size      size of buffer
+*
+* @retval     length of the JSON text
+*******************************************************************************/
+MLOCAL int Stream_FormatView(uint32_t channels, void * arg, char * buffer, int size)
+{
+    const STREAM_VIEW *pView = (const STREAM_VIEW *) arg;
+
+    return Stream_Format(pView->pRec, channels & pView->Channels, buffer, size);
+}
+
+/**
+********************************************************************************
+* @brief Turns the channel list of a subscription into the channel mask,
+*        within the channels of the stream of the client.
+*        Called by the client threads of the server, see server_cfg.subscribe.
+*
+* @param[in]  stream  stream of the client
+* @param[in]  list    channel list, see Stream_ParseList()
+*
+* @retval     bit n set: channel n of AllChannels[] is subscribed
+*******************************************************************************/
+MLOCAL uint32_t Stream_Subscribe(int stream, const char * list)
+{
+    return Stream_ParseList(list) & Streams[stream].Channels;
+}
+
+/**
+********************************************************************************
+* @brief Turns a channel list into the channel mask.
+*        The list holds "CardNb.ChannelNb" or just "CardNb" for all channels
+*        of a card, separated by commas, e.g. "3.1,3.2,4". Entries which
+*        match no configured channel are ignored.
+*
+* @param[in]  list    channel list
+*
+* @retval     bit n set: channel n of AllChannels[] is in the list
+*******************************************************************************/
+MLOCAL uint32_t Stream_ParseList(const char * list)
+{
+    const Channels *pChannels = AllChannels;
+    uint32_t channels = 0;
+    char   *pEnd;
+    UINT32  cardNb, chan;
+    BOOL    anyChan;
+
+    while (*list)
+    {
+        cardNb = strtoul(list, &pEnd, 10);
+        if (pEnd == list)
+        {
+            /* not a number, skip to the next entry */
+            while (*list && *list != ',')
+                list++;
+            if (*list)
+                list++;
+            continue;
+        }
+        list = pEnd;
+
+        anyChan = TRUE;
+        chan = 0;
+        if (*list == '.')
+        {
+            chan = strtoul(list + 1, &pEnd, 10);
+            anyChan = FALSE;
+            list = pEnd;
+        }
+
+        for (int i = 0; i < CHANNEL_ARRAY_LENGHT; ++i)
+        {
+            if (pChannels[i].drvId != 0 && pChannels[i].cardNb == cardNb &&
+                (anyChan || pChannels[i].chan == chan))
+                channels |= 1 << i;
+        }
+
+        while (*list && *list != ',')
+            list++;
+        if (*list)
+            list++;
+    }
+
+    return channels;
+}
+
+/**
+********************************************************************************
+* @brief Reads the channels of the (PaddleConfig$) groups from mconfig, in
+*        their order, into a channel table. Does not touch the channels in
+*        use, so that it can run beside the control task.
+*
+* @param[out] pTable  channel table
 *
 * @retval     N/A
 *******************************************************************************/
-MLOCAL VOID GetMCONFIG_Data()
+MLOCAL VOID GetMCONFIG_Data(ChannelTable * pTable)
 {
     int lastPos = 0;
     SINT32 cardNb = 0;
     SINT32 channelNb = 0;
-    char *paddleString = "PaddleConfig1";
+    SINT32 timeConstant = 0;
+    CHAR calIn[128];
+    CHAR calOut[128];
+    COND_CONFIG *pCond;
+    CHAR Func[] = "GetMCONFIG_Data";
+    char paddleString[32];
+
+    memset(pTable, 0, sizeof(*pTable));
+    for (int i = 0; i < CHANNEL_ARRAY_LENGHT; i++)
+        pTable->Cond[i].Median = 1;
 
     for (int i = 0; i < 1024; i++)
     {
 
-        paddleString = BuildString(paddleString, 'g', i);
+        snprintf(paddleString, sizeof(paddleString), "PaddleConfig%d", i);
 
         //ReadCardNb
         pf_GetInt("M1STREAM", paddleString, "cardNb", 0, &cardNb, 0, NULL);
@@ -313,57 +833,414 @@ MLOCAL VOID GetMCONFIG_Data()
         pf_GetInt("M1STREAM", paddleString, "channel", 0, &channelNb, 0, NULL);
 
         //Check if mapping is used
-        if (cardNb != 0 && channelNb != 0)
+        if (cardNb != 0 && channelNb != 0 && lastPos < CHANNEL_ARRAY_LENGHT)
         {
             //Add to all paddle list
-            AllChannels[lastPos].cardNb = cardNb;
-            AllChannels[lastPos].chan = channelNb;
-            AllChannels[lastPos].drvId = mio_GetDrv(AllChannels[lastPos].cardNb);
+            pTable->Channel[lastPos].cardNb = cardNb;
+            pTable->Channel[lastPos].chan = channelNb;
+            pTable->Channel[lastPos].drvId = mio_GetDrv(cardNb);
+
+            //Signal conditioning, everything off by default
+            pCond = &pTable->Cond[lastPos];
+            pf_GetInt("M1STREAM", paddleString, "Median", 1, &pCond->Median, 0, NULL);
+            pf_GetInt("M1STREAM", paddleString, "TimeConstant", 0, &timeConstant, 0, NULL);
+            pf_GetStrg("M1STREAM", paddleString, "CalIn", "", calIn, sizeof(calIn), 0, NULL);
+            pf_GetStrg("M1STREAM", paddleString, "CalOut", "", calOut, sizeof(calOut), 0, NULL);
+            pCond->TimeConstant_us = timeConstant * 1000;
+            pCond->Points = Cond_ParseList(calIn, pCond->In, COND_POINTS);
+            if (Cond_ParseList(calOut, pCond->Out, COND_POINTS) != pCond->Points)
+            {
+                LOG_E(0, Func, "(%s) CalIn and CalOut need the same number of points, "
+                      "at most %d", paddleString, COND_POINTS);
+                pCond->Points = 0;
+            }
+
             lastPos++;
         }
     }
-    free(paddleString);
 }
 
-MLOCAL char* BuildString(char *paddleString, char SearchChar, int loopCount)
+/**
+********************************************************************************
+* @brief Makes a channel table the current one. The last values and the
+*        subscriptions of the clients follow each channel to its new
+*        position, the conditioning starts again. If anything changed, the
+*        clients of each stream get its new channels, see
+*        Stream_SendSchema().
+*        Called by the control task between two cycles.
+*
+* @param[in]  pTable  channel table, filled in by GetMCONFIG_Data()
+*
+* @retval     N/A
+*******************************************************************************/
+MLOCAL VOID Channel_Swap(ChannelTable * pTable)
+{
+    SINT32  Map[CHANNEL_ARRAY_LENGHT];  /* new position of each old channel, -1: gone */
+    SINT32  Values[CHANNEL_ARRAY_LENGHT];
+    BOOL    Changed = FALSE;
+    CHAR    Func[] = "Channel_Swap";
+
+    memset(Values, 0, sizeof(Values));
+    for (int i = 0; i < CHANNEL_ARRAY_LENGHT; ++i)
+    {
+        Map[i] = -1;
+        for (int j = 0; j < CHANNEL_ARRAY_LENGHT; ++j)
+        {
+            if (AllChannels[i].drvId != 0 && pTable->Channel[j].drvId != 0 &&
+                pTable->Channel[j].cardNb == AllChannels[i].cardNb && pTable->Channel[j].chan == AllChannels[i].chan)
+            {
+                Map[i] = j;
+                Values[j] = RawValues[i];
+                break;
+            }
+        }
+        if (pTable->Channel[i].drvId != AllChannels[i].drvId || (AllChannels[i].drvId != 0 && Map[i] != i))
+            Changed = TRUE;
+    }
+
+    for (int i = 0; i < CHANNEL_ARRAY_LENGHT; ++i)
+        Cond_Set(i, &pTable->Cond[i], TaskProperties_aControl.CycleTime_ms * 1000);
+    memcpy(RawValues, Values, sizeof(RawValues));
+    server_map_channels(Channel_MapMask, Map);
+    AllChannels = pTable->Channel;
+
+    /* the channels of each stream, by their lists */
+    for (UINT32 s = 0; s < NbOfStreams; s++)
+        Streams[s].Channels = Streams[s].List[0] ? Stream_ParseList(Streams[s].List) : 0xFFFFFFFF;
+
+    if (!Changed)
+        return;
+
+    for (UINT32 s = 0; s < NbOfStreams; s++)
+        Stream_SendSchema(s);
+
+    LOG_I(0, Func, "New channel table taken over");
+}
+
+/**
+********************************************************************************
+* @brief Sends the clients of a stream its channels as
+*        {"Schema":[{"CardNb": 3, "ChannelNb": 1}, ...]}.
+*
+* @param[in]  Stream  0 .. NbOfStreams-1
+*
+* @retval     N/A
+*******************************************************************************/
+MLOCAL VOID Stream_SendSchema(UINT32 Stream)
+{
+    char    buffer[1024];
+    int     len;
+
+    len = snprintf(buffer, sizeof(buffer), "{\"Schema\":[");
+    for (int i = 0; i < CHANNEL_ARRAY_LENGHT; ++i)
+    {
+        if (AllChannels[i].drvId == 0 || !(Streams[Stream].Channels & (1 << i)))
+            continue;
+        len += snprintf(buffer + len, sizeof(buffer) - len, "%s{\"CardNb\": %u, \"ChannelNb\": %u}",
+                        buffer[len - 1] == '[' ? "" : ",", AllChannels[i].cardNb, AllChannels[i].chan);
+    }
+    snprintf(buffer + len, sizeof(buffer) - len, "]}");
+    send_to_all(Stream, buffer);
+}
+
+/**
+********************************************************************************
+* @brief Moves the bits of a channel mask to the new positions of the
+*        channels. Called by server_map_channels() for each client.
+*
+* @param[in]  channels  mask of the old positions
+* @param[in]  arg       new position of each old one, -1: gone
+*
+* @retval     mask of the new positions
+*******************************************************************************/
+MLOCAL uint32_t Channel_MapMask(uint32_t channels, void * arg)
+{
+    const SINT32 *pMap = (const SINT32 *) arg;
+    uint32_t mapped = 0;
+
+    for (int i = 0; i < CHANNEL_ARRAY_LENGHT; ++i)
+    {
+        if ((channels & (1 << i)) && pMap[i] >= 0)
+            mapped |= 1 << pMap[i];
+    }
+
+    return mapped;
+}
+
+/**
+********************************************************************************
+* @brief Reads the channels from mconfig again while the module runs.
+*        The new table is taken over by the control task at the start of
+*        its next cycle, so the clients stay connected.
+*        Called by the bTask on SMI_PROC_NEWCFG.
+*
+* @param[in]  N/A
+* @param[out] N/A
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. ERROR, the table read before has not been taken over yet
+*******************************************************************************/
+SINT32 m1stream_AppNewCfg(VOID)
+{
+    ChannelTable *pTable;
+    CHAR    Func[] = "m1stream_AppNewCfg";
+
+    if (pChannelNew)
+    {
+        LOG_W(0, Func, "The channels read before have not been taken over yet");
+        return (ERROR);
+    }
+
+    /* the control task changes AllChannels only while pChannelNew is set */
+    pTable = (AllChannels == ChannelTables[0].Channel) ? &ChannelTables[1] : &ChannelTables[0];
+    GetMCONFIG_Data(pTable);
+
+    __sync_synchronize();
+    pChannelNew = pTable;
+
+    LOG_I(0, Func, "Channels read, taken over with the next cycle");
+    return (OK);
+}
+/**
+********************************************************************************
+* @brief Administration code to be called at each task cycle end
+*
+* @param[in]  pointer to task properties data structure
+* @param[out] N/A
+*
+* @retval     N/A
+*******************************************************************************/
+MLOCAL VOID Control_CycleEnd(TASK_PROPERTIES * pTaskData)
+{
+
+    /* SVI reads get the values of this cycle from now on */
+    Blk_Swap();
+
+    Stat_CycleEnd();
+
+    /*
+     * This is the very end of the cycle
+     * Delay task in order to match desired cycle time
+     */
+    Task_WaitCycle(pTaskData);
+}
+
+/**
+********************************************************************************
+* @brief Main entry function of the log task.
+*        Drains the log ring of the websocket server once per cycle, so that
+*        the threads serving the clients never write to the logger or to a
+*        file themselves. Runs at low priority.
+*
+* @param[in]  pointer to task properties data structure
+* @param[out] N/A
+*
+* @retval     N/A
+*******************************************************************************/
+MLOCAL VOID Log_Main(TASK_PROPERTIES * pTaskData)
+{
+    FILE   *pFile = NULL;
+    UINT32  Dropped = 0;
+    CHAR    Func[] = "Log_Main";
+
+    if (server_cfg.log_to_file)
+    {
+        pFile = fopen(server_cfg.log_file, "a");
+        if (!pFile)
+            LOG_W(0, Func, "Could not open '%s', using the logger instead", server_cfg.log_file);
+    }
+
+    while (!pTaskData->Quit)
+    {
+        /* at most one ring full per cycle, so that a quit request is seen */
+        if (ws_log_drain(Log_Sink, pFile, WS_LOG_SLOTS) > 0 && pFile)
+            fflush(pFile);
+
+        if (ws_log_dropped() != Dropped)
+        {
+            LOG_W(0, Func, "%u server log messages have been dropped", ws_log_dropped() - Dropped);
+            Dropped = ws_log_dropped();
+        }
+
+        Task_WaitCycle(pTaskData);
+    }
+
+    /* write what is left */
+    ws_log_drain(Log_Sink, pFile, WS_LOG_SLOTS);
+    if (pFile)
+        fclose(pFile);
+}
+
+/**
+********************************************************************************
+* @brief Main function of the record task.
+*        Writes the records queued by the control task to the segment files.
+*        Without (Recorder) Enable = 1 the task ends right away.
+*
+* @param[in]  pointer to task properties data structure
+* @param[out] N/A
+*
+* @retval     N/A
+*******************************************************************************/
+MLOCAL VOID Rec_Main(TASK_PROPERTIES * pTaskData)
+{
+    if (!m1stream_RecCfg.Enable)
+        return;
+
+    while (!pTaskData->Quit)
+    {
+        /* at most a quarter of the queue per cycle, so that a quit request is seen */
+        Rec_Write(REC_QUEUE_LEN / 4);
+
+        Task_WaitCycle(pTaskData);
+    }
+
+    /* write what is left and close the segment */
+    Rec_Close();
+}
+
+/**
+********************************************************************************
+* @brief Main function of the replay task.
+*        Sends the records of the session in (Replay) to the websocket
+*        clients, paced by the time stamps of the records divided by Speed.
+*        With Speed 0 the records are sent as fast as possible, for at most
+*        PLAY_AFAP_LOAD percent of each task cycle.
+*        Without (Replay) Enable = 1 the task ends right away.
+*
+* @param[in]  pointer to task properties data structure
+* @param[out] N/A
+*
+* @retval     N/A
+*******************************************************************************/
+MLOCAL VOID Play_Main(TASK_PROPERTIES * pTaskData)
 {
-    int idx;
-    int length;
-    char *searchLetter;
+    REC_RECORD Rec;
+    BOOL    Pending = FALSE;            /* Rec has been read but not sent yet */
+    BOOL    Restart = TRUE;             /* take the next record as time reference */
+    SINT32  Speed = 0;
+    UINT64  Elapsed = 0;                /* time since the reference in us */
+    UINT64  RecStart = 0;               /* Time_us of the reference record */
+    UINT32  Last, Now, CycleStart;
+    UINT32  Budget = pTaskData->CycleTime_ms * 10 * PLAY_AFAP_LOAD;
+    UINT32  RateStart, RateRecords = 0;
+    SINT32  ret;
+    CHAR    Func[] = "Play_Main";
+
+    if (!m1stream_PlayCfg.Enable)
+        return;
+
+    if (Play_Open() < 0)
+        return;
+    if (m1stream_PlayCfg.StartCycle)
+        Play_Seek(m1stream_PlayCfg.StartCycle);
+
+    Last = RateStart = m_GetProcTime();
+
+    while (!pTaskData->Quit)
+    {
+        Stream_Commands();
+
+        /* jump requested by SVI */
+        if (PlaySeek)
+        {
+            if (Play_Seek(PlaySeek) < 0)
+                LOG_W(0, Func, "Could not jump to cycle %u", PlaySeek);
+            PlaySeek = 0;
+            Pending = FALSE;
+            Restart = TRUE;
+        }
+        if (m1stream_PlayCfg.Speed != Speed)
+        {
+            Speed = m1stream_PlayCfg.Speed;
+            Restart = TRUE;
+        }
+
+        CycleStart = Now = m_GetProcTime();
+        Elapsed += Now - Last;
+        Last = Now;
+
+        while (!pTaskData->Quit)
+        {
+            if (!Pending)
+            {
+                ret = Play_Read(&Rec);
+                if (ret == 0 && m1stream_PlayCfg.Loop)
+                {
+                    /* start again, with a new time reference */
+                    Play_Seek(0);
+                    Restart = TRUE;
+                    ret = Play_Read(&Rec);
+                }
+                if (ret <= 0)
+                    break;
+                Pending = TRUE;
+            }
 
-    searchLetter = strchr(paddleString, SearchChar);
+            if (Restart)
+            {
+                RecStart = Rec.Time_us;
+                Elapsed = 0;
+                Restart = FALSE;
+            }
 
-    idx = (int) (searchLetter - paddleString);
+            if (Speed > 0)
+            {
+                /* not due yet */
+                if (Rec.Time_us - RecStart > Elapsed * Speed)
+                    break;
+            }
+            else if (m_GetProcTime() - CycleStart >= Budget)
+                break;
+
+            Stream_Send(&Rec);
+            Pending = FALSE;
+            m1stream_PlayCycle = Rec.Cycle;
+            m1stream_PlayRecords++;
+            RateRecords++;
+        }
 
-    length = snprintf(NULL, 0, "%d", loopCount);
+        if (Now - RateStart >= 1000000)
+        {
+            m1stream_PlayRate = RateRecords;
+            RateRecords = 0;
+            RateStart = Now;
+        }
 
-    char *result = (char*) malloc(idx + length + strlen(paddleString) + 1);
+        Task_WaitCycle(pTaskData);
+    }
+
+    Play_Close();
+}
+
+/**
+********************************************************************************
+* @brief Writes one record of the server log to the file, if one is open,
+*        or to the logger otherwise.
+*
+* @param[in]  pRec    log record
+* @param[in]  pArg    file or NULL
+* @param[out] N/A
+*
+* @retval     N/A
+*******************************************************************************/
+MLOCAL VOID Log_Sink(const ws_log_record * pRec, VOID * pArg)
+{
+    FILE   *pFile = (FILE *) pArg;
 
-    if (result == NULL)
+    if (pFile)
     {
-        return NULL;
+        fprintf(pFile, "%u.%06u %s\n", (UINT32) (pRec->time / 1000000),
+                (UINT32) (pRec->time % 1000000), pRec->text);
+        return;
     }
 
-    strncpy(result, paddleString, idx + 1);
-    //result[idx + 1] = '\0';
-
-    sprintf(result + idx + 1, "%d", loopCount);
-
-    //strcat(result, searchLetter + 1);
-
-    return result;
-}
-
-MLOCAL VOID Control_CycleEnd(TASK_PROPERTIES * pTaskData)
-{
-
-    /* TODO: add what is to be called at each cycle end */
-
-    /*
-     * This is the very end of the cycle
-     * Delay task in order to match desired cycle time
-     */
-    Task_WaitCycle(pTaskData);
+    if (pRec->level == WS_LOG_ERR)
+        log_Err("%s: server: %s", "m1stream", pRec->text);
+    else if (pRec->level == WS_LOG_WRN)
+        log_Wrn("%s: server: %s", "m1stream", pRec->text);
+    else
+        log_Info("%s: server: %s", "m1stream", pRec->text);
 }
 
 /**
@@ -388,6 +1265,30 @@ SINT32 m1stream_AppEOI(VOID)
 
         /* TODO: add all initializations required by your application */
 
+        /* The game advances by the cycle time of the control task, with a
+         * fixed seed a replay gives the same game as the live values did */
+        StreamCycle_us = TaskProperties_aControl.CycleTime_ms * 1000;
+        for (UINT32 s = 0; s < NbOfStreams; s++)
+        {
+            Streams[s].GameTime_us = 0;
+            Game_Init(&Streams[s].Game, 1);
+        }
+
+        /* Statistics of the control task, M1STREAM_PROC_APPSTAT */
+        Stat_Init(TaskProperties_aControl.CycleTime_ms * 1000);
+
+        /* Sample ring for other modules, needed before the control task starts */
+        if (Shm_Init(TaskProperties_aControl.CycleTime_ms * 1000) < 0)
+            break;
+
+        /* Multicast output, needed before the control task starts */
+        if (Udp_Init() < 0)
+            break;
+
+        /* Queue of the recorder, needed before the control task starts */
+        if (Rec_Init(TaskProperties_aControl.CycleTime_ms * 1000) < 0)
+            break;
+
         /* Start all application tasks listed in TaskList */
         if (Task_CreateAll() < 0)
             break;
@@ -424,6 +1325,15 @@ VOID m1stream_AppDeinit(VOID)
     /* Delete all application tasks listed in TaskList */
     Task_DeleteAll();
 
+    /* No task uses the recorder queue any more */
+    Rec_Deinit();
+
+    /* Nor the sample ring */
+    Shm_Deinit();
+
+    /* Nor the multicast socket */
+    Udp_Deinit();
+
 }
 
 /**
@@ -578,6 +1488,400 @@ MLOCAL SINT32 Task_CfgRead(VOID)
         return (OK);
 }
 
+/**
+********************************************************************************
+* @brief Reads one optional integer setting of the websocket server.
+*        If the key is missing, the value is left untouched.
+*
+* @param[in]  pSection  section name in mconfig
+* @param[in]  pGroup    group name in mconfig
+* @param[in]  pKey      key name in mconfig
+* @param[out] pValue    value read, also holds the default value
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. key is missing
+*******************************************************************************/
+MLOCAL SINT32 Server_CfgGetInt(CHAR * pSection, CHAR * pGroup, CHAR * pKey, int * pValue)
+{
+    SINT32  ret;
+    SINT32  TmpVal;
+    CHAR    Func[] = "Server_CfgRead";
+
+    ret = pf_GetInt(pSection, pGroup, pKey, *pValue, &TmpVal,
+                    m1stream_BaseParams.CfgLine, m1stream_BaseParams.CfgFileName);
+    if (ret >= 0)
+        *pValue = TmpVal;
+    else
+        LOG_I(1, Func, "Missing '[%s](%s)%s', using %d", pSection, pGroup, pKey, *pValue);
+
+    return (ret);
+}
+
+/**
+********************************************************************************
+* @brief Reads one optional string setting of the websocket server.
+*        If the key is missing, the value is left untouched.
+*
+* @param[in]  pSection  section name in mconfig
+* @param[in]  pGroup    group name in mconfig
+* @param[in]  pKey      key name in mconfig
+* @param[out] pValue    value read, also holds the default value
+* @param[in]  Size      size of pValue in bytes
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. key is missing
+*******************************************************************************/
+MLOCAL SINT32 Server_CfgGetStrg(CHAR * pSection, CHAR * pGroup, CHAR * pKey, CHAR * pValue, UINT32 Size)
+{
+    SINT32  ret;
+    CHAR    Func[] = "Server_CfgRead";
+
+    ret = pf_GetStrg(pSection, pGroup, pKey, pValue, pValue, Size,
+                     m1stream_BaseParams.CfgLine, m1stream_BaseParams.CfgFileName);
+    if (ret < 0)
+        LOG_I(1, Func, "Missing '[%s](%s)%s', using '%s'", pSection, pGroup, pKey, pValue);
+
+    return (ret);
+}
+
+/**
+********************************************************************************
+* @brief Reads the settings of the websocket server from configuration file
+*        mconfig into server_cfg.
+*        Being called by m1stream_CfgRead.
+*        All parameters are being treated as optional, the initialization
+*        values of server_cfg are being used as default values.
+*
+* @param[in]  N/A
+* @param[out] N/A
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. ERROR
+*******************************************************************************/
+MLOCAL SINT32 Server_CfgRead(VOID)
+{
+    CHAR    section[PF_KEYLEN_A];
+    CHAR    TmpStrg[16];
+
+    /* section name is the application name */
+    snprintf(section, sizeof(section), m1stream_BaseParams.AppName);
+
+    /* permessage-deflate negotiation on/off */
+    Server_CfgGetInt(section, "Compression", "Enable", &server_cfg.deflate_enable);
+
+    /* zlib compression level */
+    Server_CfgGetInt(section, "Compression", "Level", &server_cfg.deflate_level);
+
+    /* messages below this size are always sent uncompressed */
+    Server_CfgGetInt(section, "Compression", "MinSize", &server_cfg.deflate_min_size);
+
+    /* ping interval in ms, 0 turns the keepalive off */
+    Server_CfgGetInt(section, "Keepalive", "Interval", &server_cfg.keepalive_interval);
+
+    /* unanswered pings before a client is dropped */
+    Server_CfgGetInt(section, "Keepalive", "MaxMissed", &server_cfg.keepalive_missed);
+
+    /* TCP port of all streams */
+    Server_CfgGetInt(section, "Connections", "Port", &server_cfg.port);
+
+    /* clients the object pools of the server are allocated for */
+    Server_CfgGetInt(section, "Connections", "MaxClients", &server_cfg.max_clients);
+
+    /* limits of new connections, checked right after accept() */
+    Server_CfgGetInt(section, "Admission", "MaxConnections", &server_cfg.max_connections);
+    Server_CfgGetInt(section, "Admission", "MaxPerIp", &server_cfg.max_per_ip);
+    Server_CfgGetInt(section, "Admission", "HandshakeRate", &server_cfg.handshake_rate);
+    Server_CfgGetInt(section, "Admission", "HandshakeBurst", &server_cfg.handshake_burst);
+    Server_CfgGetInt(section, "Admission", "HandshakeTimeout", &server_cfg.handshake_timeout);
+    Server_CfgGetInt(section, "Admission", "Backlog", &server_cfg.backlog);
+
+    /* how far the stream of a slow client is thinned out, and when */
+    Server_CfgGetInt(section, "RateControl", "MaxDivider", &server_cfg.rate_max_divider);
+    Server_CfgGetInt(section, "RateControl", "QueueHigh", &server_cfg.rate_queue);
+
+    /* files for plain HTTP requests on the same port */
+    Server_CfgGetInt(section, "Http", "Enable", &server_cfg.http_enable);
+    Server_CfgGetInt(section, "Http", "IdleTimeout", &server_cfg.http_idle_timeout);
+
+    /* destination of the server log, drained by the log task */
+    snprintf(TmpStrg, sizeof(TmpStrg), server_cfg.log_to_file ? "File" : "Logger");
+    if (Server_CfgGetStrg(section, "Logging", "Target", TmpStrg, sizeof(TmpStrg)) >= 0)
+        server_cfg.log_to_file = !strncmp(TmpStrg, "File", 4);
+
+    Server_CfgGetStrg(section, "Logging", "FileName", server_cfg.log_file, sizeof(server_cfg.log_file));
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Reads the settings of the session recorder from configuration file
+*        mconfig into m1stream_RecCfg.
+*        Being called by m1stream_CfgRead.
+*        All parameters are being treated as optional, the initialization
+*        values of m1stream_RecCfg are being used as default values.
+*
+* @param[in]  N/A
+* @param[out] N/A
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. ERROR
+*******************************************************************************/
+MLOCAL SINT32 Rec_CfgRead(VOID)
+{
+    CHAR    section[PF_KEYLEN_A];
+
+    /* section name is the application name */
+    snprintf(section, sizeof(section), m1stream_BaseParams.AppName);
+
+    /* recording on/off */
+    Server_CfgGetInt(section, "Recorder", "Enable", (int *) &m1stream_RecCfg.Enable);
+
+    /* directory of the segment files */
+    Server_CfgGetStrg(section, "Recorder", "Path", m1stream_RecCfg.Path, sizeof(m1stream_RecCfg.Path));
+
+    /* records per segment file */
+    Server_CfgGetInt(section, "Recorder", "SegmentRecords", (int *) &m1stream_RecCfg.SegmentRecords);
+
+    /* segment files kept, older ones are deleted, 0 keeps all */
+    Server_CfgGetInt(section, "Recorder", "MaxSegments", (int *) &m1stream_RecCfg.MaxSegments);
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Reads the settings of the replay from configuration file mconfig
+*        into m1stream_PlayCfg.
+*        Being called by m1stream_CfgRead.
+*        All parameters are being treated as optional, the initialization
+*        values of m1stream_PlayCfg are being used as default values.
+*
+* @param[in]  N/A
+* @param[out] N/A
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. ERROR
+*******************************************************************************/
+MLOCAL SINT32 Play_CfgRead(VOID)
+{
+    CHAR    section[PF_KEYLEN_A];
+
+    /* section name is the application name */
+    snprintf(section, sizeof(section), m1stream_BaseParams.AppName);
+
+    /* replay instead of the live values */
+    Server_CfgGetInt(section, "Replay", "Enable", (int *) &m1stream_PlayCfg.Enable);
+
+    /* segment files of the session without "_<n>.rec" */
+    Server_CfgGetStrg(section, "Replay", "Session", m1stream_PlayCfg.Session,
+                      sizeof(m1stream_PlayCfg.Session));
+
+    /* 1 = real time, 10 = ten times faster, .., 0 = as fast as possible */
+    Server_CfgGetInt(section, "Replay", "Speed", (int *) &m1stream_PlayCfg.Speed);
+
+    /* start again at the end of the session */
+    Server_CfgGetInt(section, "Replay", "Loop", (int *) &m1stream_PlayCfg.Loop);
+
+    /* cycle to start the replay with */
+    Server_CfgGetInt(section, "Replay", "StartCycle", (int *) &m1stream_PlayCfg.StartCycle);
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Reads the settings of the game from configuration file mconfig
+*        into m1stream_GameCfg.
+*        Being called by m1stream_CfgRead.
+*        All parameters are being treated as optional, the initialization
+*        values of m1stream_GameCfg are being used as default values.
+*
+* @param[in]  N/A
+* @param[out] N/A
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. ERROR
+*******************************************************************************/
+MLOCAL SINT32 Game_CfgRead(VOID)
+{
+    CHAR    section[PF_KEYLEN_A];
+    CHAR    Func[] = "Game_CfgRead";
+
+    /* section name is the application name */
+    snprintf(section, sizeof(section), m1stream_BaseParams.AppName);
+
+    /* game state instead of the channel values */
+    Server_CfgGetInt(section, "Game", "Enable", (int *) &m1stream_GameCfg.Enable);
+
+    /* paddle channels, as position in the list of (PaddleConfig) groups */
+    Server_CfgGetInt(section, "Game", "LeftPaddle", (int *) &m1stream_GameCfg.LeftPaddle);
+    Server_CfgGetInt(section, "Game", "RightPaddle", (int *) &m1stream_GameCfg.RightPaddle);
+
+    /* channel values at the top and the bottom end of the field */
+    Server_CfgGetInt(section, "Game", "InputMin", (int *) &m1stream_GameCfg.InputMin);
+    Server_CfgGetInt(section, "Game", "InputMax", (int *) &m1stream_GameCfg.InputMax);
+
+    if (m1stream_GameCfg.LeftPaddle < 0 || m1stream_GameCfg.LeftPaddle >= REC_CHANNELS ||
+        m1stream_GameCfg.RightPaddle < 0 || m1stream_GameCfg.RightPaddle >= REC_CHANNELS)
+    {
+        LOG_E(0, Func, "Paddle channels must be 0 .. %d", REC_CHANNELS - 1);
+        return (ERROR);
+    }
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Reads the streams of the module from configuration file mconfig
+*        into Streams[] and server_cfg. Stream 0 is always there, at "/",
+*        with all channels and the (Game) settings. Each (Stream$) group
+*        with a Path adds one more, its game starts with the paddle range
+*        of (Game).
+*        Being called by m1stream_CfgRead, after Game_CfgRead.
+*
+* @param[in]  N/A
+* @param[out] N/A
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. ERROR
+*******************************************************************************/
+MLOCAL SINT32 Stream_CfgRead(VOID)
+{
+    CHAR    section[PF_KEYLEN_A];
+    CHAR    group[PF_KEYLEN_A];
+    CHAR    path[SERVER_PATH_SIZE];
+    STREAM *pStream;
+    CHAR    Func[] = "Stream_CfgRead";
+
+    /* section name is the application name */
+    snprintf(section, sizeof(section), m1stream_BaseParams.AppName);
+
+    memset(Streams, 0, sizeof(Streams));
+    Streams[0].pGameCfg = &m1stream_GameCfg;
+    Streams[0].Divider = 1;
+    snprintf(server_cfg.stream_path[0], SERVER_PATH_SIZE, "/");
+    NbOfStreams = 1;
+
+    for (UINT32 i = 1; i < SERVER_STREAMS; i++)
+    {
+        snprintf(group, sizeof(group), "Stream%u", i);
+        path[0] = '\0';
+        pf_GetStrg(section, group, "Path", "", path, sizeof(path),
+                   m1stream_BaseParams.CfgLine, m1stream_BaseParams.CfgFileName);
+        if (!path[0])
+            continue;
+
+        if (path[0] != '/' || strchr(path, '?'))
+        {
+            LOG_E(0, Func, "(%s) Path must start with '/' and have no query", group);
+            return (ERROR);
+        }
+        for (UINT32 k = 0; k < NbOfStreams; k++)
+        {
+            if (!strcmp(server_cfg.stream_path[k], path))
+            {
+                LOG_E(0, Func, "(%s) Path %s is used by another stream", group, path);
+                return (ERROR);
+            }
+        }
+
+        pStream = &Streams[NbOfStreams];
+        pStream->Divider = 1;
+        pStream->GameCfg = m1stream_GameCfg;
+        pStream->GameCfg.Enable = 0;
+        pStream->pGameCfg = &pStream->GameCfg;
+
+        /* channels of the stream, resolved when the channel table is taken over */
+        Server_CfgGetStrg(section, group, "Channels", pStream->List, sizeof(pStream->List));
+
+        /* game of the stream, from its own paddle channels */
+        Server_CfgGetInt(section, group, "Game", (int *) &pStream->GameCfg.Enable);
+        Server_CfgGetInt(section, group, "LeftPaddle", (int *) &pStream->GameCfg.LeftPaddle);
+        Server_CfgGetInt(section, group, "RightPaddle", (int *) &pStream->GameCfg.RightPaddle);
+        if (pStream->GameCfg.LeftPaddle < 0 || pStream->GameCfg.LeftPaddle >= REC_CHANNELS ||
+            pStream->GameCfg.RightPaddle < 0 || pStream->GameCfg.RightPaddle >= REC_CHANNELS)
+        {
+            LOG_E(0, Func, "(%s) Paddle channels must be 0 .. %d", group, REC_CHANNELS - 1);
+            return (ERROR);
+        }
+
+        snprintf(server_cfg.stream_path[NbOfStreams], SERVER_PATH_SIZE, "%s", path);
+        NbOfStreams++;
+        LOG_I(0, Func, "Stream %u at %s, channels '%s'", NbOfStreams - 1, path, pStream->List);
+    }
+    server_cfg.streams = NbOfStreams;
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Reads the settings of the sample ring from configuration file mconfig
+*        into m1stream_ShmCfg.
+*        Being called by m1stream_CfgRead.
+*        All parameters are being treated as optional, the initialization
+*        values of m1stream_ShmCfg are being used as default values.
+*
+* @param[in]  N/A
+* @param[out] N/A
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. ERROR
+*******************************************************************************/
+MLOCAL SINT32 Shm_CfgRead(VOID)
+{
+    CHAR    section[PF_KEYLEN_A];
+
+    /* section name is the application name */
+    snprintf(section, sizeof(section), m1stream_BaseParams.AppName);
+
+    /* samples in the ring for the other modules, 0 = off */
+    Server_CfgGetInt(section, "SharedRing", "Samples", (int *) &m1stream_ShmCfg.Samples);
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Reads the settings of the multicast output from configuration file
+*        mconfig into m1stream_UdpCfg.
+*        Being called by m1stream_CfgRead.
+*        All parameters are being treated as optional, the initialization
+*        values of m1stream_UdpCfg are being used as default values.
+*
+* @param[in]  N/A
+* @param[out] N/A
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. ERROR
+*******************************************************************************/
+MLOCAL SINT32 Udp_CfgRead(VOID)
+{
+    CHAR    section[PF_KEYLEN_A];
+
+    /* section name is the application name */
+    snprintf(section, sizeof(section), m1stream_BaseParams.AppName);
+
+    /* datagrams on/off */
+    Server_CfgGetInt(section, "Multicast", "Enable", (int *) &m1stream_UdpCfg.Enable);
+
+    /* destination, a multicast group or a broadcast address */
+    Server_CfgGetStrg(section, "Multicast", "Address", m1stream_UdpCfg.Address, sizeof(m1stream_UdpCfg.Address));
+    Server_CfgGetInt(section, "Multicast", "Port", (int *) &m1stream_UdpCfg.Port);
+
+    /* sending interface, empty for the one of the routing table */
+    Server_CfgGetStrg(section, "Multicast", "Interface", m1stream_UdpCfg.Interface,
+                      sizeof(m1stream_UdpCfg.Interface));
+
+    /* hops and local delivery of multicast datagrams */
+    Server_CfgGetInt(section, "Multicast", "Ttl", (int *) &m1stream_UdpCfg.Ttl);
+    Server_CfgGetInt(section, "Multicast", "Loop", (int *) &m1stream_UdpCfg.Loop);
+
+    return (OK);
+}
+
 /**
 ********************************************************************************
 * @brief Starts all tasks which are registered in the global task list
@@ -1185,10 +2489,40 @@ SINT32 m1stream_CfgRead(VOID)
     if (ret < 0)
         return ret;
 
-    /*
-     * TODO:
-     * Call other specific configuration read functions here
-     */
+    /* Read the websocket server settings from mconfig.ini */
+    ret = Server_CfgRead();
+    if (ret < 0)
+        return ret;
+
+    /* Read the session recorder settings from mconfig.ini */
+    ret = Rec_CfgRead();
+    if (ret < 0)
+        return ret;
+
+    /* Read the replay settings from mconfig.ini */
+    ret = Play_CfgRead();
+    if (ret < 0)
+        return ret;
+
+    /* Read the game settings from mconfig.ini */
+    ret = Game_CfgRead();
+    if (ret < 0)
+        return ret;
+
+    /* Read the streams from mconfig.ini, after the game of stream 0 */
+    ret = Stream_CfgRead();
+    if (ret < 0)
+        return ret;
+
+    /* Read the sample ring settings from mconfig.ini */
+    ret = Shm_CfgRead();
+    if (ret < 0)
+        return ret;
+
+    /* Read the multicast settings from mconfig.ini */
+    ret = Udp_CfgRead();
+    if (ret < 0)
+        return ret;
 
     return (OK);
 }
@@ -0,0 +1,218 @@
+/**
+********************************************************************************
+* @file     m1stream_assets.c
+*
+* @brief    Files of the built-in HTTP server, see ws/Static.h. Made by
+*           sim/asset_pack.c, do not edit: change the files in html/ and
+*           run 'make assets' in sim/.
+*
+*******************************************************************************/
+
+/* VxWorks includes */
+#include <vxWorks.h>
+
+/* MSys includes */
+#include <mtypes.h>
+
+/* Project includes */
+#include "ws/Static.h"
+#include "m1stream_assets.h"
+
+/* ../html/hello.html */
+MLOCAL const unsigned char Asset0[1502] = {
+    0x3c, 0x21, 0x64, 0x6f, 0x63, 0x74, 0x79, 0x70, 0x65, 0x20, 0x68, 0x74,
+    0x6d, 0x6c, 0x3e, 0x0a, 0x3c, 0x68, 0x74, 0x6d, 0x6c, 0x20, 0x63, 0x6c,
+    0x61, 0x73, 0x73, 0x3d, 0x22, 0x6e, 0x6f, 0x2d, 0x6a, 0x73, 0x22, 0x20,
+    0x6c, 0x61, 0x6e, 0x67, 0x3d, 0x22, 0x65, 0x6e, 0x22, 0x3e, 0x0a, 0x20,
+    0x20, 0x20, 0x20, 0x3c, 0x68, 0x65, 0x61, 0x64, 0x3e, 0x0a, 0x20, 0x20,
+    0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x6d, 0x65, 0x74, 0x61, 0x20,
+    0x63, 0x68, 0x61, 0x72, 0x73, 0x65, 0x74, 0x3d, 0x22, 0x75, 0x74, 0x66,
+    0x2d, 0x38, 0x22, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+    0x20, 0x3c, 0x74, 0x69, 0x74, 0x6c, 0x65, 0x3e, 0x3c, 0x2f, 0x74, 0x69,
+    0x74, 0x6c, 0x65, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+    0x20, 0x3c, 0x21, 0x2d, 0x2d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+    0x20, 0x20, 0x3c, 0x6d, 0x65, 0x74, 0x61, 0x20, 0x68, 0x74, 0x74, 0x70,
+    0x2d, 0x65, 0x71, 0x75, 0x69, 0x76, 0x3d, 0x22, 0x78, 0x2d, 0x75, 0x61,
+    0x2d, 0x63, 0x6f, 0x6d, 0x70, 0x61, 0x74, 0x69, 0x62, 0x6c, 0x65, 0x22,
+    0x20, 0x63, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x3d, 0x22, 0x69, 0x65,
+    0x3d, 0x65, 0x64, 0x67, 0x65, 0x22, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20,
+    0x20, 0x20, 0x20, 0x20, 0x3c, 0x6d, 0x65, 0x74, 0x61, 0x20, 0x6e, 0x61,
+    0x6d, 0x65, 0x3d, 0x22, 0x64, 0x65, 0x73, 0x63, 0x72, 0x69, 0x70, 0x74,
+    0x69, 0x6f, 0x6e, 0x22, 0x20, 0x63, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74,
+    0x3d, 0x22, 0x22, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+    0x20, 0x3c, 0x6d, 0x65, 0x74, 0x61, 0x20, 0x6e, 0x61, 0x6d, 0x65, 0x3d,
+    0x22, 0x76, 0x69, 0x65, 0x77, 0x70, 0x6f, 0x72, 0x74, 0x22, 0x20, 0x63,
+    0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x3d, 0x22, 0x77, 0x69, 0x64, 0x74,
+    0x68, 0x3d, 0x64, 0x65, 0x76, 0x69, 0x63, 0x65, 0x2d, 0x77, 0x69, 0x64,
+    0x74, 0x68, 0x2c, 0x20, 0x69, 0x6e, 0x69, 0x74, 0x69, 0x61, 0x6c, 0x2d,
+    0x73, 0x63, 0x61, 0x6c, 0x65, 0x3d, 0x31, 0x22, 0x3e, 0x0a, 0x09, 0x09,
+    0x3c, 0x6c, 0x69, 0x6e, 0x6b, 0x20, 0x72, 0x65, 0x6c, 0x3d, 0x22, 0x63,
+    0x61, 0x6e, 0x6f, 0x6e, 0x69, 0x63, 0x61, 0x6c, 0x22, 0x20, 0x68, 0x72,
+    0x65, 0x66, 0x3d, 0x22, 0x68, 0x74, 0x74, 0x70, 0x73, 0x3a, 0x2f, 0x2f,
+    0x68, 0x74, 0x6d, 0x6c, 0x35, 0x2d, 0x74, 0x65, 0x6d, 0x70, 0x6c, 0x61,
+    0x74, 0x65, 0x73, 0x2e, 0x63, 0x6f, 0x6d, 0x2f, 0x22, 0x20, 0x2f, 0x3e,
+    0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x6c, 0x69,
+    0x6e, 0x6b, 0x20, 0x72, 0x65, 0x6c, 0x3d, 0x22, 0x61, 0x70, 0x70, 0x6c,
+    0x65, 0x2d, 0x74, 0x6f, 0x75, 0x63, 0x68, 0x2d, 0x69, 0x63, 0x6f, 0x6e,
+    0x22, 0x20, 0x68, 0x72, 0x65, 0x66, 0x3d, 0x22, 0x61, 0x70, 0x70, 0x6c,
+    0x65, 0x2d, 0x74, 0x6f, 0x75, 0x63, 0x68, 0x2d, 0x69, 0x63, 0x6f, 0x6e,
+    0x2e, 0x70, 0x6e, 0x67, 0x22, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20,
+    0x20, 0x20, 0x20, 0x20, 0x50, 0x6c, 0x61, 0x63, 0x65, 0x20, 0x66, 0x61,
+    0x76, 0x69, 0x63, 0x6f, 0x6e, 0x2e, 0x69, 0x63, 0x6f, 0x20, 0x69, 0x6e,
+    0x20, 0x74, 0x68, 0x65, 0x20, 0x72, 0x6f, 0x6f, 0x74, 0x20, 0x64, 0x69,
+    0x72, 0x65, 0x63, 0x74, 0x6f, 0x72, 0x79, 0x20, 0x0a, 0x20, 0x20, 0x20,
+    0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x6c, 0x69, 0x6e, 0x6b, 0x20, 0x72,
+    0x65, 0x6c, 0x3d, 0x22, 0x73, 0x74, 0x79, 0x6c, 0x65, 0x73, 0x68, 0x65,
+    0x65, 0x74, 0x22, 0x20, 0x68, 0x72, 0x65, 0x66, 0x3d, 0x22, 0x63, 0x73,
+    0x73, 0x2f, 0x6e, 0x6f, 0x72, 0x6d, 0x61, 0x6c, 0x69, 0x7a, 0x65, 0x2e,
+    0x63, 0x73, 0x73, 0x22, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+    0x20, 0x20, 0x3c, 0x6c, 0x69, 0x6e, 0x6b, 0x20, 0x72, 0x65, 0x6c, 0x3d,
+    0x22, 0x73, 0x74, 0x79, 0x6c, 0x65, 0x73, 0x68, 0x65, 0x65, 0x74, 0x22,
+    0x20, 0x68, 0x72, 0x65, 0x66, 0x3d, 0x22, 0x63, 0x73, 0x73, 0x2f, 0x6d,
+    0x61, 0x69, 0x6e, 0x2e, 0x63, 0x73, 0x73, 0x22, 0x3e, 0x0a, 0x20, 0x20,
+    0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x73, 0x63, 0x72, 0x69, 0x70,
+    0x74, 0x20, 0x73, 0x72, 0x63, 0x3d, 0x22, 0x6a, 0x73, 0x2f, 0x76, 0x65,
+    0x6e, 0x64, 0x6f, 0x72, 0x2f, 0x6d, 0x6f, 0x64, 0x65, 0x72, 0x6e, 0x69,
+    0x7a, 0x72, 0x2d, 0x32, 0x2e, 0x38, 0x2e, 0x33, 0x2e, 0x6d, 0x69, 0x6e,
+    0x2e, 0x6a, 0x73, 0x22, 0x3e, 0x3c, 0x2f, 0x73, 0x63, 0x72, 0x69, 0x70,
+    0x74, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x2d,
+    0x2d, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x2f, 0x68, 0x65, 0x61,
+    0x64, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x62, 0x6f, 0x64, 0x79,
+    0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x21,
+    0x2d, 0x2d, 0x20, 0x41, 0x64, 0x64, 0x20, 0x79, 0x6f, 0x75, 0x72, 0x20,
+    0x73, 0x69, 0x74, 0x65, 0x20, 0x6f, 0x72, 0x20, 0x61, 0x70, 0x70, 0x6c,
+    0x69, 0x63, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x63, 0x6f, 0x6e, 0x74,
+    0x65, 0x6e, 0x74, 0x20, 0x68, 0x65, 0x72, 0x65, 0x20, 0x2d, 0x2d, 0x3e,
+    0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x70, 0x3e,
+    0x48, 0x54, 0x4d, 0x4c, 0x20, 0x3c, 0x73, 0x74, 0x72, 0x6f, 0x6e, 0x67,
+    0x3e, 0x62, 0x6f, 0x69, 0x6c, 0x65, 0x72, 0x70, 0x6c, 0x61, 0x74, 0x65,
+    0x3c, 0x2f, 0x73, 0x74, 0x72, 0x6f, 0x6e, 0x67, 0x3e, 0x20, 0x74, 0x6f,
+    0x20, 0x73, 0x74, 0x61, 0x72, 0x74, 0x20, 0x61, 0x20, 0x70, 0x72, 0x6f,
+    0x6a, 0x65, 0x63, 0x74, 0x2e, 0x3c, 0x2f, 0x70, 0x3e, 0x0a, 0x0a, 0x20,
+    0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x73, 0x63, 0x72, 0x69,
+    0x70, 0x74, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+    0x76, 0x61, 0x72, 0x20, 0x6f, 0x6e, 0x4d, 0x65, 0x73, 0x73, 0x61, 0x67,
+    0x65, 0x43, 0x61, 0x6c, 0x6c, 0x73, 0x20, 0x3d, 0x20, 0x30, 0x3b, 0x0a,
+    0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x76, 0x61, 0x72, 0x20,
+    0x6c, 0x61, 0x73, 0x74, 0x4d, 0x65, 0x73, 0x73, 0x61, 0x67, 0x65, 0x3b,
+    0x0a, 0x09, 0x09, 0x09, 0x76, 0x61, 0x72, 0x20, 0x63, 0x6f, 0x6e, 0x6e,
+    0x65, 0x63, 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x3d, 0x20, 0x6e, 0x65, 0x77,
+    0x20, 0x57, 0x65, 0x62, 0x53, 0x6f, 0x63, 0x6b, 0x65, 0x74, 0x28, 0x27,
+    0x77, 0x73, 0x3a, 0x2f, 0x2f, 0x27, 0x20, 0x2b, 0x20, 0x28, 0x6c, 0x6f,
+    0x63, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x2e, 0x68, 0x6f, 0x73, 0x74, 0x20,
+    0x7c, 0x7c, 0x20, 0x27, 0x31, 0x30, 0x2e, 0x32, 0x30, 0x34, 0x2e, 0x38,
+    0x36, 0x2e, 0x36, 0x30, 0x3a, 0x34, 0x35, 0x36, 0x37, 0x27, 0x29, 0x20,
+    0x2b, 0x20, 0x27, 0x2f, 0x27, 0x29, 0x3b, 0x0a, 0x09, 0x09, 0x09, 0x2f,
+    0x2f, 0x20, 0x57, 0x68, 0x65, 0x6e, 0x20, 0x74, 0x68, 0x65, 0x20, 0x63,
+    0x6f, 0x6e, 0x6e, 0x65, 0x63, 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x69, 0x73,
+    0x20, 0x6f, 0x70, 0x65, 0x6e, 0x2c, 0x20, 0x73, 0x65, 0x6e, 0x64, 0x20,
+    0x73, 0x6f, 0x6d, 0x65, 0x20, 0x64, 0x61, 0x74, 0x61, 0x20, 0x74, 0x6f,
+    0x20, 0x74, 0x68, 0x65, 0x20, 0x73, 0x65, 0x72, 0x76, 0x65, 0x72, 0x0a,
+    0x09, 0x09, 0x09, 0x63, 0x6f, 0x6e, 0x6e, 0x65, 0x63, 0x74, 0x69, 0x6f,
+    0x6e, 0x2e, 0x6f, 0x6e, 0x6f, 0x70, 0x65, 0x6e, 0x20, 0x3d, 0x20, 0x66,
+    0x75, 0x6e, 0x63, 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x28, 0x29, 0x20, 0x7b,
+    0x0a, 0x09, 0x09, 0x09, 0x20, 0x20, 0x63, 0x6f, 0x6e, 0x6e, 0x65, 0x63,
+    0x74, 0x69, 0x6f, 0x6e, 0x2e, 0x73, 0x65, 0x6e, 0x64, 0x28, 0x27, 0x50,
+    0x69, 0x6e, 0x67, 0x27, 0x29, 0x3b, 0x20, 0x2f, 0x2f, 0x20, 0x53, 0x65,
+    0x6e, 0x64, 0x20, 0x74, 0x68, 0x65, 0x20, 0x6d, 0x65, 0x73, 0x73, 0x61,
+    0x67, 0x65, 0x20, 0x27, 0x50, 0x69, 0x6e, 0x67, 0x27, 0x20, 0x74, 0x6f,
+    0x20, 0x74, 0x68, 0x65, 0x20, 0x73, 0x65, 0x72, 0x76, 0x65, 0x72, 0x0a,
+    0x09, 0x09, 0x09, 0x7d, 0x3b, 0x0a, 0x09, 0x09, 0x09, 0x0a, 0x09, 0x09,
+    0x09, 0x2f, 0x2f, 0x20, 0x4c, 0x6f, 0x67, 0x20, 0x65, 0x72, 0x72, 0x6f,
+    0x72, 0x73, 0x0a, 0x09, 0x09, 0x09, 0x63, 0x6f, 0x6e, 0x6e, 0x65, 0x63,
+    0x74, 0x69, 0x6f, 0x6e, 0x2e, 0x6f, 0x6e, 0x65, 0x72, 0x72, 0x6f, 0x72,
+    0x20, 0x3d, 0x20, 0x66, 0x75, 0x6e, 0x63, 0x74, 0x69, 0x6f, 0x6e, 0x20,
+    0x28, 0x65, 0x72, 0x72, 0x6f, 0x72, 0x29, 0x20, 0x7b, 0x0a, 0x09, 0x09,
+    0x09, 0x20, 0x20, 0x63, 0x6f, 0x6e, 0x73, 0x6f, 0x6c, 0x65, 0x2e, 0x6c,
+    0x6f, 0x67, 0x28, 0x27, 0x57, 0x65, 0x62, 0x53, 0x6f, 0x63, 0x6b, 0x65,
+    0x74, 0x20, 0x45, 0x72, 0x72, 0x6f, 0x72, 0x20, 0x27, 0x20, 0x2b, 0x20,
+    0x65, 0x72, 0x72, 0x6f, 0x72, 0x29, 0x3b, 0x0a, 0x09, 0x09, 0x09, 0x7d,
+    0x3b, 0x0a, 0x09, 0x09, 0x09, 0x0a, 0x09, 0x09, 0x09, 0x2f, 0x2f, 0x20,
+    0x4c, 0x6f, 0x67, 0x20, 0x6d, 0x65, 0x73, 0x73, 0x61, 0x67, 0x65, 0x73,
+    0x20, 0x66, 0x72, 0x6f, 0x6d, 0x20, 0x74, 0x68, 0x65, 0x20, 0x73, 0x65,
+    0x72, 0x76, 0x65, 0x72, 0x0a, 0x09, 0x09, 0x09, 0x63, 0x6f, 0x6e, 0x6e,
+    0x65, 0x63, 0x74, 0x69, 0x6f, 0x6e, 0x2e, 0x6f, 0x6e, 0x6d, 0x65, 0x73,
+    0x73, 0x61, 0x67, 0x65, 0x20, 0x3d, 0x20, 0x66, 0x75, 0x6e, 0x63, 0x74,
+    0x69, 0x6f, 0x6e, 0x20, 0x28, 0x65, 0x29, 0x20, 0x7b, 0x0a, 0x09, 0x09,
+    0x09, 0x20, 0x20, 0x63, 0x6f, 0x6e, 0x73, 0x6f, 0x6c, 0x65, 0x2e, 0x6c,
+    0x6f, 0x67, 0x28, 0x27, 0x53, 0x65, 0x72, 0x76, 0x65, 0x72, 0x3a, 0x20,
+    0x27, 0x20, 0x2b, 0x20, 0x65, 0x2e, 0x64, 0x61, 0x74, 0x61, 0x29, 0x3b,
+    0x0a, 0x09, 0x09, 0x09, 0x20, 0x20, 0x6f, 0x6e, 0x4d, 0x65, 0x73, 0x73,
+    0x61, 0x67, 0x65, 0x43, 0x61, 0x6c, 0x6c, 0x73, 0x2b, 0x2b, 0x3b, 0x0a,
+    0x09, 0x09, 0x09, 0x20, 0x20, 0x6c, 0x61, 0x73, 0x74, 0x4d, 0x65, 0x73,
+    0x73, 0x61, 0x67, 0x65, 0x20, 0x3d, 0x20, 0x65, 0x2e, 0x64, 0x61, 0x74,
+    0x61, 0x3b, 0x0a, 0x09, 0x09, 0x09, 0x7d, 0x3b, 0x09, 0x09, 0x09, 0x0a,
+    0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x2f, 0x73, 0x63,
+    0x72, 0x69, 0x70, 0x74, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x2f,
+    0x62, 0x6f, 0x64, 0x79, 0x3e, 0x0a, 0x3c, 0x2f, 0x68, 0x74, 0x6d, 0x6c,
+    0x3e, 0x0a
+};
+
+MLOCAL const unsigned char Asset0Gz[711] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x8d, 0x54,
+    0xdf, 0x4f, 0xdb, 0x30, 0x10, 0x7e, 0x86, 0xbf, 0xe2, 0xf0, 0x4b, 0x8a,
+    0x20, 0x49, 0xc7, 0x80, 0x21, 0x48, 0x2a, 0x4d, 0xd3, 0xa4, 0x3d, 0x80,
+    0x84, 0xc4, 0x24, 0x9e, 0x5d, 0xe7, 0x9a, 0x18, 0x1c, 0x5f, 0x66, 0xbb,
+    0xed, 0xca, 0xd8, 0xff, 0x3e, 0x3b, 0x2e, 0x34, 0x2d, 0x6c, 0x5a, 0x1e,
+    0x92, 0xfa, 0x7e, 0x7c, 0xf7, 0xdd, 0xdd, 0xe7, 0x16, 0x07, 0x15, 0x09,
+    0xb7, 0xea, 0x10, 0x1a, 0xd7, 0xaa, 0xc9, 0x7e, 0x11, 0x3e, 0x20, 0x14,
+    0xb7, 0xb6, 0x64, 0x9a, 0xd2, 0x07, 0xcb, 0x40, 0x71, 0x5d, 0x97, 0x0c,
+    0x35, 0x9b, 0xec, 0x83, 0x7f, 0x8a, 0x06, 0x79, 0x15, 0x7f, 0xf6, 0xc7,
+    0x16, 0x1d, 0x07, 0xd1, 0x70, 0x63, 0xd1, 0x95, 0x6c, 0xee, 0x66, 0xe9,
+    0x05, 0x1b, 0xb8, 0x9d, 0x74, 0x0a, 0x27, 0x45, 0x1e, 0xbf, 0x1b, 0xfb,
+    0x41, 0x9a, 0xee, 0x60, 0x34, 0xce, 0x75, 0x29, 0xfe, 0x98, 0xcb, 0x45,
+    0xc9, 0x7e, 0xa6, 0x73, 0x9e, 0x0a, 0x6a, 0x3b, 0xee, 0xe4, 0x54, 0x21,
+    0x03, 0x41, 0xda, 0xa1, 0xf6, 0x05, 0x24, 0x96, 0x58, 0xd5, 0xc8, 0x76,
+    0x19, 0x68, 0xde, 0x62, 0xc9, 0x2a, 0xb4, 0xc2, 0xc8, 0xce, 0x49, 0xd2,
+    0x83, 0x9c, 0xbf, 0x04, 0x2f, 0x24, 0x2e, 0x3b, 0x32, 0x6e, 0x10, 0xb9,
+    0x94, 0x95, 0x6b, 0xca, 0x0a, 0x17, 0x52, 0x60, 0xda, 0x1f, 0x8e, 0x41,
+    0x6a, 0xe9, 0x24, 0x57, 0xa9, 0x15, 0x5c, 0x61, 0xf9, 0xc1, 0x83, 0xed,
+    0xed, 0x15, 0x4a, 0xea, 0x47, 0x30, 0xa8, 0x4a, 0x26, 0xb8, 0x26, 0x2d,
+    0xbd, 0x8f, 0x41, 0x63, 0x70, 0x56, 0xb2, 0xd0, 0x87, 0xbd, 0xcc, 0xf3,
+    0x30, 0xca, 0xb3, 0xd4, 0x61, 0xdb, 0x29, 0xee, 0xd0, 0x66, 0xbe, 0x9d,
+    0x9c, 0x41, 0x3e, 0xe0, 0xb2, 0x01, 0xe1, 0x5d, 0xa7, 0x30, 0x75, 0x34,
+    0x17, 0x4d, 0x2a, 0x45, 0x20, 0x1f, 0xb1, 0x76, 0xed, 0x59, 0xa7, 0xeb,
+    0x41, 0x37, 0x70, 0xab, 0xb8, 0x40, 0x98, 0xf1, 0x45, 0xef, 0xf4, 0x2f,
+    0xcf, 0x16, 0x5c, 0x83, 0x60, 0x88, 0x1c, 0x54, 0xd2, 0xa0, 0x70, 0x64,
+    0x56, 0xf0, 0x5e, 0x4d, 0xeb, 0x56, 0x0a, 0x6d, 0x83, 0xe8, 0x5e, 0xaa,
+    0x09, 0x6b, 0x73, 0x4d, 0xa6, 0xe5, 0x4a, 0x3e, 0x61, 0xe6, 0x4f, 0x6c,
+    0xf2, 0xff, 0x89, 0x2d, 0x97, 0x7a, 0x37, 0x27, 0x2e, 0x03, 0xac, 0x11,
+    0x25, 0x7b, 0xb0, 0xf9, 0x02, 0x75, 0x45, 0x26, 0x6f, 0xa9, 0x42, 0xa3,
+    0xe5, 0x93, 0x49, 0x4f, 0xb2, 0x8b, 0xec, 0x63, 0xd6, 0xfa, 0x44, 0x2f,
+    0x34, 0x2f, 0x92, 0x18, 0xbf, 0x01, 0x48, 0xd3, 0xb5, 0xe6, 0xf2, 0x8d,
+    0xe8, 0x8a, 0x29, 0x55, 0xab, 0x6d, 0x21, 0xc1, 0xe7, 0xaa, 0x82, 0x15,
+    0xcd, 0x0d, 0x58, 0xe9, 0x10, 0xc8, 0x40, 0x98, 0x9b, 0xdf, 0x49, 0xd0,
+    0xc1, 0xcb, 0x72, 0xa1, 0x41, 0x83, 0xaf, 0x88, 0x7d, 0x6a, 0x37, 0xf9,
+    0xf6, 0xfd, 0xe6, 0xda, 0xd3, 0x74, 0x86, 0x74, 0x3d, 0x99, 0x92, 0x54,
+    0x68, 0xfa, 0x6d, 0x79, 0x2a, 0xd1, 0x06, 0x8e, 0xc0, 0x3a, 0x6e, 0x1c,
+    0x70, 0xe8, 0x0c, 0x3d, 0xf8, 0x79, 0x66, 0x45, 0xde, 0x4d, 0xf6, 0x77,
+    0x9b, 0xdc, 0xc0, 0x2e, 0xb8, 0x01, 0xd2, 0x37, 0x68, 0x2d, 0xaf, 0xf1,
+    0x0b, 0x57, 0xca, 0x42, 0x09, 0xe3, 0xab, 0x2d, 0xbf, 0xbf, 0x60, 0x6e,
+    0x1d, 0x71, 0xe5, 0xe5, 0xb4, 0x17, 0x6c, 0x9e, 0xa7, 0xf6, 0xf0, 0x81,
+    0x72, 0x09, 0x1a, 0x97, 0x70, 0x8f, 0xd3, 0x3b, 0x12, 0x8f, 0xe8, 0x46,
+    0xc9, 0x32, 0x08, 0x2a, 0x81, 0x23, 0x18, 0x29, 0x8a, 0x6d, 0x65, 0x0d,
+    0x59, 0x07, 0xcf, 0xcf, 0x90, 0x7c, 0x18, 0x67, 0x27, 0xe3, 0xd3, 0xec,
+    0xe2, 0x3c, 0x3b, 0x1f, 0x5f, 0x9e, 0x9e, 0x9d, 0x7f, 0x4a, 0x0e, 0x7d,
+    0x60, 0x92, 0x27, 0x87, 0x3d, 0x74, 0x9e, 0xc3, 0x7d, 0x83, 0x51, 0x15,
+    0x83, 0x12, 0xd2, 0x02, 0x75, 0xa8, 0x8f, 0xc1, 0xfa, 0xa5, 0x80, 0xa5,
+    0x16, 0xa1, 0xe2, 0xfe, 0x6a, 0xf8, 0x7e, 0x43, 0xa4, 0x45, 0xb3, 0x40,
+    0x13, 0xf2, 0x37, 0x39, 0x19, 0xe9, 0x90, 0xe2, 0xd9, 0xcd, 0xe6, 0x3a,
+    0xa2, 0x8c, 0x0e, 0xe1, 0x57, 0x08, 0x82, 0x01, 0x74, 0x16, 0x10, 0x47,
+    0xc9, 0xad, 0xd4, 0xb5, 0xa7, 0x00, 0xbe, 0xfe, 0x5d, 0x28, 0x11, 0x50,
+    0xdb, 0xd8, 0x32, 0x44, 0xe7, 0xdb, 0x5a, 0xbf, 0x7b, 0xc6, 0x6b, 0xd6,
+    0xd7, 0x54, 0x03, 0x1a, 0x43, 0xc6, 0xbe, 0xa1, 0xd1, 0x9b, 0xb7, 0x78,
+    0xf4, 0x96, 0x21, 0x19, 0x4b, 0x0a, 0x33, 0x45, 0xf5, 0x28, 0x79, 0x1d,
+    0x23, 0x7c, 0xed, 0xd3, 0xc2, 0x18, 0x63, 0xf8, 0xd5, 0xbb, 0x35, 0xd7,
+    0x24, 0x2d, 0xcc, 0x0c, 0xb5, 0xff, 0x1a, 0xc6, 0x4b, 0x37, 0x5b, 0x3c,
+    0xde, 0xe7, 0x70, 0xd7, 0x23, 0x5c, 0xc6, 0xda, 0x59, 0x18, 0x74, 0x2c,
+    0x0e, 0x3b, 0x4a, 0x39, 0x3a, 0x5a, 0x9b, 0x07, 0x02, 0xf1, 0xf8, 0x31,
+    0x65, 0x4d, 0x37, 0xb0, 0x7d, 0x15, 0xdf, 0xd6, 0x95, 0x29, 0xf2, 0x78,
+    0x37, 0x8a, 0x3c, 0xfe, 0x9b, 0xff, 0x01, 0x1c, 0xd2, 0x22, 0xf4, 0xde,
+    0x05, 0x00, 0x00
+};
+
+const ws_asset m1stream_Assets[] = {
+    {"/", "text/html; charset=utf-8", "W/\"f422d21c-5de\"", Asset0, 1502, Asset0Gz, 711},
+    {"/hello.html", "text/html; charset=utf-8", "W/\"f422d21c-5de\"", Asset0, 1502, Asset0Gz, 711}
+};
+const int m1stream_NbOfAssets = 2;
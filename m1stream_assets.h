@@ -0,0 +1,20 @@
+/**
+********************************************************************************
+* @file     m1stream_assets.h
+*
+* @brief    Files the websocket server serves to plain HTTP requests, e.g.
+*           the page of a display, so it can boot from the controller alone.
+*           m1stream_assets.c is made from html/ by 'make assets' in sim/.
+*
+*******************************************************************************/
+
+/* Avoid problems with multiple including */
+#ifndef M1STREAM_ASSETS__H
+#define M1STREAM_ASSETS__H
+
+/*--- Variable definitions ---*/
+
+EXTERN const ws_asset m1stream_Assets[];
+EXTERN const int m1stream_NbOfAssets;
+
+#endif /* Avoid problems with multiple include */
@@ -0,0 +1,118 @@
+/**
+********************************************************************************
+* @file     m1stream_blk.c
+*
+* @brief    SVI block export of the channel values, see m1stream_blk.h.
+*           Two snapshots: the control task fills in the back one while
+*           the SVI reads copy the front one, and the swap at the cycle end
+*           is a single increment of the sequence counter. A read which
+*           sees the counter change during its copy takes the new front
+*           again, the control task never waits for a reader.
+*
+*******************************************************************************/
+
+/* VxWorks includes */
+#include <vxWorks.h>
+#include <string.h>
+
+/* MSys includes */
+#include <mtypes.h>
+#include <msys_e.h>
+#include <svi_e.h>
+
+/* Project includes */
+#include "m1stream.h"
+#include "m1stream_int.h"
+#include "m1stream_rec.h"
+#include "m1stream_cmd.h"
+#include "m1stream_blk.h"
+
+/* Global variables: copy for the SVI reads */
+BLK_SNAPSHOT m1stream_Blk;
+
+MLOCAL BLK_SNAPSHOT Buffer[2];          /* front: Buffer[BlkSeq & 1] */
+MLOCAL volatile UINT32 BlkSeq = 0;      /* number of swaps */
+MLOCAL UINT32 ReadErrors = 0;
+
+/**
+********************************************************************************
+* @brief Fills in the back snapshot with the values of a cycle.
+*        Control task only, Blk_Swap() publishes it.
+*
+* @param[in]  pRec    values of the cycle
+* @param[out] N/A
+*
+* @retval     N/A
+*******************************************************************************/
+VOID Blk_Update(const REC_RECORD * pRec)
+{
+    BLK_SNAPSHOT *pBack = &Buffer[(BlkSeq + 1) & 1];
+    const BLK_SNAPSHOT *pFront = &Buffer[BlkSeq & 1];
+    UINT32  Now = m_GetProcTime();
+    int     i;
+
+    for (i = 0; i < REC_CHANNELS; i++)
+    {
+        if (pRec->Valid & (1 << i))
+        {
+            pBack->Value[i] = pRec->Channel[i].Value;
+            pBack->Time_us[i] = Now;
+        }
+        else
+        {
+            /* keep the last good value and when it was read */
+            pBack->Value[i] = pFront->Value[i];
+            pBack->Time_us[i] = pFront->Time_us[i];
+            if (pRec->Channel[i].CardNb != 0)
+                ReadErrors++;
+        }
+    }
+
+    pBack->Stats.Cycle = pRec->Cycle;
+    pBack->Stats.Valid = pRec->Valid;
+    pBack->Stats.Time_us = Now;
+    pBack->Stats.Snapshots = BlkSeq + 1;
+    pBack->Stats.ReadErrors = ReadErrors;
+    pBack->Stats.RecRecords = m1stream_RecRecords;
+    pBack->Stats.RecDropped = m1stream_RecDropped;
+    pBack->Stats.CmdReceived = m1stream_CmdReceived;
+}
+
+/**
+********************************************************************************
+* @brief Publishes the snapshot of Blk_Update(). Control task only, at the
+*        cycle end.
+*******************************************************************************/
+VOID Blk_Swap(VOID)
+{
+    /* the snapshot must be complete before a reader can see it */
+    __sync_synchronize();
+    BlkSeq++;
+}
+
+/**
+********************************************************************************
+* @brief Copies the front snapshot to m1stream_Blk before an SVI read of any
+*        of its blocks. Called by the SVI server.
+*
+* @param[in]  pVar       SVI variable, not used
+* @param[in]  UserParam  not used
+* @param[out] N/A
+*
+* @retval     = 0 .. OK
+*******************************************************************************/
+SINT32 Blk_SviStart(SVI_VAR * pVar, UINT32 UserParam)
+{
+    UINT32  Seq;
+
+    do
+    {
+        Seq = BlkSeq;
+        __sync_synchronize();
+        memcpy(&m1stream_Blk, &Buffer[Seq & 1], sizeof(m1stream_Blk));
+        /* the copy must be done before the counter is checked */
+        __sync_synchronize();
+    } while (BlkSeq != Seq);
+
+    return (OK);
+}
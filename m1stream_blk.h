@@ -0,0 +1,53 @@
+/**
+********************************************************************************
+* @file     m1stream_blk.h
+*
+* @brief    Export of the channel values as SVI block variables, for other
+*           modules and the SCADA, without going through the websocket.
+*           The control task fills in one snapshot per cycle and publishes
+*           it at the cycle end. An SVI read (SVI_PROC_GETBLK and
+*           SVI_PROC_GETMULTIBLK alike) gets a copy of the snapshot
+*           published last, so all values of a block are from one cycle.
+*           Separate blocks may be from different cycles, even if read with
+*           one SVI_PROC_GETMULTIBLK; "Snapshot" holds all of them.
+*
+*******************************************************************************/
+
+/* Avoid problems with multiple including */
+#ifndef M1STREAM_BLK__H
+#define M1STREAM_BLK__H
+
+/*--- Structures ---*/
+
+/* Statistics of the stream, all values as of the cycle of the snapshot */
+typedef struct BLK_STATS
+{
+    UINT32  Cycle;                      /* cycle counter of the control task */
+    UINT32  Valid;                      /* bit n set: channel n was read successfully */
+    UINT32  Time_us;                    /* time of the cycle, m_GetProcTime() */
+    UINT32  Snapshots;                  /* snapshots published since module start */
+    UINT32  ReadErrors;                 /* channel reads which failed */
+    UINT32  RecRecords;                 /* records written by the recorder */
+    UINT32  RecDropped;                 /* records lost by the recorder */
+    UINT32  CmdReceived;                /* commands of the clients */
+} BLK_STATS;
+
+/* Everything exported, as one block */
+typedef struct BLK_SNAPSHOT
+{
+    SINT32  Value[REC_CHANNELS];        /* last value of each channel */
+    UINT32  Time_us[REC_CHANNELS];      /* time of the last successful read */
+    BLK_STATS Stats;
+} BLK_SNAPSHOT;
+
+/*--- Variable definitions ---*/
+
+EXTERN BLK_SNAPSHOT m1stream_Blk;       /* exported by SVI, see Blk_SviStart() */
+
+/*--- Function prototyping ---*/
+
+EXTERN VOID Blk_Update(const REC_RECORD * pRec);
+EXTERN VOID Blk_Swap(VOID);
+EXTERN SINT32 Blk_SviStart(SVI_VAR * pVar, UINT32 UserParam);
+
+#endif /* Avoid problems with multiple include */
@@ -0,0 +1,180 @@
+/**
+********************************************************************************
+* @file     m1stream_cmd.c
+*
+* @brief    Commands of the websocket clients, see m1stream_cmd.h.
+*           Every client has its own thread, so the queue has many
+*           producers and one consumer. A producer reserves a slot by
+*           moving the head with compare and swap, and publishes it through
+*           the sequence number of the slot. The consumer takes a slot only
+*           after it has been published, and hands it back to the producers
+*           by moving its sequence number one lap ahead. Nobody ever waits
+*           for a lock, and a full queue drops the command.
+*
+*******************************************************************************/
+
+/* VxWorks includes */
+#include <vxWorks.h>
+#include <string.h>
+
+/* MSys includes */
+#include <mtypes.h>
+
+/* Project includes */
+#include "m1stream.h"
+#include "m1stream_int.h"
+#include "m1stream_cmd.h"
+
+/* One slot of the queue */
+typedef struct CMD_SLOT
+{
+    volatile UINT32 Seq;                /* = position: free, = position + 1: published */
+    CMD_COMMAND Cmd;
+} CMD_SLOT;
+
+/* Global variables: statistics, exported by SVI */
+UINT32  m1stream_CmdReceived = 0;
+UINT32  m1stream_CmdRejected = 0;
+UINT32  m1stream_CmdDropped = 0;
+
+/* Queue between the client threads and the control task */
+MLOCAL CMD_SLOT Queue[CMD_QUEUE_LEN];
+MLOCAL volatile UINT32 QueueHead = 0;   /* moved by the client threads */
+MLOCAL UINT32 QueueTail = 0;            /* moved by the control task */
+
+/**
+********************************************************************************
+* @brief Empties the queue. Called before the server is started.
+*******************************************************************************/
+VOID Cmd_Init(VOID)
+{
+    UINT32  i;
+
+    for (i = 0; i < CMD_QUEUE_LEN; i++)
+        Queue[i].Seq = i;
+    QueueHead = QueueTail = 0;
+}
+
+/**
+********************************************************************************
+* @brief Checks a binary message and fills in the command, without copying
+*        or allocating anything.
+*
+* @param[in]  data    payload of the message
+* @param[in]  len     length of the payload
+* @param[out] pCmd    command
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. no valid command
+*******************************************************************************/
+MLOCAL SINT32 Cmd_Parse(const char * data, uint64_t len, CMD_COMMAND * pCmd)
+{
+    const UINT8 *p = (const UINT8 *) data;
+
+    if (len < 1)
+        return (ERROR);
+
+    memset(pCmd, 0, sizeof(*pCmd));
+    pCmd->Code = p[0];
+
+    switch (pCmd->Code)
+    {
+        case CMD_START:
+        case CMD_STOP:
+        case CMD_RESET:
+            return len == 1 ? OK : ERROR;
+
+        case CMD_CALIBRATE:
+            if (len != 3 || p[1] > 1 || p[2] > 1)
+                return (ERROR);
+            pCmd->Side = p[1];
+            pCmd->End = p[2];
+            return (OK);
+
+        case CMD_RATE:
+            if (len != 3)
+                return (ERROR);
+            pCmd->Value = (p[1] << 8) | p[2];
+            return (OK);
+
+        default:
+            return (ERROR);
+    }
+}
+
+/**
+********************************************************************************
+* @brief Parses a binary message of a client and queues the command.
+*        Called by the client threads, see server_config.input.
+*
+* @param[in]  stream  stream of the client
+* @param[in]  data    payload of the message
+* @param[in]  len     length of the payload
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. no valid command, or the queue is full
+*******************************************************************************/
+int Cmd_Input(int stream, const char * data, uint64_t len)
+{
+    CMD_COMMAND Cmd;
+    CMD_SLOT *pSlot;
+    UINT32  Pos;
+
+    if (Cmd_Parse(data, len, &Cmd) < 0)
+    {
+        __sync_fetch_and_add(&m1stream_CmdRejected, 1);
+        return (ERROR);
+    }
+    Cmd.Stream = (UINT8) stream;
+
+    /* reserve a slot, another client may be faster */
+    Pos = QueueHead;
+    for (;;)
+    {
+        pSlot = &Queue[Pos & (CMD_QUEUE_LEN - 1)];
+        if ((SINT32) (pSlot->Seq - Pos) < 0)
+        {
+            /* not handed back by the control task yet: full */
+            __sync_fetch_and_add(&m1stream_CmdDropped, 1);
+            return (ERROR);
+        }
+        if (pSlot->Seq == Pos && __sync_bool_compare_and_swap(&QueueHead, Pos, Pos + 1))
+            break;
+        Pos = QueueHead;
+    }
+
+    pSlot->Cmd = Cmd;
+    /* the command must be complete before the control task can see it */
+    __sync_synchronize();
+    pSlot->Seq = Pos + 1;
+
+    __sync_fetch_and_add(&m1stream_CmdReceived, 1);
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Takes the oldest command from the queue. Control task only.
+*
+* @param[out] pCmd    command
+*
+* @retval     TRUE  .. pCmd is filled in
+* @retval     FALSE .. queue empty
+*******************************************************************************/
+BOOL Cmd_Get(CMD_COMMAND * pCmd)
+{
+    CMD_SLOT *pSlot = &Queue[QueueTail & (CMD_QUEUE_LEN - 1)];
+
+    /* reserved but not published yet counts as empty */
+    if (pSlot->Seq != QueueTail + 1)
+        return FALSE;
+    __sync_synchronize();
+
+    *pCmd = pSlot->Cmd;
+    /* the slot must be copied before a client reuses it */
+    __sync_synchronize();
+    pSlot->Seq = QueueTail + CMD_QUEUE_LEN;
+    QueueTail++;
+
+    return TRUE;
+}
@@ -0,0 +1,67 @@
+/**
+********************************************************************************
+* @file     m1stream_cmd.h
+*
+* @brief    Commands of the websocket clients, sent as binary messages.
+*           The client threads parse and queue them, the task feeding the
+*           clients takes them at its cycle start, so a command takes
+*           effect in the next cycle at the latest. A command is for the
+*           stream of the client which sent it.
+*
+*           Message:  Code (1 byte), followed by the parameters of the code,
+*                     multi-byte values in network byte order.
+*
+*               CMD_START       -                   start a new game
+*               CMD_STOP        -                   back to the channel values
+*               CMD_RESET       -                   new game, scores to 0
+*               CMD_CALIBRATE   Side (1), End (1)   current value of the
+*                                                   paddle channel of Side
+*                                                   (0=left, 1=right) is the
+*                                                   top (End 0) or the bottom
+*                                                   (End 1) of the field
+*               CMD_RATE        Rate (2)            frames per second sent to
+*                                                   the clients, 0 = all
+*
+*******************************************************************************/
+
+/* Avoid problems with multiple including */
+#ifndef M1STREAM_CMD__H
+#define M1STREAM_CMD__H
+
+#include <stdint.h>
+
+/*--- Defines ---*/
+
+#define CMD_START           0x01
+#define CMD_STOP            0x02
+#define CMD_RESET           0x03
+#define CMD_CALIBRATE       0x04
+#define CMD_RATE            0x05
+
+#define CMD_QUEUE_LEN       64          /* commands between the clients and the control task, power of 2 */
+
+/*--- Structures ---*/
+
+/* A parsed command */
+typedef struct CMD_COMMAND
+{
+    UINT8   Code;                       /* CMD_xxx */
+    UINT8   Side;                       /* CMD_CALIBRATE: GAME_LEFT, GAME_RIGHT */
+    UINT8   End;                        /* CMD_CALIBRATE: 0 = top, 1 = bottom */
+    UINT8   Stream;                     /* of the client which sent it */
+    UINT32  Value;                      /* CMD_RATE: frames per second */
+} CMD_COMMAND;
+
+/*--- Variable definitions ---*/
+
+EXTERN UINT32 m1stream_CmdReceived;     /* commands queued */
+EXTERN UINT32 m1stream_CmdRejected;     /* messages which were no valid command */
+EXTERN UINT32 m1stream_CmdDropped;      /* commands lost because the queue was full */
+
+/*--- Function prototyping ---*/
+
+EXTERN VOID Cmd_Init(VOID);
+EXTERN int Cmd_Input(int stream, const char * data, uint64_t len);
+EXTERN BOOL Cmd_Get(CMD_COMMAND * pCmd);
+
+#endif /* Avoid problems with multiple include */
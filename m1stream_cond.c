@@ -0,0 +1,290 @@
+/**
+********************************************************************************
+* @file     m1stream_cond.c
+*
+* @brief    Signal conditioning of the channel values, see m1stream_cond.h.
+*           Cond_Set() and Cond_Run() are called by the control task only.
+*           The kernel has no branches on the settings of a channel: the
+*           median of 3 and of 5 are both worked out by min/max networks
+*           and the one of the channel is selected, a channel without
+*           low-pass has the coefficient 1. The calibration adds up the
+*           part of the input within each segment times its slope, so it
+*           needs only min/max too; a channel without calibration has a
+*           segment of slope 1 below and above 0, up to COND_LIMIT, so the
+*           output is always within SINT32.
+*
+*******************************************************************************/
+
+/* VxWorks includes */
+#include <vxWorks.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* MSys includes */
+#include <mtypes.h>
+#include <msys_e.h>
+#include <log_e.h>
+
+/* Project includes */
+#include "m1stream.h"
+#include "m1stream_int.h"
+#include "m1stream_rec.h"
+#include "m1stream_cond.h"
+
+#define COND_LIMIT          2147483520.0f   /* largest float below 2^31 */
+
+#define COND_MIN(a, b)      ((a) < (b) ? (a) : (b))
+#define COND_MAX(a, b)      ((a) > (b) ? (a) : (b))
+#define COND_MED3(a, b, c)  COND_MAX(COND_MIN(a, b), COND_MIN(COND_MAX(a, b), c))
+
+/* State of all channels, one array per item */
+typedef struct COND_STATE
+{
+    SINT32  Hist[COND_MEDIAN][COND_CHANNELS];   /* last inputs, Hist[Pos] is the newest */
+    float   Y[COND_CHANNELS];                   /* output of the low-pass */
+    SINT32  Median[COND_CHANNELS];
+    float   Alpha[COND_CHANNELS];               /* low-pass coefficient, 1 = off */
+    float   Base[COND_CHANNELS];                    /* output at the start of the first segment */
+    float   SegStart[COND_POINTS - 1][COND_CHANNELS];   /* input range of each segment */
+    float   SegEnd[COND_POINTS - 1][COND_CHANNELS];
+    float   SegRef[COND_POINTS - 1][COND_CHANNELS];     /* input of Base, usually SegStart */
+    float   Slope[COND_POINTS - 1][COND_CHANNELS];
+    SINT32  Pass[COND_CHANNELS];                /* -1: not conditioned, 0: conditioned */
+    UINT32  Pos;
+    BOOL    Primed;                             /* Hist and Y hold values */
+} COND_STATE;
+
+MLOCAL COND_STATE Cond;
+MLOCAL BOOL CondInit = FALSE;
+
+/**
+********************************************************************************
+* @brief Sets all channels to pass unchanged.
+*******************************************************************************/
+MLOCAL VOID Cond_Init(VOID)
+{
+    UINT32  i;
+
+    memset(&Cond, 0, sizeof(Cond));
+    for (i = 0; i < COND_CHANNELS; i++)
+    {
+        Cond.Median[i] = 1;
+        Cond.Alpha[i] = 1.0f;
+        Cond.SegStart[0][i] = -COND_LIMIT;
+        Cond.Slope[0][i] = 1.0f;
+        Cond.SegEnd[1][i] = COND_LIMIT;
+        Cond.Slope[1][i] = 1.0f;
+        Cond.Pass[i] = -1;
+    }
+    CondInit = TRUE;
+}
+
+/**
+********************************************************************************
+* @brief Reads a list of numbers, separated by commas, e.g. "0, 1200, 32767".
+*
+* @param[in]  pList   list, may be empty
+* @param[out] pValue  numbers read
+* @param[in]  Max     size of pValue
+*
+* @retval     numbers read, Max + 1 if there are more
+*******************************************************************************/
+UINT32 Cond_ParseList(const CHAR * pList, SINT32 * pValue, UINT32 Max)
+{
+    UINT32  Count = 0;
+    CHAR   *pEnd;
+    long    Value;
+
+    while (*pList)
+    {
+        Value = strtol(pList, &pEnd, 0);
+        if (pEnd == pList)
+            break;
+        if (Count == Max)
+            return Max + 1;
+        pValue[Count++] = (SINT32) Value;
+
+        pList = pEnd;
+        while (*pList == ' ' || *pList == ',')
+            pList++;
+    }
+
+    return Count;
+}
+
+/**
+********************************************************************************
+* @brief Sets the conditioning of a channel. The filters of all channels
+*        start again with the next value.
+*
+* @param[in]  Channel       0 .. COND_CHANNELS-1
+* @param[in]  pCfg          settings
+* @param[in]  CycleTime_us  cycle time of the control task, for the low-pass
+* @param[out] N/A
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. ERROR, invalid settings, the channel is left unchanged
+*******************************************************************************/
+SINT32 Cond_Set(UINT32 Channel, const COND_CONFIG * pCfg, UINT32 CycleTime_us)
+{
+    CHAR    Func[] = "Cond_Set";
+    UINT32  k;
+    float   Slope;
+
+    if (!CondInit)
+        Cond_Init();
+
+    if (Channel >= COND_CHANNELS || (pCfg->Median != 1 && pCfg->Median != 3 && pCfg->Median != 5) ||
+        pCfg->TimeConstant_us < 0 || pCfg->Points == 1 || pCfg->Points > COND_POINTS)
+    {
+        LOG_E(0, Func, "Invalid conditioning of channel %u", Channel);
+        return (ERROR);
+    }
+    for (k = 1; k < pCfg->Points; k++)
+    {
+        if (pCfg->In[k] <= pCfg->In[k - 1])
+        {
+            LOG_E(0, Func, "Calibration points of channel %u must be ascending", Channel);
+            return (ERROR);
+        }
+    }
+    for (k = 0; k < pCfg->Points; k++)
+    {
+        /* the output must stay within SINT32 after rounding */
+        if ((float) pCfg->Out[k] > COND_LIMIT || (float) pCfg->Out[k] < -COND_LIMIT)
+        {
+            LOG_E(0, Func, "Calibrated values of channel %u must be within +-%.0f", Channel, COND_LIMIT);
+            return (ERROR);
+        }
+    }
+
+    Cond.Median[Channel] = pCfg->Median;
+    Cond.Alpha[Channel] = (float) CycleTime_us / (float) (CycleTime_us + pCfg->TimeConstant_us);
+
+    /* unused segments add nothing */
+    for (k = 0; k < COND_POINTS - 1; k++)
+    {
+        Cond.SegStart[k][Channel] = 0.0f;
+        Cond.SegEnd[k][Channel] = 0.0f;
+        Cond.SegRef[k][Channel] = 0.0f;
+        Cond.Slope[k][Channel] = 0.0f;
+    }
+    Cond.Base[Channel] = 0.0f;
+    if (pCfg->Points == 0)
+    {
+        /* the input itself, without the loss of adding up from -COND_LIMIT */
+        Cond.SegStart[0][Channel] = -COND_LIMIT;
+        Cond.Slope[0][Channel] = 1.0f;
+        Cond.SegEnd[1][Channel] = COND_LIMIT;
+        Cond.Slope[1][Channel] = 1.0f;
+    }
+    else
+    {
+        Cond.Base[Channel] = (float) pCfg->Out[0];
+        for (k = 0; k < pCfg->Points - 1; k++)
+        {
+            Slope = ((float) pCfg->Out[k + 1] - (float) pCfg->Out[k]) /
+                    ((float) pCfg->In[k + 1] - (float) pCfg->In[k]);
+            Cond.SegStart[k][Channel] = (float) pCfg->In[k];
+            Cond.SegEnd[k][Channel] = (float) pCfg->In[k + 1];
+            Cond.SegRef[k][Channel] = (float) pCfg->In[k];
+            Cond.Slope[k][Channel] = Slope;
+        }
+    }
+
+    Cond.Pass[Channel] = (pCfg->Median == 1 && pCfg->TimeConstant_us == 0 && pCfg->Points == 0) ? -1 : 0;
+    Cond.Primed = FALSE;
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Lets the filters start again with the next value, e.g. after the
+*        channels were not read for a while.
+*******************************************************************************/
+VOID Cond_Reset(VOID)
+{
+    Cond.Primed = FALSE;
+}
+
+/**
+********************************************************************************
+* @brief Conditions the values of one cycle. A channel which could not be
+*        read should get its last raw value again.
+*
+* @param[in]  pValue    raw value of each channel
+* @param[out] pValue    conditioned value of each channel
+* @param[in]  Channels  channels in pValue, at most COND_CHANNELS
+*
+* @retval     N/A
+*******************************************************************************/
+VOID Cond_Run(SINT32 * pValue, UINT32 Channels)
+{
+    const SINT32 *pH0, *pH1, *pH2, *pH3, *pH4;
+    SINT32  Med[COND_CHANNELS];
+    float   Out[COND_CHANNELS];
+    UINT32  i, k;
+
+    if (!CondInit)
+        Cond_Init();
+    if (Channels > COND_CHANNELS)
+        Channels = COND_CHANNELS;
+
+    /* the first values fill the history, so that the filters start there */
+    if (!Cond.Primed)
+    {
+        for (k = 0; k < COND_MEDIAN; k++)
+            memcpy(Cond.Hist[k], pValue, Channels * sizeof(SINT32));
+        for (i = 0; i < Channels; i++)
+            Cond.Y[i] = (float) pValue[i];
+        Cond.Primed = TRUE;
+    }
+
+    Cond.Pos = Cond.Pos == COND_MEDIAN - 1 ? 0 : Cond.Pos + 1;
+    memcpy(Cond.Hist[Cond.Pos], pValue, Channels * sizeof(SINT32));
+
+    /* newest to oldest */
+    pH0 = Cond.Hist[Cond.Pos];
+    pH1 = Cond.Hist[(Cond.Pos + 4) % COND_MEDIAN];
+    pH2 = Cond.Hist[(Cond.Pos + 3) % COND_MEDIAN];
+    pH3 = Cond.Hist[(Cond.Pos + 2) % COND_MEDIAN];
+    pH4 = Cond.Hist[(Cond.Pos + 1) % COND_MEDIAN];
+
+    /* median */
+    for (i = 0; i < Channels; i++)
+    {
+        SINT32  a = pH0[i], b = pH1[i], c = pH2[i], d = pH3[i], e = pH4[i];
+        SINT32  m3 = COND_MED3(a, b, c);
+        SINT32  m5 = COND_MED3(e, COND_MAX(COND_MIN(a, b), COND_MIN(c, d)), COND_MIN(COND_MAX(a, b), COND_MAX(c, d)));
+
+        Med[i] = Cond.Median[i] == 5 ? m5 : (Cond.Median[i] == 3 ? m3 : a);
+    }
+
+    /* low-pass */
+    for (i = 0; i < Channels; i++)
+    {
+        Cond.Y[i] += Cond.Alpha[i] * ((float) Med[i] - Cond.Y[i]);
+        Out[i] = Cond.Base[i];
+    }
+
+    /* calibration, the part of the input within each segment */
+    for (k = 0; k < COND_POINTS - 1; k++)
+    {
+        for (i = 0; i < Channels; i++)
+        {
+            float   x = Cond.Y[i] < Cond.SegStart[k][i] ? Cond.SegStart[k][i] : Cond.Y[i];
+
+            x = x > Cond.SegEnd[k][i] ? Cond.SegEnd[k][i] : x;
+            Out[i] += Cond.Slope[k][i] * (x - Cond.SegRef[k][i]);
+        }
+    }
+
+    /* rounded, channels without conditioning exactly as read */
+    for (i = 0; i < Channels; i++)
+    {
+        SINT32  r = (SINT32) (Out[i] + __builtin_copysignf(0.5f, Out[i]));
+
+        pValue[i] = (pH0[i] & Cond.Pass[i]) | (r & ~Cond.Pass[i]);
+    }
+}
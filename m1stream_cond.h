@@ -0,0 +1,52 @@
+/**
+********************************************************************************
+* @file     m1stream_cond.h
+*
+* @brief    Signal conditioning of the channel values in the control task,
+*           before they are sent, recorded or move the paddles. Per channel,
+*           as set in its (PaddleConfig$) group:
+*           - median of the last 1, 3 or 5 values, removes single spikes
+*           - first order low-pass with the given time constant
+*           - piecewise linear calibration through up to COND_POINTS points,
+*             e.g. from the raw counts to the paddle position 0 .. 32767
+*           A channel without any of them passes unchanged. The filters
+*           work in float, so values beyond 2^24 lose their lowest bits.
+*
+*           All channels are done together, each step as one loop over
+*           arrays of the channels (structure of arrays), which a compiler
+*           can vectorize.
+*
+*******************************************************************************/
+
+/* Avoid problems with multiple including */
+#ifndef M1STREAM_COND__H
+#define M1STREAM_COND__H
+
+/*--- Defines ---*/
+
+#ifndef COND_CHANNELS
+#define COND_CHANNELS       REC_CHANNELS    /* channels of the kernel, the benchmark uses more */
+#endif
+#define COND_MEDIAN         5               /* longest median */
+#define COND_POINTS         8               /* calibration points per channel */
+
+/*--- Structures ---*/
+
+/* Settings of one channel */
+typedef struct COND_CONFIG
+{
+    SINT32  Median;                     /* values of the median: 1 (= off), 3 or 5 */
+    SINT32  TimeConstant_us;            /* of the low-pass, 0 = off */
+    UINT32  Points;                     /* calibration points, 0 = off */
+    SINT32  In[COND_POINTS];            /* raw values, ascending */
+    SINT32  Out[COND_POINTS];           /* calibrated values */
+} COND_CONFIG;
+
+/*--- Function prototyping ---*/
+
+EXTERN UINT32 Cond_ParseList(const CHAR * pList, SINT32 * pValue, UINT32 Max);
+EXTERN SINT32 Cond_Set(UINT32 Channel, const COND_CONFIG * pCfg, UINT32 CycleTime_us);
+EXTERN VOID Cond_Reset(VOID);
+EXTERN VOID Cond_Run(SINT32 * pValue, UINT32 Channels);
+
+#endif /* Avoid problems with multiple include */
@@ -31,14 +31,87 @@
 */
 #define M_ES_M1STREAM  0x04000000
 
+/* Channels of a sample, same as in the websocket stream */
+#define M1STREAM_CHANNELS       16
 
+/* Readers which can be attached to the sample ring at the same time */
+#define M1STREAM_SHM_READERS    8
 
 
 /*--- Structures ---*/
 
+/*
+ * Sample ring for modules on the same CPU.
+ * The control task of m1stream writes one sample per cycle into the ring,
+ * a reader takes them from there without any socket or copy in between.
+ * Nobody waits: the control task overwrites the oldest sample in any case,
+ * a reader which falls behind by more than the ring length loses samples
+ * and is told so.
+ *
+ * Protocol, for a reader working on the ring directly:
+ * - Head is the number of samples written. Sample n is in
+ *   pSlot[n & (Len - 1)] and complete when its Seq is n + 1.
+ * - Read Head, then Seq, then the sample, then Seq again. The sample is
+ *   valid if both Seq are n + 1; otherwise it was being overwritten.
+ * - All read accesses must be ordered by memory barriers on PowerPC.
+ * m1stream_ShmRead() and m1stream_ShmPeek()/m1stream_ShmDone() do this.
+ */
+
+/* One channel of a sample */
+typedef struct M1STREAM_CHANNEL
+{
+    UINT16  CardNb;                     /* card number, 0: channel not configured */
+    UINT16  Chan;                       /* channel number on the card */
+    SINT32  Value;                      /* value read in this cycle */
+} M1STREAM_CHANNEL;
+
+/* Values of one control cycle */
+typedef struct M1STREAM_SAMPLE
+{
+    UINT32  Cycle;                      /* cycle counter of the control task */
+    UINT32  Valid;                      /* bit n set: Channel[n] was read successfully */
+    UINT32  Time_us;                    /* time of the cycle, m_GetProcTime() */
+    UINT32  Spare;
+    M1STREAM_CHANNEL Channel[M1STREAM_CHANNELS];
+} M1STREAM_SAMPLE;
+
+/* Slot of the ring */
+typedef struct M1STREAM_SLOT
+{
+    volatile UINT32 Seq;                /* n + 1 when sample n is complete */
+    UINT32  Spare;
+    M1STREAM_SAMPLE Sample;
+} M1STREAM_SLOT;
+
+/* The ring, valid from attach until the module m1stream ends */
+typedef struct M1STREAM_RING
+{
+    UINT32  Len;                        /* slots, power of 2 */
+    UINT32  CycleTime_us;               /* cycle time of the control task */
+    volatile UINT32 Head;               /* samples written */
+    UINT32  Spare;
+    M1STREAM_SLOT *pSlot;
+} M1STREAM_RING;
+
+/* Read cursor, owned by the reader */
+typedef struct M1STREAM_READER
+{
+    const M1STREAM_RING *pRing;         /* set by m1stream_ShmAttach() */
+    UINT32  Cursor;                     /* number of the next sample */
+    UINT32  Lost;                       /* samples lost by overruns */
+    UINT32  Overruns;                   /* overruns reported */
+    SINT32  Id;                         /* registration, 0 .. M1STREAM_SHM_READERS-1 */
+} M1STREAM_READER;
+
 
 /*--- Function prototypes ---*/
 
+EXTERN SINT32 m1stream_ShmAttach(M1STREAM_READER * pReader);
+EXTERN VOID m1stream_ShmDetach(M1STREAM_READER * pReader);
+EXTERN SINT32 m1stream_ShmRead(M1STREAM_READER * pReader, M1STREAM_SAMPLE * pSample);
+EXTERN SINT32 m1stream_ShmPeek(M1STREAM_READER * pReader, const M1STREAM_SAMPLE ** ppSample);
+EXTERN SINT32 m1stream_ShmDone(M1STREAM_READER * pReader);
+
 
 /*--- Variable definitions ---*/
 
@@ -0,0 +1,213 @@
+/**
+********************************************************************************
+* @file     m1stream_game.c
+*
+* @brief    Server side Pong game, see m1stream_game.h.
+*           The functions only work on the state they are given, they are
+*           called by the task feeding the websocket clients.
+*
+*******************************************************************************/
+
+/* VxWorks includes */
+#include <vxWorks.h>
+#include <stdio.h>
+#include <string.h>
+
+/* MSys includes */
+#include <mtypes.h>
+
+/* Project includes */
+#include "m1stream.h"
+#include "m1stream_int.h"
+#include "m1stream_game.h"
+
+/* Global variables: settings */
+GAME_CONFIG m1stream_GameCfg = {
+    0,                                  /* Enable */
+    0,                                  /* LeftPaddle */
+    1,                                  /* RightPaddle */
+    0,                                  /* InputMin */
+    32767                               /* InputMax */
+};
+
+/**
+********************************************************************************
+* @brief Puts the ball into the middle and lets it start towards one side
+*        after GAME_SERVE_STEPS. The vertical speed is random, but only
+*        depends on the seed.
+*******************************************************************************/
+MLOCAL VOID Game_Serve(GAME_STATE * pGame, UINT32 Side)
+{
+    pGame->BallX = (GAME_WIDTH - GAME_BALL) / 2;
+    pGame->BallY = (GAME_HEIGHT - GAME_BALL) / 2;
+    pGame->BallVx = (Side == GAME_LEFT) ? -GAME_SPEED : GAME_SPEED;
+
+    /* linear congruential generator, same sequence on every CPU */
+    pGame->Seed = pGame->Seed * 1664525 + 1013904223;
+    pGame->BallVy = (SINT32) ((pGame->Seed >> 8) % (GAME_SPEED + 1)) - GAME_SPEED / 2;
+
+    pGame->ServeWait = GAME_SERVE_STEPS;
+}
+
+/**
+********************************************************************************
+* @brief Maps a channel value to the position of a paddle.
+*******************************************************************************/
+MLOCAL SINT32 Game_Paddle(const GAME_CONFIG * pCfg, SINT32 Value)
+{
+    SINT32  Y;
+
+    if (pCfg->InputMax == pCfg->InputMin)
+        return (GAME_HEIGHT - GAME_PADDLE_LEN) / 2;
+
+    Y = (SINT32) ((SINT64) (Value - pCfg->InputMin) * (GAME_HEIGHT - GAME_PADDLE_LEN) /
+                  (pCfg->InputMax - pCfg->InputMin));
+    if (Y < 0)
+        Y = 0;
+    if (Y > GAME_HEIGHT - GAME_PADDLE_LEN)
+        Y = GAME_HEIGHT - GAME_PADDLE_LEN;
+
+    return Y;
+}
+
+/**
+********************************************************************************
+* @brief Bounces the ball off the paddle at PaddleY: it gets faster, and the
+*        farther from the middle of the paddle it hit, the more vertical
+*        speed it gets.
+*******************************************************************************/
+MLOCAL VOID Game_Bounce(GAME_STATE * pGame, SINT32 PaddleY)
+{
+    SINT32  Offset;
+
+    /* -GAME_SPIN at the top end .. +GAME_SPIN at the bottom end */
+    Offset = (pGame->BallY + GAME_BALL / 2) - (PaddleY + GAME_PADDLE_LEN / 2);
+    pGame->BallVy += (SINT32) ((SINT64) Offset * GAME_SPIN / ((GAME_PADDLE_LEN + GAME_BALL) / 2));
+    if (pGame->BallVy > GAME_SPEED_MAX)
+        pGame->BallVy = GAME_SPEED_MAX;
+    if (pGame->BallVy < -GAME_SPEED_MAX)
+        pGame->BallVy = -GAME_SPEED_MAX;
+
+    pGame->BallVx = -(pGame->BallVx + pGame->BallVx / 16);
+    if (pGame->BallVx > GAME_SPEED_MAX)
+        pGame->BallVx = GAME_SPEED_MAX;
+    if (pGame->BallVx < -GAME_SPEED_MAX)
+        pGame->BallVx = -GAME_SPEED_MAX;
+}
+
+/**
+********************************************************************************
+* @brief Checks if the ball overlaps a paddle vertically.
+*******************************************************************************/
+MLOCAL BOOL Game_Hit(const GAME_STATE * pGame, SINT32 PaddleY)
+{
+    return pGame->BallY + GAME_BALL >= PaddleY && pGame->BallY <= PaddleY + GAME_PADDLE_LEN;
+}
+
+/**
+********************************************************************************
+* @brief Starts a new game.
+*
+* @param[out] pGame   game state
+* @param[in]  Seed    start value of the serve directions
+*
+* @retval     N/A
+*******************************************************************************/
+VOID Game_Init(GAME_STATE * pGame, UINT32 Seed)
+{
+    memset(pGame, 0, sizeof(*pGame));
+    pGame->Seed = Seed;
+    pGame->PaddleY[GAME_LEFT] = pGame->PaddleY[GAME_RIGHT] = (GAME_HEIGHT - GAME_PADDLE_LEN) / 2;
+    Game_Serve(pGame, (Seed & 1) ? GAME_RIGHT : GAME_LEFT);
+}
+
+/**
+********************************************************************************
+* @brief Advances the game by GAME_STEP_US.
+*
+* @param[in,out] pGame  game state
+* @param[in]  pCfg      input range of the paddle channels
+* @param[in]  Left      value of the left paddle channel
+* @param[in]  Right     value of the right paddle channel
+*
+* @retval     N/A
+*******************************************************************************/
+VOID Game_Step(GAME_STATE * pGame, const GAME_CONFIG * pCfg, SINT32 Left, SINT32 Right)
+{
+    SINT32  LeftFace = GAME_PADDLE_X;
+    SINT32  RightFace = GAME_WIDTH - GAME_PADDLE_X - GAME_BALL;
+
+    pGame->Step++;
+    pGame->PaddleY[GAME_LEFT] = Game_Paddle(pCfg, Left);
+    pGame->PaddleY[GAME_RIGHT] = Game_Paddle(pCfg, Right);
+
+    if (pGame->ServeWait)
+    {
+        pGame->ServeWait--;
+        return;
+    }
+
+    pGame->BallX += pGame->BallVx;
+    pGame->BallY += pGame->BallVy;
+
+    /* top and bottom wall */
+    if (pGame->BallY < 0)
+    {
+        pGame->BallY = -pGame->BallY;
+        pGame->BallVy = -pGame->BallVy;
+    }
+    else if (pGame->BallY > GAME_HEIGHT - GAME_BALL)
+    {
+        pGame->BallY = 2 * (GAME_HEIGHT - GAME_BALL) - pGame->BallY;
+        pGame->BallVy = -pGame->BallVy;
+    }
+
+    /* paddles, only when the ball crossed the face in this step */
+    if (pGame->BallVx < 0 && pGame->BallX < LeftFace && pGame->BallX - pGame->BallVx >= LeftFace &&
+        Game_Hit(pGame, pGame->PaddleY[GAME_LEFT]))
+    {
+        pGame->BallX = 2 * LeftFace - pGame->BallX;
+        Game_Bounce(pGame, pGame->PaddleY[GAME_LEFT]);
+    }
+    else if (pGame->BallVx > 0 && pGame->BallX > RightFace && pGame->BallX - pGame->BallVx <= RightFace &&
+             Game_Hit(pGame, pGame->PaddleY[GAME_RIGHT]))
+    {
+        pGame->BallX = 2 * RightFace - pGame->BallX;
+        Game_Bounce(pGame, pGame->PaddleY[GAME_RIGHT]);
+    }
+
+    /* out, the side which missed gets the next serve */
+    if (pGame->BallX + GAME_BALL < 0)
+    {
+        pGame->Score[GAME_RIGHT]++;
+        Game_Serve(pGame, GAME_LEFT);
+    }
+    else if (pGame->BallX > GAME_WIDTH)
+    {
+        pGame->Score[GAME_LEFT]++;
+        Game_Serve(pGame, GAME_RIGHT);
+    }
+}
+
+/**
+********************************************************************************
+* @brief Builds the JSON frame of the game state, in whole units of the field:
+*        {"Game":[Step,BallX,BallY,LeftPaddleY,RightPaddleY,LeftScore,RightScore]}
+*
+* @param[in]  pGame   game state
+* @param[out] buffer  JSON text, zero terminated
+* @param[in]  size    size of buffer
+*
+* @retval     length of the JSON text
+*******************************************************************************/
+int Game_Format(const GAME_STATE * pGame, char * buffer, int size)
+{
+    int     len;
+
+    len = snprintf(buffer, size, "{\"Game\":[%u,%d,%d,%d,%d,%u,%u]}", pGame->Step,
+                   pGame->BallX >> GAME_FRAC, pGame->BallY >> GAME_FRAC,
+                   pGame->PaddleY[GAME_LEFT] >> GAME_FRAC, pGame->PaddleY[GAME_RIGHT] >> GAME_FRAC,
+                   pGame->Score[GAME_LEFT], pGame->Score[GAME_RIGHT]);
+
+    return (len < size) ? len : size - 1;
+}
@@ -0,0 +1,73 @@
+/**
+********************************************************************************
+* @file     m1stream_game.h
+*
+* @brief    Server side Pong game, driven by two paddle channels.
+*           All coordinates are fixed point numbers with GAME_FRAC fractional
+*           bits, there is no floating point and no memory allocation.
+*           Game_Step() only depends on the state and the inputs, so the
+*           same inputs always give the same game, e.g. in a replay.
+*
+*           Field: x = 0 .. GAME_WIDTH from left to right,
+*                  y = 0 .. GAME_HEIGHT from top to bottom.
+*           The ball position is its top left corner, a paddle position
+*           is its top end.
+*
+*******************************************************************************/
+
+/* Avoid problems with multiple including */
+#ifndef M1STREAM_GAME__H
+#define M1STREAM_GAME__H
+
+/*--- Defines ---*/
+
+#define GAME_FRAC           16                          /* fractional bits */
+#define GAME_ONE            (1 << GAME_FRAC)            /* 1 unit of the field */
+#define GAME_WIDTH          (640 * GAME_ONE)
+#define GAME_HEIGHT         (480 * GAME_ONE)
+#define GAME_BALL           (8 * GAME_ONE)              /* size of the ball */
+#define GAME_PADDLE_LEN     (80 * GAME_ONE)             /* length of a paddle */
+#define GAME_PADDLE_X       (30 * GAME_ONE)             /* paddle face to the wall behind it */
+#define GAME_STEP_US        1000                        /* simulated time of one step */
+#define GAME_SPEED          (GAME_ONE * 300 / 1000)     /* serve: 300 units/s */
+#define GAME_SPEED_MAX      (GAME_ONE * 900 / 1000)     /* 900 units/s */
+#define GAME_SPIN           (GAME_ONE * 200 / 1000)     /* added at the paddle end */
+#define GAME_SERVE_STEPS    1000                        /* pause before a serve */
+#define GAME_LEFT           0
+#define GAME_RIGHT          1
+
+/*--- Structures ---*/
+
+/* Settings from (Game) in mconfig */
+typedef struct GAME_CONFIG
+{
+    SINT32  Enable;                     /* broadcast the game instead of the channels */
+    SINT32  LeftPaddle;                 /* position of the left paddle channel in (PaddleConfig) */
+    SINT32  RightPaddle;                /* position of the right paddle channel */
+    SINT32  InputMin;                   /* channel value at the top end of the field */
+    SINT32  InputMax;                   /* channel value at the bottom end */
+} GAME_CONFIG;
+
+/* State of the game */
+typedef struct GAME_STATE
+{
+    UINT32  Step;                       /* steps since Game_Init */
+    SINT32  BallX, BallY;
+    SINT32  BallVx, BallVy;             /* per step */
+    SINT32  PaddleY[2];
+    UINT32  Score[2];
+    UINT32  ServeWait;                  /* steps until the next serve */
+    UINT32  Seed;                       /* of the serve directions */
+} GAME_STATE;
+
+/*--- Variable definitions ---*/
+
+EXTERN GAME_CONFIG m1stream_GameCfg;
+
+/*--- Function prototyping ---*/
+
+EXTERN VOID Game_Init(GAME_STATE * pGame, UINT32 Seed);
+EXTERN VOID Game_Step(GAME_STATE * pGame, const GAME_CONFIG * pCfg, SINT32 Left, SINT32 Right);
+EXTERN int Game_Format(const GAME_STATE * pGame, char * buffer, int size);
+
+#endif /* Avoid problems with multiple include */
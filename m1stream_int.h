@@ -108,6 +108,7 @@ EXTERN UINT32 m1stream_SviHandle;
 /* Functions: system global, defined in m1stream_app.c */
 EXTERN SINT32 m1stream_AppEOI(VOID);
 EXTERN VOID m1stream_AppDeinit(VOID);
+EXTERN SINT32 m1stream_AppNewCfg(VOID);
 EXTERN SINT32 m1stream_CfgRead(VOID);
 EXTERN SINT32 m1stream_SviSrvInit(VOID);
 EXTERN VOID m1stream_SviSrvDeinit(VOID);
@@ -0,0 +1,97 @@
+/**
+********************************************************************************
+* @file     m1stream_lvc.c
+*
+* @brief    Last-value cache of the sample stream, see m1stream_lvc.h.
+*           The sequence counter of an entry is odd while an update of it
+*           is in progress.
+*           A reader copies the values and takes them only if the counter
+*           was even and unchanged over the copy.
+*
+*******************************************************************************/
+
+/* VxWorks includes */
+#include <vxWorks.h>
+#include <taskLib.h>
+#include <string.h>
+
+/* MSys includes */
+#include <mtypes.h>
+
+/* Project includes */
+#include "m1stream.h"
+#include "m1stream_int.h"
+#include "m1stream_rec.h"
+#include "m1stream_game.h"
+#include "m1stream_lvc.h"
+
+/* Values of one stream */
+typedef struct LVC_ENTRY
+{
+    volatile UINT32 Seq;                /* 2 * number of updates, odd during one */
+    REC_RECORD Record;
+    GAME_STATE Game;
+} LVC_ENTRY;
+
+MLOCAL LVC_ENTRY Lvc[LVC_STREAMS];
+
+/**
+********************************************************************************
+* @brief Stores the values of a cycle. Only the task feeding the clients
+*        may call this, there must never be two writers at a time.
+*
+* @param[in]  Stream  0 .. LVC_STREAMS-1
+* @param[in]  pRec    values of the cycle
+* @param[in]  pGame   game state of the stream after the cycle
+* @param[out] N/A
+*
+* @retval     N/A
+*******************************************************************************/
+VOID Lvc_Update(UINT32 Stream, const REC_RECORD * pRec, const GAME_STATE * pGame)
+{
+    LVC_ENTRY *pEntry = &Lvc[Stream];
+
+    pEntry->Seq++;
+    __sync_synchronize();
+
+    memcpy(&pEntry->Record, pRec, sizeof(pEntry->Record));
+    memcpy(&pEntry->Game, pGame, sizeof(pEntry->Game));
+
+    __sync_synchronize();
+    pEntry->Seq++;
+}
+
+/**
+********************************************************************************
+* @brief Returns a consistent copy of the values stored last.
+*        Never blocks the writer, the copy is repeated if an update
+*        came in between.
+*
+* @param[in]  Stream  0 .. LVC_STREAMS-1
+* @param[out] pRec    values of the cycle stored last
+* @param[out] pGame   game state stored last
+*
+* @retval     > 0 .. version of the values, increases with every update
+* @retval     = 0 .. nothing stored yet
+*******************************************************************************/
+UINT32 Lvc_Read(UINT32 Stream, REC_RECORD * pRec, GAME_STATE * pGame)
+{
+    LVC_ENTRY *pEntry = &Lvc[Stream];
+    UINT32  Seq;
+
+    do
+    {
+        /* wait for the end of an update in progress */
+        while ((Seq = pEntry->Seq) & 1)
+            taskDelay(0);
+        __sync_synchronize();
+
+        memcpy(pRec, &pEntry->Record, sizeof(pEntry->Record));
+        memcpy(pGame, &pEntry->Game, sizeof(pEntry->Game));
+
+        __sync_synchronize();
+    }
+    while (pEntry->Seq != Seq);
+
+    return Seq / 2;
+}
@@ -0,0 +1,28 @@
+/**
+********************************************************************************
+* @file     m1stream_lvc.h
+*
+* @brief    Last-value cache of the sample stream.
+*           Holds the values of the cycle sent last and the game state
+*           derived from them, so that a client can be served without
+*           waiting for the next cycle. One entry per stream of the module,
+*           each with its own game. The task feeding the
+*           clients is the only writer, readers of any task retry instead of
+*           blocking it (seqlock).
+*
+*******************************************************************************/
+
+/* Avoid problems with multiple including */
+#ifndef M1STREAM_LVC__H
+#define M1STREAM_LVC__H
+
+/*--- Defines ---*/
+
+#define LVC_STREAMS         8           /* entries, one per stream */
+
+/*--- Function prototyping ---*/
+
+EXTERN VOID Lvc_Update(UINT32 Stream, const REC_RECORD * pRec, const GAME_STATE * pGame);
+EXTERN UINT32 Lvc_Read(UINT32 Stream, REC_RECORD * pRec, GAME_STATE * pGame);
+
+#endif /* Avoid problems with multiple include */
@@ -47,6 +47,8 @@
 /* Project includes */
 #include "m1stream_e.h"
 #include "m1stream_int.h"
+#include "m1stream_stat.h"
+#include "ws/Log.h"
 
 /* Defines for SMI server task */
 #define SMI_SRV_PRIO        120         /* Priority (range 118 ... 127) */
@@ -85,6 +87,7 @@ MLOCAL VOID RpcDeinit(SMI_MSG * pMsg);
 MLOCAL VOID RpcSetDbg(SMI_MSG * pMsg);
 MLOCAL VOID RpcGetInfo(SMI_MSG * pMsg);
 MLOCAL VOID RpcEndOfInit(SMI_MSG * pMsg);
+MLOCAL VOID RpcAppStat(SMI_MSG * pMsg);
 MLOCAL VOID PanicHandler(UINT32 PanicMode);
 
 /* Function pointer for extended version of smi_receive and svi_MsgHandler */
@@ -117,6 +120,7 @@ SINT32 m1stream_Init(MOD_CONF * pConf, MOD_LOAD * pLoad)
 
     /* Copy profile content to module variables */
     m1stream_Debug = pConf->DebugMode;
+    ws_log_setLevel(m1stream_Debug);
     m1stream_CfgLine = pConf->LineNbr;
     m1stream_AppPrio = pConf->TskPrior;
     strncpy(m1stream_AppName, pConf->AppName, M_MODNAMELEN);
@@ -488,6 +492,12 @@ MLOCAL VOID bTaskMain(VOID)
                         fpSviMsgHandler(m1stream_SviHandle, &Msg, m1stream_pSmiId, UserSessionId);
                     break;
 
+                    /* Module specific calls */
+                case M1STREAM_PROC_APPSTAT:
+                    LOG_I(4, m1stream_AppName, "%s: received call M1STREAM_PROC_APPSTAT", Func);
+                    RpcAppStat(&Msg);
+                    break;
+
                     /* Not a standard SMI call */
                 default:
                     LOG_W(2, m1stream_AppName, "%s: received unknown call with SMI id %d", Func, Msg.ProcRetCode);
@@ -647,6 +657,10 @@ MLOCAL VOID RpcRun(SMI_MSG * pMsg)
 /**
 ********************************************************************************
 * @brief Reloads the module configuration.
+*        While the module runs, only the channels of the (PaddleConfig$)
+*        groups are read again and taken over between two cycles, the tasks
+*        and the clients stay. Otherwise the application is restarted with
+*        the whole new configuration.
 *
 * @param[in]  pMsg    SMI call
 * @param[out] N/A
@@ -659,8 +673,11 @@ MLOCAL VOID RpcNewCfg(SMI_MSG * pMsg)
     SINT32  ret;
 
     /* Test if module is in a valid state to take over a new configuration */
-    if (m1stream_ModState == RES_S_STOP || m1stream_ModState == RES_S_RUN ||
-        m1stream_ModState == RES_S_ERROR)
+    if (m1stream_ModState == RES_S_RUN)
+    {
+        Reply.RetCode = (m1stream_AppNewCfg() < 0) ? SMI_E_FAILED : SMI_E_OK;
+    }
+    else if (m1stream_ModState == RES_S_STOP || m1stream_ModState == RES_S_ERROR)
     {
         /* Remove application (if it is running) */
         m1stream_AppDeinit();
@@ -834,6 +851,7 @@ MLOCAL VOID RpcSetDbg(SMI_MSG * pMsg)
 
     /* Take over the new debug mode */
     m1stream_Debug = pCall->DebugMode;
+    ws_log_setLevel(m1stream_Debug);
     Reply.RetCode = SMI_E_OK;
 
     /* Send reply */
@@ -842,6 +860,45 @@ MLOCAL VOID RpcSetDbg(SMI_MSG * pMsg)
         LOG_E(0, "RpcSetDbg", "SMI SendCReply failed!");
 }
 
+/**
+********************************************************************************
+* @brief Handles the RPC-request M1STREAM_PROC_APPSTAT.
+*        The statistics are read from counters only, so this call can be
+*        made at any rate without disturbing the control task.
+*
+* @param[in]  pMsg    RPC-request
+* @param[out] N/A
+*
+* @retval     N/A
+*******************************************************************************/
+MLOCAL VOID RpcAppStat(SMI_MSG * pMsg)
+{
+    M1STREAM_APPSTAT_C *pCall = NULL;
+    M1STREAM_APPSTAT_R *pReply;
+
+    if (pMsg->DataLen >= sizeof(*pCall))
+        pCall = (M1STREAM_APPSTAT_C *) pMsg->Data;
+
+    /* Allocate memory for the answer */
+    pReply = smi_MemAlloc(sizeof(*pReply));
+    if (!pReply)
+    {
+        smi_FreeData(pMsg);
+        LOG_E(0, "RpcAppStat", "No memory!");
+        if (smi_SendReply(m1stream_pSmiId, pMsg, SMI_E_ARGS, 0, 0) < 0)
+            LOG_E(0, "RpcAppStat", "SendReply failed!");
+
+        return;
+    }
+
+    Stat_Fill(pCall, pReply);
+
+    /* Send reply */
+    smi_FreeData(pMsg);
+    if (smi_SendReply(m1stream_pSmiId, pMsg, SMI_E_OK, pReply, sizeof(*pReply)) < 0)
+        LOG_E(0, "RpcAppStat", "SMI SendReply failed!");
+}
+
 /**
 ********************************************************************************
 * @brief Handles the RPC-request SMI_PROC_GETINFO.
@@ -0,0 +1,511 @@
+/**
+********************************************************************************
+* @file     m1stream_play.c
+*
+* @brief    Replay of a recorded session, see m1stream_play.h.
+*           All functions are called by the replay task only.
+*           Play_Open() looks up the segment files of the session and builds
+*           the sparse index, Play_Read() returns the records in order and
+*           reads the files in blocks of PLAY_BLOCK_RECORDS.
+*
+*******************************************************************************/
+
+/* VxWorks includes */
+#include <vxWorks.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+/* MSys includes */
+#include <mtypes.h>
+#include <msys_e.h>
+#include <log_e.h>
+
+/* Project includes */
+#include "m1stream.h"
+#include "m1stream_int.h"
+#include "m1stream_rec.h"
+#include "m1stream_play.h"
+
+#define PLAY_MAGIC_SWAPPED  0x4352314D  /* REC_MAGIC written by a CPU of the other byte order */
+
+/* One segment file of the session */
+typedef struct PLAY_SEGMENT
+{
+    UINT32  Number;                     /* <n> of the file name */
+    UINT32  Records;                    /* records in the file */
+} PLAY_SEGMENT;
+
+/* One entry of the sparse index */
+typedef struct PLAY_INDEX
+{
+    UINT32  Cycle;                      /* Cycle of the record */
+    UINT32  Segment;                    /* position in Segments[] */
+    UINT32  Record;                     /* record in the segment */
+} PLAY_INDEX;
+
+/* Global variables: settings and statistics, exported by SVI */
+PLAY_CONFIG m1stream_PlayCfg = {
+    0,                                  /* Enable */
+    "",                                 /* Session */
+    1,                                  /* Speed */
+    1,                                  /* Loop */
+    0                                   /* StartCycle */
+};
+UINT32  m1stream_PlayCycle = 0;
+UINT32  m1stream_PlayRecords = 0;
+UINT32  m1stream_PlayRate = 0;
+
+/* Session */
+MLOCAL PLAY_SEGMENT *pSegments = NULL;
+MLOCAL UINT32 NbOfSegments = 0;
+MLOCAL PLAY_INDEX *pIndex = NULL;
+MLOCAL UINT32 NbOfIndex = 0;
+
+/* Read position */
+MLOCAL int ReadFd = ERROR;
+MLOCAL UINT32 ReadSegment = 0;          /* position in Segments[] */
+MLOCAL UINT32 ReadRecord = 0;           /* next record to read from the file */
+MLOCAL REC_RECORD *pBlock = NULL;
+MLOCAL UINT32 BlockFill = 0;
+MLOCAL UINT32 BlockPos = 0;
+
+/**
+********************************************************************************
+* @brief Builds the file name of a segment of the session.
+*******************************************************************************/
+MLOCAL VOID SegmentName(CHAR * pName, UINT32 Size, UINT32 Number)
+{
+    snprintf(pName, Size, "%s_%04u.rec", m1stream_PlayCfg.Session, Number);
+}
+
+/**
+********************************************************************************
+* @brief Sorts the segments by number, for qsort().
+*******************************************************************************/
+MLOCAL int SegmentCompare(const void *pA, const void *pB)
+{
+    const PLAY_SEGMENT *pSegA = pA;
+    const PLAY_SEGMENT *pSegB = pB;
+
+    return (pSegA->Number > pSegB->Number) - (pSegA->Number < pSegB->Number);
+}
+
+/**
+********************************************************************************
+* @brief Finds all segment files of the session in its directory.
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. ERROR
+*******************************************************************************/
+MLOCAL SINT32 SegmentFind(VOID)
+{
+    CHAR    Dir[M_PATHLEN_A];
+    CHAR   *pBase;
+    CHAR   *pEnd;
+    UINT32  BaseLen;
+    UINT32  Number;
+    DIR    *pDir;
+    struct dirent *pEntry;
+    CHAR    Func[] = "Play_Open";
+
+    /* directory and file name part of the session */
+    snprintf(Dir, sizeof(Dir), "%s", m1stream_PlayCfg.Session);
+    pBase = strrchr(Dir, '/');
+    if (pBase)
+    {
+        *pBase++ = 0;
+        if (!Dir[0])
+            snprintf(Dir, sizeof(Dir), "/");
+        pBase = strrchr(m1stream_PlayCfg.Session, '/') + 1;
+    }
+    else
+    {
+        snprintf(Dir, sizeof(Dir), ".");
+        pBase = m1stream_PlayCfg.Session;
+    }
+    BaseLen = strlen(pBase);
+
+    pDir = opendir(Dir);
+    if (!pDir)
+    {
+        LOG_E(0, Func, "Could not open directory '%s'", Dir);
+        return (ERROR);
+    }
+
+    NbOfSegments = 0;
+    while ((pEntry = readdir(pDir)) != NULL)
+    {
+        /* <Session>_<n>.rec */
+        if (strncmp(pEntry->d_name, pBase, BaseLen) || pEntry->d_name[BaseLen] != '_')
+            continue;
+        Number = strtoul(&pEntry->d_name[BaseLen + 1], &pEnd, 10);
+        if (pEnd == &pEntry->d_name[BaseLen + 1] || strcmp(pEnd, ".rec"))
+            continue;
+
+        if (NbOfSegments >= PLAY_MAX_SEGMENTS)
+        {
+            LOG_W(0, Func, "More than %d segments, the rest is ignored", PLAY_MAX_SEGMENTS);
+            break;
+        }
+        pSegments[NbOfSegments].Number = Number;
+        pSegments[NbOfSegments].Records = 0;
+        NbOfSegments++;
+    }
+    closedir(pDir);
+
+    if (!NbOfSegments)
+    {
+        LOG_E(0, Func, "No segments of session '%s'", m1stream_PlayCfg.Session);
+        return (ERROR);
+    }
+
+    qsort(pSegments, NbOfSegments, sizeof(PLAY_SEGMENT), SegmentCompare);
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Checks the header of a segment file and returns its record count.
+*        A segment which has not been closed properly has no record count in
+*        the header, it is taken from the file size instead.
+*
+* @param[in]  Fd      open segment file
+* @param[in]  pName   file name, for messages
+*
+* @retval     >= 0 .. number of records
+* @retval     < 0  .. ERROR
+*******************************************************************************/
+MLOCAL SINT32 SegmentCheck(int Fd, CHAR * pName)
+{
+    REC_FILEHDR Hdr;
+    struct stat Stat;
+    UINT32  Records;
+    CHAR    Func[] = "Play_Open";
+
+    if (read(Fd, (char *) &Hdr, sizeof(Hdr)) != sizeof(Hdr) || fstat(Fd, &Stat) < 0)
+    {
+        LOG_E(0, Func, "Could not read '%s'", pName);
+        return (ERROR);
+    }
+
+    if (Hdr.Magic == PLAY_MAGIC_SWAPPED)
+    {
+        LOG_E(0, Func, "'%s' has been recorded with the other byte order", pName);
+        return (ERROR);
+    }
+    if (Hdr.Magic != REC_MAGIC || Hdr.Version != REC_VERSION ||
+        Hdr.RecordSize != sizeof(REC_RECORD) || Hdr.Channels != REC_CHANNELS)
+    {
+        LOG_E(0, Func, "'%s' is no recording of this module version", pName);
+        return (ERROR);
+    }
+
+    Records = 0;
+    if (Stat.st_size > (off_t) sizeof(REC_FILEHDR))
+        Records = (Stat.st_size - sizeof(REC_FILEHDR)) / sizeof(REC_RECORD);
+    if (Hdr.Records && Hdr.Records < Records)
+        Records = Hdr.Records;
+
+    return (Records);
+}
+
+/**
+********************************************************************************
+* @brief Closes the file of the read position.
+*******************************************************************************/
+MLOCAL VOID ReadClose(VOID)
+{
+    if (ReadFd != ERROR)
+        close(ReadFd);
+    ReadFd = ERROR;
+    BlockFill = BlockPos = 0;
+}
+
+/**
+********************************************************************************
+* @brief Sets the read position to a record of a segment.
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. ERROR
+*******************************************************************************/
+MLOCAL SINT32 ReadSetPos(UINT32 Segment, UINT32 Record)
+{
+    CHAR    Name[M_PATHLEN_A + 16];
+
+    ReadClose();
+
+    ReadSegment = Segment;
+    ReadRecord = Record;
+    if (Segment >= NbOfSegments)
+        return (OK);
+
+    SegmentName(Name, sizeof(Name), pSegments[Segment].Number);
+    ReadFd = open(Name, O_RDONLY, 0);
+    if (ReadFd < 0)
+    {
+        LOG_E(0, "Play_Read", "Could not open '%s'", Name);
+        ReadFd = ERROR;
+        return (ERROR);
+    }
+    if (lseek(ReadFd, sizeof(REC_FILEHDR) + Record * sizeof(REC_RECORD), SEEK_SET) < 0)
+    {
+        ReadClose();
+        return (ERROR);
+    }
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Reads the next block of records, continuing with the next segment
+*        at the end of one.
+*
+* @retval     > 0 .. records in the block
+* @retval     = 0 .. end of the session
+* @retval     < 0 .. ERROR
+*******************************************************************************/
+MLOCAL SINT32 ReadBlock(VOID)
+{
+    UINT32  Count;
+    SINT32  Len;
+
+    BlockFill = BlockPos = 0;
+
+    while (ReadSegment < NbOfSegments && ReadRecord >= pSegments[ReadSegment].Records)
+    {
+        if (ReadSetPos(ReadSegment + 1, 0) < 0)
+            return (ERROR);
+    }
+    if (ReadSegment >= NbOfSegments)
+        return 0;
+
+    Count = pSegments[ReadSegment].Records - ReadRecord;
+    if (Count > PLAY_BLOCK_RECORDS)
+        Count = PLAY_BLOCK_RECORDS;
+
+    Len = read(ReadFd, (char *) pBlock, Count * sizeof(REC_RECORD));
+    if (Len < (SINT32) sizeof(REC_RECORD))
+    {
+        LOG_E(0, "Play_Read", "Read error in segment %u", pSegments[ReadSegment].Number);
+        return (ERROR);
+    }
+
+    BlockFill = Len / sizeof(REC_RECORD);
+    ReadRecord += BlockFill;
+
+    return (BlockFill);
+}
+
+/**
+********************************************************************************
+* @brief Builds the sparse index over all segments of the session.
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. ERROR
+*******************************************************************************/
+MLOCAL SINT32 IndexBuild(VOID)
+{
+    CHAR    Name[M_PATHLEN_A + 16];
+    UINT32  Seg, Rec;
+    UINT32  Cycle;
+    SINT32  Records;
+    int     Fd;
+    CHAR    Func[] = "Play_Open";
+
+    /* record counts first, they give the size of the index */
+    NbOfIndex = 0;
+    for (Seg = 0; Seg < NbOfSegments; Seg++)
+    {
+        SegmentName(Name, sizeof(Name), pSegments[Seg].Number);
+        Fd = open(Name, O_RDONLY, 0);
+        if (Fd < 0)
+        {
+            LOG_E(0, Func, "Could not open '%s'", Name);
+            return (ERROR);
+        }
+        Records = SegmentCheck(Fd, Name);
+        close(Fd);
+        if (Records < 0)
+            return (ERROR);
+
+        pSegments[Seg].Records = Records;
+        NbOfIndex += (Records + PLAY_INDEX_STEP - 1) / PLAY_INDEX_STEP;
+    }
+
+    pIndex = sys_MemAlloc((NbOfIndex + 1) * sizeof(PLAY_INDEX));
+    if (!pIndex)
+    {
+        LOG_E(0, Func, "Could not allocate the index!");
+        return (ERROR);
+    }
+
+    /* Cycle of every PLAY_INDEX_STEP-th record */
+    NbOfIndex = 0;
+    for (Seg = 0; Seg < NbOfSegments; Seg++)
+    {
+        SegmentName(Name, sizeof(Name), pSegments[Seg].Number);
+        Fd = open(Name, O_RDONLY, 0);
+        if (Fd < 0)
+            return (ERROR);
+
+        for (Rec = 0; Rec < pSegments[Seg].Records; Rec += PLAY_INDEX_STEP)
+        {
+            if (lseek(Fd, sizeof(REC_FILEHDR) + Rec * sizeof(REC_RECORD), SEEK_SET) < 0 ||
+                read(Fd, (char *) &Cycle, sizeof(Cycle)) != sizeof(Cycle))
+            {
+                LOG_E(0, Func, "Could not read '%s'", Name);
+                close(Fd);
+                return (ERROR);
+            }
+            pIndex[NbOfIndex].Cycle = Cycle;
+            pIndex[NbOfIndex].Segment = Seg;
+            pIndex[NbOfIndex].Record = Rec;
+            NbOfIndex++;
+        }
+        close(Fd);
+    }
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Opens the session m1stream_PlayCfg.Session and builds its index.
+*        The read position is the first record.
+*
+* @param[in]  N/A
+* @param[out] N/A
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. ERROR
+*******************************************************************************/
+SINT32 Play_Open(VOID)
+{
+    CHAR    Func[] = "Play_Open";
+
+    pSegments = sys_MemAlloc(PLAY_MAX_SEGMENTS * sizeof(PLAY_SEGMENT));
+    pBlock = sys_MemAlloc(PLAY_BLOCK_RECORDS * sizeof(REC_RECORD));
+    if (!pSegments || !pBlock)
+    {
+        LOG_E(0, Func, "Could not allocate the replay buffers!");
+        Play_Close();
+        return (ERROR);
+    }
+
+    if (SegmentFind() < 0 || IndexBuild() < 0 || ReadSetPos(0, 0) < 0)
+    {
+        Play_Close();
+        return (ERROR);
+    }
+
+    LOG_I(0, Func, "Replaying '%s', %u segments, cycles %u ..", m1stream_PlayCfg.Session,
+          NbOfSegments, NbOfIndex ? pIndex[0].Cycle : 0);
+
+    m1stream_PlayRecords = 0;
+    m1stream_PlayRate = 0;
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Closes the session and frees all buffers.
+*******************************************************************************/
+VOID Play_Close(VOID)
+{
+    ReadClose();
+
+    if (pSegments)
+        sys_MemFree(pSegments);
+    if (pBlock)
+        sys_MemFree(pBlock);
+    if (pIndex)
+        sys_MemFree(pIndex);
+    pSegments = NULL;
+    pBlock = NULL;
+    pIndex = NULL;
+    NbOfSegments = NbOfIndex = 0;
+}
+
+/**
+********************************************************************************
+* @brief Sets the read position to the first record with a Cycle of at least
+*        the one given. The index gives the block to start from, at most
+*        PLAY_INDEX_STEP records are read to get to the exact record.
+*
+* @param[in]  Cycle   cycle to jump to, 0 = start of the session
+* @param[out] N/A
+*
+* @retval     = 0 .. OK, also if Cycle is beyond the end of the session
+* @retval     < 0 .. ERROR
+*******************************************************************************/
+SINT32 Play_Seek(UINT32 Cycle)
+{
+    UINT32  Low = 0, High = NbOfIndex, Mid;
+    SINT32  ret;
+
+    /* last index entry with a Cycle <= the one searched */
+    while (High - Low > 1)
+    {
+        Mid = (Low + High) / 2;
+        if (pIndex[Mid].Cycle <= Cycle)
+            Low = Mid;
+        else
+            High = Mid;
+    }
+
+    if (!NbOfIndex)
+        return ReadSetPos(0, 0);
+    if (ReadSetPos(pIndex[Low].Segment, pIndex[Low].Record) < 0)
+        return (ERROR);
+
+    /* skip the records before the one searched */
+    do
+    {
+        ret = ReadBlock();
+        if (ret <= 0)
+            return ret;
+        while (BlockPos < BlockFill && pBlock[BlockPos].Cycle < Cycle)
+            BlockPos++;
+    }
+    while (BlockPos == BlockFill);
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Returns the record at the read position and moves on to the next one.
+*
+* @param[in]  N/A
+* @param[out] pRec    record read
+*
+* @retval     = 1 .. OK
+* @retval     = 0 .. end of the session
+* @retval     < 0 .. ERROR
+*******************************************************************************/
+SINT32 Play_Read(REC_RECORD * pRec)
+{
+    SINT32  ret;
+
+    if (!pBlock)
+        return (ERROR);
+
+    if (BlockPos == BlockFill)
+    {
+        ret = ReadBlock();
+        if (ret <= 0)
+            return ret;
+    }
+
+    memcpy(pRec, &pBlock[BlockPos++], sizeof(REC_RECORD));
+
+    return 1;
+}
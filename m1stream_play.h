@@ -0,0 +1,50 @@
+/**
+********************************************************************************
+* @file     m1stream_play.h
+*
+* @brief    Replay of a session written by the recorder, see m1stream_rec.h.
+*           The replay task reads the segment files of one session in
+*           order and sends each record to the websocket clients in place
+*           of the live values. A sparse index of every PLAY_INDEX_STEP-th
+*           record allows to jump to a cycle without reading the session
+*           from the start.
+*
+*******************************************************************************/
+
+/* Avoid problems with multiple including */
+#ifndef M1STREAM_PLAY__H
+#define M1STREAM_PLAY__H
+
+/*--- Defines ---*/
+
+#define PLAY_INDEX_STEP     1024        /* records between two index entries */
+#define PLAY_MAX_SEGMENTS   4096        /* segment files of one session */
+#define PLAY_BLOCK_RECORDS  REC_BLOCK_RECORDS   /* records per read() */
+
+/*--- Structures ---*/
+
+/* Settings from (Replay) in mconfig */
+typedef struct PLAY_CONFIG
+{
+    SINT32  Enable;                     /* replay instead of the live values */
+    CHAR    Session[M_PATHLEN_A];       /* session: segment file name without "_<n>.rec" */
+    SINT32  Speed;                      /* 1 = real time, 10, 100 .. faster, 0 = as fast as possible */
+    SINT32  Loop;                       /* start again at the end of the session */
+    SINT32  StartCycle;                 /* cycle to start with, 0 = first record */
+} PLAY_CONFIG;
+
+/*--- Variable definitions ---*/
+
+EXTERN PLAY_CONFIG m1stream_PlayCfg;
+EXTERN UINT32 m1stream_PlayCycle;       /* cycle of the record sent last */
+EXTERN UINT32 m1stream_PlayRecords;     /* records sent */
+EXTERN UINT32 m1stream_PlayRate;        /* records sent in the last second */
+
+/*--- Function prototyping ---*/
+
+EXTERN SINT32 Play_Open(VOID);
+EXTERN VOID Play_Close(VOID);
+EXTERN SINT32 Play_Seek(UINT32 Cycle);
+EXTERN SINT32 Play_Read(REC_RECORD * pRec);
+
+#endif /* Avoid problems with multiple include */
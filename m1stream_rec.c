@@ -0,0 +1,360 @@
+/**
+********************************************************************************
+* @file     m1stream_rec.c
+*
+* @brief    Binary session recorder of the sample stream, see m1stream_rec.h.
+*           Rec_Claim()/Rec_Commit() are called by the control task only,
+*           Rec_Write()/Rec_Close() by the record task only. The queue
+*           between them is a single producer, single consumer ring, so the
+*           control task never waits for the file system. If the queue is
+*           full, the record of the cycle is dropped and counted.
+*
+*******************************************************************************/
+
+/* VxWorks includes */
+#include <vxWorks.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+
+/* MSys includes */
+#include <mtypes.h>
+#include <msys_e.h>
+#include <log_e.h>
+
+/* Project includes */
+#include "m1stream.h"
+#include "m1stream_int.h"
+#include "m1stream_rec.h"
+
+#define REC_FLUSH_US        1000000     /* write a partial block after this time */
+
+/* Global variables: settings and statistics, exported by SVI */
+REC_CONFIG m1stream_RecCfg = {
+    0,                                  /* Enable */
+    "/cfc0/rec",                        /* Path */
+    60000,                              /* SegmentRecords, 1 minute at 1 ms */
+    0                                   /* MaxSegments */
+};
+UINT32  m1stream_RecRecords = 0;
+UINT32  m1stream_RecDropped = 0;
+
+/* Queue between control task and record task */
+MLOCAL REC_RECORD *pQueue = NULL;
+MLOCAL volatile UINT32 QueueHead = 0;   /* written by the control task */
+MLOCAL volatile UINT32 QueueTail = 0;   /* written by the record task */
+
+/* State of the record task */
+MLOCAL REC_RECORD *pBlock = NULL;
+MLOCAL UINT32 BlockFill = 0;
+MLOCAL UINT32 BlockTime = 0;
+MLOCAL int SegmentFd = ERROR;
+MLOCAL REC_FILEHDR SegmentHdr;
+MLOCAL UINT32 SegmentIdx = 0;
+MLOCAL UINT32 SessionTime = 0;
+MLOCAL UINT32 CycleTime = 0;
+
+/* 64 bit time stamp, extended by the control task on each wrap */
+MLOCAL UINT32 LastTime = 0;
+MLOCAL UINT32 TimeHigh = 0;
+
+/**
+********************************************************************************
+* @brief Allocates the queue if recording is enabled.
+*        Called before the tasks are started.
+*
+* @param[in]  CycleTime_us  cycle time of the control task, for the file header
+* @param[out] N/A
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. ERROR
+*******************************************************************************/
+SINT32 Rec_Init(UINT32 CycleTime_us)
+{
+    CHAR    Func[] = "Rec_Init";
+
+    if (!m1stream_RecCfg.Enable)
+        return (OK);
+
+    pBlock = sys_MemAlloc(REC_BLOCK_RECORDS * sizeof(REC_RECORD));
+    pQueue = sys_MemAlloc(REC_QUEUE_LEN * sizeof(REC_RECORD));
+    if (!pQueue || !pBlock)
+    {
+        LOG_E(0, Func, "Could not allocate the recorder queue!");
+        Rec_Deinit();
+        return (ERROR);
+    }
+
+    QueueHead = QueueTail = 0;
+    BlockFill = 0;
+    SegmentIdx = 0;
+    SegmentFd = ERROR;
+    SessionTime = time(NULL);
+    CycleTime = CycleTime_us;
+    m1stream_RecRecords = 0;
+    m1stream_RecDropped = 0;
+
+    if (m1stream_RecCfg.SegmentRecords < REC_BLOCK_RECORDS)
+        m1stream_RecCfg.SegmentRecords = REC_BLOCK_RECORDS;
+
+    /* the directory may not exist yet, an error shows up at the first open */
+    mkdir(m1stream_RecCfg.Path, 0777);
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Frees the queue. Called after all tasks have ended.
+*******************************************************************************/
+VOID Rec_Deinit(VOID)
+{
+    if (pQueue)
+        sys_MemFree(pQueue);
+    if (pBlock)
+        sys_MemFree(pBlock);
+    pQueue = NULL;
+    pBlock = NULL;
+}
+
+/**
+********************************************************************************
+* @brief Returns the queue slot for the record of this cycle, to be filled in
+*        and passed on by Rec_Commit(). Control task only.
+*
+* @retval     != NULL .. record to fill in
+* @retval     NULL    .. recording disabled or queue full
+*******************************************************************************/
+REC_RECORD *Rec_Claim(VOID)
+{
+    REC_RECORD *pRec;
+    UINT32  now;
+
+    if (!pQueue)
+        return NULL;
+
+    if (QueueHead - QueueTail >= REC_QUEUE_LEN)
+    {
+        m1stream_RecDropped++;
+        return NULL;
+    }
+
+    now = m_GetProcTime();
+    if (now < LastTime)
+        TimeHigh++;
+    LastTime = now;
+
+    pRec = &pQueue[QueueHead & (REC_QUEUE_LEN - 1)];
+    pRec->Time_us = ((UINT64) TimeHigh << 32) | now;
+
+    return pRec;
+}
+
+/**
+********************************************************************************
+* @brief Passes the record of Rec_Claim() on to the record task.
+*******************************************************************************/
+VOID Rec_Commit(VOID)
+{
+    /* the record must be complete before the record task can see it */
+    __sync_synchronize();
+    QueueHead++;
+}
+
+/**
+********************************************************************************
+* @brief Builds the file name of a segment of the current session.
+*******************************************************************************/
+MLOCAL VOID SegmentName(CHAR * pName, UINT32 Size, UINT32 Idx)
+{
+    snprintf(pName, Size, "%s/m1s_%u_%04u.rec", m1stream_RecCfg.Path, SessionTime, Idx);
+}
+
+/**
+********************************************************************************
+* @brief Writes the header of the open segment.
+*******************************************************************************/
+MLOCAL SINT32 SegmentWriteHdr(VOID)
+{
+    if (lseek(SegmentFd, 0, SEEK_SET) < 0)
+        return (ERROR);
+    if (write(SegmentFd, (char *) &SegmentHdr, sizeof(SegmentHdr)) != sizeof(SegmentHdr))
+        return (ERROR);
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Closes the open segment, with the final record count in the header.
+*******************************************************************************/
+MLOCAL VOID SegmentClose(VOID)
+{
+    CHAR    Func[] = "Rec_Write";
+
+    if (SegmentFd == ERROR)
+        return;
+
+    if (SegmentWriteHdr() < 0)
+        LOG_W(0, Func, "Could not update header of segment %u", SegmentHdr.Segment);
+    close(SegmentFd);
+    SegmentFd = ERROR;
+}
+
+/**
+********************************************************************************
+* @brief Opens the next segment and deletes the oldest one beyond MaxSegments.
+*
+* @param[in]  FirstCycle  cycle of the first record in the segment
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. ERROR
+*******************************************************************************/
+MLOCAL SINT32 SegmentOpen(UINT32 FirstCycle)
+{
+    CHAR    Name[M_PATHLEN_A + 32];
+    CHAR    Func[] = "Rec_Write";
+
+    SegmentName(Name, sizeof(Name), SegmentIdx);
+    SegmentFd = open(Name, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (SegmentFd < 0)
+    {
+        LOG_E(0, Func, "Could not create segment '%s'", Name);
+        SegmentFd = ERROR;
+        return (ERROR);
+    }
+
+    memset(&SegmentHdr, 0, sizeof(SegmentHdr));
+    SegmentHdr.Magic = REC_MAGIC;
+    SegmentHdr.Version = REC_VERSION;
+    SegmentHdr.RecordSize = sizeof(REC_RECORD);
+    SegmentHdr.Channels = REC_CHANNELS;
+    SegmentHdr.Segment = SegmentIdx;
+    SegmentHdr.CycleTime_us = CycleTime;
+    SegmentHdr.FirstCycle = FirstCycle;
+    SegmentHdr.StartTime = SessionTime;
+    if (SegmentWriteHdr() < 0)
+    {
+        LOG_E(0, Func, "Could not write to segment '%s'", Name);
+        close(SegmentFd);
+        SegmentFd = ERROR;
+        return (ERROR);
+    }
+
+    LOG_I(1, Func, "Recording to '%s'", Name);
+
+    if (m1stream_RecCfg.MaxSegments > 0 && SegmentIdx >= (UINT32) m1stream_RecCfg.MaxSegments)
+    {
+        SegmentName(Name, sizeof(Name), SegmentIdx - m1stream_RecCfg.MaxSegments);
+        remove(Name);
+    }
+    SegmentIdx++;
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Writes the collected block to the segments, rolling over to the next
+*        segment where one is full.
+*******************************************************************************/
+MLOCAL VOID BlockFlush(VOID)
+{
+    UINT32  Done = 0;
+    UINT32  Count;
+    SINT32  Len;
+
+    while (Done < BlockFill)
+    {
+        if (SegmentFd != ERROR && SegmentHdr.Records >= (UINT32) m1stream_RecCfg.SegmentRecords)
+            SegmentClose();
+
+        if (SegmentFd == ERROR && SegmentOpen(pBlock[Done].Cycle) < 0)
+        {
+            /* records are lost, try again with a new segment next time */
+            m1stream_RecDropped += BlockFill - Done;
+            break;
+        }
+
+        Count = BlockFill - Done;
+        if (Count > m1stream_RecCfg.SegmentRecords - SegmentHdr.Records)
+            Count = m1stream_RecCfg.SegmentRecords - SegmentHdr.Records;
+
+        Len = Count * sizeof(REC_RECORD);
+        if (lseek(SegmentFd, sizeof(REC_FILEHDR) + SegmentHdr.Records * sizeof(REC_RECORD),
+                  SEEK_SET) < 0 || write(SegmentFd, (char *) &pBlock[Done], Len) != Len)
+        {
+            LOG_E(0, "Rec_Write", "Write error on segment %u, starting a new one",
+                  SegmentHdr.Segment);
+            SegmentClose();
+            m1stream_RecDropped += BlockFill - Done;
+            break;
+        }
+
+        SegmentHdr.Records += Count;
+        m1stream_RecRecords += Count;
+        Done += Count;
+    }
+
+    BlockFill = 0;
+    BlockTime = m_GetProcTime();
+}
+
+/**
+********************************************************************************
+* @brief Moves records from the queue into the block and writes the block
+*        when it is full, or at the latest after REC_FLUSH_US.
+*        Record task only.
+*
+* @param[in]  MaxRecords  maximum number of records taken from the queue
+*
+* @retval     number of records taken from the queue
+*******************************************************************************/
+UINT32 Rec_Write(UINT32 MaxRecords)
+{
+    UINT32  Taken = 0;
+    UINT32  Head;
+
+    if (!pQueue)
+        return 0;
+
+    Head = QueueHead;
+    /* the records up to Head are complete, see Rec_Commit */
+    __sync_synchronize();
+
+    while (QueueTail != Head && Taken < MaxRecords)
+    {
+        memcpy(&pBlock[BlockFill++], &pQueue[QueueTail & (REC_QUEUE_LEN - 1)], sizeof(REC_RECORD));
+        /* the slot must be copied before the control task reuses it */
+        __sync_synchronize();
+        QueueTail++;
+        Taken++;
+
+        if (BlockFill == REC_BLOCK_RECORDS)
+            BlockFlush();
+    }
+
+    if (BlockFill && m_GetProcTime() - BlockTime > REC_FLUSH_US)
+        BlockFlush();
+
+    return Taken;
+}
+
+/**
+********************************************************************************
+* @brief Writes everything still queued and closes the segment.
+*        Record task only, at its end.
+*******************************************************************************/
+VOID Rec_Close(VOID)
+{
+    if (!pQueue)
+        return;
+
+    Rec_Write(REC_QUEUE_LEN);
+    if (BlockFill)
+        BlockFlush();
+    SegmentClose();
+}
@@ -0,0 +1,87 @@
+/**
+********************************************************************************
+* @file     m1stream_rec.h
+*
+* @brief    Binary session recorder of the sample stream.
+*           The control task hands over one fixed-size record per cycle
+*           through a lock-free queue, the record task writes them in blocks
+*           to segment files. The file layout below is also what the
+*           replay reads.
+*
+*           Segment file:  REC_FILEHDR, followed by REC_RECORD[Records]
+*           All values are in the byte order of the writing CPU, a reader
+*           detects the other byte order by a swapped REC_MAGIC.
+*
+*******************************************************************************/
+
+/* Avoid problems with multiple including */
+#ifndef M1STREAM_REC__H
+#define M1STREAM_REC__H
+
+/*--- Defines ---*/
+
+#define REC_MAGIC           0x4D315243  /* "M1RC" */
+#define REC_VERSION         1
+#define REC_CHANNELS        16          /* channels per record */
+#define REC_QUEUE_LEN       2048        /* records between control and record task, power of 2 */
+#define REC_BLOCK_RECORDS   448         /* records per write(), 63 KiB */
+
+/*--- Structures ---*/
+
+/* One channel of a record */
+typedef struct REC_CHANNEL
+{
+    UINT16  CardNb;                     /* card number from (PaddleConfig) */
+    UINT16  Chan;                       /* channel number on the card */
+    SINT32  Value;                      /* value read in this cycle */
+} REC_CHANNEL;
+
+/* One control cycle, 144 bytes */
+typedef struct REC_RECORD
+{
+    UINT32  Cycle;                      /* cycle counter of the control task */
+    UINT32  Valid;                      /* bit n set: Channel[n] was read successfully */
+    UINT64  Time_us;                    /* time of the cycle since module start */
+    REC_CHANNEL Channel[REC_CHANNELS];
+} REC_RECORD;
+
+/* Header of a segment file, 64 bytes */
+typedef struct REC_FILEHDR
+{
+    UINT32  Magic;                      /* REC_MAGIC */
+    UINT16  Version;                    /* REC_VERSION */
+    UINT16  RecordSize;                 /* sizeof(REC_RECORD) */
+    UINT32  Channels;                   /* REC_CHANNELS */
+    UINT32  Segment;                    /* index of this segment in the session */
+    UINT32  CycleTime_us;               /* cycle time of the control task */
+    UINT32  Records;                    /* records in this file, 0 if not closed properly */
+    UINT32  FirstCycle;                 /* Cycle of the first record */
+    UINT32  StartTime;                  /* session start, seconds since 1970 */
+    UINT32  Spare[8];
+} REC_FILEHDR;
+
+/* Settings from (Recorder) in mconfig */
+typedef struct REC_CONFIG
+{
+    SINT32  Enable;                     /* record the sample stream */
+    CHAR    Path[M_PATHLEN_A];          /* directory of the segment files */
+    SINT32  SegmentRecords;             /* records per segment file */
+    SINT32  MaxSegments;                /* segments kept per session, 0 = all */
+} REC_CONFIG;
+
+/*--- Variable definitions ---*/
+
+EXTERN REC_CONFIG m1stream_RecCfg;
+EXTERN UINT32 m1stream_RecRecords;    /* records written */
+EXTERN UINT32 m1stream_RecDropped;    /* records lost because the queue was full */
+
+/*--- Function prototyping ---*/
+
+EXTERN SINT32 Rec_Init(UINT32 CycleTime_us);
+EXTERN VOID Rec_Deinit(VOID);
+EXTERN REC_RECORD *Rec_Claim(VOID);
+EXTERN VOID Rec_Commit(VOID);
+EXTERN UINT32 Rec_Write(UINT32 MaxRecords);
+EXTERN VOID Rec_Close(VOID);
+
+#endif /* Avoid problems with multiple include */
@@ -0,0 +1,321 @@
+/**
+********************************************************************************
+* @file     m1stream_shm.c
+*
+* @brief    Sample ring for modules on the same CPU, see m1stream_e.h.
+*           Shm_Write() is called by the control task only. Each slot is a
+*           small seqlock: its Seq is neither the old nor the new sample
+*           number while the control task writes it, so a reader notices a
+*           sample which was overwritten under it and drops it. A reader
+*           which lost samples goes on half a ring behind the head, to have
+*           some room before it is overrun again.
+*
+*******************************************************************************/
+
+/* VxWorks includes */
+#include <vxWorks.h>
+#include <string.h>
+
+/* MSys includes */
+#include <mtypes.h>
+#include <msys_e.h>
+#include <log_e.h>
+
+/* Project includes */
+#include "m1stream.h"
+#include "m1stream_e.h"
+#include "m1stream_int.h"
+#include "m1stream_rec.h"
+#include "m1stream_shm.h"
+
+/* Global variables: settings and statistics, exported by SVI */
+SHM_CONFIG m1stream_ShmCfg = {
+    1024                                /* Samples, 1 second at 1 ms */
+};
+UINT32  m1stream_ShmReaders = 0;
+UINT32  m1stream_ShmOverruns = 0;
+
+MLOCAL M1STREAM_RING Ring;              /* pSlot NULL: no ring */
+MLOCAL M1STREAM_READER *volatile Readers[M1STREAM_SHM_READERS];
+
+/**
+********************************************************************************
+* @brief Allocates the ring if it is switched on.
+*        Called before the tasks are started.
+*
+* @param[in]  CycleTime_us  cycle time of the control task, for the readers
+* @param[out] N/A
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. ERROR
+*******************************************************************************/
+SINT32 Shm_Init(UINT32 CycleTime_us)
+{
+    CHAR    Func[] = "Shm_Init";
+    UINT32  Len = 1;
+
+    memset(&Ring, 0, sizeof(Ring));
+    memset((VOID *) Readers, 0, sizeof(Readers));
+    m1stream_ShmReaders = 0;
+    m1stream_ShmOverruns = 0;
+
+    if (m1stream_ShmCfg.Samples <= 0)
+        return (OK);
+
+    while (Len * 2 <= (UINT32) m1stream_ShmCfg.Samples)
+        Len *= 2;
+
+    Ring.pSlot = sys_MemAlloc(Len * sizeof(M1STREAM_SLOT));
+    if (!Ring.pSlot)
+    {
+        LOG_E(0, Func, "Could not allocate the sample ring!");
+        return (ERROR);
+    }
+
+    /* Seq 0 is no sample */
+    memset(Ring.pSlot, 0, Len * sizeof(M1STREAM_SLOT));
+    Ring.Len = Len;
+    Ring.CycleTime_us = CycleTime_us;
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Frees the ring. Called after all tasks have ended.
+*******************************************************************************/
+VOID Shm_Deinit(VOID)
+{
+    CHAR    Func[] = "Shm_Deinit";
+    M1STREAM_SLOT *pSlot = Ring.pSlot;
+
+    if (!pSlot)
+        return;
+
+    if (m1stream_ShmReaders)
+        LOG_W(0, Func, "%u readers are still attached to the sample ring", m1stream_ShmReaders);
+
+    /* readers get M1STREAM_E_NORING from now on */
+    Ring.pSlot = NULL;
+    __sync_synchronize();
+    sys_MemFree(pSlot);
+}
+
+/**
+********************************************************************************
+* @brief Puts the values of a cycle into the ring. Control task only.
+*
+* @param[in]  pRec    values of the cycle
+* @param[out] N/A
+*
+* @retval     N/A
+*******************************************************************************/
+VOID Shm_Write(const REC_RECORD * pRec)
+{
+    M1STREAM_SLOT *pSlot;
+    UINT32  Pos = Ring.Head;
+    int     i;
+
+    if (!Ring.pSlot)
+        return;
+
+    pSlot = &Ring.pSlot[Pos & (Ring.Len - 1)];
+
+    /* never equal to the number of a sample in this slot, as Len is even */
+    pSlot->Seq = ~(Pos + 1);
+    __sync_synchronize();
+
+    pSlot->Sample.Cycle = pRec->Cycle;
+    pSlot->Sample.Valid = pRec->Valid;
+    pSlot->Sample.Time_us = m_GetProcTime();
+    for (i = 0; i < M1STREAM_CHANNELS && i < REC_CHANNELS; i++)
+    {
+        pSlot->Sample.Channel[i].CardNb = pRec->Channel[i].CardNb;
+        pSlot->Sample.Channel[i].Chan = pRec->Channel[i].Chan;
+        pSlot->Sample.Channel[i].Value = pRec->Channel[i].Value;
+    }
+
+    /* the sample must be complete before its Seq, Seq before the head */
+    __sync_synchronize();
+    pSlot->Seq = Pos + 1;
+    __sync_synchronize();
+    Ring.Head = Pos + 1;
+}
+
+/**
+********************************************************************************
+* @brief Moves the cursor of a reader which lost samples half a ring behind
+*        the head.
+*******************************************************************************/
+MLOCAL SINT32 Shm_Overrun(M1STREAM_READER * pReader)
+{
+    UINT32  Head = Ring.Head;
+    UINT32  Cursor = Head > Ring.Len / 2 ? Head - Ring.Len / 2 : 0;
+
+    /* a cursor of before a restart of the module loses nothing */
+    if ((SINT32) (Cursor - pReader->Cursor) > 0)
+        pReader->Lost += Cursor - pReader->Cursor;
+    pReader->Cursor = Cursor;
+    pReader->Overruns++;
+    __sync_fetch_and_add(&m1stream_ShmOverruns, 1);
+
+    return (M1STREAM_E_OVERRUN);
+}
+
+/**
+********************************************************************************
+* @brief Registers a reader of the sample ring. The reader gets the samples
+*        from the next cycle on.
+*
+* @param[in]  pReader  cursor of the reader, must stay valid until detached
+* @param[out] pReader  initialized
+*
+* @retval     = 0 .. OK
+* @retval     M1STREAM_E_NORING  .. the ring is switched off or the module does not run
+* @retval     M1STREAM_E_READERS .. too many readers
+*******************************************************************************/
+SINT32 m1stream_ShmAttach(M1STREAM_READER * pReader)
+{
+    int     i;
+
+    if (!Ring.pSlot)
+        return (M1STREAM_E_NORING);
+
+    for (i = 0; i < M1STREAM_SHM_READERS; i++)
+    {
+        if (__sync_bool_compare_and_swap(&Readers[i], NULL, pReader))
+        {
+            pReader->pRing = &Ring;
+            pReader->Cursor = Ring.Head;
+            pReader->Lost = 0;
+            pReader->Overruns = 0;
+            pReader->Id = i;
+            __sync_fetch_and_add(&m1stream_ShmReaders, 1);
+            return (M1STREAM_E_OK);
+        }
+    }
+
+    return (M1STREAM_E_READERS);
+}
+
+/**
+********************************************************************************
+* @brief Ends the registration of m1stream_ShmAttach().
+*
+* @param[in]  pReader  cursor of the reader
+* @param[out] N/A
+*
+* @retval     N/A
+*******************************************************************************/
+VOID m1stream_ShmDetach(M1STREAM_READER * pReader)
+{
+    SINT32  Id = pReader->Id;
+
+    pReader->pRing = NULL;
+    pReader->Id = -1;
+    if (Id < 0 || Id >= M1STREAM_SHM_READERS)
+        return;
+
+    /* not registered any more if the module was restarted */
+    if (__sync_bool_compare_and_swap(&Readers[Id], pReader, NULL))
+        __sync_fetch_and_sub(&m1stream_ShmReaders, 1);
+}
+
+/**
+********************************************************************************
+* @brief Gives access to the next sample in the ring, without copying it.
+*        The sample may be overwritten while it is being used, so it is valid
+*        only if m1stream_ShmDone() returns 1 afterwards.
+*
+* @param[in]  pReader   cursor of the reader
+* @param[out] ppSample  next sample, NULL if the return value is not 1
+*
+* @retval     1 .. sample available
+* @retval     0 .. no new sample
+* @retval     M1STREAM_E_OVERRUN .. samples lost, the cursor has been moved
+*                                   on, pReader->Lost tells how many
+* @retval     M1STREAM_E_NORING  .. not attached or the ring is gone
+*******************************************************************************/
+SINT32 m1stream_ShmPeek(M1STREAM_READER * pReader, const M1STREAM_SAMPLE ** ppSample)
+{
+    const M1STREAM_SLOT *pSlot;
+    UINT32  Head;
+
+    *ppSample = NULL;
+    if (!Ring.pSlot || pReader->pRing != &Ring)
+        return (M1STREAM_E_NORING);
+
+    Head = Ring.Head;
+    /* the head must be read before the slot */
+    __sync_synchronize();
+
+    if (Head == pReader->Cursor)
+        return (0);
+    if (Head - pReader->Cursor > Ring.Len)
+        return (Shm_Overrun(pReader));
+
+    pSlot = &Ring.pSlot[pReader->Cursor & (Ring.Len - 1)];
+    if (pSlot->Seq != pReader->Cursor + 1)
+        return (Shm_Overrun(pReader));
+    /* Seq must be read before the sample */
+    __sync_synchronize();
+
+    *ppSample = &pSlot->Sample;
+    return (1);
+}
+
+/**
+********************************************************************************
+* @brief Checks the sample of m1stream_ShmPeek() and moves the cursor on.
+*
+* @param[in]  pReader   cursor of the reader
+* @param[out] N/A
+*
+* @retval     1 .. the sample was valid
+* @retval     M1STREAM_E_OVERRUN .. it was overwritten meanwhile and must be
+*                                   dropped, the cursor has been moved on
+* @retval     M1STREAM_E_NORING  .. not attached or the ring is gone
+*******************************************************************************/
+SINT32 m1stream_ShmDone(M1STREAM_READER * pReader)
+{
+    const M1STREAM_SLOT *pSlot;
+
+    if (!Ring.pSlot || pReader->pRing != &Ring)
+        return (M1STREAM_E_NORING);
+
+    /* the sample must be read before Seq is checked again */
+    __sync_synchronize();
+
+    pSlot = &Ring.pSlot[pReader->Cursor & (Ring.Len - 1)];
+    if (pSlot->Seq != pReader->Cursor + 1)
+        return (Shm_Overrun(pReader));
+
+    pReader->Cursor++;
+    return (1);
+}
+
+/**
+********************************************************************************
+* @brief Copies the next sample out of the ring.
+*
+* @param[in]  pReader   cursor of the reader
+* @param[out] pSample   next sample, if the return value is 1
+*
+* @retval     1 .. sample copied
+* @retval     0 .. no new sample
+* @retval     M1STREAM_E_OVERRUN .. samples lost, the cursor has been moved
+*                                   on, pReader->Lost tells how many
+* @retval     M1STREAM_E_NORING  .. not attached or the ring is gone
+*******************************************************************************/
+SINT32 m1stream_ShmRead(M1STREAM_READER * pReader, M1STREAM_SAMPLE * pSample)
+{
+    const M1STREAM_SAMPLE *pSlotSample;
+    SINT32  ret;
+
+    ret = m1stream_ShmPeek(pReader, &pSlotSample);
+    if (ret != 1)
+        return (ret);
+
+    memcpy(pSample, pSlotSample, sizeof(*pSample));
+    return (m1stream_ShmDone(pReader));
+}
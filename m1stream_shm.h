@@ -0,0 +1,36 @@
+/**
+********************************************************************************
+* @file     m1stream_shm.h
+*
+* @brief    Sample ring for modules on the same CPU, the interface for the
+*           other modules is in m1stream_e.h. The control task writes the
+*           live values of each cycle, the readers call the m1stream_Shm*
+*           functions in their own tasks.
+*
+*******************************************************************************/
+
+/* Avoid problems with multiple including */
+#ifndef M1STREAM_SHM__H
+#define M1STREAM_SHM__H
+
+/*--- Structures ---*/
+
+/* Settings from (SharedRing) in mconfig */
+typedef struct SHM_CONFIG
+{
+    SINT32  Samples;                    /* ring length, rounded down to a power of 2, 0 = off */
+} SHM_CONFIG;
+
+/*--- Variable definitions ---*/
+
+EXTERN SHM_CONFIG m1stream_ShmCfg;
+EXTERN UINT32 m1stream_ShmReaders;      /* readers attached */
+EXTERN UINT32 m1stream_ShmOverruns;     /* overruns of all readers */
+
+/*--- Function prototyping ---*/
+
+EXTERN SINT32 Shm_Init(UINT32 CycleTime_us);
+EXTERN VOID Shm_Deinit(VOID);
+EXTERN VOID Shm_Write(const REC_RECORD * pRec);
+
+#endif /* Avoid problems with multiple include */
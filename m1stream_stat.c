@@ -0,0 +1,253 @@
+/**
+********************************************************************************
+* @file     m1stream_stat.c
+*
+* @brief    Streaming statistics, see m1stream_stat.h.
+*           The cycle times go into histograms, which only the control task
+*           writes. The percentiles are calculated by the SMI task from a
+*           copy of them, with the resolution of one bucket.
+*
+*******************************************************************************/
+
+/* VxWorks includes */
+#include <vxWorks.h>
+#include <string.h>
+
+/* MSys includes */
+#include <mtypes.h>
+#include <msys_e.h>
+
+/* Project includes */
+#include "m1stream.h"
+#include "m1stream_int.h"
+#include "m1stream_rec.h"
+#include "m1stream_cmd.h"
+#include "m1stream_stat.h"
+#include "server.h"
+#include "ws/Keepalive.h"
+#include "ws/Admit.h"
+#include "ws/Static.h"
+#include "ws/Stats.h"
+#include "ws/Pool.h"
+
+/* Same order in M1STREAM_APPSTAT_R.Pool */
+typedef char PoolCheck[(M1STREAM_STAT_POOLS == WS_POOLS) ? 1 : -1];
+
+/* Histogram of a time */
+typedef struct STAT_HIST
+{
+    volatile UINT32 Count[STAT_BUCKETS];
+    volatile UINT32 Max;
+} STAT_HIST;
+
+/* Written by the control task */
+MLOCAL STAT_HIST Exec;
+MLOCAL STAT_HIST Period;
+MLOCAL UINT32 BucketWidth = 10;         /* us per bucket */
+MLOCAL UINT32 CycleStart = 0;
+MLOCAL BOOL Started = FALSE;
+
+/* State of the SMI task, for Interval = 1 */
+MLOCAL UINT32 ExecBase[STAT_BUCKETS];
+MLOCAL UINT32 PeriodBase[STAT_BUCKETS];
+
+/**
+********************************************************************************
+* @brief Clears the histograms. Called before the control task starts.
+*
+* @param[in]  CycleTime_us  cycle time of the control task, sets the bucket width
+* @param[out] N/A
+*
+* @retval     N/A
+*******************************************************************************/
+VOID Stat_Init(UINT32 CycleTime_us)
+{
+    memset((VOID *) &Exec, 0, sizeof(Exec));
+    memset((VOID *) &Period, 0, sizeof(Period));
+    memset(ExecBase, 0, sizeof(ExecBase));
+    memset(PeriodBase, 0, sizeof(PeriodBase));
+
+    BucketWidth = CycleTime_us / STAT_BUCKETS_CYCLE;
+    if (BucketWidth == 0)
+        BucketWidth = 1;
+    Started = FALSE;
+}
+
+/**
+********************************************************************************
+* @brief Puts a time into a histogram. Control task only.
+*******************************************************************************/
+MLOCAL VOID Stat_Add(STAT_HIST * pHist, UINT32 Time_us)
+{
+    UINT32  Bucket = Time_us / BucketWidth;
+
+    if (Bucket >= STAT_BUCKETS)
+        Bucket = STAT_BUCKETS - 1;
+    pHist->Count[Bucket]++;
+    if (Time_us > pHist->Max)
+        pHist->Max = Time_us;
+}
+
+/**
+********************************************************************************
+* @brief Takes the start of a control cycle. Control task only.
+*******************************************************************************/
+VOID Stat_CycleStart(VOID)
+{
+    UINT32  Now = m_GetProcTime();
+
+    if (Started)
+        Stat_Add(&Period, Now - CycleStart);
+    CycleStart = Now;
+    Started = TRUE;
+}
+
+/**
+********************************************************************************
+* @brief Takes the end of the work of a control cycle. Control task only.
+*******************************************************************************/
+VOID Stat_CycleEnd(VOID)
+{
+    Stat_Add(&Exec, m_GetProcTime() - CycleStart);
+}
+
+/**
+********************************************************************************
+* @brief Calculates the percentiles of a histogram.
+*
+* @param[in]  pHist     histogram of the control task
+* @param[in]  pBase     counts of the last interval, NULL: since start
+* @param[out] pTiming   percentiles
+*
+* @retval     N/A
+*******************************************************************************/
+MLOCAL VOID Stat_Timing(const STAT_HIST * pHist, UINT32 * pBase, M1STREAM_TIMING * pTiming)
+{
+    MLOCAL const UINT32 Per1000[] = {500, 900, 990, 999};
+    UINT32  Count[STAT_BUCKETS];
+    UINT32 *pOut[4];
+    UINT32  Total = 0;
+    UINT32  Sum = 0;
+    UINT32  Bucket, p = 0;
+
+    pOut[0] = &pTiming->P50_us;
+    pOut[1] = &pTiming->P90_us;
+    pOut[2] = &pTiming->P99_us;
+    pOut[3] = &pTiming->P999_us;
+
+    /* each count on its own is consistent, which is enough here */
+    for (Bucket = 0; Bucket < STAT_BUCKETS; Bucket++)
+    {
+        Count[Bucket] = pHist->Count[Bucket];
+        if (pBase)
+        {
+            UINT32  Now = Count[Bucket];
+
+            Count[Bucket] -= pBase[Bucket];
+            pBase[Bucket] = Now;
+        }
+        Total += Count[Bucket];
+    }
+
+    memset(pTiming, 0, sizeof(*pTiming));
+    pTiming->Count = Total;
+    pTiming->Max_us = pHist->Max;
+    if (Total == 0)
+        return;
+
+    /* upper end of the bucket in which the percentile lies */
+    for (Bucket = 0; Bucket < STAT_BUCKETS && p < 4; Bucket++)
+    {
+        Sum += Count[Bucket];
+        while (p < 4 && (UINT64) Sum * 1000 >= (UINT64) Total * Per1000[p])
+        {
+            *pOut[p] = (Bucket + 1) * BucketWidth;
+            /* the last bucket has no upper end */
+            if (*pOut[p] > pTiming->Max_us || Bucket == STAT_BUCKETS - 1)
+                *pOut[p] = pTiming->Max_us;
+            p++;
+        }
+    }
+}
+
+/**
+********************************************************************************
+* @brief Fills in the reply of M1STREAM_PROC_APPSTAT. SMI task only.
+*
+* @param[in]  pCall   call, NULL: as with Interval = 0
+* @param[out] pReply  statistics
+*
+* @retval     N/A
+*******************************************************************************/
+VOID Stat_Fill(const M1STREAM_APPSTAT_C * pCall, M1STREAM_APPSTAT_R * pReply)
+{
+    ws_keepalive_stats Keepalive;
+    ws_admit_stats Admit;
+    ws_static_stats Http;
+    ws_pool_stats Pool;
+    ws_stat_client *pSlot;
+    M1STREAM_CLIENTSTAT *pClient;
+    BOOL    Interval = pCall && pCall->Interval;
+    UINT32  i;
+
+    memset(pReply, 0, sizeof(*pReply));
+
+    ws_keepalive_getStats(&Keepalive);
+    ws_admit_getStats(&Admit);
+    ws_static_getStats(&Http);
+
+    pReply->Clients = server_clients();
+    pReply->Handshakes = ws_stat.handshakes;
+    pReply->HandshakesFailed = ws_stat.handshakes_failed;
+    pReply->FramesSent = ws_stat.frames;
+    pReply->BytesSent = ws_stat.bytes;
+    pReply->FramesSkipped = ws_stat.skipped;
+    pReply->SendErrors = (UINT32) Keepalive.send_errors;
+    pReply->Evicted = (UINT32) Keepalive.evicted;
+    pReply->Connections = Admit.connections;
+    pReply->ConnectionsHigh = Admit.high;
+    pReply->RefusedFull = (UINT32) Admit.full;
+    pReply->RefusedPerIp = (UINT32) Admit.per_ip;
+    pReply->RefusedRate = (UINT32) Admit.rate;
+    pReply->HandshakeTimeouts = (UINT32) Admit.timeouts;
+    pReply->AcceptErrors = (UINT32) Admit.accept_errors;
+    pReply->HttpRequests = (UINT32) Http.requests;
+    pReply->HttpNotModified = (UINT32) Http.not_modified;
+    pReply->HttpNotFound = (UINT32) Http.not_found;
+    pReply->HttpBytes = (UINT32) Http.bytes;
+    pReply->RecDropped = m1stream_RecDropped;
+    pReply->CmdRejected = m1stream_CmdRejected;
+    pReply->CmdDropped = m1stream_CmdDropped;
+
+    Stat_Timing(&Exec, Interval ? ExecBase : NULL, &pReply->CycleExec);
+    Stat_Timing(&Period, Interval ? PeriodBase : NULL, &pReply->CyclePeriod);
+
+    for (i = 0; i < M1STREAM_STAT_POOLS; i++)
+    {
+        ws_pool_getStats((ws_pool_type) i, &Pool);
+        pReply->Pool[i].Size = (UINT32) Pool.size;
+        pReply->Pool[i].Used = (UINT32) Pool.used;
+        pReply->Pool[i].High = (UINT32) Pool.high;
+        pReply->Pool[i].Fallback = Pool.fallback;
+    }
+
+    for (i = 0; i < WS_STAT_CLIENTS && pReply->NbOfClients < M1STREAM_STAT_CLIENTS; i++)
+    {
+        pSlot = &ws_stat.client[i];
+        if (!pSlot->used)
+            continue;
+
+        pClient = &pReply->Client[pReply->NbOfClients++];
+        pClient->SocketId = pSlot->socket_id;
+        pClient->QueueDepth = ws_stat_queue(pSlot->socket_id);
+        pClient->FramesSent = pSlot->frames;
+        pClient->BytesSent = pSlot->bytes;
+        pClient->FramesSkipped = pSlot->skipped;
+        pClient->Rtt_us = pSlot->rtt;
+        pClient->Channels = pSlot->channels;
+        pClient->RateDivider = pSlot->divider;
+        pClient->Rate = pSlot->rate;
+    }
+
+    pReply->RetCode = M1STREAM_E_OK;
+}
@@ -0,0 +1,28 @@
+/**
+********************************************************************************
+* @file     m1stream_stat.h
+*
+* @brief    Streaming statistics for the SMI call M1STREAM_PROC_APPSTAT.
+*           The control task only increments counters, the reply is put
+*           together by the SMI task from them, so a monitor can poll as
+*           often as it likes without ever stopping the control task.
+*
+*******************************************************************************/
+
+/* Avoid problems with multiple including */
+#ifndef M1STREAM_STAT__H
+#define M1STREAM_STAT__H
+
+/*--- Defines ---*/
+
+#define STAT_BUCKETS        256         /* histogram buckets, the last one takes all beyond */
+#define STAT_BUCKETS_CYCLE  100         /* buckets per cycle time */
+
+/*--- Function prototyping ---*/
+
+EXTERN VOID Stat_Init(UINT32 CycleTime_us);
+EXTERN VOID Stat_CycleStart(VOID);
+EXTERN VOID Stat_CycleEnd(VOID);
+EXTERN VOID Stat_Fill(const M1STREAM_APPSTAT_C * pCall, M1STREAM_APPSTAT_R * pReply);
+
+#endif /* Avoid problems with multiple include */
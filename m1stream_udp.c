@@ -0,0 +1,179 @@
+/**
+********************************************************************************
+* @file     m1stream_udp.c
+*
+* @brief    UDP multicast output of the sample stream, see m1stream_udp.h.
+*           Udp_Send() is called by the task feeding the clients, which is
+*           the control task or the replay task, never both. The socket is
+*           non-blocking: a datagram the stack cannot take right away is
+*           counted and dropped, the receivers see the gap in Seq.
+*
+*******************************************************************************/
+
+/* VxWorks includes */
+#include <vxWorks.h>
+#include <string.h>
+#include <unistd.h>
+#include <sockLib.h>
+#include <inetLib.h>
+#include <ioLib.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* MSys includes */
+#include <mtypes.h>
+#include <msys_e.h>
+#include <log_e.h>
+
+/* Project includes */
+#include "m1stream.h"
+#include "m1stream_int.h"
+#include "m1stream_rec.h"
+#include "m1stream_udp.h"
+
+/* Global variables: settings and statistics, exported by SVI */
+UDP_CONFIG m1stream_UdpCfg = {
+    0,                                  /* Enable */
+    "239.255.77.1",                     /* Address, organization-local scope */
+    4568,                               /* Port, next to the websocket server */
+    "",                                 /* Interface */
+    1,                                  /* Ttl, this subnet only */
+    0                                   /* Loop */
+};
+UINT32  m1stream_UdpSent = 0;
+UINT32  m1stream_UdpErrors = 0;
+
+MLOCAL int UdpFd = ERROR;
+MLOCAL struct sockaddr_in Dest;
+MLOCAL UINT32 Seq = 0;
+
+/**
+********************************************************************************
+* @brief Opens the socket if the output is enabled.
+*        Called before the tasks are started.
+*
+* @param[in]  N/A
+* @param[out] N/A
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. ERROR
+*******************************************************************************/
+SINT32 Udp_Init(VOID)
+{
+    CHAR    Func[] = "Udp_Init";
+    struct in_addr If;
+    unsigned char Ttl, Loop;
+    int     on = 1;
+
+    m1stream_UdpSent = 0;
+    m1stream_UdpErrors = 0;
+    Seq = 0;
+
+    if (!m1stream_UdpCfg.Enable)
+        return (OK);
+
+    memset(&Dest, 0, sizeof(Dest));
+    Dest.sin_family = AF_INET;
+    Dest.sin_port = htons((unsigned short) m1stream_UdpCfg.Port);
+    Dest.sin_addr.s_addr = inet_addr(m1stream_UdpCfg.Address);
+    /* the limited broadcast is the same as the error value of inet_addr() */
+    if ((Dest.sin_addr.s_addr == INADDR_NONE && strcmp(m1stream_UdpCfg.Address, "255.255.255.255") != 0) ||
+        m1stream_UdpCfg.Port <= 0 || m1stream_UdpCfg.Port > 65535)
+    {
+        LOG_E(0, Func, "Invalid destination %s:%d", m1stream_UdpCfg.Address, m1stream_UdpCfg.Port);
+        return (ERROR);
+    }
+
+    UdpFd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (UdpFd < 0)
+    {
+        LOG_E(0, Func, "Could not create the socket!");
+        return (ERROR);
+    }
+
+    do
+    {
+        if (ioctl(UdpFd, FIONBIO, &on) < 0)
+            break;
+
+        if (IN_MULTICAST(ntohl(Dest.sin_addr.s_addr)))
+        {
+            Ttl = (unsigned char) m1stream_UdpCfg.Ttl;
+            Loop = m1stream_UdpCfg.Loop ? 1 : 0;
+            if (setsockopt(UdpFd, IPPROTO_IP, IP_MULTICAST_TTL, &Ttl, sizeof(Ttl)) < 0 ||
+                setsockopt(UdpFd, IPPROTO_IP, IP_MULTICAST_LOOP, &Loop, sizeof(Loop)) < 0)
+                break;
+
+            if (m1stream_UdpCfg.Interface[0])
+            {
+                If.s_addr = inet_addr(m1stream_UdpCfg.Interface);
+                if (setsockopt(UdpFd, IPPROTO_IP, IP_MULTICAST_IF, &If, sizeof(If)) < 0)
+                    break;
+            }
+        }
+        else if (setsockopt(UdpFd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on)) < 0)
+            break;
+
+        LOG_I(0, Func, "Sending the samples to %s:%d", m1stream_UdpCfg.Address, m1stream_UdpCfg.Port);
+        return (OK);
+    }
+    while (0);
+
+    LOG_E(0, Func, "Could not set up the socket for %s!", m1stream_UdpCfg.Address);
+    Udp_Deinit();
+    return (ERROR);
+}
+
+/**
+********************************************************************************
+* @brief Closes the socket. Called after all tasks have ended.
+*******************************************************************************/
+VOID Udp_Deinit(VOID)
+{
+    if (UdpFd >= 0)
+        close(UdpFd);
+    UdpFd = ERROR;
+}
+
+/**
+********************************************************************************
+* @brief Sends the values of one cycle as one datagram.
+*
+* @param[in]  pRec    values of one cycle
+* @param[out] N/A
+*
+* @retval     N/A
+*******************************************************************************/
+VOID Udp_Send(const REC_RECORD * pRec)
+{
+    UDP_DATAGRAM Dgram;
+    int     i;
+
+    if (UdpFd < 0)
+        return;
+
+    Dgram.Magic = htonl(UDP_MAGIC);
+    Dgram.Version = htons(UDP_VERSION);
+    Dgram.Channels = htons(REC_CHANNELS);
+    Dgram.Seq = htonl(Seq);
+    Dgram.Cycle = htonl(pRec->Cycle);
+    Dgram.Valid = htonl(pRec->Valid);
+    Dgram.Time_us = htonl(m_GetProcTime());
+    for (i = 0; i < REC_CHANNELS; i++)
+    {
+        Dgram.Channel[i].CardNb = htons(pRec->Channel[i].CardNb);
+        Dgram.Channel[i].Chan = htons(pRec->Channel[i].Chan);
+        Dgram.Channel[i].Value = (SINT32) htonl((UINT32) pRec->Channel[i].Value);
+    }
+
+    /* a dropped datagram still takes its number, so that it shows as gap */
+    Seq++;
+    if (sendto(UdpFd, (char *) &Dgram, sizeof(Dgram), 0, (struct sockaddr *) &Dest, sizeof(Dest)) !=
+        (int) sizeof(Dgram))
+    {
+        m1stream_UdpErrors++;
+        return;
+    }
+    m1stream_UdpSent++;
+}
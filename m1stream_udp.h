@@ -0,0 +1,72 @@
+/**
+********************************************************************************
+* @file     m1stream_udp.h
+*
+* @brief    UDP multicast (or broadcast) output of the sample stream, for any
+*           number of displays on the LAN. Each frame goes out as one
+*           datagram, whatever the number of receivers, next to the frames
+*           of the websocket server.
+*
+*           Datagram:  UDP_DATAGRAM, all values big-endian
+*           Seq counts the datagrams, a receiver detects lost or reordered
+*           datagrams by a gap. Seq starts at 0 with each module start.
+*
+*******************************************************************************/
+
+/* Avoid problems with multiple including */
+#ifndef M1STREAM_UDP__H
+#define M1STREAM_UDP__H
+
+/*--- Defines ---*/
+
+#define UDP_MAGIC           0x4D315355  /* "M1SU" */
+#define UDP_VERSION         1
+#define UDP_ADDRLEN         32          /* dotted IPv4 address */
+
+/*--- Structures ---*/
+
+/* One channel of a datagram */
+typedef struct UDP_CHANNEL
+{
+    UINT16  CardNb;                     /* card number, 0: channel not configured */
+    UINT16  Chan;                       /* channel number on the card */
+    SINT32  Value;                      /* value read in this cycle */
+} UDP_CHANNEL;
+
+/* One frame, 152 bytes */
+typedef struct UDP_DATAGRAM
+{
+    UINT32  Magic;                      /* UDP_MAGIC */
+    UINT16  Version;                    /* UDP_VERSION */
+    UINT16  Channels;                   /* entries in Channel[] */
+    UINT32  Seq;                        /* datagram counter */
+    UINT32  Cycle;                      /* cycle counter of the control task */
+    UINT32  Valid;                      /* bit n set: Channel[n] was read successfully */
+    UINT32  Time_us;                    /* time of sending, m_GetProcTime() */
+    UDP_CHANNEL Channel[REC_CHANNELS];
+} UDP_DATAGRAM;
+
+/* Settings from (Multicast) in mconfig */
+typedef struct UDP_CONFIG
+{
+    SINT32  Enable;                     /* send the datagrams */
+    CHAR    Address[UDP_ADDRLEN];       /* multicast group or broadcast address */
+    SINT32  Port;                       /* destination port */
+    CHAR    Interface[UDP_ADDRLEN];     /* address of the sending interface, "" = routing table */
+    SINT32  Ttl;                        /* router hops of a multicast datagram */
+    SINT32  Loop;                       /* receivers on the controller itself get the datagrams */
+} UDP_CONFIG;
+
+/*--- Variable definitions ---*/
+
+EXTERN UDP_CONFIG m1stream_UdpCfg;
+EXTERN UINT32 m1stream_UdpSent;       /* datagrams sent */
+EXTERN UINT32 m1stream_UdpErrors;     /* datagrams the stack did not take */
+
+/*--- Function prototyping ---*/
+
+EXTERN SINT32 Udp_Init(VOID);
+EXTERN VOID Udp_Deinit(VOID);
+EXTERN VOID Udp_Send(const REC_RECORD * pRec);
+
+#endif /* Avoid problems with multiple include */
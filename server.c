@@ -9,34 +9,195 @@
 #include "ws/Communicate.h"
 #include "ws/Errors.h"
 #include "ws/Datastructures.h"
+#include "ws/Deflate.h"
+#include "ws/Keepalive.h"
+#include "ws/Admit.h"
+#include "ws/Pool.h"
+#include "ws/Rate.h"
+#include "ws/Static.h"
+#include "ws/Stats.h"
+#include "ws/Log.h"
+#include "server.h"
 #include <sockLib.h>
 #include <pthread.h>
 #include <inetLib.h>
 
-ws_list *server_l;
+ws_list *server_l[SERVER_STREAMS + 1];    /* clients of each stream, NULL terminated */
 int server_port;
 
-#define PORT 4567
+server_config server_cfg = {
+    SERVER_PORT,                        /* port */
+    1,                                  /* streams */
+    {"/"},                              /* stream_path */
+    1,                                  /* deflate_enable */
+    DEFLATE_LEVEL,                      /* deflate_level */
+    DEFLATE_MIN_SIZE,                   /* deflate_min_size */
+    KEEPALIVE_INTERVAL,                 /* keepalive_interval */
+    KEEPALIVE_MISSED,                   /* keepalive_missed */
+    WS_POOL_CLIENTS,                    /* max_clients */
+    WS_ADMIT_CONNECTIONS,               /* max_connections */
+    WS_ADMIT_PER_IP,                    /* max_per_ip */
+    WS_ADMIT_RATE,                      /* handshake_rate */
+    WS_ADMIT_BURST,                     /* handshake_burst */
+    WS_ADMIT_TIMEOUT,                   /* handshake_timeout */
+    64,                                 /* backlog */
+    WS_RATE_DIVIDER,                    /* rate_max_divider */
+    WS_RATE_QUEUE,                      /* rate_queue */
+    1,                                  /* http_enable */
+    WS_STATIC_IDLE,                     /* http_idle_timeout */
+    NULL,                               /* assets */
+    0,                                  /* asset_count */
+    0,                                  /* log_to_file */
+    "/cfc0/m1stream.log",               /* log_file */
+    NULL,                               /* snapshot */
+    NULL,                               /* subscribe */
+    NULL                                /* input */
+};
+
+#define SNAPSHOT_SIZE 2048
+#define VIEW_MAX 16                     /* distinct channel selections per send_channels() */
+#define VIEW_SIZE 1024                  /* largest frame of send_channels() */
+#define SUBSCRIBE_PARAM "channels="     /* channel list in the upgrade URL */
 
 /**
- * Shuts down a client in a safe way. This is only used for Hybi-00.
+ * The frames of one send_channels() call, one per channel selection.
+ */
+typedef struct {
+    int (*format)(uint32_t channels, void *arg, char *buffer, int size);
+    void *arg;
+    int count;
+    uint32_t channels[VIEW_MAX];
+    ws_message *message[VIEW_MAX];
+    ws_message *spare;                  /* for clients beyond VIEW_MAX selections */
+} server_views;
+
+/**
+ * Shuts down a client in a safe way. This is only used for Hybi-00. It is
+ * pushed once the client is in the list of its stream: before that, every
+ * way out of the handshake has released the client already.
  */
 void server_cleanup_client(void *args) {
     ws_client *n = args;
     if (n != NULL) {
-        printf("Shutting client down..\n\n> ");
-        fflush(stdout);
-        list_remove(server_l, n);
+        WS_LOG(WS_LOG_WRN, "Shutting client down..");
+        list_remove(server_l[n->stream], n);
+    }
+}
+
+/**
+ * Sends the snapshot of server_cfg.snapshot for the channels of a client.
+ * Right after the handshake the client is not in the list yet, so no
+ * broadcast can be written to its socket at the same time. Later on the
+ * list lock keeps the snapshot and the broadcasts apart.
+ */
+void server_send_snapshot(ws_client *n, int in_list) {
+    char buffer[SNAPSHOT_SIZE];
+    int len;
+
+    if (server_cfg.snapshot == NULL || n->headers->type == UNKNOWN) {
+        return;
+    }
+
+    len = server_cfg.snapshot(n->stream, n->channels, buffer, sizeof(buffer));
+    if (len <= 0) {
+        return;
+    }
+
+    ws_message *m = message_new();
+    if (m == NULL) {
+        return;
+    }
+
+    m->msg = malloc(len + 1);
+    if (m->msg == NULL) {
+        message_unref(m);
+        return;
+    }
+    memcpy(m->msg, buffer, len);
+    m->msg[len] = '\0';
+    m->len = len;
+
+    if (encodeMessage(m) == CONTINUE) {
+        if (in_list) {
+            list_multicast_one(server_l[n->stream], n, m);
+        } else {
+            ws_send(n, m);
+        }
     }
+
+    message_unref(m);
+}
+
+/**
+ * Selects the stream of a client by the resource of the upgrade request,
+ * without the query, e.g. "GET /line2?channels=3.1 HTTP/1.1". With one
+ * stream, every resource leads to it.
+ *
+ * Returns 0 if the client has its stream, -1 if there is none at the path.
+ */
+int server_route(ws_client *n) {
+    const char *r = n->headers->resourcename;
+    size_t len;
+    int i;
+
+    if (server_cfg.streams <= 1) {
+        return 0;
+    }
+    if (r == NULL) {
+        return -1;
+    }
+
+    len = strcspn(r, "?");
+    for (i = 0; i < server_cfg.streams; i++) {
+        if (strlen(server_cfg.stream_path[i]) == len &&
+                strncmp(r, server_cfg.stream_path[i], len) == 0) {
+            n->stream = i;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Takes the channel selection from the upgrade URL, e.g.
+ * "GET /?channels=3.1,3.2 HTTP/1.1". Without one, the client gets all
+ * channels.
+ */
+void server_subscribe_url(ws_client *n) {
+    char list[128];
+    char *p;
+    int i;
+
+    if (n->headers->resourcename == NULL ||
+            (p = strstr(n->headers->resourcename, SUBSCRIBE_PARAM)) == NULL) {
+        return;
+    }
+    p += strlen(SUBSCRIBE_PARAM);
+
+    /**
+     * %2C is how some clients encode the comma.
+     */
+    for (i = 0; *p != '\0' && *p != '&' && i < (int) sizeof(list) - 1; p++) {
+        if (strncmp(p, "%2C", 3) == 0 || strncmp(p, "%2c", 3) == 0) {
+            list[i++] = ',';
+            p += 2;
+        } else {
+            list[i++] = *p;
+        }
+    }
+    list[i] = '\0';
+
+    ws_subscribe(n, list);
 }
 
 void *server_handleClient(void *args) {
     pthread_detach(pthread_self());
     pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
     pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
-    pthread_cleanup_push(&server_cleanup_client, args);
 
     int buffer_length = 0, string_length = 1, reads = 1;
+    uint64_t deadline = ws_admit_deadline();
 
     ws_client *n = args;
     n->thread_id = pthread_self();
@@ -53,11 +214,9 @@ void *server_handleClient(void *args) {
         pthread_exit((void *) EXIT_FAILURE);
     }
 
-    printf("Client connected with the following information:\n"
-           "\tSocket: %d\n"
-           "\tAddress: %s\n\n", n->socket_id, (char *) n->client_ip);
-    printf("Checking whether client is valid ...\n\n");
-    fflush(stdout);
+    WS_LOG(WS_LOG_WRN, "Client connected on socket %d from %s",
+            n->socket_id, (char *) n->client_ip);
+    WS_LOG(WS_LOG_INF, "Checking whether client is valid ...");
 
     /**
      * Getting headers and doing reallocation if headers is bigger than our
@@ -65,7 +224,14 @@ void *server_handleClient(void *args) {
      */
     do {
         memset(buffer, '\0', BUFFERSIZE);
-        if ((buffer_length = recv(n->socket_id, buffer, BUFFERSIZE, 0)) <= 0){
+        buffer_length = ws_admit_recv(n->socket_id, buffer, BUFFERSIZE,
+                deadline);
+        if (buffer_length == WS_ADMIT_EXPIRED) {
+            pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+            handshake_error("The headers took too long.", ERROR_TIMEOUT, n);
+            pthread_exit((void *) EXIT_FAILURE);
+        }
+        if (buffer_length <= 0) {
             pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
             handshake_error("Didn't receive any headers from the client.",
                     ERROR_BAD, n);
@@ -99,8 +265,12 @@ void *server_handleClient(void *args) {
             && strncmp("\r\n\r\n", n->string + (string_length-8-5), 4) != 0
             && strncmp("\n\n", n->string + (string_length-8-3), 2) != 0 );
 
-    printf("User connected with the following headers:\n%s\n\n", n->string);
-    fflush(stdout);
+    if (deadline != 0) {
+        ws_admit_done(n->socket_id);
+    }
+
+    WS_LOG_BLOCK(WS_LOG_DBG, "User connected with the following headers:",
+            n->string);
 
     ws_header *h = header_new();
 
@@ -114,36 +284,78 @@ void *server_handleClient(void *args) {
 
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
     if ( parseHeaders(n->string, n, server_port) < 0 ) {
+        ws_stat_handshake(0);
         pthread_exit((void *) EXIT_FAILURE);
     }
 
+    /**
+     * A plain HTTP request gets a file, the connection is never upgraded.
+     * ws_static_session() releases n, and the cleanup handler is not pushed
+     * yet, so nothing touches n after it.
+     */
+    if ( n->headers->type == HTTP ) {
+        ws_static_session(n);
+        pthread_exit((void *) EXIT_SUCCESS);
+    }
+
+    if ( server_route(n) < 0 ) {
+        handshake_error("No stream at this resource.", ERROR_NOT_FOUND, n);
+        ws_stat_handshake(0);
+        pthread_exit((void *) EXIT_FAILURE);
+    }
+
+    server_subscribe_url(n);
+
     if ( sendHandshake(n) < 0 && n->headers->type != UNKNOWN ) {
+        ws_stat_handshake(0);
         pthread_exit((void *) EXIT_FAILURE);
     }
+    ws_stat_handshake(1);
+
+    /**
+     * The last values go out before the client is added to the list, so
+     * it can render without waiting for the next broadcast.
+     */
+    server_send_snapshot(n, 0);
 
-    list_add(server_l, n);
+    list_add(server_l[n->stream], n);
+    pthread_cleanup_push(&server_cleanup_client, n);
     pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
 
-    printf("Client has been validated and is now connected\n\n");
-    printf("> ");
-    fflush(stdout);
+    WS_LOG(WS_LOG_WRN, "Client has been validated and is now connected");
 
     uint64_t next_len = 0;
     char next[BUFFERSIZE];
+    ws_connection_close status;
     memset(next, '\0', BUFFERSIZE);
 
     while (1) {
-        if ( communicate(n, next, next_len) != CONTINUE) {
+        if ( (status = communicate(n, next, next_len)) != CONTINUE) {
+            n->close = status;
             break;
         }
 
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
-        if (n->headers->protocol == CHAT) {
-            list_multicast(server_l, n);
+        if (n->message->opcode[0] & 0x08) {
+            /**
+             * Ping and pong are between the server and this client only.
+             */
+            ws_keepalive_control(server_l[n->stream], n);
+        } else if (n->message->command == WS_COMMAND_SUBSCRIBE) {
+            /**
+             * A new subscription takes effect with the current values.
+             */
+            server_send_snapshot(n, 1);
+        } else if (n->message->command) {
+            /**
+             * Binary commands have been handed to the control task already.
+             */
+        } else if (n->headers->protocol == CHAT) {
+            list_multicast(server_l[n->stream], n);
         } else if (n->headers->protocol == ECHO) {
-            list_multicast_one(server_l, n, n->message);
+            list_multicast_one(server_l[n->stream], n, n->message);
         } else {
-            list_multicast_one(server_l, n, n->message);
+            list_multicast_one(server_l[n->stream], n, n->message);
         }
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
 
@@ -151,18 +363,14 @@ void *server_handleClient(void *args) {
             memset(next, '\0', BUFFERSIZE);
             memcpy(next, n->message->next, n->message->next_len);
             next_len = n->message->next_len;
-            message_free(n->message);
-            free(n->message);
-            n->message = NULL;
+            client_message_done(n);
         }
     }
 
-    printf("Shutting client down..\n\n");
-    printf("> ");
-    fflush(stdout);
+    WS_LOG(WS_LOG_WRN, "Shutting client down..");
 
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
-    list_remove(server_l, n);
+    list_remove(server_l[n->stream], n);
     pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
 
     pthread_cleanup_pop(0);
@@ -170,7 +378,7 @@ void *server_handleClient(void *args) {
 }
 
 void server_sigint_handler(int sig) {
-    printf("signal\n");
+    WS_LOG(WS_LOG_WRN, "signal");
 }
 
 int server_main() {
@@ -180,11 +388,27 @@ int server_main() {
     socklen_t client_length;
     pthread_t pthread_id;
     pthread_attr_t pthread_attr;
+    struct timeval timeout;
+    struct timespec wait;
+    ws_admit_result admit;
+    int i;
+
+    /**
+     * The clients and their messages come from pools, allocated once.
+     */
+    ws_pool_configure(server_cfg.max_clients);
 
     /**
-     * Creating new lists, l is supposed to contain the connected users.
+     * Creating new lists, one per stream, each is supposed to contain the
+     * users connected to the stream.
      */
-    server_l = list_new();
+    if (server_cfg.streams < 1 || server_cfg.streams > SERVER_STREAMS) {
+        server_cfg.streams = 1;
+    }
+    for (i = 0; i < server_cfg.streams; i++) {
+        server_l[i] = list_new();
+    }
+    server_l[server_cfg.streams] = NULL;
 
     /**
      * Listens for CTRL-C and Segmentation faults.
@@ -194,63 +418,74 @@ int server_main() {
     (void) signal(SIGPIPE, &server_sigint_handler);
 
 
-    printf("Server: \t\tStarted\n");
-    fflush(stdout);
+    WS_LOG(WS_LOG_INF, "Server: \t\tStarted");
 
-    server_port = PORT;
+    server_port = server_cfg.port;
 
-    printf("Port: \t\t\t%d\n", server_port);
-    fflush(stdout);
+    ws_deflate_configure(server_cfg.deflate_enable, server_cfg.deflate_level,
+            server_cfg.deflate_min_size);
+    ws_keepalive_configure(server_cfg.keepalive_interval,
+            server_cfg.keepalive_missed);
+    ws_rate_configure(server_cfg.rate_max_divider, server_cfg.rate_queue);
+    ws_admit_configure(server_cfg.max_connections, server_cfg.max_per_ip,
+            server_cfg.handshake_rate, server_cfg.handshake_burst,
+            server_cfg.handshake_timeout);
+    ws_subscribe_configure(server_cfg.subscribe);
+    ws_binary_configure(server_cfg.input);
+    ws_static_configure(server_cfg.http_enable ? server_cfg.assets : NULL,
+            server_cfg.asset_count, server_cfg.http_idle_timeout);
+
+    WS_LOG(WS_LOG_INF, "Port: \t\t\t%d", server_port);
+    for (i = 0; i < server_cfg.streams; i++) {
+        WS_LOG(WS_LOG_INF, "Stream %d: \t\t%s", i,
+                (server_cfg.streams > 1) ? server_cfg.stream_path[i] : "any");
+    }
 
     /**
      * Opening server socket.
      */
     if ( (server_socket = socket(AF_INET, SOCK_STREAM, 0)) < 0 ) {
-        server_error(strerror(errno), server_socket, server_l);
+        server_error(strerror(errno), server_socket, server_l[0]);
     }
 
-    printf("Socket: \t\tInitialized\n");
-    fflush(stdout);
+    WS_LOG(WS_LOG_INF, "Socket: \t\tInitialized");
 
     /**
      * Allow reuse of address, when the server shuts down.
      */
     if ( (setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &on,
                     sizeof(on))) < 0 ){
-        server_error(strerror(errno), server_socket, server_l);
+        server_error(strerror(errno), server_socket, server_l[0]);
     }
 
-    printf("Reuse Port %d: \tEnabled\n", server_port);
-    fflush(stdout);
+    WS_LOG(WS_LOG_INF, "Reuse Port %d: \tEnabled", server_port);
 
     memset((char *) &server_addr, '\0', sizeof(server_addr));
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
     server_addr.sin_port = htons(server_port);
 
-    printf("Ip Address: \t\t%s\n", inet_ntoa(server_addr.sin_addr));
-    fflush(stdout);
+    WS_LOG(WS_LOG_INF, "Ip Address: \t\t%s", inet_ntoa(server_addr.sin_addr));
 
     /**
      * Bind address.
      */
     if ( (bind(server_socket, (struct sockaddr *) &server_addr,
             sizeof(server_addr))) < 0 ) {
-        server_error(strerror(errno), server_socket, server_l);
+        server_error(strerror(errno), server_socket, server_l[0]);
     }
 
-    printf("Binding: \t\tSuccess\n");
-    fflush(stdout);
+    WS_LOG(WS_LOG_INF, "Binding: \t\tSuccess");
 
     /**
-     * Listen on the server socket for connections
+     * Listen on the server socket for connections, the backlog takes a
+     * burst of them while the loop below refuses what is too much.
      */
-    if ( (listen(server_socket, 10)) < 0) {
-        server_error(strerror(errno), server_socket, server_l);
+    if ( (listen(server_socket, server_cfg.backlog)) < 0) {
+        server_error(strerror(errno), server_socket, server_l[0]);
     }
 
-    printf("Listen: \t\tSuccess\n\n");
-    fflush(stdout);
+    WS_LOG(WS_LOG_INF, "Listen: \t\tSuccess");
 
     /**
      * Attributes for the threads we will create when a new client connects.
@@ -259,8 +494,19 @@ int server_main() {
     pthread_attr_setdetachstate(&pthread_attr, PTHREAD_CREATE_DETACHED);
     pthread_attr_setstacksize(&pthread_attr, 524288);
 
-    printf("Server is now waiting for clients to connect ...\n\n");
-    fflush(stdout);
+    WS_LOG(WS_LOG_INF, "Server is now waiting for clients to connect ...");
+
+    /**
+     * Create the thread, which pings the clients of all streams and drops
+     * dead ones.
+     */
+    if (server_cfg.keepalive_interval > 0) {
+        if ( (pthread_create(&pthread_id, &pthread_attr, ws_keepalive_thread,
+                        (void *) server_l)) < 0 ){
+            server_error(strerror(errno), server_socket, server_l[0]);
+        }
+        pthread_detach(pthread_id);
+    }
 
 //    /**
 //     * Create commandline, such that we can do simple commands on the server.
@@ -283,7 +529,47 @@ int server_main() {
         if ( (client_socket = accept(server_socket,
                 (struct sockaddr *) &client_addr,
                 &client_length)) < 0) {
-            server_error(strerror(errno), server_socket, server_l);
+            /**
+             * Out of descriptors or memory for a moment, e.g. during a
+             * flood of connections: the server waits a bit and goes on.
+             */
+            if (errno == EINTR || errno == ECONNABORTED || errno == EMFILE
+                    || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                WS_LOG(WS_LOG_WRN, "Accept failed: %s", strerror(errno));
+                ws_admit_acceptError();
+                wait.tv_sec = 0;
+                wait.tv_nsec = 100000000;
+                nanosleep(&wait, NULL);
+                continue;
+            }
+            server_error(strerror(errno), server_socket, server_l[0]);
+        }
+
+        /**
+         * Connections beyond the limits are refused before they get a
+         * thread or any memory.
+         */
+        if ( (admit = ws_admit(client_addr.sin_addr.s_addr)) != ADMIT_OK ) {
+            WS_LOG(WS_LOG_DBG, "Refused connection from %s: %s",
+                    inet_ntoa(client_addr.sin_addr),
+                    (admit == ADMIT_FULL) ? "too many connections" :
+                    (admit == ADMIT_PER_IP) ? "too many from this address" :
+                    "too many handshakes");
+            send(client_socket, ERROR_UNAVAILABLE, strlen(ERROR_UNAVAILABLE),
+                    MSG_DONTWAIT);
+            close(client_socket);
+            continue;
+        }
+
+        /**
+         * The broadcasts never wait for the socket of a client, this limits
+         * the other sends, e.g. of the handshake, to one ping interval.
+         */
+        if (server_cfg.keepalive_interval > 0) {
+            timeout.tv_sec = server_cfg.keepalive_interval / 1000;
+            timeout.tv_usec = (server_cfg.keepalive_interval % 1000) * 1000;
+            setsockopt(client_socket, SOL_SOCKET, SO_SNDTIMEO,
+                    (char *) &timeout, sizeof(timeout));
         }
 
         /**
@@ -293,13 +579,21 @@ int server_main() {
         char *temp = (char *) inet_ntoa(client_addr.sin_addr);
         char *addr = (char *) malloc( sizeof(char)*(strlen(temp)+1) );
         if (addr == NULL) {
-            server_error(strerror(errno), server_socket, server_l);
+            server_error(strerror(errno), server_socket, server_l[0]);
             break;
         }
         memset(addr, '\0', strlen(temp)+1);
         memcpy(addr, temp, strlen(temp));
 
         ws_client *n = client_new(client_socket, addr);
+        if (n == NULL) {
+            ws_admit_release(client_addr.sin_addr.s_addr);
+            free(addr);
+            close(client_socket);
+            continue;
+        }
+        n->admitted = 1;
+        n->admit_addr = client_addr.sin_addr.s_addr;
 
         /**
          * Create client thread, which will take care of handshake and all
@@ -307,24 +601,33 @@ int server_main() {
          */
         if ( (pthread_create(&pthread_id, &pthread_attr, server_handleClient,
                         (void *) n)) < 0 ){
-            server_error(strerror(errno), server_socket, server_l);
+            server_error(strerror(errno), server_socket, server_l[0]);
         }
 
         pthread_detach(pthread_id);
     }
 
-    list_free(server_l);
-    server_l = NULL;
+    for (i = 0; i < server_cfg.streams; i++) {
+        ws_list *l = server_l[i];
+
+        server_l[i] = NULL;
+        list_free(l);
+    }
     close(server_socket);
     pthread_attr_destroy(&pthread_attr);
     return EXIT_SUCCESS;
 }
 
-void send_to_all(char *message)
+/**
+ * Sends a text message to every client of a stream.
+ */
+void send_to_all(int stream, char *message)
 {
+    ws_list *l = server_l[stream];
+
     do
     {
-        if (server_l)
+        if (l)
         {
             ws_connection_close status;
 
@@ -342,15 +645,13 @@ void send_to_all(char *message)
             temp = NULL;
 
             if ( (status = encodeMessage(m)) != CONTINUE) {
-                message_free(m);
-                free(m);
+                message_unref(m);
                 raise(SIGINT);
                 break;
             }
 
-            list_multicast_all(server_l, m);
-            message_free(m);
-            free(m);
+            list_multicast_all(l, m);
+            message_unref(m);
         }
         else
         {
@@ -359,3 +660,118 @@ void send_to_all(char *message)
     }
     while (0);
 }
+
+/**
+ * Returns the frame for a channel selection, built by the format function
+ * of send_channels() on first use. Called with the client list locked.
+ */
+static ws_message *server_view(uint32_t channels, void *arg)
+{
+    server_views *v = arg;
+    char buffer[VIEW_SIZE];
+    ws_message *m;
+    int i, len;
+
+    for (i = 0; i < v->count; i++) {
+        if (v->channels[i] == channels) {
+            return v->message[i];
+        }
+    }
+
+    len = v->format(channels, v->arg, buffer, sizeof(buffer));
+    if (len <= 0 || (m = message_new()) == NULL) {
+        return NULL;
+    }
+    m->msg = malloc(len + 1);
+    if (m->msg == NULL) {
+        message_unref(m);
+        return NULL;
+    }
+    memcpy(m->msg, buffer, len);
+    m->msg[len] = '\0';
+    m->len = len;
+
+    if (encodeMessage(m) != CONTINUE) {
+        message_unref(m);
+        return NULL;
+    }
+
+    if (v->count < VIEW_MAX) {
+        v->channels[v->count] = channels;
+        v->message[v->count++] = m;
+    } else {
+        /**
+         * More selections than expected, this frame is for one client.
+         */
+        if (v->spare != NULL) {
+            message_unref(v->spare);
+        }
+        v->spare = m;
+    }
+
+    return m;
+}
+
+/**
+ * Sends every client of a stream the frame for the channels it has
+ * subscribed to. format() fills in the frame for a channel selection and
+ * returns its length. It is called once per distinct selection, not once
+ * per client, and so is the encoding and compression of each frame.
+ */
+void send_channels(int stream, int (*format)(uint32_t channels, void *arg,
+        char *buffer, int size), void *arg)
+{
+    ws_list *l = server_l[stream];
+    server_views v;
+    int i;
+
+    if (!l) {
+        return;
+    }
+
+    v.format = format;
+    v.arg = arg;
+    v.count = 0;
+    v.spare = NULL;
+
+    list_multicast_views(l, server_view, &v);
+
+    for (i = 0; i < v.count; i++) {
+        message_unref(v.message[i]);
+    }
+    if (v.spare != NULL) {
+        message_unref(v.spare);
+    }
+}
+
+/**
+ * Changes the channel selections of the clients of all streams, after the
+ * channels were numbered anew. Clients which get all channels keep getting
+ * all of them.
+ */
+void server_map_channels(uint32_t (*map)(uint32_t channels, void *arg),
+        void *arg)
+{
+    ws_list *l;
+    int i;
+
+    for (i = 0; i < SERVER_STREAMS && (l = server_l[i]) != NULL; i++) {
+        list_map_channels(l, map, arg);
+    }
+}
+
+/**
+ * Number of connected clients of all streams. Read without the lock, for
+ * statistics.
+ */
+int server_clients(void)
+{
+    ws_list *l;
+    int i, clients = 0;
+
+    for (i = 0; i < SERVER_STREAMS && (l = server_l[i]) != NULL; i++) {
+        clients += l->len;
+    }
+
+    return clients;
+}
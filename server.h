@@ -8,7 +8,69 @@
 #ifndef SERVER_H_
 #define SERVER_H_
 
+#include <stdint.h>
+#include "ws/Static.h"
+
+#define SERVER_PORT 4567                /* default port of all streams */
+#define SERVER_STREAMS 8                /* streams one server carries at most */
+#define SERVER_PATH_SIZE 32             /* longest resource path of a stream + 1 */
+
+/**
+ * Settings of the websocket server, to be filled in before server_main()
+ * is spawned.
+ */
+typedef struct server_config {
+    int port;                   /* TCP port of all streams */
+    int streams;                /* streams, 1 .. SERVER_STREAMS */
+    char stream_path[SERVER_STREAMS][SERVER_PATH_SIZE];
+                                /* resource of each stream in the upgrade
+                                 * request, e.g. "/line2". With one stream
+                                 * any resource leads to it. */
+    int deflate_enable;         /* negotiate permessage-deflate */
+    int deflate_level;          /* zlib compression level 1 .. 9 */
+    int deflate_min_size;       /* smallest message which is compressed */
+    int keepalive_interval;     /* ms between pings, 0 disables them */
+    int keepalive_missed;       /* unanswered pings before a client is dropped */
+    int max_clients;            /* clients the pools are allocated for, more
+                                 * can connect but need the heap */
+    int max_connections;        /* connections open at the same time, more
+                                 * are refused right after accept() */
+    int max_per_ip;             /* connections of one address, 0 = any */
+    int handshake_rate;         /* handshakes per second, 0 = any */
+    int handshake_burst;        /* handshakes at once after a quiet time */
+    int handshake_timeout;      /* ms for the headers of the handshake,
+                                 * 0 = no limit */
+    int backlog;                /* connections the stack queues for accept() */
+    int rate_max_divider;       /* a slow client gets down to every n-th frame
+                                 * of the stream, 1 = every client gets all */
+    int rate_queue;             /* bytes in the send buffer of a client which
+                                 * make its rate go down */
+    int http_enable;            /* serve the assets to plain HTTP requests */
+    int http_idle_timeout;      /* ms an HTTP connection is kept without a
+                                 * request */
+    const ws_asset *assets;     /* files served by HTTP, NULL = none */
+    int asset_count;            /* files in assets */
+    int log_to_file;            /* 0: log to the logger, 1: log to log_file */
+    char log_file[128];         /* path of the log file */
+    int (*snapshot)(int stream, uint32_t channels, char *buffer, int size);
+                                /* fills in the frame sent right after the
+                                 * handshake, returns its length, NULL = none */
+    uint32_t (*subscribe)(int stream, const char *list);
+                                /* channel mask of a subscription list,
+                                 * NULL = every client gets all channels */
+    int (*input)(int stream, const char *data, uint64_t len);
+                                /* takes a binary message from a client,
+                                 * NULL = binary messages are not allowed */
+} server_config;
+
+extern server_config server_cfg;
+
 int server_main();
-void send_to_all(char *message);
+void send_to_all(int stream, char *message);
+void send_channels(int stream, int (*format)(uint32_t channels, void *arg,
+        char *buffer, int size), void *arg);
+void server_map_channels(uint32_t (*map)(uint32_t channels, void *arg),
+        void *arg);
+int server_clients(void);
 
 #endif /* SERVER_H_ */
@@ -0,0 +1,243 @@
+/**
+********************************************************************************
+* @file     asset_pack.c
+*
+* @brief    Packs the files of the built-in HTTP server (ws/Static.h) into a
+*           C file, which is compiled into the module: each file as it is
+*           and gzip compressed, with a weak ETag from its CRC-32 and length,
+*           the same for both, which only changes with the content. A file
+*           given for more than one resource is stored once. 'make assets'
+*           runs it for the files of html/ and writes m1stream_assets.c.
+*
+*               ./asset_pack -o file.c resource=file ...
+*
+*******************************************************************************/
+
+#include <unistd.h>
+#include <zlib.h>
+
+#include "msys_sim.h"
+
+#define PACK_FILES      64
+
+/* One file of the table */
+typedef struct PACK_FILE
+{
+    const char *Resource;
+    const char *Name;
+    int     Data;                       /* index of the file its data is in */
+    unsigned char *pPlain;
+    unsigned long PlainLen;
+    unsigned char *pGzip;
+    unsigned long GzipLen;              /* 0: not smaller than the file */
+    unsigned long Crc;
+} PACK_FILE;
+
+MLOCAL PACK_FILE Files[PACK_FILES];
+
+/* Content-Type by the file name extension */
+MLOCAL const char *ContentType(const char *pName)
+{
+    static const char *Types[][2] = {
+        {".html", "text/html; charset=utf-8"},
+        {".htm", "text/html; charset=utf-8"},
+        {".js", "application/javascript"},
+        {".css", "text/css"},
+        {".json", "application/json"},
+        {".svg", "image/svg+xml"},
+        {".png", "image/png"},
+        {".ico", "image/x-icon"},
+        {".txt", "text/plain; charset=utf-8"}
+    };
+    const char *pExt = strrchr(pName, '.');
+    size_t  i;
+
+    for (i = 0; pExt && i < sizeof(Types) / sizeof(Types[0]); i++)
+    {
+        if (strcmp(pExt, Types[i][0]) == 0)
+            return Types[i][1];
+    }
+    return "application/octet-stream";
+}
+
+/* Reads a whole file */
+MLOCAL unsigned char *ReadFile(const char *pName, unsigned long *pLen)
+{
+    FILE   *pFile = fopen(pName, "rb");
+    unsigned char *pData;
+    long    Len;
+
+    if (!pFile)
+        return NULL;
+    fseek(pFile, 0, SEEK_END);
+    Len = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+    pData = malloc(Len > 0 ? Len : 1);
+    if (pData && fread(pData, 1, Len, pFile) != (size_t) Len)
+    {
+        free(pData);
+        pData = NULL;
+    }
+    fclose(pFile);
+    *pLen = (unsigned long) Len;
+    return pData;
+}
+
+/* Compresses with the gzip header, without a time stamp so the output only
+ * depends on the file */
+MLOCAL int Compress(PACK_FILE * pFile)
+{
+    z_stream z;
+    unsigned long Max = compressBound(pFile->PlainLen) + 32;
+
+    memset(&z, 0, sizeof(z));
+    pFile->pGzip = malloc(Max);
+    if (!pFile->pGzip || deflateInit2(&z, 9, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+        return -1;
+
+    z.next_in = pFile->pPlain;
+    z.avail_in = pFile->PlainLen;
+    z.next_out = pFile->pGzip;
+    z.avail_out = Max;
+    if (deflate(&z, Z_FINISH) != Z_STREAM_END)
+    {
+        deflateEnd(&z);
+        return -1;
+    }
+    pFile->GzipLen = z.total_out;
+    deflateEnd(&z);
+
+    if (pFile->GzipLen >= pFile->PlainLen)
+        pFile->GzipLen = 0;
+    return 0;
+}
+
+/* Writes the bytes as an array */
+MLOCAL void WriteArray(FILE * pOut, const char *pName, const unsigned char *pData, unsigned long Len)
+{
+    unsigned long i;
+
+    fprintf(pOut, "MLOCAL const unsigned char %s[%lu] = {", pName, Len);
+    for (i = 0; i < Len; i++)
+        fprintf(pOut, "%s0x%02x%s", (i % 12) ? " " : "\n    ", pData[i], (i + 1 < Len) ? "," : "");
+    fprintf(pOut, "\n};\n\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *pOutName = NULL;
+    FILE   *pOut;
+    PACK_FILE *pFile;
+    char   *pEq;
+    int     Count = 0, i, j, opt;
+
+    while ((opt = getopt(argc, argv, "o:")) != -1)
+    {
+        if (opt != 'o')
+        {
+            fprintf(stderr, "usage: %s -o file.c resource=file ...\n", argv[0]);
+            return 2;
+        }
+        pOutName = optarg;
+    }
+    if (!pOutName || optind == argc || argc - optind > PACK_FILES)
+    {
+        fprintf(stderr, "usage: %s -o file.c resource=file ... (at most %d)\n", argv[0], PACK_FILES);
+        return 2;
+    }
+
+    for (i = optind; i < argc; i++)
+    {
+        pFile = &Files[Count];
+        pEq = strchr(argv[i], '=');
+        if (!pEq || argv[i][0] != '/')
+        {
+            fprintf(stderr, "%s: not resource=file\n", argv[i]);
+            return 2;
+        }
+        *pEq = '\0';
+        pFile->Resource = argv[i];
+        pFile->Name = pEq + 1;
+        pFile->Data = Count;
+
+        /* the same file as an earlier one shares its data */
+        for (j = 0; j < Count; j++)
+        {
+            if (strcmp(Files[j].Name, pFile->Name) == 0)
+            {
+                *pFile = Files[j];
+                pFile->Resource = argv[i];
+                break;
+            }
+        }
+        if (j == Count)
+        {
+            pFile->pPlain = ReadFile(pFile->Name, &pFile->PlainLen);
+            if (!pFile->pPlain || Compress(pFile) < 0)
+            {
+                fprintf(stderr, "%s: could not be read or compressed\n", pFile->Name);
+                return 1;
+            }
+            pFile->Crc = crc32(0L, pFile->pPlain, pFile->PlainLen);
+        }
+        Count++;
+    }
+
+    pOut = fopen(pOutName, "w");
+    if (!pOut)
+    {
+        perror(pOutName);
+        return 1;
+    }
+
+    fprintf(pOut, "/**\n"
+            "********************************************************************************\n"
+            "* @file     m1stream_assets.c\n"
+            "*\n"
+            "* @brief    Files of the built-in HTTP server, see ws/Static.h. Made by\n"
+            "*           sim/asset_pack.c, do not edit: change the files in html/ and\n"
+            "*           run 'make assets' in sim/.\n"
+            "*\n"
+            "*******************************************************************************/\n\n"
+            "/* VxWorks includes */\n"
+            "#include <vxWorks.h>\n\n"
+            "/* MSys includes */\n"
+            "#include <mtypes.h>\n\n"
+            "/* Project includes */\n"
+            "#include \"ws/Static.h\"\n"
+            "#include \"m1stream_assets.h\"\n\n");
+
+    for (i = 0; i < Count; i++)
+    {
+        char    Name[32];
+
+        if (Files[i].Data != i)
+            continue;
+        fprintf(pOut, "/* %s */\n", Files[i].Name);
+        snprintf(Name, sizeof(Name), "Asset%d", i);
+        WriteArray(pOut, Name, Files[i].pPlain, Files[i].PlainLen);
+        if (Files[i].GzipLen)
+        {
+            snprintf(Name, sizeof(Name), "Asset%dGz", i);
+            WriteArray(pOut, Name, Files[i].pGzip, Files[i].GzipLen);
+        }
+    }
+
+    fprintf(pOut, "const ws_asset m1stream_Assets[] = {\n");
+    for (i = 0; i < Count; i++)
+    {
+        pFile = &Files[i];
+        fprintf(pOut, "    {\"%s\", \"%s\", \"W/\\\"%08lx-%lx\\\"\", Asset%d, %lu, ", pFile->Resource,
+                ContentType(pFile->Name), pFile->Crc, pFile->PlainLen, pFile->Data, pFile->PlainLen);
+        if (pFile->GzipLen)
+            fprintf(pOut, "Asset%dGz, %lu}%s\n", pFile->Data, pFile->GzipLen, (i + 1 < Count) ? "," : "");
+        else
+            fprintf(pOut, "NULL, 0}%s\n", (i + 1 < Count) ? "," : "");
+    }
+    fprintf(pOut, "};\n"
+            "const int m1stream_NbOfAssets = %d;\n", Count);
+
+    fclose(pOut);
+    printf("%s: %d resources\n", pOutName, Count);
+    return 0;
+}
@@ -0,0 +1,150 @@
+/**
+********************************************************************************
+* @file     cond_bench.c
+*
+* @brief    Benchmark of the signal conditioning in m1stream_cond.c, without
+*           the rest of the module, built with COND_CHANNELS = 256. All
+*           channels have the median of 5, a low-pass and a calibration of
+*           4 points, the input is a sine with noise and single spikes.
+*           Prints the time of one control cycle for 16 to 256 channels.
+*           Before that, a constant input with single spikes must come out
+*           unchanged, otherwise the median does not remove them.
+*
+*               ./cond_bench [-n cycles]
+*
+*******************************************************************************/
+
+#define _GNU_SOURCE
+#include <time.h>
+#include <math.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+#include "msys_sim.h"
+#include "m1stream_rec.h"
+#include "m1stream_cond.h"
+
+#define BENCH_CYCLES    200000
+#define BENCH_INPUTS    4096            /* length of the scripted input */
+#define BENCH_CYCLE_US  1000
+
+/* What m1stream_cond.c needs of the module, its errors go to stderr */
+SINT32  m1stream_Debug = 0;
+
+SINT32 log_Err(const CHAR * pFormat, ...)
+{
+    va_list args;
+
+    va_start(args, pFormat);
+    vfprintf(stderr, pFormat, args);
+    va_end(args);
+    fputc('\n', stderr);
+    return 0;
+}
+
+MLOCAL SINT32 Input[BENCH_INPUTS][COND_CHANNELS];
+MLOCAL SINT32 Value[COND_CHANNELS];
+
+MLOCAL double Now(VOID)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Sets all channels to the same conditioning */
+MLOCAL VOID Setup(SINT32 Median, SINT32 TimeConstant_us, UINT32 Points)
+{
+    COND_CONFIG Cfg;
+
+    memset(&Cfg, 0, sizeof(Cfg));
+    Cfg.Median = Median;
+    Cfg.TimeConstant_us = TimeConstant_us;
+    Cfg.Points = Points;
+    Cfg.In[0] = 1000;  Cfg.Out[0] = 0;
+    Cfg.In[1] = 12000; Cfg.Out[1] = 10000;
+    Cfg.In[2] = 20000; Cfg.Out[2] = 22000;
+    Cfg.In[3] = 31000; Cfg.Out[3] = 32767;
+
+    for (UINT32 i = 0; i < COND_CHANNELS; i++)
+        Cond_Set(i, &Cfg, BENCH_CYCLE_US);
+}
+
+/* Single spikes on a constant input must not come through */
+MLOCAL BOOL SpikeCheck(SINT32 MedianLen)
+{
+    Setup(MedianLen, 0, 0);
+    for (UINT32 c = 0; c < 1000; c++)
+    {
+        for (UINT32 i = 0; i < COND_CHANNELS; i++)
+            Value[i] = (c % 7 == 3) ? 30000 : 5000;
+        Cond_Run(Value, COND_CHANNELS);
+        for (UINT32 i = 0; i < COND_CHANNELS; i++)
+        {
+            if (Value[i] != 5000)
+                return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* Runs Cycles cycles of Channels channels, returns the time taken in seconds */
+MLOCAL double Run(UINT32 Channels, UINT32 Cycles)
+{
+    double  Start = Now();
+
+    for (UINT32 c = 0; c < Cycles; c++)
+    {
+        memcpy(Value, Input[c & (BENCH_INPUTS - 1)], Channels * sizeof(SINT32));
+        Cond_Run(Value, Channels);
+    }
+
+    return Now() - Start;
+}
+
+int main(int argc, char **argv)
+{
+    UINT32  Cycles = BENCH_CYCLES;
+    BOOL    Median3, Median5;
+    double  Time, ns;
+    int     opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1)
+    {
+        if (opt != 'n')
+        {
+            fprintf(stderr, "usage: %s [-n cycles]\n", argv[0]);
+            return 1;
+        }
+        Cycles = strtoul(optarg, NULL, 0);
+    }
+
+    Median3 = SpikeCheck(3);
+    Median5 = SpikeCheck(5);
+    printf("spikes removed: median 3 %s, median 5 %s\n", Median3 ? "yes" : "NO", Median5 ? "yes" : "NO");
+
+    srand(1);
+    for (UINT32 c = 0; c < BENCH_INPUTS; c++)
+    {
+        for (UINT32 i = 0; i < COND_CHANNELS; i++)
+        {
+            Input[c][i] = 16000 + 14000 * sin(2 * M_PI * c * (i + 1) / BENCH_INPUTS) + rand() % 200 - 100;
+            if (rand() % 100 == 0)
+                Input[c][i] = rand() % 32768;
+        }
+    }
+    Setup(5, 20000, 4);
+
+    printf("channels   ns/cycle   ns/channel   %% of a 1 ms cycle\n");
+    for (UINT32 Channels = 16; Channels <= COND_CHANNELS; Channels *= 2)
+    {
+        /* the first run warms up the caches */
+        Run(Channels, Cycles / 10);
+        Time = Run(Channels, Cycles);
+        ns = Time * 1e9 / Cycles;
+        printf("%8u %10.1f %12.2f %12.4f\n", Channels, ns, ns / Channels, ns / 1e4);
+    }
+
+    return (Median3 && Median5) ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+/**
+********************************************************************************
+* @file     game_bench.c
+*
+* @brief    Headless benchmark of the game in m1stream_game.c, without the
+*           rest of the module. Both paddles follow a scripted input, a
+*           sine of different period on each side, so that there are
+*           rallies as well as points. Prints the steps per second, the time
+*           of one step and its share of a 1 ms control cycle.
+*           The same run is done twice, the end states must be equal,
+*           otherwise the game is not deterministic.
+*
+*               ./game_bench [-n steps]
+*
+*******************************************************************************/
+
+#define _GNU_SOURCE
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "msys_sim.h"
+#include "m1stream_game.h"
+
+#define BENCH_STEPS     10000000
+#define BENCH_INPUTS    4096            /* length of the scripted input */
+
+MLOCAL SINT32 InputLeft[BENCH_INPUTS];
+MLOCAL SINT32 InputRight[BENCH_INPUTS];
+
+MLOCAL double Now(VOID)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Runs the game for Steps, returns the time taken in seconds */
+MLOCAL double Run(GAME_STATE * pGame, UINT32 Steps)
+{
+    double  Start = Now();
+
+    Game_Init(pGame, 1);
+    for (UINT32 i = 0; i < Steps; i++)
+        Game_Step(pGame, &m1stream_GameCfg, InputLeft[i & (BENCH_INPUTS - 1)],
+                  InputRight[i & (BENCH_INPUTS - 1)]);
+
+    return Now() - Start;
+}
+
+int main(int argc, char **argv)
+{
+    GAME_STATE First, Second;
+    UINT32  Steps = BENCH_STEPS;
+    char    buffer[128];
+    double  Time, ns;
+    int     opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1)
+    {
+        if (opt != 'n')
+        {
+            fprintf(stderr, "usage: %s [-n steps]\n", argv[0]);
+            return 1;
+        }
+        Steps = strtoul(optarg, NULL, 0);
+    }
+
+    for (int i = 0; i < BENCH_INPUTS; i++)
+    {
+        InputLeft[i] = 16384 + 16000 * sin(2 * M_PI * i / BENCH_INPUTS);
+        InputRight[i] = 16384 + 12000 * sin(6 * M_PI * i / BENCH_INPUTS);
+    }
+
+    /* the first run also warms up the caches */
+    Run(&First, Steps);
+    Time = Run(&Second, Steps);
+    ns = Time * 1e9 / Steps;
+
+    Game_Format(&Second, buffer, sizeof(buffer));
+    printf("end state:     %s\n", buffer);
+    printf("score:         %u : %u\n", Second.Score[GAME_LEFT], Second.Score[GAME_RIGHT]);
+    printf("steps:         %u in %.3f s\n", Steps, Time);
+    printf("steps/s:       %.0f\n", Steps / Time);
+    printf("time/step:     %.1f ns, %.4f %% of a 1 ms cycle\n", ns, ns / 1e4);
+
+    if (memcmp(&First, &Second, sizeof(First)) != 0)
+    {
+        printf("deterministic: NO, the two runs ended differently\n");
+        return 1;
+    }
+    printf("deterministic: yes\n");
+
+    return 0;
+}
@@ -0,0 +1,329 @@
+/**
+********************************************************************************
+* @file     msys_sim.h
+*
+* @brief    Host stand-in for the VxWorks and MSys headers used by m1stream.
+*           All the forwarding headers in this directory (vxWorks.h, mio.h,
+*           svi_e.h, ...) include this file, so the module sources build
+*           unchanged on a Linux host. Only what m1stream uses is declared,
+*           the functions are implemented in sim/sim_*.c.
+*
+*           Handles which the target code casts to UINT32 (semaphores,
+*           watchdogs, SVI handles) are small table indices here, so they
+*           survive the cast on a 64 bit host.
+*
+*******************************************************************************/
+
+/* Avoid problems with multiple including */
+#ifndef MSYS_SIM__H
+#define MSYS_SIM__H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+/*--- Basic types (mtypes.h) ---*/
+
+typedef void VOID;
+typedef char CHAR;
+typedef char CHAR8;
+typedef uint8_t UINT8;
+typedef int8_t SINT8;
+typedef uint16_t UINT16;
+typedef int16_t SINT16;
+typedef uint32_t UINT32;
+typedef int32_t SINT32;
+typedef uint64_t UINT64;
+typedef int64_t SINT64;
+typedef float REAL32;
+typedef double REAL64;
+typedef uint8_t BOOL8;
+typedef uint32_t BOOL32;
+
+#define MLOCAL  static
+#define EXTERN  extern
+
+/*--- VxWorks types and defines ---*/
+
+typedef int STATUS;
+typedef int BOOL;
+typedef int (*FUNCPTR) ();
+typedef void (*VOIDFUNCPTR) ();
+typedef UINT32 SEM_ID;
+typedef UINT8 SYM_TYPE;
+typedef struct SIM_SYMTAB *SYMTAB_ID;
+
+#ifndef OK
+#define OK      0
+#endif
+#ifndef ERROR
+#define ERROR   (-1)
+#endif
+#ifndef TRUE
+#define TRUE    1
+#endif
+#ifndef FALSE
+#define FALSE   0
+#endif
+
+#define WAIT_FOREVER    (-1)
+#define NO_WAIT         0
+#define VX_FP_TASK      0x0008
+
+#define SEM_Q_FIFO      0x00
+#define SEM_Q_PRIORITY  0x01
+#define SEM_EMPTY       0
+#define SEM_FULL        1
+
+/* taskLib.h, semLib.h, tickLib.h, sysLib.h */
+STATUS  taskDelay(int Ticks);
+STATUS  taskDelete(int TaskId);
+STATUS  taskIdVerify(int TaskId);
+SEM_ID  semBCreate(int Options, int InitialState);
+STATUS  semGive(SEM_ID SemId);
+STATUS  semTake(SEM_ID SemId, int Timeout);
+STATUS  semFlush(SEM_ID SemId);
+STATUS  semDelete(SEM_ID SemId);
+UINT32  tickGet(void);
+int     sysClkRateGet(void);
+
+/* symLib.h, sysSymTbl.h */
+extern SYMTAB_ID sysSymTbl;
+STATUS  symFindByName(SYMTAB_ID SymTbl, char *pName, char **ppValue, SYM_TYPE * pType);
+
+/*--- MSys defines ---*/
+
+#define M_PATHLEN           80
+#define M_PATHLEN_A         (M_PATHLEN + 1)
+#define M_MODNAMELEN        8
+#define M_MODNAMELEN_A      (M_MODNAMELEN + 1)
+#define M_TSKNAMELEN        15
+#define M_TSKNAMELEN_A      (M_TSKNAMELEN + 1)
+#define M_VERSTRGLEN        31
+#define M_VERSTRGLEN_A      (M_VERSTRGLEN + 1)
+#define PF_KEYLEN           20
+#define PF_KEYLEN_A         (PF_KEYLEN + 1)
+#define SMI_DESCLEN         63
+#define SMI_DESCLEN_A       (SMI_DESCLEN + 1)
+
+/* Bits of (BaseParms)DebugMode */
+#define APP_DBG_INFO1       0x00000001
+
+/*--- Resource handler (res_e.h) ---*/
+
+#define RES_E_OK            0
+#define RES_UNLIMITUSR      0
+
+#define RES_S_INIT          0
+#define RES_S_EOI           1
+#define RES_S_RUN           2
+#define RES_S_STOP          3
+#define RES_S_ERROR         4
+#define RES_S_DEINIT        5
+
+/*--- Standard module interface (smi_e.h) ---*/
+
+#define SMI_F_CALL          0x01
+#define SMI_F_REPLY         0x02
+
+#define SMI_E_OK            0
+#define SMI_E_FAILED        (-1)
+#define SMI_E_PROC          (-2)
+#define SMI_E_ARGS          (-3)
+
+#define SMI_PROC_NULL       0
+#define SMI_PROC_DEINIT     2
+#define SMI_PROC_RESET      4
+#define SMI_PROC_STOP       6
+#define SMI_PROC_RUN        8
+#define SMI_PROC_NEWCFG     10
+#define SMI_PROC_GETINFO    12
+#define SMI_PROC_ENDOFINIT  14
+#define SMI_PROC_SETDBG     16
+
+#define SVI_PROC_GETADDR        200
+#define SVI_PROC_GETPVINF       202
+#define SVI_PROC_GETSERVINF     204
+#define SVI_PROC_GETVALLST      206
+#define SVI_PROC_SETVALLST      208
+#define SVI_PROC_GETVAL         210
+#define SVI_PROC_SETVAL         212
+#define SVI_PROC_GETBLK         214
+#define SVI_PROC_SETBLK         216
+#define SVI_PROC_GETMULTIBLK    218
+#define SVI_PROC_SETMULTIBLK    220
+
+typedef struct SMI_ID
+{
+    CHAR    AppName[M_MODNAMELEN_A];    /* module owning this interface */
+} SMI_ID;
+
+typedef struct SMI_MSG
+{
+    UINT32  Type;                       /* SMI_F_CALL or SMI_F_REPLY */
+    SINT32  ProcRetCode;                /* procedure number of a call */
+    UINT32  DataLen;                    /* length of Data in bytes */
+    VOID   *Data;                       /* call parameters, see smi_FreeData */
+} SMI_MSG;
+
+typedef struct { SINT32 RetCode; } SMI_RESET_R;
+typedef struct { SINT32 RetCode; } SMI_STOP_R;
+typedef struct { SINT32 RetCode; } SMI_RUN_R;
+typedef struct { SINT32 RetCode; } SMI_NEWCFG_R;
+typedef struct { SINT32 RetCode; } SMI_DEINIT_R;
+typedef struct { SINT32 RetCode; } SMI_ENDOFINIT_R;
+typedef struct { SINT32 RetCode; } SMI_SETDBG_R;
+typedef struct { UINT32 DebugMode; } SMI_SETDBG_C;
+
+typedef struct SMI_GETINFO_R
+{
+    SINT32  RetCode;
+    CHAR    Name[M_MODNAMELEN_A];
+    CHAR    Desc[SMI_DESCLEN_A];
+    UINT32  VersType;
+    UINT8   VersCode[4];
+    UINT32  State;
+    UINT32  DebugMode;
+} SMI_GETINFO_R;
+
+SINT32  smi_Receive(SMI_ID * pSmiId, SMI_MSG * pMsg, SINT32 Timeout);
+SINT32  smi_Receive2(SMI_ID * pSmiId, SMI_MSG * pMsg, SINT32 Timeout, UINT32 * pUser);
+SINT32  smi_SendReply(SMI_ID * pSmiId, SMI_MSG * pMsg, SINT32 RetCode, VOID * pData, UINT32 Len);
+SINT32  smi_SendCReply(SMI_ID * pSmiId, SMI_MSG * pMsg, SINT32 RetCode, VOID * pData, UINT32 Len);
+VOID    smi_FreeData(SMI_MSG * pMsg);
+VOID   *smi_MemAlloc(UINT32 Size);
+
+/*--- Module handler (mod_e.h) ---*/
+
+typedef struct MOD_CONF
+{
+    CHAR    AppName[M_MODNAMELEN_A];    /* instance name, section in mconfig */
+    CHAR    TypeName[M_MODNAMELEN_A];   /* module type, name of the .m file */
+    CHAR    ProfileName[M_PATHLEN_A];   /* mconfig file, empty = default */
+    UINT32  LineNbr;                    /* line of the section in mconfig */
+    UINT32  DebugMode;                  /* (BaseParms)DebugMode */
+    UINT32  TskPrior;                   /* (BaseParms)Priority */
+    UINT32  MemPart;                    /* (BaseParms)Partition */
+} MOD_CONF;
+
+typedef struct MOD_LOAD
+{
+    VOID   *pCfg;                       /* configuration data, freed by module */
+    UINT32  LenCfg;
+    VOID   *pAttr;                      /* attributes, freed by module */
+    UINT32  LenAttr;
+} MOD_LOAD;
+
+SINT32  res_ModParam(CHAR * pAppName, UINT32 MinVers, UINT32 MaxVers, UINT32 MaxUsers, SMI_ID ** ppSmiId);
+SINT32  res_ModState(CHAR * pAppName, UINT32 State);
+SINT32  res_ModDelete(CHAR * pAppName);
+
+/*--- System services (msys_e.h) ---*/
+
+typedef struct SYS_VERSION
+{
+    UINT32  Type;                       /* 0 = release, 1 = beta, 2 = alpha */
+    UINT8   Code[4];                    /* major, minor, revision, build */
+} SYS_VERSION;
+
+typedef struct SYS_EXTCPUINFO
+{
+    UINT32  SyncHigh;                   /* high time of the sync signal in us */
+    UINT32  SyncLow;                    /* low time of the sync signal in us */
+} SYS_EXTCPUINFO;
+
+typedef struct SYS_CPUINFO
+{
+    CHAR    CpuName[32];
+    SYS_EXTCPUINFO *pExtCpuInfo;
+} SYS_CPUINFO;
+
+/*
+ * sys_TaskSpawn takes an optional task argument. The trailing 0 makes the
+ * argument defined when the caller leaves it out.
+ */
+#define sys_TaskSpawn(pAppName, pTaskName, Prio, Options, StackSize, ...) \
+    sim_TaskSpawn((pAppName), (pTaskName), (Prio), (Options), (StackSize), __VA_ARGS__, 0)
+SINT32  sim_TaskSpawn(CHAR * pAppName, CHAR * pTaskName, SINT32 Prio, SINT32 Options,
+                      SINT32 StackSize, FUNCPTR pEntry, VOID * pArg, ...);
+
+VOID   *sys_MemAlloc(UINT32 Size);
+VOID    sys_MemFree(VOID * pMem);
+VOID    sys_MemPFree(UINT32 Partition, VOID * pMem);
+UINT32  sys_WdogCreate(CHAR * pAppName, UINT32 Time_us);
+SINT32  sys_WdogTrigg(UINT32 WdogId);
+SINT32  sys_WdogDisable(UINT32 WdogId);
+SINT32  sys_WdogDelete(UINT32 WdogId);
+VOID    sys_CycleStart(VOID);
+VOID    sys_CycleEnd(VOID);
+SINT32  sys_PanicSigSet(VOIDFUNCPTR pHandler);
+SINT32  sys_PanicSigReset(VOID);
+SINT32  sys_ExcSigReset(VOID);
+SINT32  sys_GetVersion(SYS_VERSION * pVersion, CHAR * pVersStrg);
+SINT32  sys_GetCpuInfo(SYS_CPUINFO * pInfo);
+UINT32  m_GetProcTime(VOID);
+
+/*--- Logger (log_e.h) ---*/
+
+SINT32  log_Info(const CHAR * pFormat, ...) __attribute__ ((format(printf, 1, 2)));
+SINT32  log_Wrn(const CHAR * pFormat, ...) __attribute__ ((format(printf, 1, 2)));
+SINT32  log_Err(const CHAR * pFormat, ...) __attribute__ ((format(printf, 1, 2)));
+SINT32  log_User(const CHAR * pFormat, ...) __attribute__ ((format(printf, 1, 2)));
+
+/*--- Profile access to mconfig (prof_e.h) ---*/
+
+SINT32  pf_GetInt(CHAR * pSection, CHAR * pGroup, CHAR * pKey, SINT32 Default,
+                  SINT32 * pValue, UINT32 Line, CHAR * pFileName);
+SINT32  pf_GetStrg(CHAR * pSection, CHAR * pGroup, CHAR * pKey, CHAR * pDefault,
+                   CHAR * pValue, UINT32 Size, UINT32 Line, CHAR * pFileName);
+
+/*--- Standard variable interface (svi_e.h) ---*/
+
+#define SVI_F_IN            0x01
+#define SVI_F_OUT           0x02
+#define SVI_F_INOUT         (SVI_F_IN | SVI_F_OUT)
+#define SVI_F_UINT32        0x0300
+#define SVI_F_SINT32        0x0400
+#define SVI_F_REAL32        0x0500
+#define SVI_F_STRING        0x0a00
+#define SVI_F_BLK           0x0b00
+
+typedef struct SVI_VAR SVI_VAR;
+typedef SINT32(*SVI_FKTSTART) (SVI_VAR * pVar, UINT32 UserParam);
+typedef VOID(*SVI_FKTEND) (SVI_VAR * pVar, UINT32 UserParam);
+
+UINT32  svi_Init(CHAR * pAppName, UINT32 Spare1, UINT32 Spare2);
+SINT32  svi_DeInit(UINT32 SviHandle);
+SINT32  svi_AddGlobVar(UINT32 SviHandle, CHAR * pName, UINT32 Format, UINT32 Size,
+                       UINT32 * pVar, UINT32 Spare, UINT32 UserParam,
+                       SVI_FKTSTART pStart, SVI_FKTEND pEnd);
+SINT32  svi_MsgHandler2(UINT32 SviHandle, SMI_MSG * pMsg, SMI_ID * pSmiId, UINT32 User);
+
+/*--- I/O access (mio.h, mio_e.h, aic2xx.h) ---*/
+
+#define MIO_SYNC_IN         0
+#define MIO_SYNC_OUT        1
+
+typedef struct AIC2XX_RING_SLICE AIC2XX_RING_SLICE;
+
+VOID   *mio_GetDrv(UINT32 CardNb);
+SINT32  mio_GetValue(VOID * pDrv, UINT32 Chan, SINT32 * pValue);
+SINT32  mio_StartSyncSession(CHAR * pAppName);
+SINT32  mio_StopSyncSession(SINT32 SessionId);
+SINT32  mio_AttachSync(SINT32 SessionId, UINT32 Edge, UINT32 Cycles, VOIDFUNCPTR pIsr, UINT32 Arg);
+SINT32  aic2xx_ReleaseRing(VOID * pDrv, UINT32 Chan);
+
+/*--- Simulation control, used by sim_main.c ---*/
+
+VOID    sim_TaskInit(UINT32 ClkRate);
+VOID    sim_LogInit(FILE * pStream);
+SINT32  sim_CfgLoad(CHAR * pFileName);
+SINT32  sim_CfgFindSection(CHAR * pSection);
+SINT32  sim_IoLoad(CHAR * pFileName);
+VOID    sim_IoInit(UINT32 SyncCycle_us);
+SINT32  sim_SmiCall(SINT32 Proc, VOID * pData, UINT32 Len, VOID * pReply, UINT32 ReplyLen);
+VOID    sim_SviDump(FILE * pStream);
+
+#endif /* Avoid problems with multiple include */
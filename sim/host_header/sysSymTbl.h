@@ -0,0 +1,6 @@
+/*
+ * sysSymTbl.h
+ *
+ * Host stand-in for the target header, see msys_sim.h.
+ */
+#include "msys_sim.h"
@@ -0,0 +1,358 @@
+/**
+********************************************************************************
+* @file     sim_cfg.c
+*
+* @brief    Host stand-in for the profile access functions pf_GetInt and
+*           pf_GetStrg. Reads an mconfig.ini of the form
+*
+*               [SECTION]
+*               (Group)
+*                   Key = Value
+*
+*           Comments start with ';' or '#', string values may be quoted.
+*           Names are compared case-insensitively, as on the target.
+*           The file is parsed once and parsed again when it changes on disk.
+*
+*******************************************************************************/
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <ctype.h>
+#include <errno.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+#include "msys_sim.h"
+
+#define SIM_CFG_LINELEN     256
+#define SIM_CFG_VALUELEN    128
+
+typedef struct SIM_CFG_ENTRY
+{
+    UINT32  Line;                       /* line of the key in the file */
+    CHAR    Section[PF_KEYLEN_A];
+    CHAR    Group[PF_KEYLEN_A];
+    CHAR    Key[PF_KEYLEN_A];
+    CHAR    Value[SIM_CFG_VALUELEN];
+} SIM_CFG_ENTRY;
+
+typedef struct SIM_CFG_SECTION
+{
+    UINT32  Line;                       /* line of the [SECTION] header */
+    CHAR    Name[PF_KEYLEN_A];
+} SIM_CFG_SECTION;
+
+MLOCAL pthread_mutex_t CfgLock = PTHREAD_MUTEX_INITIALIZER;
+MLOCAL CHAR CfgDefault[M_PATHLEN_A] = "mconfig.ini";
+MLOCAL CHAR CfgPath[M_PATHLEN_A];
+MLOCAL time_t CfgMTime;
+MLOCAL SIM_CFG_ENTRY *pEntries;
+MLOCAL UINT32 NbOfEntries;
+MLOCAL SIM_CFG_SECTION *pSections;
+MLOCAL UINT32 NbOfSections;
+
+/**
+********************************************************************************
+* @brief Removes leading and trailing blanks, in place.
+*******************************************************************************/
+MLOCAL CHAR *Trim(CHAR * pStrg)
+{
+    CHAR   *pEnd;
+
+    while (isspace((unsigned char) *pStrg))
+        pStrg++;
+    pEnd = pStrg + strlen(pStrg);
+    while (pEnd > pStrg && isspace((unsigned char) pEnd[-1]))
+        *--pEnd = 0;
+
+    return pStrg;
+}
+
+/**
+********************************************************************************
+* @brief Copies a name up to the closing delimiter into pDest.
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. delimiter is missing
+*******************************************************************************/
+MLOCAL SINT32 CopyName(CHAR * pDest, CHAR * pSrc, CHAR Close)
+{
+    CHAR   *pEnd = strchr(pSrc, Close);
+
+    if (!pEnd)
+        return (ERROR);
+    *pEnd = 0;
+    snprintf(pDest, PF_KEYLEN_A, "%s", Trim(pSrc));
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Parses the whole file into the entry table.
+*        Must be called with CfgLock held.
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. file could not be read
+*******************************************************************************/
+MLOCAL SINT32 CfgParse(CHAR * pFileName, time_t MTime)
+{
+    FILE   *pFile;
+    CHAR    Buffer[SIM_CFG_LINELEN];
+    CHAR    Section[PF_KEYLEN_A] = "";
+    CHAR    Group[PF_KEYLEN_A] = "";
+    UINT32  Line = 0;
+    UINT32  Size = 0, SectSize = 0;
+
+    pFile = fopen(pFileName, "r");
+    if (!pFile)
+        return (ERROR);
+
+    free(pEntries);
+    free(pSections);
+    pEntries = NULL;
+    pSections = NULL;
+    NbOfEntries = 0;
+    NbOfSections = 0;
+
+    while (fgets(Buffer, sizeof(Buffer), pFile))
+    {
+        CHAR   *pLine = Trim(Buffer);
+        CHAR   *pValue;
+        SIM_CFG_ENTRY *pEntry;
+
+        Line++;
+        if (*pLine == 0 || *pLine == ';' || *pLine == '#')
+            continue;
+
+        if (*pLine == '[')
+        {
+            if (CopyName(Section, pLine + 1, ']') < 0)
+                log_Wrn("sim: %s:%u: unterminated section", pFileName, Line);
+            Group[0] = 0;
+            if (NbOfSections == SectSize)
+            {
+                SectSize = SectSize ? SectSize * 2 : 16;
+                pSections = realloc(pSections, SectSize * sizeof(*pSections));
+            }
+            pSections[NbOfSections].Line = Line;
+            snprintf(pSections[NbOfSections].Name, PF_KEYLEN_A, "%s", Section);
+            NbOfSections++;
+            continue;
+        }
+
+        if (*pLine == '(')
+        {
+            if (CopyName(Group, pLine + 1, ')') < 0)
+                log_Wrn("sim: %s:%u: unterminated group", pFileName, Line);
+            continue;
+        }
+
+        pValue = strchr(pLine, '=');
+        if (!pValue)
+        {
+            log_Wrn("sim: %s:%u: ignoring '%s'", pFileName, Line, pLine);
+            continue;
+        }
+        *pValue++ = 0;
+
+        if (NbOfEntries == Size)
+        {
+            Size = Size ? Size * 2 : 64;
+            pEntries = realloc(pEntries, Size * sizeof(*pEntries));
+        }
+        pEntry = &pEntries[NbOfEntries++];
+        pEntry->Line = Line;
+        snprintf(pEntry->Section, PF_KEYLEN_A, "%s", Section);
+        snprintf(pEntry->Group, PF_KEYLEN_A, "%s", Group);
+        snprintf(pEntry->Key, PF_KEYLEN_A, "%s", Trim(pLine));
+
+        /* cut a trailing comment, strip the quotes of a string */
+        pValue = Trim(pValue);
+        if (*pValue == '"')
+        {
+            CHAR   *pEnd = strchr(++pValue, '"');
+
+            if (pEnd)
+                *pEnd = 0;
+        }
+        else
+        {
+            CHAR   *pEnd = strpbrk(pValue, ";#");
+
+            if (pEnd)
+                *pEnd = 0;
+            pValue = Trim(pValue);
+        }
+        snprintf(pEntry->Value, SIM_CFG_VALUELEN, "%s", pValue);
+    }
+
+    fclose(pFile);
+    snprintf(CfgPath, sizeof(CfgPath), "%s", pFileName);
+    CfgMTime = MTime;
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Makes sure the entry table reflects the given file.
+*        Must be called with CfgLock held.
+*******************************************************************************/
+MLOCAL SINT32 CfgUpdate(CHAR * pFileName)
+{
+    struct stat st;
+
+    if (!pFileName || !*pFileName)
+        pFileName = CfgDefault;
+
+    if (stat(pFileName, &st) < 0)
+        return (ERROR);
+
+    if (strcmp(CfgPath, pFileName) || st.st_mtime != CfgMTime)
+        return CfgParse(pFileName, st.st_mtime);
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Looks up a key, starting the search at the given line.
+*        Must be called with CfgLock held.
+*******************************************************************************/
+MLOCAL SIM_CFG_ENTRY *CfgFind(CHAR * pSection, CHAR * pGroup, CHAR * pKey,
+                              UINT32 Line, CHAR * pFileName)
+{
+    UINT32  i;
+
+    if (CfgUpdate(pFileName) < 0)
+        return NULL;
+
+    for (i = 0; i < NbOfEntries; i++)
+    {
+        SIM_CFG_ENTRY *pEntry = &pEntries[i];
+
+        if (pEntry->Line >= Line &&
+            !strcasecmp(pEntry->Section, pSection) &&
+            !strcasecmp(pEntry->Group, pGroup) && !strcasecmp(pEntry->Key, pKey))
+            return pEntry;
+    }
+
+    return NULL;
+}
+
+/**
+********************************************************************************
+* @brief Sets the file used when a module passes no profile name.
+*
+* @param[in]  pFileName  path of the mconfig.ini
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. file could not be read
+*******************************************************************************/
+SINT32 sim_CfgLoad(CHAR * pFileName)
+{
+    SINT32  ret;
+
+    pthread_mutex_lock(&CfgLock);
+    snprintf(CfgDefault, sizeof(CfgDefault), "%s", pFileName);
+    ret = CfgUpdate(CfgDefault);
+    pthread_mutex_unlock(&CfgLock);
+
+    return (ret);
+}
+
+/**
+********************************************************************************
+* @brief Returns the line of a section header in the default file, which the
+*        module handler passes to the module as MOD_CONF.LineNbr.
+*
+* @retval     > 0 .. line number
+* @retval     < 0 .. section not found
+*******************************************************************************/
+SINT32 sim_CfgFindSection(CHAR * pSection)
+{
+    SINT32  ret = ERROR;
+    UINT32  i;
+
+    pthread_mutex_lock(&CfgLock);
+    if (CfgUpdate(CfgDefault) == OK)
+    {
+        for (i = 0; i < NbOfSections; i++)
+        {
+            if (!strcasecmp(pSections[i].Name, pSection))
+            {
+                ret = pSections[i].Line;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&CfgLock);
+
+    return (ret);
+}
+
+/**
+********************************************************************************
+* @brief Reads an integer from mconfig. Decimal and 0x hex are accepted,
+*        any other value counts as missing.
+*
+* @retval     = 0 .. OK, value in *pValue
+* @retval     < 0 .. not found, *pValue = Default
+*******************************************************************************/
+SINT32 pf_GetInt(CHAR * pSection, CHAR * pGroup, CHAR * pKey, SINT32 Default,
+                 SINT32 * pValue, UINT32 Line, CHAR * pFileName)
+{
+    SIM_CFG_ENTRY *pEntry;
+    CHAR   *pEnd;
+    long    Value;
+    SINT32  ret = ERROR;
+
+    *pValue = Default;
+
+    pthread_mutex_lock(&CfgLock);
+    pEntry = CfgFind(pSection, pGroup, pKey, Line, pFileName);
+    if (pEntry)
+    {
+        errno = 0;
+        Value = strtol(pEntry->Value, &pEnd, 0);
+        if (!errno && pEnd != pEntry->Value && *pEnd == 0)
+        {
+            *pValue = (SINT32) Value;
+            ret = OK;
+        }
+    }
+    pthread_mutex_unlock(&CfgLock);
+
+    return (ret);
+}
+
+/**
+********************************************************************************
+* @brief Reads a string from mconfig.
+*
+* @retval     = 0 .. OK, value in pValue
+* @retval     < 0 .. not found, pValue = pDefault
+*******************************************************************************/
+SINT32 pf_GetStrg(CHAR * pSection, CHAR * pGroup, CHAR * pKey, CHAR * pDefault,
+                  CHAR * pValue, UINT32 Size, UINT32 Line, CHAR * pFileName)
+{
+    SIM_CFG_ENTRY *pEntry;
+    SINT32  ret = ERROR;
+
+    if (!Size)
+        return (ERROR);
+
+    pthread_mutex_lock(&CfgLock);
+    pEntry = CfgFind(pSection, pGroup, pKey, Line, pFileName);
+    if (pEntry)
+    {
+        snprintf(pValue, Size, "%s", pEntry->Value);
+        ret = OK;
+    }
+    else if (pDefault != pValue)
+        snprintf(pValue, Size, "%s", pDefault ? pDefault : "");
+    pthread_mutex_unlock(&CfgLock);
+
+    return (ret);
+}
@@ -0,0 +1,413 @@
+/**
+********************************************************************************
+* @file     sim_io.c
+*
+* @brief    Host stand-in for the I/O driver access (mio, aic2xx) and the
+*           sync interrupt. The analog inputs are driven by a signal script,
+*           one channel per line:
+*
+*               # card chan shape    amplitude freq[Hz] offset [noise]
+*               3      1    sine     10000     1.0      0       50
+*               3      2    ramp     32767     0.5      0
+*               fail   3    2        5.0       7.5
+*
+*           Shapes are const, sine, square, triangle, ramp and noise.
+*           A 'fail' line makes mio_GetValue of a channel return an error
+*           between the two given times in seconds, e.g. to play a broken
+*           cable. Cards which do not appear in the script are not present.
+*
+*           The sync is a thread with a fixed period, calling the functions
+*           attached with mio_AttachSync every given number of syncs.
+*
+*******************************************************************************/
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <strings.h>
+
+#include "msys_sim.h"
+
+#define SIM_MAX_CARDS       32
+#define SIM_MAX_CHANNELS    64
+#define SIM_MAX_SYNCS       16
+#define SIM_MAX_FAILS       64
+
+typedef enum
+{
+    SHAPE_NONE = 0,
+    SHAPE_CONST,
+    SHAPE_SINE,
+    SHAPE_SQUARE,
+    SHAPE_TRIANGLE,
+    SHAPE_RAMP,
+    SHAPE_NOISE
+} SIM_SHAPE;
+
+typedef struct SIM_CHANNEL
+{
+    SIM_SHAPE Shape;
+    REAL64  Amplitude;
+    REAL64  Frequency;                  /* Hz */
+    REAL64  Offset;
+    REAL64  Noise;                      /* amplitude of the added noise */
+    UINT32  Seed;                       /* state of the noise generator */
+} SIM_CHANNEL;
+
+typedef struct SIM_CARD
+{
+    UINT32  CardNb;                     /* 0 = slot not used */
+    SIM_CHANNEL Chan[SIM_MAX_CHANNELS + 1];     /* channels count from 1 */
+} SIM_CARD;
+
+typedef struct SIM_FAIL
+{
+    SIM_CARD *pCard;
+    UINT32  Chan;
+    UINT32  From_us;
+    UINT32  To_us;
+} SIM_FAIL;
+
+typedef struct SIM_SYNC
+{
+    UINT32  Used;
+    UINT32  Cycles;                     /* call pIsr every Cycles syncs */
+    VOIDFUNCPTR pIsr;
+    UINT32  Arg;
+} SIM_SYNC;
+
+MLOCAL SIM_CARD Cards[SIM_MAX_CARDS];
+MLOCAL SIM_FAIL Fails[SIM_MAX_FAILS];
+MLOCAL UINT32 NbOfFails;
+MLOCAL SIM_SYNC Syncs[SIM_MAX_SYNCS];
+MLOCAL pthread_mutex_t SyncLock = PTHREAD_MUTEX_INITIALIZER;
+MLOCAL pthread_t SyncThread;
+MLOCAL UINT32 SyncRunning;
+MLOCAL UINT32 SyncCycle = 1000;         /* us */
+MLOCAL SYS_EXTCPUINFO ExtCpuInfo;
+
+MLOCAL SIM_CARD *CardFind(UINT32 CardNb, UINT32 Create)
+{
+    UINT32  i;
+
+    for (i = 0; i < SIM_MAX_CARDS; i++)
+    {
+        if (Cards[i].CardNb == CardNb)
+            return &Cards[i];
+    }
+    if (!Create)
+        return NULL;
+    for (i = 0; i < SIM_MAX_CARDS; i++)
+    {
+        if (!Cards[i].CardNb)
+        {
+            Cards[i].CardNb = CardNb;
+            return &Cards[i];
+        }
+    }
+
+    return NULL;
+}
+
+MLOCAL SIM_SHAPE ShapeFind(CHAR * pName)
+{
+    static const CHAR *Names[] = { "", "const", "sine", "square", "triangle", "ramp", "noise" };
+    UINT32  i;
+
+    for (i = 1; i < sizeof(Names) / sizeof(Names[0]); i++)
+    {
+        if (!strcasecmp(pName, Names[i]))
+            return (SIM_SHAPE) i;
+    }
+
+    return SHAPE_NONE;
+}
+
+/**
+********************************************************************************
+* @brief Reads a signal script, see the top of this file.
+*
+* @param[in]  pFileName  path of the script
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. file could not be read or has errors
+*******************************************************************************/
+SINT32 sim_IoLoad(CHAR * pFileName)
+{
+    FILE   *pFile;
+    CHAR    Buffer[256];
+    CHAR    Shape[16];
+    UINT32  Line = 0, CardNb, Chan;
+    REAL64  Amp, Freq, Offset, Noise, From, To;
+    SINT32  ret = OK;
+
+    pFile = fopen(pFileName, "r");
+    if (!pFile)
+    {
+        log_Err("sim: could not open signal script '%s'", pFileName);
+        return (ERROR);
+    }
+
+    while (fgets(Buffer, sizeof(Buffer), pFile))
+    {
+        SIM_CARD *pCard;
+        CHAR   *pComment = strchr(Buffer, '#');
+        int     n;
+
+        Line++;
+        if (pComment)
+            *pComment = 0;
+
+        if (sscanf(Buffer, " fail %u %u %lf %lf", &CardNb, &Chan, &From, &To) == 4)
+        {
+            pCard = CardFind(CardNb, TRUE);
+            if (!pCard || NbOfFails == SIM_MAX_FAILS || Chan < 1 || Chan > SIM_MAX_CHANNELS)
+            {
+                log_Err("sim: %s:%u: invalid fail entry", pFileName, Line);
+                ret = ERROR;
+                continue;
+            }
+            Fails[NbOfFails].pCard = pCard;
+            Fails[NbOfFails].Chan = Chan;
+            Fails[NbOfFails].From_us = From * 1e6;
+            Fails[NbOfFails].To_us = To * 1e6;
+            NbOfFails++;
+            continue;
+        }
+
+        Freq = Offset = Noise = 0;
+        n = sscanf(Buffer, " %u %u %15s %lf %lf %lf %lf", &CardNb, &Chan, Shape, &Amp, &Freq,
+                   &Offset, &Noise);
+        if (n <= 0)
+            continue;
+        if (n < 4 || CardNb == 0 || Chan < 1 || Chan > SIM_MAX_CHANNELS || !ShapeFind(Shape))
+        {
+            log_Err("sim: %s:%u: invalid signal entry", pFileName, Line);
+            ret = ERROR;
+            continue;
+        }
+
+        pCard = CardFind(CardNb, TRUE);
+        if (!pCard)
+        {
+            log_Err("sim: %s:%u: more than %d cards", pFileName, Line, SIM_MAX_CARDS);
+            ret = ERROR;
+            continue;
+        }
+        pCard->Chan[Chan].Shape = ShapeFind(Shape);
+        pCard->Chan[Chan].Amplitude = Amp;
+        pCard->Chan[Chan].Frequency = Freq;
+        pCard->Chan[Chan].Offset = Offset;
+        pCard->Chan[Chan].Noise = Noise;
+        pCard->Chan[Chan].Seed = CardNb * 1000 + Chan;
+    }
+
+    fclose(pFile);
+
+    return (ret);
+}
+
+/**
+********************************************************************************
+* @brief Uniform random number in -1 .. 1, reproducible per channel.
+*******************************************************************************/
+MLOCAL REAL64 Random(UINT32 * pSeed)
+{
+    *pSeed = *pSeed * 1103515245u + 12345u;
+    return ((*pSeed >> 8) & 0xffff) / 32767.5 - 1.0;
+}
+
+VOID   *mio_GetDrv(UINT32 CardNb)
+{
+    return CardNb ? CardFind(CardNb, FALSE) : NULL;
+}
+
+/**
+********************************************************************************
+* @brief Returns the current value of a simulated channel. The value only
+*        depends on the time since the start of the simulation.
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. unknown channel or failure scripted for this time
+*******************************************************************************/
+SINT32 mio_GetValue(VOID * pDrv, UINT32 Chan, SINT32 * pValue)
+{
+    SIM_CARD *pCard = pDrv;
+    SIM_CHANNEL *pChan;
+    UINT32  now = m_GetProcTime();
+    REAL64  t = now / 1e6, phase, v = 0;
+    UINT32  i;
+
+    if (!pCard || Chan < 1 || Chan > SIM_MAX_CHANNELS)
+        return (ERROR);
+
+    pChan = &pCard->Chan[Chan];
+    if (pChan->Shape == SHAPE_NONE)
+        return (ERROR);
+
+    for (i = 0; i < NbOfFails; i++)
+    {
+        if (Fails[i].pCard == pCard && Fails[i].Chan == Chan &&
+            now >= Fails[i].From_us && now < Fails[i].To_us)
+            return (ERROR);
+    }
+
+    phase = pChan->Frequency * t;
+    phase -= floor(phase);
+
+    switch (pChan->Shape)
+    {
+        case SHAPE_CONST:
+            v = pChan->Amplitude;
+            break;
+        case SHAPE_SINE:
+            v = pChan->Amplitude * sin(2 * M_PI * phase);
+            break;
+        case SHAPE_SQUARE:
+            v = phase < 0.5 ? pChan->Amplitude : -pChan->Amplitude;
+            break;
+        case SHAPE_TRIANGLE:
+            v = pChan->Amplitude * (phase < 0.5 ? 4 * phase - 1 : 3 - 4 * phase);
+            break;
+        case SHAPE_RAMP:
+            v = pChan->Amplitude * phase;
+            break;
+        case SHAPE_NOISE:
+            v = pChan->Amplitude * Random(&pChan->Seed);
+            break;
+        default:
+            break;
+    }
+    if (pChan->Noise)
+        v += pChan->Noise * Random(&pChan->Seed);
+
+    *pValue = (SINT32) lround(v + pChan->Offset);
+
+    return (OK);
+}
+
+SINT32 aic2xx_ReleaseRing(VOID * pDrv, UINT32 Chan)
+{
+    (void) pDrv;
+    (void) Chan;
+    return (OK);
+}
+
+/*--- Sync ---*/
+
+/**
+********************************************************************************
+* @brief Sets the sync period reported by sys_GetCpuInfo and used by the
+*        sync thread.
+*
+* @param[in]  SyncCycle_us  period in us, 0 keeps the default of 1000
+*******************************************************************************/
+VOID sim_IoInit(UINT32 SyncCycle_us)
+{
+    if (SyncCycle_us)
+        SyncCycle = SyncCycle_us;
+    ExtCpuInfo.SyncHigh = SyncCycle / 2;
+    ExtCpuInfo.SyncLow = SyncCycle - SyncCycle / 2;
+}
+
+SINT32 sys_GetCpuInfo(SYS_CPUINFO * pInfo)
+{
+    memset(pInfo, 0, sizeof(*pInfo));
+    snprintf(pInfo->CpuName, sizeof(pInfo->CpuName), "host");
+    pInfo->pExtCpuInfo = &ExtCpuInfo;
+    return (OK);
+}
+
+MLOCAL VOID *SyncMain(VOID *pArg)
+{
+    struct timespec next;
+    UINT64  count = 0;
+    UINT32  i;
+
+    (void) pArg;
+    pthread_setname_np(pthread_self(), "tSimSync");
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (1)
+    {
+        next.tv_nsec += SyncCycle * 1000L;
+        while (next.tv_nsec >= 1000000000L)
+        {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000L;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+            ;
+        count++;
+
+        pthread_mutex_lock(&SyncLock);
+        for (i = 0; i < SIM_MAX_SYNCS; i++)
+        {
+            if (Syncs[i].Used && Syncs[i].pIsr && count % Syncs[i].Cycles == 0)
+                Syncs[i].pIsr(Syncs[i].Arg);
+        }
+        pthread_mutex_unlock(&SyncLock);
+    }
+
+    return NULL;
+}
+
+SINT32 mio_StartSyncSession(CHAR * pAppName)
+{
+    SINT32  id;
+
+    (void) pAppName;
+
+    pthread_mutex_lock(&SyncLock);
+    for (id = 0; id < SIM_MAX_SYNCS; id++)
+    {
+        if (!Syncs[id].Used)
+        {
+            memset(&Syncs[id], 0, sizeof(Syncs[id]));
+            Syncs[id].Used = TRUE;
+            break;
+        }
+    }
+    if (id < SIM_MAX_SYNCS && !SyncRunning)
+    {
+        if (pthread_create(&SyncThread, NULL, SyncMain, NULL) == 0)
+        {
+            pthread_detach(SyncThread);
+            SyncRunning = TRUE;
+        }
+    }
+    pthread_mutex_unlock(&SyncLock);
+
+    return id < SIM_MAX_SYNCS ? id : ERROR;
+}
+
+SINT32 mio_AttachSync(SINT32 SessionId, UINT32 Edge, UINT32 Cycles, VOIDFUNCPTR pIsr, UINT32 Arg)
+{
+    (void) Edge;
+
+    if (SessionId < 0 || SessionId >= SIM_MAX_SYNCS || !Syncs[SessionId].Used)
+        return (ERROR);
+
+    pthread_mutex_lock(&SyncLock);
+    Syncs[SessionId].Cycles = Cycles ? Cycles : 1;
+    Syncs[SessionId].Arg = Arg;
+    Syncs[SessionId].pIsr = pIsr;
+    pthread_mutex_unlock(&SyncLock);
+
+    return (OK);
+}
+
+SINT32 mio_StopSyncSession(SINT32 SessionId)
+{
+    if (SessionId < 0 || SessionId >= SIM_MAX_SYNCS)
+        return (ERROR);
+
+    pthread_mutex_lock(&SyncLock);
+    Syncs[SessionId].Used = FALSE;
+    Syncs[SessionId].pIsr = NULL;
+    pthread_mutex_unlock(&SyncLock);
+
+    return (OK);
+}
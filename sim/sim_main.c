@@ -0,0 +1,206 @@
+/**
+********************************************************************************
+* @file     sim_main.c
+*
+* @brief    Runs the unmodified m1stream module on a Linux host.
+*           Plays the part of the module handler: reads (BaseParms) of the
+*           module from mconfig, calls m1stream_Init(), sends the SMI call
+*           SMI_PROC_ENDOFINIT, SMI_PROC_NEWCFG on SIGHUP (after mconfig
+*           was edited), and finally SMI_PROC_DEINIT on exit.
+*           From there on the real Control and Log tasks and server_main()
+*           run on top of the host stand-ins in sim_*.c.
+*
+*           Usage: m1stream_sim [options]
+*               -f <file>   mconfig file (default: mconfig.ini)
+*               -a <name>   module instance, section in mconfig (default: M1STREAM)
+*               -s <file>   signal script (default: signals.sim)
+*               -t <sec>    run time in seconds, 0 = until Ctrl-C (default: 0)
+*               -r <Hz>     tick rate (default: 1000)
+*               -y <us>     sync period (default: 1000)
+*               -v          print the SVI variables and the statistics
+*                           (M1STREAM_PROC_APPSTAT) of the module on exit
+*
+*******************************************************************************/
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "msys_sim.h"
+#include "m1stream.h"
+
+/* Entry point of the module, see m1stream_module.c */
+SINT32  m1stream_Init(MOD_CONF * pConf, MOD_LOAD * pLoad);
+
+/* Prints the reply of M1STREAM_PROC_APPSTAT */
+MLOCAL VOID StatDump(FILE * pStream)
+{
+    MLOCAL M1STREAM_APPSTAT_R Stat;
+    M1STREAM_APPSTAT_C Call = { 0 };
+    M1STREAM_TIMING *pTiming[2] = { &Stat.CycleExec, &Stat.CyclePeriod };
+    CHAR   *pName[2] = { "exec", "period" };
+    CHAR   *pPool[M1STREAM_STAT_POOLS] = { "clients", "headers", "messages" };
+    UINT32  i;
+
+    if (sim_SmiCall(M1STREAM_PROC_APPSTAT, &Call, sizeof(Call), &Stat, sizeof(Stat)) != SMI_E_OK)
+        return;
+
+    fprintf(pStream, "stat: clients %u, handshakes %u (%u failed), frames %u, bytes %u, "
+            "skipped %u, send errors %u, evicted %u\n", Stat.Clients, Stat.Handshakes,
+            Stat.HandshakesFailed, Stat.FramesSent, Stat.BytesSent, Stat.FramesSkipped,
+            Stat.SendErrors, Stat.Evicted);
+    fprintf(pStream, "stat: connections %u (high %u), refused full %u, per ip %u, rate %u, "
+            "handshake timeouts %u, accept errors %u\n", Stat.Connections, Stat.ConnectionsHigh,
+            Stat.RefusedFull, Stat.RefusedPerIp, Stat.RefusedRate, Stat.HandshakeTimeouts,
+            Stat.AcceptErrors);
+    fprintf(pStream, "stat: http requests %u, not modified %u, not found %u, bytes %u\n",
+            Stat.HttpRequests, Stat.HttpNotModified, Stat.HttpNotFound, Stat.HttpBytes);
+    for (i = 0; i < 2; i++)
+        fprintf(pStream, "stat: cycle %-6s n %u, p50 %u, p90 %u, p99 %u, p99.9 %u, max %u us\n",
+                pName[i], pTiming[i]->Count, pTiming[i]->P50_us, pTiming[i]->P90_us,
+                pTiming[i]->P99_us, pTiming[i]->P999_us, pTiming[i]->Max_us);
+    for (i = 0; i < M1STREAM_STAT_POOLS; i++)
+        fprintf(pStream, "stat: pool %-8s size %u, used %u, high %u, fallback %u\n", pPool[i],
+                Stat.Pool[i].Size, Stat.Pool[i].Used, Stat.Pool[i].High, Stat.Pool[i].Fallback);
+    for (i = 0; i < Stat.NbOfClients; i++)
+        fprintf(pStream, "stat: client socket %u, queue %u, frames %u, bytes %u, skipped %u, "
+                "rtt %u us, every %u. frame, %u/s\n", Stat.Client[i].SocketId, Stat.Client[i].QueueDepth,
+                Stat.Client[i].FramesSent, Stat.Client[i].BytesSent, Stat.Client[i].FramesSkipped,
+                Stat.Client[i].Rtt_us, Stat.Client[i].RateDivider, Stat.Client[i].Rate);
+}
+
+MLOCAL VOID Usage(CHAR * pName)
+{
+    fprintf(stderr, "usage: %s [-f mconfig] [-a name] [-s script] [-t sec] "
+            "[-r tickrate] [-y sync_us] [-v]\n", pName);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    CHAR   *pCfgFile = "mconfig.ini";
+    CHAR   *pScript = "signals.sim";
+    CHAR   *pAppName = "M1STREAM";
+    CHAR    Strg[M_PATHLEN_A];
+    UINT32  RunTime = 0, ClkRate = 0, SyncCycle = 0, DumpSvi = FALSE;
+    SMI_ENDOFINIT_R EoiReply;
+    SMI_DEINIT_R DeinitReply;
+    SMI_NEWCFG_R NewCfgReply;
+    struct timespec End, Now, Left;
+    MOD_CONF Conf;
+    MOD_LOAD Load;
+    SINT32  Line, Value;
+    sigset_t sigs;
+    int     opt;
+
+    while ((opt = getopt(argc, argv, "f:a:s:t:r:y:v")) != -1)
+    {
+        switch (opt)
+        {
+            case 'f': pCfgFile = optarg; break;
+            case 'a': pAppName = optarg; break;
+            case 's': pScript = optarg; break;
+            case 't': RunTime = atoi(optarg); break;
+            case 'r': ClkRate = atoi(optarg); break;
+            case 'y': SyncCycle = atoi(optarg); break;
+            case 'v': DumpSvi = TRUE; break;
+            default: Usage(argv[0]);
+        }
+    }
+
+    /*
+     * Every thread inherits this mask, so Ctrl-C always ends up in the
+     * sigtimedwait() below and not in the handler of server_main().
+     */
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGINT);
+    sigaddset(&sigs, SIGTERM);
+    sigaddset(&sigs, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &sigs, NULL);
+
+    sim_TaskInit(ClkRate);
+    sim_IoInit(SyncCycle);
+
+    if (sim_CfgLoad(pCfgFile) < 0)
+    {
+        log_Err("sim: could not read '%s'", pCfgFile);
+        return 1;
+    }
+    if (sim_IoLoad(pScript) < 0)
+        return 1;
+
+    /* What the module handler takes from (BaseParms) of the module */
+    memset(&Conf, 0, sizeof(Conf));
+    memset(&Load, 0, sizeof(Load));
+    Line = sim_CfgFindSection(pAppName);
+    if (Line < 0)
+    {
+        log_Err("sim: no section [%s] in '%s'", pAppName, pCfgFile);
+        return 1;
+    }
+    snprintf(Conf.AppName, sizeof(Conf.AppName), "%s", pAppName);
+    Conf.LineNbr = Line;
+    pf_GetInt(pAppName, "BaseParms", "DebugMode", 0, &Value, Line, NULL);
+    Conf.DebugMode = Value;
+    pf_GetInt(pAppName, "BaseParms", "Priority", 130, &Value, Line, NULL);
+    Conf.TskPrior = Value;
+    pf_GetInt(pAppName, "BaseParms", "Partition", 1, &Value, Line, NULL);
+    Conf.MemPart = Value;
+    pf_GetStrg(pAppName, "BaseParms", "ModuleName", "m1stream.m", Strg, sizeof(Strg), Line, NULL);
+    *strchrnul(Strg, '.') = 0;
+    snprintf(Conf.TypeName, sizeof(Conf.TypeName), "%.*s", M_MODNAMELEN, Strg);
+
+    if (m1stream_Init(&Conf, &Load) < 0)
+    {
+        log_Err("sim: m1stream_Init failed");
+        return 1;
+    }
+
+    memset(&EoiReply, 0, sizeof(EoiReply));
+    sim_SmiCall(SMI_PROC_ENDOFINIT, NULL, 0, &EoiReply, sizeof(EoiReply));
+    if (EoiReply.RetCode != SMI_E_OK)
+    {
+        log_Err("sim: end of init of '%s' failed", pAppName);
+        return 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &End);
+    End.tv_sec += RunTime;
+    while (1)
+    {
+        if (RunTime)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &Now);
+            Left.tv_sec = End.tv_sec - Now.tv_sec;
+            Left.tv_nsec = End.tv_nsec - Now.tv_nsec;
+            if (Left.tv_nsec < 0)
+            {
+                Left.tv_sec--;
+                Left.tv_nsec += 1000000000;
+            }
+            if (Left.tv_sec < 0 || sigtimedwait(&sigs, NULL, &Left) != SIGHUP)
+                break;
+        }
+        else if (sigwaitinfo(&sigs, NULL) != SIGHUP)
+            break;
+
+        /* as the module handler does after the configuration was changed */
+        memset(&NewCfgReply, 0, sizeof(NewCfgReply));
+        sim_SmiCall(SMI_PROC_NEWCFG, NULL, 0, &NewCfgReply, sizeof(NewCfgReply));
+        if (NewCfgReply.RetCode != SMI_E_OK)
+            log_Err("sim: new configuration of '%s' failed", pAppName);
+    }
+
+    if (DumpSvi)
+    {
+        sim_SviDump(stdout);
+        StatDump(stdout);
+    }
+
+    sim_SmiCall(SMI_PROC_DEINIT, NULL, 0, &DeinitReply, sizeof(DeinitReply));
+
+    /* server_main() has no way to stop, it ends with the process */
+    return 0;
+}
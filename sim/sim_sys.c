@@ -0,0 +1,444 @@
+/**
+********************************************************************************
+* @file     sim_sys.c
+*
+* @brief    Host stand-in for the remaining MSys services: logger, resource
+*           handler, SMI message queue, SVI variable table, memory and
+*           version functions, and the symbol lookup used by BaseInit().
+*
+*           SMI calls are made by sim_SmiCall() from the simulation main.
+*           They are queued for the b-task of the module, which receives them
+*           with smi_Receive2() exactly as on the target. sim_SmiCall()
+*           returns when the module has replied.
+*
+*******************************************************************************/
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "msys_sim.h"
+
+#define SIM_MAX_SVIVARS     64
+
+typedef struct SIM_SVIVAR
+{
+    CHAR   *pName;
+    UINT32  Format;
+    UINT32  Size;
+    UINT32 *pVar;
+    UINT32  UserParam;
+    SVI_FKTSTART pStart;
+    SVI_FKTEND pEnd;
+} SIM_SVIVAR;
+
+/* The single SMI call in progress, the module handler serializes them too */
+typedef struct SIM_SMI
+{
+    pthread_mutex_t Lock;
+    pthread_cond_t Cond;
+    UINT32  Pending;                    /* call waiting for smi_Receive2 */
+    UINT32  Taken;                      /* call has been received */
+    UINT32  Replied;                    /* reply has been sent */
+    SMI_MSG Msg;
+    SINT32  RetCode;
+    VOID   *pReply;
+    UINT32  ReplyLen;
+} SIM_SMI;
+
+struct SIM_SYMTAB
+{
+    UINT32  Spare;
+};
+
+MLOCAL struct SIM_SYMTAB SymTbl;
+SYMTAB_ID sysSymTbl = &SymTbl;
+
+MLOCAL SIM_SMI Smi = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+MLOCAL SMI_ID SmiId;
+MLOCAL SIM_SVIVAR SviVars[SIM_MAX_SVIVARS];
+MLOCAL UINT32 NbOfSviVars;
+MLOCAL CHAR SviAppName[M_MODNAMELEN_A];
+MLOCAL FILE *pLogStream;
+MLOCAL pthread_mutex_t LogLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*--- Logger ---*/
+
+VOID sim_LogInit(FILE * pStream)
+{
+    pLogStream = pStream;
+}
+
+MLOCAL SINT32 LogWrite(CHAR Type, const CHAR * pFormat, va_list Args)
+{
+    UINT32  now = m_GetProcTime();
+    FILE   *pStream = pLogStream ? pLogStream : stderr;
+
+    pthread_mutex_lock(&LogLock);
+    fprintf(pStream, "%5u.%06u %c ", now / 1000000, now % 1000000, Type);
+    vfprintf(pStream, pFormat, Args);
+    fputc('\n', pStream);
+    fflush(pStream);
+    pthread_mutex_unlock(&LogLock);
+
+    return (OK);
+}
+
+#define SIM_LOG_FUNC(Name, Type) \
+SINT32 Name(const CHAR * pFormat, ...) \
+{ \
+    va_list args; \
+    SINT32  ret; \
+    va_start(args, pFormat); \
+    ret = LogWrite(Type, pFormat, args); \
+    va_end(args); \
+    return ret; \
+}
+
+SIM_LOG_FUNC(log_Info, 'I')
+SIM_LOG_FUNC(log_Wrn, 'W')
+SIM_LOG_FUNC(log_Err, 'E')
+SIM_LOG_FUNC(log_User, 'U')
+
+/*--- Resource handler ---*/
+
+SINT32 res_ModParam(CHAR * pAppName, UINT32 MinVers, UINT32 MaxVers, UINT32 MaxUsers,
+                    SMI_ID ** ppSmiId)
+{
+    (void) MinVers;
+    (void) MaxVers;
+    (void) MaxUsers;
+
+    snprintf(SmiId.AppName, sizeof(SmiId.AppName), "%s", pAppName);
+    *ppSmiId = &SmiId;
+
+    return (RES_E_OK);
+}
+
+SINT32 res_ModState(CHAR * pAppName, UINT32 State)
+{
+    static const CHAR *Names[] = { "INIT", "EOI", "RUN", "STOP", "ERROR", "DEINIT" };
+
+    log_Info("sim: module '%s' is now in state %s", pAppName,
+             State < sizeof(Names) / sizeof(Names[0]) ? Names[State] : "?");
+
+    return (RES_E_OK);
+}
+
+SINT32 res_ModDelete(CHAR * pAppName)
+{
+    (void) pAppName;
+    return (RES_E_OK);
+}
+
+/*--- SMI ---*/
+
+/**
+********************************************************************************
+* @brief Sends an SMI call to the module and waits for the reply.
+*
+* @param[in]  Proc      procedure number, SMI_PROC_xxx
+* @param[in]  pData     call parameters, copied
+* @param[in]  Len       length of pData
+* @param[out] pReply    reply data, may be NULL
+* @param[in]  ReplyLen  size of pReply
+*
+* @retval     return code of smi_SendReply/smi_SendCReply
+*******************************************************************************/
+SINT32 sim_SmiCall(SINT32 Proc, VOID * pData, UINT32 Len, VOID * pReply, UINT32 ReplyLen)
+{
+    SINT32  ret;
+
+    pthread_mutex_lock(&Smi.Lock);
+    while (Smi.Pending || Smi.Replied)
+        pthread_cond_wait(&Smi.Cond, &Smi.Lock);
+
+    memset(&Smi.Msg, 0, sizeof(Smi.Msg));
+    Smi.Msg.Type = SMI_F_CALL;
+    Smi.Msg.ProcRetCode = Proc;
+    if (Len)
+    {
+        Smi.Msg.Data = smi_MemAlloc(Len);
+        memcpy(Smi.Msg.Data, pData, Len);
+        Smi.Msg.DataLen = Len;
+    }
+    Smi.Pending = TRUE;
+    Smi.Taken = FALSE;
+    Smi.Replied = FALSE;
+    pthread_cond_broadcast(&Smi.Cond);
+
+    while (!Smi.Replied)
+        pthread_cond_wait(&Smi.Cond, &Smi.Lock);
+
+    ret = Smi.RetCode;
+    if (pReply && Smi.pReply)
+        memcpy(pReply, Smi.pReply, Smi.ReplyLen < ReplyLen ? Smi.ReplyLen : ReplyLen);
+    free(Smi.pReply);
+    Smi.pReply = NULL;
+    Smi.Replied = FALSE;
+    pthread_cond_broadcast(&Smi.Cond);
+    pthread_mutex_unlock(&Smi.Lock);
+
+    return (ret);
+}
+
+SINT32 smi_Receive2(SMI_ID * pSmiId, SMI_MSG * pMsg, SINT32 Timeout, UINT32 * pUser)
+{
+    (void) pSmiId;
+    (void) Timeout;
+
+    pthread_mutex_lock(&Smi.Lock);
+    while (!Smi.Pending || Smi.Taken)
+        pthread_cond_wait(&Smi.Cond, &Smi.Lock);
+    Smi.Taken = TRUE;
+    *pMsg = Smi.Msg;
+    Smi.Msg.Data = NULL;
+    pthread_mutex_unlock(&Smi.Lock);
+
+    if (pUser)
+        *pUser = 0;
+
+    return (0);
+}
+
+SINT32 smi_Receive(SMI_ID * pSmiId, SMI_MSG * pMsg, SINT32 Timeout)
+{
+    return smi_Receive2(pSmiId, pMsg, Timeout, NULL);
+}
+
+MLOCAL SINT32 SmiReply(SINT32 RetCode, VOID * pData, UINT32 Len, UINT32 Copy)
+{
+    pthread_mutex_lock(&Smi.Lock);
+    if (!Smi.Pending)
+    {
+        pthread_mutex_unlock(&Smi.Lock);
+        return (ERROR);
+    }
+    Smi.RetCode = RetCode;
+    Smi.pReply = NULL;
+    Smi.ReplyLen = 0;
+    if (pData && Len)
+    {
+        Smi.pReply = malloc(Len);
+        memcpy(Smi.pReply, pData, Len);
+        Smi.ReplyLen = Len;
+    }
+    /* smi_SendReply hands over memory from smi_MemAlloc */
+    if (!Copy)
+        free(pData);
+    Smi.Pending = FALSE;
+    Smi.Replied = TRUE;
+    pthread_cond_broadcast(&Smi.Cond);
+    pthread_mutex_unlock(&Smi.Lock);
+
+    return (OK);
+}
+
+SINT32 smi_SendReply(SMI_ID * pSmiId, SMI_MSG * pMsg, SINT32 RetCode, VOID * pData, UINT32 Len)
+{
+    (void) pSmiId;
+    (void) pMsg;
+    return SmiReply(RetCode, pData, Len, FALSE);
+}
+
+SINT32 smi_SendCReply(SMI_ID * pSmiId, SMI_MSG * pMsg, SINT32 RetCode, VOID * pData, UINT32 Len)
+{
+    (void) pSmiId;
+    (void) pMsg;
+    return SmiReply(RetCode, pData, Len, TRUE);
+}
+
+VOID smi_FreeData(SMI_MSG * pMsg)
+{
+    free(pMsg->Data);
+    pMsg->Data = NULL;
+    pMsg->DataLen = 0;
+}
+
+VOID   *smi_MemAlloc(UINT32 Size)
+{
+    return calloc(1, Size);
+}
+
+/*--- SVI ---*/
+
+UINT32 svi_Init(CHAR * pAppName, UINT32 Spare1, UINT32 Spare2)
+{
+    (void) Spare1;
+    (void) Spare2;
+
+    snprintf(SviAppName, sizeof(SviAppName), "%s", pAppName);
+    NbOfSviVars = 0;
+
+    return (1);
+}
+
+SINT32 svi_DeInit(UINT32 SviHandle)
+{
+    if (SviHandle != 1)
+        return (ERROR);
+    NbOfSviVars = 0;
+    return (OK);
+}
+
+SINT32 svi_AddGlobVar(UINT32 SviHandle, CHAR * pName, UINT32 Format, UINT32 Size,
+                      UINT32 * pVar, UINT32 Spare, UINT32 UserParam,
+                      SVI_FKTSTART pStart, SVI_FKTEND pEnd)
+{
+    (void) Spare;
+
+    if (SviHandle != 1 || NbOfSviVars == SIM_MAX_SVIVARS)
+        return (ERROR);
+
+    SviVars[NbOfSviVars].pName = pName;
+    SviVars[NbOfSviVars].Format = Format;
+    SviVars[NbOfSviVars].Size = Size;
+    SviVars[NbOfSviVars].pVar = pVar;
+    SviVars[NbOfSviVars].UserParam = UserParam;
+    SviVars[NbOfSviVars].pStart = pStart;
+    SviVars[NbOfSviVars].pEnd = pEnd;
+    NbOfSviVars++;
+
+    return (OK);
+}
+
+SINT32 svi_MsgHandler2(UINT32 SviHandle, SMI_MSG * pMsg, SMI_ID * pSmiId, UINT32 User)
+{
+    (void) SviHandle;
+    (void) User;
+
+    smi_FreeData(pMsg);
+    return smi_SendReply(pSmiId, pMsg, SMI_E_PROC, 0, 0);
+}
+
+/**
+********************************************************************************
+* @brief Prints all exported SVI variables with their current values.
+*        The start and end functions of a variable are called around it,
+*        as the SVI server does. Blocks are printed as 32 bit words.
+*******************************************************************************/
+VOID sim_SviDump(FILE * pStream)
+{
+    UINT32  i, w;
+
+    for (i = 0; i < NbOfSviVars; i++)
+    {
+        SIM_SVIVAR *pVar = &SviVars[i];
+
+        if (pVar->pStart && pVar->pStart(NULL, pVar->UserParam) < 0)
+            continue;
+
+        fprintf(pStream, "%s/%s = ", SviAppName, pVar->pName);
+        switch (pVar->Format & 0xff00)
+        {
+            case SVI_F_UINT32:
+                fprintf(pStream, "%u\n", *pVar->pVar);
+                break;
+            case SVI_F_SINT32:
+                fprintf(pStream, "%d\n", *(SINT32 *) pVar->pVar);
+                break;
+            case SVI_F_REAL32:
+                fprintf(pStream, "%f\n", *(REAL32 *) pVar->pVar);
+                break;
+            case SVI_F_STRING:
+                fprintf(pStream, "%.*s\n", (int) pVar->Size, (CHAR *) pVar->pVar);
+                break;
+            case SVI_F_BLK:
+                for (w = 0; w < pVar->Size / 4; w++)
+                    fprintf(pStream, "%d ", ((SINT32 *) pVar->pVar)[w]);
+                fprintf(pStream, "\n");
+                break;
+            default:
+                fprintf(pStream, "<%u bytes>\n", pVar->Size);
+                break;
+        }
+
+        if (pVar->pEnd)
+            pVar->pEnd(NULL, pVar->UserParam);
+    }
+}
+
+/*--- System ---*/
+
+VOID   *sys_MemAlloc(UINT32 Size)
+{
+    return malloc(Size);
+}
+
+VOID sys_MemFree(VOID * pMem)
+{
+    free(pMem);
+}
+
+VOID sys_MemPFree(UINT32 Partition, VOID * pMem)
+{
+    (void) Partition;
+    free(pMem);
+}
+
+VOID sys_CycleStart(VOID)
+{
+}
+
+VOID sys_CycleEnd(VOID)
+{
+}
+
+SINT32 sys_PanicSigSet(VOIDFUNCPTR pHandler)
+{
+    (void) pHandler;
+    return (OK);
+}
+
+SINT32 sys_PanicSigReset(VOID)
+{
+    return (OK);
+}
+
+SINT32 sys_ExcSigReset(VOID)
+{
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Parses a version string like "V1.00.01 Alpha".
+*******************************************************************************/
+SINT32 sys_GetVersion(SYS_VERSION * pVersion, CHAR * pVersStrg)
+{
+    unsigned int major = 0, minor = 0, rev = 0;
+
+    memset(pVersion, 0, sizeof(*pVersion));
+    sscanf(pVersStrg, "V%u.%u.%u", &major, &minor, &rev);
+    pVersion->Code[0] = major;
+    pVersion->Code[1] = minor;
+    pVersion->Code[2] = rev;
+    if (strstr(pVersStrg, "Alpha"))
+        pVersion->Type = 2;
+    else if (strstr(pVersStrg, "Beta"))
+        pVersion->Type = 1;
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Resolves the few symbols the module looks up at runtime.
+*******************************************************************************/
+STATUS symFindByName(SYMTAB_ID SymTbl, char *pName, char **ppValue, SYM_TYPE * pType)
+{
+    (void) SymTbl;
+
+    if (pType)
+        *pType = 0;
+
+    if (!strcmp(pName, "_smi_Receive2"))
+        *ppValue = (char *) smi_Receive2;
+    else if (!strcmp(pName, "_svi_MsgHandler2"))
+        *ppValue = (char *) svi_MsgHandler2;
+    else
+        return (ERROR);
+
+    return (OK);
+}
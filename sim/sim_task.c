@@ -0,0 +1,398 @@
+/**
+********************************************************************************
+* @file     sim_task.c
+*
+* @brief    Host stand-in for the VxWorks task, semaphore and tick services.
+*           Tasks are detached pthreads, semaphores are mutex/condition
+*           pairs, and the tick counter is derived from CLOCK_MONOTONIC.
+*           Task priorities are recorded but not applied, as real-time
+*           scheduling needs privileges a developer box usually lacks.
+*
+*******************************************************************************/
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include <stdarg.h>
+#include <limits.h>
+
+#include "msys_sim.h"
+
+#define SIM_MAX_TASKS       64
+#define SIM_MAX_SEMS        256
+#define SIM_MAX_WDOGS       64
+#define SIM_MIN_STACK       (256 * 1024)
+
+typedef struct SIM_TASK
+{
+    CHAR    Name[M_TSKNAMELEN_A];
+    FUNCPTR pEntry;
+    VOID   *pArg;
+    pthread_t Thread;
+    volatile UINT32 Used;
+    volatile UINT32 Running;
+} SIM_TASK;
+
+typedef struct SIM_SEM
+{
+    pthread_mutex_t Lock;
+    pthread_cond_t Cond;
+    UINT32  Used;
+    UINT32  Full;                       /* binary semaphore state */
+    UINT32  Flushes;                    /* incremented by semFlush */
+} SIM_SEM;
+
+typedef struct SIM_WDOG
+{
+    UINT32  Used;
+    UINT32  Enabled;
+    UINT32  Time_us;
+    UINT32  LastTrigg;
+    UINT32  Expired;
+} SIM_WDOG;
+
+MLOCAL SIM_TASK Tasks[SIM_MAX_TASKS];
+MLOCAL SIM_SEM Sems[SIM_MAX_SEMS];
+MLOCAL SIM_WDOG Wdogs[SIM_MAX_WDOGS];
+MLOCAL pthread_mutex_t TableLock = PTHREAD_MUTEX_INITIALIZER;
+MLOCAL UINT32 ClkRate = 1000;
+MLOCAL struct timespec StartTime;
+
+/**
+********************************************************************************
+* @brief Sets the tick rate and the time origin of the simulation.
+*
+* @param[in]  Rate  ticks per second, 0 keeps the default of 1000
+*******************************************************************************/
+VOID sim_TaskInit(UINT32 Rate)
+{
+    if (Rate)
+        ClkRate = Rate;
+    clock_gettime(CLOCK_MONOTONIC, &StartTime);
+}
+
+MLOCAL UINT64 ElapsedUs(VOID)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (UINT64) (now.tv_sec - StartTime.tv_sec) * 1000000ULL +
+        (now.tv_nsec - StartTime.tv_nsec) / 1000;
+}
+
+int sysClkRateGet(void)
+{
+    return ClkRate;
+}
+
+UINT32 tickGet(void)
+{
+    return (UINT32) (ElapsedUs() * ClkRate / 1000000ULL);
+}
+
+UINT32 m_GetProcTime(VOID)
+{
+    return (UINT32) ElapsedUs();
+}
+
+/**
+********************************************************************************
+* @brief Converts a timeout in ticks into an absolute CLOCK_MONOTONIC time.
+*******************************************************************************/
+MLOCAL VOID TicksToDeadline(int Ticks, struct timespec *pTs)
+{
+    UINT64  ns = (UINT64) Ticks * 1000000000ULL / ClkRate;
+
+    clock_gettime(CLOCK_MONOTONIC, pTs);
+    pTs->tv_sec += ns / 1000000000ULL;
+    pTs->tv_nsec += ns % 1000000000ULL;
+    if (pTs->tv_nsec >= 1000000000L)
+    {
+        pTs->tv_sec++;
+        pTs->tv_nsec -= 1000000000L;
+    }
+}
+
+STATUS taskDelay(int Ticks)
+{
+    struct timespec ts;
+
+    TicksToDeadline(Ticks > 0 ? Ticks : 0, &ts);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+    return (OK);
+}
+
+/*--- Tasks ---*/
+
+MLOCAL VOID *TaskEntry(VOID *pArg)
+{
+    SIM_TASK *pTask = pArg;
+
+    pthread_setname_np(pthread_self(), pTask->Name);
+    pTask->pEntry(pTask->pArg);
+    pTask->Running = FALSE;
+    return NULL;
+}
+
+SINT32 sim_TaskSpawn(CHAR * pAppName, CHAR * pTaskName, SINT32 Prio, SINT32 Options,
+                     SINT32 StackSize, FUNCPTR pEntry, VOID * pArg, ...)
+{
+    pthread_attr_t attr;
+    SINT32  id;
+    SIM_TASK *pTask = NULL;
+
+    (void) pAppName;
+    (void) Prio;
+    (void) Options;
+
+    pthread_mutex_lock(&TableLock);
+    for (id = 0; id < SIM_MAX_TASKS; id++)
+    {
+        /* slots of tasks which have returned are reused */
+        if (!Tasks[id].Used || !Tasks[id].Running)
+        {
+            pTask = &Tasks[id];
+            break;
+        }
+    }
+    if (!pTask)
+    {
+        pthread_mutex_unlock(&TableLock);
+        log_Err("sim: task table full, cannot spawn '%s'", pTaskName);
+        return (ERROR);
+    }
+    memset(pTask, 0, sizeof(*pTask));
+    snprintf(pTask->Name, sizeof(pTask->Name), "%s", pTaskName);
+    pTask->pEntry = pEntry;
+    pTask->pArg = pArg;
+    pTask->Used = TRUE;
+    pTask->Running = TRUE;
+    pthread_mutex_unlock(&TableLock);
+
+    /* glibc needs more stack than the VxWorks task would */
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, StackSize < SIM_MIN_STACK ? SIM_MIN_STACK : StackSize);
+    if (pthread_create(&pTask->Thread, &attr, TaskEntry, pTask) != 0)
+    {
+        pTask->Used = FALSE;
+        pTask->Running = FALSE;
+        id = ERROR;
+    }
+    pthread_attr_destroy(&attr);
+
+    return (id);
+}
+
+STATUS taskIdVerify(int TaskId)
+{
+    if (TaskId < 0 || TaskId >= SIM_MAX_TASKS)
+        return (ERROR);
+    return (Tasks[TaskId].Used && Tasks[TaskId].Running) ? OK : ERROR;
+}
+
+STATUS taskDelete(int TaskId)
+{
+    if (taskIdVerify(TaskId) != OK)
+        return (ERROR);
+    if (pthread_cancel(Tasks[TaskId].Thread) != 0)
+        return (ERROR);
+    Tasks[TaskId].Running = FALSE;
+    return (OK);
+}
+
+/*--- Binary semaphores ---*/
+
+MLOCAL SIM_SEM *SemGet(SEM_ID SemId)
+{
+    if (SemId < 1 || SemId > SIM_MAX_SEMS || !Sems[SemId - 1].Used)
+        return NULL;
+    return &Sems[SemId - 1];
+}
+
+SEM_ID semBCreate(int Options, int InitialState)
+{
+    pthread_condattr_t attr;
+    SEM_ID  id;
+
+    (void) Options;
+
+    pthread_mutex_lock(&TableLock);
+    for (id = 1; id <= SIM_MAX_SEMS; id++)
+    {
+        if (!Sems[id - 1].Used)
+        {
+            SIM_SEM *pSem = &Sems[id - 1];
+
+            pthread_mutex_init(&pSem->Lock, NULL);
+            pthread_condattr_init(&attr);
+            pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+            pthread_cond_init(&pSem->Cond, &attr);
+            pthread_condattr_destroy(&attr);
+            pSem->Full = (InitialState == SEM_FULL);
+            pSem->Flushes = 0;
+            pSem->Used = TRUE;
+            pthread_mutex_unlock(&TableLock);
+            return (id);
+        }
+    }
+    pthread_mutex_unlock(&TableLock);
+
+    return (0);
+}
+
+STATUS semGive(SEM_ID SemId)
+{
+    SIM_SEM *pSem = SemGet(SemId);
+
+    if (!pSem)
+        return (ERROR);
+
+    pthread_mutex_lock(&pSem->Lock);
+    pSem->Full = TRUE;
+    pthread_cond_signal(&pSem->Cond);
+    pthread_mutex_unlock(&pSem->Lock);
+
+    return (OK);
+}
+
+/**
+********************************************************************************
+* @brief Takes a binary semaphore, waiting at most Timeout ticks.
+*        A semFlush() releases all waiters without making the semaphore full.
+*
+* @retval     = 0 .. OK
+* @retval     < 0 .. timeout or invalid semaphore
+*******************************************************************************/
+STATUS semTake(SEM_ID SemId, int Timeout)
+{
+    SIM_SEM *pSem = SemGet(SemId);
+    struct timespec deadline;
+    UINT32  flushes;
+    STATUS  ret = OK;
+
+    if (!pSem)
+        return (ERROR);
+
+    if (Timeout != WAIT_FOREVER)
+        TicksToDeadline(Timeout, &deadline);
+
+    pthread_mutex_lock(&pSem->Lock);
+    flushes = pSem->Flushes;
+    while (!pSem->Full && pSem->Flushes == flushes)
+    {
+        if (Timeout == WAIT_FOREVER)
+            pthread_cond_wait(&pSem->Cond, &pSem->Lock);
+        else if (Timeout == NO_WAIT ||
+                 pthread_cond_timedwait(&pSem->Cond, &pSem->Lock, &deadline) == ETIMEDOUT)
+        {
+            ret = ERROR;
+            break;
+        }
+    }
+    if (ret == OK && pSem->Flushes == flushes)
+        pSem->Full = FALSE;
+    pthread_mutex_unlock(&pSem->Lock);
+
+    return (ret);
+}
+
+STATUS semFlush(SEM_ID SemId)
+{
+    SIM_SEM *pSem = SemGet(SemId);
+
+    if (!pSem)
+        return (ERROR);
+
+    pthread_mutex_lock(&pSem->Lock);
+    pSem->Flushes++;
+    pthread_cond_broadcast(&pSem->Cond);
+    pthread_mutex_unlock(&pSem->Lock);
+
+    return (OK);
+}
+
+STATUS semDelete(SEM_ID SemId)
+{
+    SIM_SEM *pSem = SemGet(SemId);
+
+    if (!pSem)
+        return (ERROR);
+
+    /* wake up everybody still waiting, they see an invalid semaphore */
+    semFlush(SemId);
+    pthread_mutex_lock(&TableLock);
+    pSem->Used = FALSE;
+    pthread_mutex_unlock(&TableLock);
+
+    return (OK);
+}
+
+/*--- Software watchdogs ---*/
+
+/**
+********************************************************************************
+* @brief Creates a software watchdog. On the host an expired watchdog is
+*        only reported on the next trigger, it does not stop the module.
+*******************************************************************************/
+UINT32 sys_WdogCreate(CHAR * pAppName, UINT32 Time_us)
+{
+    UINT32  id;
+
+    (void) pAppName;
+
+    pthread_mutex_lock(&TableLock);
+    for (id = 1; id <= SIM_MAX_WDOGS; id++)
+    {
+        if (!Wdogs[id - 1].Used)
+        {
+            memset(&Wdogs[id - 1], 0, sizeof(Wdogs[0]));
+            Wdogs[id - 1].Used = TRUE;
+            Wdogs[id - 1].Time_us = Time_us;
+            pthread_mutex_unlock(&TableLock);
+            return (id);
+        }
+    }
+    pthread_mutex_unlock(&TableLock);
+
+    return (0);
+}
+
+SINT32 sys_WdogTrigg(UINT32 WdogId)
+{
+    SIM_WDOG *pWdog;
+    UINT32  now = m_GetProcTime();
+
+    if (WdogId < 1 || WdogId > SIM_MAX_WDOGS || !Wdogs[WdogId - 1].Used)
+        return (ERROR);
+
+    pWdog = &Wdogs[WdogId - 1];
+    if (pWdog->Enabled && now - pWdog->LastTrigg > pWdog->Time_us)
+    {
+        pWdog->Expired++;
+        log_Wrn("sim: watchdog %u expired, %u us since last trigger (limit %u us)",
+                WdogId, now - pWdog->LastTrigg, pWdog->Time_us);
+    }
+    pWdog->LastTrigg = now;
+    pWdog->Enabled = TRUE;
+
+    return (OK);
+}
+
+SINT32 sys_WdogDisable(UINT32 WdogId)
+{
+    if (WdogId < 1 || WdogId > SIM_MAX_WDOGS)
+        return (ERROR);
+    Wdogs[WdogId - 1].Enabled = FALSE;
+    return (OK);
+}
+
+SINT32 sys_WdogDelete(UINT32 WdogId)
+{
+    if (WdogId < 1 || WdogId > SIM_MAX_WDOGS)
+        return (ERROR);
+    Wdogs[WdogId - 1].Used = FALSE;
+    return (OK);
+}
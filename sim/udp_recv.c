@@ -0,0 +1,120 @@
+/**
+********************************************************************************
+* @file     udp_recv.c
+*
+* @brief    Receiver of the multicast output of m1stream_udp.c, as a display
+*           on the LAN would be one. Joins the group, checks each datagram
+*           and its Seq, and prints once per second what came in. Any
+*           number of receivers can run at the same time, on this host
+*           through the loopback of multicast ((Multicast) Loop = 1).
+*           Ends after the given time, with exit code 1 if a datagram was
+*           lost or broken.
+*
+*               ./udp_recv [-a address] [-p port] [-i interface] [-t seconds]
+*
+*******************************************************************************/
+
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "msys_sim.h"
+#include "m1stream_rec.h"
+#include "m1stream_udp.h"
+
+int main(int argc, char **argv)
+{
+    const char *Address = "239.255.77.1";
+    const char *Interface = NULL;
+    int     Port = 4568;
+    int     Seconds = 10;
+    struct sockaddr_in Local;
+    struct ip_mreq Mreq;
+    struct timeval Timeout = {0, 100000};
+    UDP_DATAGRAM Dgram;
+    UINT32  Seq, Expected = 0, Received = 0, Lost = 0, Late = 0, Broken = 0;
+    BOOL    First = TRUE;
+    time_t  End, Next;
+    int     fd, opt, on = 1;
+    ssize_t len;
+
+    while ((opt = getopt(argc, argv, "a:p:i:t:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'a': Address = optarg; break;
+            case 'p': Port = atoi(optarg); break;
+            case 'i': Interface = optarg; break;
+            case 't': Seconds = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-a address] [-p port] [-i interface] [-t seconds]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &Timeout, sizeof(Timeout));
+
+    /* bound to the port only, so that broadcasts come in as well */
+    memset(&Local, 0, sizeof(Local));
+    Local.sin_family = AF_INET;
+    Local.sin_port = htons(Port);
+    Local.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, (struct sockaddr *) &Local, sizeof(Local)) < 0)
+    {
+        perror("bind");
+        return 2;
+    }
+
+    Mreq.imr_multiaddr.s_addr = inet_addr(Address);
+    Mreq.imr_interface.s_addr = Interface ? inet_addr(Interface) : htonl(INADDR_ANY);
+    if (IN_MULTICAST(ntohl(Mreq.imr_multiaddr.s_addr)) &&
+        setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &Mreq, sizeof(Mreq)) < 0)
+    {
+        perror("IP_ADD_MEMBERSHIP");
+        return 2;
+    }
+
+    memset(&Dgram, 0, sizeof(Dgram));
+    End = time(NULL) + Seconds;
+    Next = time(NULL) + 1;
+    while (time(NULL) < End)
+    {
+        len = recv(fd, &Dgram, sizeof(Dgram), 0);
+        if (len >= 0)
+        {
+            if (len != sizeof(Dgram) || ntohl(Dgram.Magic) != UDP_MAGIC || ntohs(Dgram.Version) != UDP_VERSION)
+            {
+                Broken++;
+                continue;
+            }
+
+            Received++;
+            Seq = ntohl(Dgram.Seq);
+            if (First || (SINT32) (Seq - Expected) >= 0)
+            {
+                /* a jump ahead is a gap, one back is late */
+                if (!First)
+                    Lost += Seq - Expected;
+                Expected = Seq + 1;
+            }
+            else
+                Late++;
+            First = FALSE;
+        }
+
+        if (time(NULL) >= Next)
+        {
+            Next++;
+            printf("received %u, lost %u, late %u, broken %u, cycle %u, value[0] %d\n", Received, Lost, Late,
+                   Broken, ntohl(Dgram.Cycle), (SINT32) ntohl((UINT32) Dgram.Channel[0].Value));
+            fflush(stdout);
+        }
+    }
+
+    close(fd);
+    return (Received == 0 || Lost || Broken) ? 1 : 0;
+}
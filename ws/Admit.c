@@ -0,0 +1,270 @@
+/******************************************************************************
+  Copyright (c) 2013 Morten Houmøller Nygaard - www.mortz.dk - admin@mortz.dk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "Admit.h"
+#include "Datastructures.h"
+#include "Log.h"
+#include <sockLib.h>
+
+typedef struct {
+	uint32_t addr; 				/* in network byte order */
+	uint32_t count; 			/* connections open from it */
+} ws_admit_ip;
+
+/**
+ * The token bucket counts in us * rate: one us adds rate of them, and a
+ * handshake takes ADMIT_TOKEN, so no fraction of a handshake is lost
+ * however short the time between two of them.
+ */
+#define ADMIT_TOKEN 1000000ULL
+
+static uint32_t admit_max = WS_ADMIT_CONNECTIONS;
+static uint32_t admit_per_ip = WS_ADMIT_PER_IP;
+static uint64_t admit_rate = WS_ADMIT_RATE;
+static uint64_t admit_burst = WS_ADMIT_BURST * ADMIT_TOKEN;
+static uint64_t admit_timeout = WS_ADMIT_TIMEOUT * 1000ULL;
+static uint64_t admit_tokens = WS_ADMIT_BURST * ADMIT_TOKEN;
+static uint64_t admit_stamp = 0; 	/* ws_now() of the last refill */
+static ws_admit_ip admit_ips[WS_ADMIT_IPS + 1]; 	/* + the one looked up */
+static int admit_ips_used = 0;
+static ws_admit_stats admit_stats;
+static pthread_mutex_t admit_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Sets the limits of new connections. Connections open already are kept,
+ * even if there are more of them than the new limits allow.
+ *
+ * @param type(int) max_connections [Connections open at the same time]
+ * @param type(int) max_per_ip [Connections of one address, 0: any]
+ * @param type(int) rate [Handshakes per second, 0: any]
+ * @param type(int) burst [Handshakes at once after a quiet time]
+ * @param type(int) timeout [Time for the headers in ms, 0: none]
+ */
+void ws_admit_configure(int max_connections, int max_per_ip, int rate,
+		int burst, int timeout) {
+	pthread_mutex_lock(&admit_lock);
+	if (max_connections < 1) {
+		admit_max = WS_ADMIT_CONNECTIONS;
+	} else if (max_connections > WS_ADMIT_IPS) {
+		admit_max = WS_ADMIT_IPS;
+	} else {
+		admit_max = (uint32_t) max_connections;
+	}
+	admit_per_ip = (max_per_ip < 0) ? 0 : (uint32_t) max_per_ip;
+	admit_rate = (rate < 0) ? 0 : (uint64_t) rate;
+	admit_burst = ((burst < 1) ? 1 : (uint64_t) burst) * ADMIT_TOKEN;
+	admit_tokens = admit_burst;
+	admit_timeout = (timeout < 0) ? 0 : (uint64_t) timeout * 1000ULL;
+	pthread_mutex_unlock(&admit_lock);
+}
+
+/**
+ * Finds the entry of an address, or makes a new one.
+ */
+static ws_admit_ip *admit_find(uint32_t addr) {
+	int i;
+
+	for (i = 0; i < admit_ips_used; i++) {
+		if (admit_ips[i].addr == addr) {
+			return &admit_ips[i];
+		}
+	}
+	admit_ips[admit_ips_used].addr = addr;
+	admit_ips[admit_ips_used].count = 0;
+	return &admit_ips[admit_ips_used++];
+}
+
+/**
+ * Takes one handshake from the token bucket, after adding what came in
+ * since the last one.
+ */
+static int admit_token(uint64_t now) {
+	if (admit_rate == 0) {
+		return 1;
+	}
+
+	/* after burst seconds the bucket is full at any rate */
+	if (now - admit_stamp >= admit_burst) {
+		admit_tokens = admit_burst;
+	} else {
+		admit_tokens += (now - admit_stamp) * admit_rate;
+		if (admit_tokens > admit_burst) {
+			admit_tokens = admit_burst;
+		}
+	}
+	admit_stamp = now;
+
+	if (admit_tokens < ADMIT_TOKEN) {
+		return 0;
+	}
+	admit_tokens -= ADMIT_TOKEN;
+	return 1;
+}
+
+/**
+ * Decides whether a connection, which was just accepted, is served. An
+ * admitted connection must be given back by ws_admit_release() when it
+ * is closed.
+ *
+ * @param type(uint32_t) addr [Address of the client, network byte order]
+ * @return type(ws_admit_result) [ADMIT_OK, or why it is refused]
+ */
+ws_admit_result ws_admit(uint32_t addr) {
+	ws_admit_result r = ADMIT_OK;
+	ws_admit_ip *ip;
+
+	pthread_mutex_lock(&admit_lock);
+	ip = admit_find(addr);
+
+	if (admit_stats.connections >= admit_max) {
+		r = ADMIT_FULL;
+		admit_stats.full++;
+	} else if (admit_per_ip > 0 && ip->count >= admit_per_ip) {
+		r = ADMIT_PER_IP;
+		admit_stats.per_ip++;
+	} else if (!admit_token(ws_now())) {
+		r = ADMIT_RATE;
+		admit_stats.rate++;
+	} else {
+		ip->count++;
+		admit_stats.accepted++;
+		if (++admit_stats.connections > admit_stats.high) {
+			admit_stats.high = admit_stats.connections;
+		}
+	}
+
+	/* an address without connections doesn't keep its entry */
+	if (ip->count == 0) {
+		*ip = admit_ips[--admit_ips_used];
+	}
+	pthread_mutex_unlock(&admit_lock);
+
+	return r;
+}
+
+/**
+ * Gives the place of an admitted connection back.
+ *
+ * @param type(uint32_t) addr [Address it was admitted with]
+ */
+void ws_admit_release(uint32_t addr) {
+	ws_admit_ip *ip;
+
+	pthread_mutex_lock(&admit_lock);
+	ip = admit_find(addr);
+	if (ip->count > 0) {
+		ip->count--;
+		admit_stats.connections--;
+	}
+	if (ip->count == 0) {
+		*ip = admit_ips[--admit_ips_used];
+	}
+	pthread_mutex_unlock(&admit_lock);
+}
+
+/**
+ * Tells until when the headers of a handshake starting now must be in.
+ *
+ * @return type(uint64_t) [ws_now() of the end, 0: no end]
+ */
+uint64_t ws_admit_deadline(void) {
+	uint64_t timeout;
+
+	pthread_mutex_lock(&admit_lock);
+	timeout = admit_timeout;
+	pthread_mutex_unlock(&admit_lock);
+
+	return (timeout == 0) ? 0 : ws_now() + timeout;
+}
+
+/**
+ * Receives a part of the handshake, waiting no longer than the deadline.
+ * A client which sends a byte now and then still has to finish in time.
+ *
+ * @param type(int) sock [Socket of the client]
+ * @param type(char *) buffer [Where the data goes]
+ * @param type(int) size [Size of the buffer]
+ * @param type(uint64_t) deadline [From ws_admit_deadline()]
+ * @return type(int) [As recv(), or WS_ADMIT_EXPIRED]
+ */
+int ws_admit_recv(int sock, char *buffer, int size, uint64_t deadline) {
+	struct timeval tv;
+	uint64_t now;
+	int len = WS_ADMIT_EXPIRED;
+
+	if (deadline == 0) {
+		return recv(sock, buffer, size, 0);
+	}
+
+	now = ws_now();
+	if (now < deadline) {
+		tv.tv_sec = (deadline - now) / 1000000ULL;
+		tv.tv_usec = (deadline - now) % 1000000ULL;
+		setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (char *) &tv, sizeof(tv));
+
+		len = recv(sock, buffer, size, 0);
+		if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			len = WS_ADMIT_EXPIRED;
+		}
+	}
+
+	if (len == WS_ADMIT_EXPIRED) {
+		pthread_mutex_lock(&admit_lock);
+		admit_stats.timeouts++;
+		pthread_mutex_unlock(&admit_lock);
+	}
+	return len;
+}
+
+/**
+ * Lets the socket of a client wait for data without an end again, once
+ * the handshake is in.
+ *
+ * @param type(int) sock [Socket of the client]
+ */
+void ws_admit_done(int sock) {
+	struct timeval tv;
+
+	tv.tv_sec = 0;
+	tv.tv_usec = 0;
+	setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (char *) &tv, sizeof(tv));
+}
+
+/**
+ * Counts a failed accept().
+ */
+void ws_admit_acceptError(void) {
+	pthread_mutex_lock(&admit_lock);
+	admit_stats.accept_errors++;
+	pthread_mutex_unlock(&admit_lock);
+}
+
+/**
+ * Copies the admission counters.
+ *
+ * @param type(ws_admit_stats *) s [Destination of the counters]
+ */
+void ws_admit_getStats(ws_admit_stats *s) {
+	pthread_mutex_lock(&admit_lock);
+	memcpy(s, &admit_stats, sizeof(ws_admit_stats));
+	pthread_mutex_unlock(&admit_lock);
+}
@@ -0,0 +1,73 @@
+/******************************************************************************
+  Copyright (c) 2013 Morten Houmøller Nygaard - www.mortz.dk - admin@mortz.dk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#ifndef _ADMIT_H
+#define _ADMIT_H
+
+#include <stdint.h>
+
+/**
+ * Admission of new connections, decided right after accept() and before a
+ * thread or any memory is spent on them. A connection is refused when
+ * max_connections are open already (handshakes included), when its address
+ * has max_per_ip of them, or when the token bucket of handshakes is empty:
+ * it is refilled with rate tokens per second up to burst. Refused
+ * connections get a 503 and are closed at once. The headers of the
+ * handshake must be in within the timeout, otherwise the client gets a 408,
+ * so that slow clients can't hold the connections for long.
+ */
+#define WS_ADMIT_CONNECTIONS 64 	/* Default connections open at the same time */
+#define WS_ADMIT_PER_IP 8 			/* Default connections of one address, 0: any */
+#define WS_ADMIT_RATE 20 			/* Default handshakes per second, 0: any */
+#define WS_ADMIT_BURST 20 			/* Default handshakes at once after a quiet time */
+#define WS_ADMIT_TIMEOUT 5000 		/* Default time for the headers in ms, 0: none */
+#define WS_ADMIT_IPS 1024 			/* Addresses tracked, the most connections allowed */
+#define WS_ADMIT_EXPIRED -2 		/* ws_admit_recv(): the time is up */
+
+typedef enum {
+	ADMIT_OK = 0,
+	ADMIT_FULL,
+	ADMIT_PER_IP,
+	ADMIT_RATE
+} ws_admit_result;
+
+typedef struct {
+	uint32_t connections; 		/* Connections open now */
+	uint32_t high; 				/* Most connections open at the same time */
+	uint64_t accepted; 			/* Connections admitted */
+	uint64_t full; 				/* Refused, max_connections open */
+	uint64_t per_ip; 			/* Refused, max_per_ip open from the address */
+	uint64_t rate; 				/* Refused, too many handshakes per second */
+	uint64_t timeouts; 			/* Handshakes not done within the timeout */
+	uint64_t accept_errors; 	/* accept() failed, e.g. out of descriptors */
+} ws_admit_stats;
+
+void ws_admit_configure(int max_connections, int max_per_ip, int rate,
+		int burst, int timeout);
+ws_admit_result ws_admit(uint32_t addr);
+void ws_admit_release(uint32_t addr);
+uint64_t ws_admit_deadline(void);
+int ws_admit_recv(int sock, char *buffer, int size, uint64_t deadline);
+void ws_admit_done(int sock);
+void ws_admit_acceptError(void);
+void ws_admit_getStats(ws_admit_stats *s);
+#endif
@@ -21,7 +21,67 @@ SOFTWARE.
 ******************************************************************************/
 
 #include "Communicate.h"
+#include "Deflate.h"
+#include "Keepalive.h"
+#include "Log.h"
+#include "utf8.h"
 #include <sockLib.h>
+
+/**
+ * Parser of the channel lists of "subscribe", see ws_subscribe_configure().
+ */
+static uint32_t (*subscribe_parse)(int stream, const char *list) = NULL;
+
+/**
+ * Handler of binary messages, see ws_binary_configure().
+ */
+static int (*binary_handler)(int stream, const char *data, uint64_t len) =
+		NULL;
+
+/**
+ * Sets the parser for the channel lists of "subscribe" and of the upgrade
+ * URL. NULL turns subscriptions off.
+ *
+ * @param type(function) parse [Returns the channel mask for a list of the
+ * 		stream of the client]
+ */
+void ws_subscribe_configure(uint32_t (*parse)(int stream, const char *list)) {
+	subscribe_parse = parse;
+}
+
+/**
+ * Selects the channels a client receives. An empty list selects all of them.
+ *
+ * @param type(ws_client *) n [Client]
+ * @param type(const char *) list [Channel list, as understood by the parser]
+ */
+void ws_subscribe(ws_client *n, const char *list) {
+	if (subscribe_parse == NULL) {
+		return;
+	}
+
+	while (*list == ' ') {
+		list++;
+	}
+	n->channels = (*list == '\0') ? WS_CHANNELS_ALL : subscribe_parse(n->stream,
+			list);
+
+	WS_LOG(WS_LOG_INF, "Client %s on socket %d subscribed to 0x%x",
+			(char *) n->client_ip, n->socket_id, n->channels);
+}
+
+/**
+ * Sets the handler of binary messages. It is called by the thread of the
+ * client, so it must not block. NULL makes binary messages close the
+ * connection again.
+ *
+ * @param type(function) handler [Gets the stream of the client and the
+ * 		payload, returns < 0 if rejected]
+ */
+void ws_binary_configure(int (*handler)(int stream, const char *data,
+		uint64_t len)) {
+	binary_handler = handler;
+}
 /** 
  * Converts the unsigned 64 bit integer from host byte order to network byte 
  * order.
@@ -46,70 +106,78 @@ uint64_t ntohl64(uint64_t value) {
 
 
 /**
- * This function is suppose to get the remaining part of the message, if
- * the message from the client is too big to be contained in the buffer.
- * And we are dealing with the RFC6455 convention.
+ * Receives exactly len bytes from the client, straight into the message.
+ * Nothing of a following frame is read.
+ *
+ * @return type(int) [0: done, -1: the connection ended]
  */
-uint64_t getRemainingMessage(ws_client *n, uint64_t msg_length) {
-	int buffer_length = 0; 
-	uint64_t remaining_length = 0, final_length = 0;
-	char buffer[BUFFERSIZE];
-	ws_message *m = n->message;
-
-	do {
-		memset(buffer, '\0', BUFFERSIZE);
-	
-		/**
-		 * Receive new chunk of the message.
-		 */	
-		if ((buffer_length = recv(n->socket_id, buffer, BUFFERSIZE, 0)) <= 0) {
-			printf("Didn't receive anything from remaining part of message. %d"
-					"\n\n", buffer_length);
-			fflush(stdout);
-			return 0;	
-		}
-
-		/**
-		 * The overall length of the message received. Because the recv call
-		 * eventually will merge messages together we have to have a check
-		 * whether the overall length we received is greater than the expected
-		 * length of the message.
-		 */ 
-	 	final_length = (msg_length+remaining_length+buffer_length);	
-
-		/**
-		 * If the overall message is longer than the expected length of the
-		 * message, we know that this chunk most contain the last part of the
-		 * original message, and the first chunk of a new message.
-		 */
-		if ( final_length > m->len ) {
-			uint64_t next_len = final_length-m->len;
-			m->next = (char *) malloc(sizeof(char)*next_len);
-			if (m->next == NULL) {
-				printf("1: Couldn't allocate memory.\n\n");
-				fflush(stdout);
-				return 0;
-			}
-			memset(m->next, '\0', next_len);
-		   	memcpy(m->next, buffer + (buffer_length - next_len), next_len);
-			m->next_len = next_len;
-			buffer_length = buffer_length - next_len;
+static int recvAll(ws_client *n, char *buf, uint64_t len) {
+	int buffer_length;
+
+	while (len > 0) {
+		buffer_length = recv(n->socket_id, buf, 
+				len < BUFFERSIZE ? (int) len : BUFFERSIZE, 0);
+		if (buffer_length <= 0) {
+			WS_LOG(WS_LOG_WRN, "Didn't receive anything from remaining part of "
+					"message. %d", buffer_length);
+			return -1;
 		}
+		buf += buffer_length;
+		len -= buffer_length;
+	}
+	return 0;
+}
 
-		remaining_length += buffer_length;
+/**
+ * Removes the masking from the payload of one frame, 4 bytes at a time.
+ */
+static void unmask(char *p, uint64_t len, const char *mask) {
+	uint64_t i = 0;
+	uint32_t m32, w;
+
+	memcpy(&m32, mask, sizeof(m32));
+	for (; i + 4 <= len; i += 4) {
+		memcpy(&w, p + i, sizeof(w));
+		w ^= m32;
+		memcpy(p + i, &w, sizeof(w));
+	}
+	for (; i < len; i++) {
+		p[i] ^= mask[i % 4];
+	}
+}
 
-		memcpy(m->msg + (msg_length+(remaining_length-buffer_length)), buffer, 
-				buffer_length);
-	} while( (msg_length + remaining_length) < m->len );
+/**
+ * Bytes of the frame header in buffer, including the mask, or 0 if buffer
+ * does not hold enough of it to tell.
+ */
+static uint64_t headerLength(const char *buffer, uint64_t buffer_length) {
+	if (buffer_length < 2) {
+		return 0;
+	}
 
-	return remaining_length;
+	switch (buffer[1] & 0x7f) {
+	case 126:
+		return 8;
+	case 127:
+		return 14;
+	default:
+		return 6;
+	}
 }
 
+/**
+ * Appends the payload of the frame in buffer to the message. buffer holds
+ * the whole header, and whatever the last recv returned after it. The rest
+ * of the payload is received right behind that in the message, so it is
+ * copied only once, and the buffer of the message is grown to the length
+ * in the header, not chunk by chunk. Anything in buffer after the frame
+ * goes to m->next.
+ */
 ws_connection_close parseMessage(char *buffer, uint64_t buffer_length, 
 		ws_client *n) {
 	ws_message *m = n->message;
-	int length, has_mask, skip, j;
-	uint64_t message_length = m->len, i, remaining_length = 0, buf_len;
+	int length, has_mask, skip;
+	uint64_t start = m->len, frame_length, buf_len;
 
 	/**
 	 * Extracting information from frame
@@ -118,9 +186,8 @@ ws_connection_close parseMessage(char *buffer, uint64_t buffer_length,
 	length = buffer[1] & 0x7f;
 
 	if (!has_mask) {
-		printf("Message didn't have masked data, received: 0x%x\n\n", 
+		WS_LOG(WS_LOG_WRN, "Message didn't have masked data, received: 0x%x", 
 				buffer[1]);
-		fflush(stdout);
 		return CLOSE_PROTOCOL;
 	}
 
@@ -139,268 +206,256 @@ ws_connection_close parseMessage(char *buffer, uint64_t buffer_length,
 	 * 				  data must be further 2 bytes away.
 	 */
 	if (length <= 125) {
-		m->len += length;	
+		frame_length = length;
 		skip = 6;
 		memcpy(&m->mask, buffer + 2, sizeof(m->mask));
 	} else if (length == 126) {
 		uint16_t sz16;
 		memcpy(&sz16, buffer + 2, sizeof(uint16_t));
 
-		m->len += ntohs(sz16);
+		frame_length = ntohs(sz16);
 
 		skip = 8;
 		memcpy(&m->mask, buffer + 4, sizeof(m->mask));
-	} else if (length == 127) {
+	} else {
 		uint64_t sz64;
 		memcpy(&sz64, buffer + 2, sizeof(uint64_t));
 
-		m->len += ntohl64(sz64);
+		frame_length = ntohl64(sz64);
 
 		skip = 14;
 		memcpy(&m->mask, buffer + 10, sizeof(m->mask));
-	} else {
-		printf("Obscure length received from client: %d\n\n", length);
-		fflush(stdout);
-		return CLOSE_BIG;	
 	}
 
 	/**
 	 * If the message length is greater that our MAXMESSAGE constant, we
 	 * skip the message and close the connection.
 	 */
-	if (m->len > MAXMESSAGE) {
-		printf("Message received was bigger than MAXMESSAGE.");
-		fflush(stdout);
+	if (frame_length > MAXMESSAGE - m->len) {
+		WS_LOG(WS_LOG_WRN, "Message received was bigger than MAXMESSAGE.");
 		return CLOSE_BIG;
 	}
 	
 	/**
-	 * Allocating memory to hold the message sent from the client.
-	 * We can do this because we now know the actual length ofr the message.
-	 */ 
-	m->msg = (char *) malloc(sizeof(char) * (m->len + 1));
-	if (m->msg == NULL) {
-		printf("2: Couldn't allocate memory.\n\n");
-		fflush(stdout);
+	 * Room for the message so far, this frame and a terminating zero.
+	 */
+	if (message_reserve(m, m->len + frame_length + 1) < 0) {
+		WS_LOG(WS_LOG_ERR, "2: Couldn't allocate memory.");
 		return CLOSE_UNEXPECTED;
 	}
-	memset(m->msg, '\0', (m->len + 1));
+	m->len += frame_length;
 
 	buf_len = (buffer_length-skip);
 
 	/**
-	 * The message read from recv is larger than the message we are supposed
-	 * to receive. This means that we have received the first part of the next
-	 * message as well.
+	 * The message read from recv is larger than the frame we are supposed
+	 * to receive. This means that we have received the first part of the 
+	 * next frame as well.
 	 */
-	if (buf_len > m->len) {
-		uint64_t next_len = buf_len - m->len;
+	if (buf_len > frame_length) {
+		uint64_t next_len = buf_len - frame_length;
 		m->next = (char *) malloc(next_len);
 		if (m->next == NULL) {
-			printf("3: Couldn't allocate memory.\n\n");
-			fflush(stdout);
+			WS_LOG(WS_LOG_ERR, "3: Couldn't allocate memory.");
 			return CLOSE_UNEXPECTED;
 		}
-		memset(m->next, '\0', next_len);
-		memcpy(m->next, buffer + (m->len+skip), next_len);
+		memcpy(m->next, buffer + (frame_length+skip), next_len);
 		m->next_len = next_len;
-		buf_len = m->len;	
+		buf_len = frame_length;	
 	}
 
-	memcpy(m->msg+message_length, buffer+skip, buf_len);
-
-	message_length += buf_len;
+	memcpy(m->msg + start, buffer + skip, buf_len);
 
 	/**
-	 * We have not yet received the whole message, and must continue reading
+	 * We have not yet received the whole frame, and must continue reading
 	 * new data from the client.
 	 */
-	if (message_length < m->len) {
-		if ((remaining_length = getRemainingMessage(n, message_length)) == 0) {
-			return CLOSE_POLICY;
-		}
-	}
-
-	message_length += remaining_length;
-
-	/**
-	 * If this is true, our receival of the message has gone wrong, and we 
-	 * have no other choice than closing the connection.
-	 */
-	if (message_length != m->len) {
-		printf("Message does not fit. Expected: %d but got %d\n\n", 
-				(int) m->len, (int) message_length);
-		fflush(stdout);
+	if (buf_len < frame_length && recvAll(n, m->msg + start + buf_len, 
+				frame_length - buf_len) < 0) {
 		return CLOSE_POLICY;
 	}
 
 	/**
-	 * If everything went well, we have to remove the masking from the data.
+	 * Each frame has a mask of its own.
 	 */
-	for (i = 0, j = 0; i < message_length; i++, j++){
-		m->msg[j] = m->msg[i] ^ m->mask[j % 4];
-	}
+	unmask(m->msg + start, frame_length, m->mask);
+	m->msg[m->len] = '\0';
 
 	return CONTINUE;
 }
 
 /**
  * This function is used to get the whole message when using the Hybi-00
- * standard.
+ * standard. What comes after the '\xFF' at its end goes to m->next.
  */
 ws_connection_close getWholeMessage(char *buffer, uint64_t buffer_length, 
 		ws_client *n) {
-	uint64_t msg_length = buffer_length, i, j;
+	ws_message *m = n->message;
+	uint64_t msg_length = buffer_length, scanned = 0;
 	int buf_length;
-	char buf[BUFFERSIZE];
-	char *temp = NULL;
+	char *end;
 
 	/**
-	 * Allocate what's received so far
+	 * Copy what's received so far
 	 */
-	n->message->msg = malloc(buffer_length);
-	if (n->message->msg == NULL) {
-		printf("4: Couldn't allocate memory.\n\n");
-		fflush(stdout);
+	if (message_reserve(m, buffer_length + 1) < 0) {
+		WS_LOG(WS_LOG_ERR, "4: Couldn't allocate memory.");
 		return CLOSE_UNEXPECTED;
 	}
-	memset(n->message->msg, '\0', buffer_length);
+	memcpy(m->msg, buffer, buffer_length);
 
 	/**
-	 * If a byte is equal to zero, we know that we have reached the end of
-	 * the message.
+	 * While we still haven't seen the end of the message, continue reading
+	 * data right behind it. Only the new data is searched.
 	 */
-	for (i = 0; i < buffer_length; i++) {	
-		if (buffer[i] != '\xFF') {
-			n->message->msg[i] = buffer[i];
-		} else {
-			n->message->len = strlen(n->message->msg);
-			return CONTINUE;
+	while ( (end = memchr(m->msg + scanned, '\xFF', msg_length - scanned)) 
+			== NULL ) {
+		scanned = msg_length;
+		if (msg_length >= MAXMESSAGE) {
+			WS_LOG(WS_LOG_WRN, "Message received was bigger than MAXMESSAGE.");
+			return CLOSE_BIG;
 		}
-	}
 
-	/**
-	 * While we still haven't seen the end of the message, continue reading
-	 * data. The things done in the loop are basicly equivalent to what was
-	 * done above.
-	 */
-	do {	
-		memset(buf, '\0', BUFFERSIZE);
-		if ((buf_length = recv(n->socket_id, buf, BUFFERSIZE, 0)) <= 0) {
-			printf("Didn't receive any message from client.\n\n");
-			fflush(stdout);
+		if (message_reserve(m, msg_length + BUFFERSIZE + 1) < 0) {
+			WS_LOG(WS_LOG_ERR, "5: Couldn't allocate memory.");
+			return CLOSE_UNEXPECTED;
+		}
+
+		if ((buf_length = recv(n->socket_id, m->msg + msg_length, BUFFERSIZE, 
+						0)) <= 0) {
+			WS_LOG(WS_LOG_INF, "Didn't receive any message from client.");
 			return CLOSE_PROTOCOL;	
 		}
 		msg_length += buf_length;
-	
-		temp = realloc(n->message->msg, msg_length);
-		if (temp == NULL) {
-			printf("5: Couldn't allocate memory.\n\n");
-			fflush(stdout);
+	}
+
+	m->len = end - m->msg;
+	msg_length -= m->len + 1;
+	if (msg_length > 0) {
+		m->next = (char *) malloc(msg_length);
+		if (m->next == NULL) {
+			WS_LOG(WS_LOG_ERR, "6: Couldn't allocate memory.");
 			return CLOSE_UNEXPECTED;
 		}
-		n->message->msg = temp;
-		memset(n->message->msg+(msg_length-buf_length), '\0', buf_length);
-		temp = NULL;
-
-		for (j = 0, i = (msg_length-buf_length); i < msg_length; i++, j++) {	
-			if (buf[j] != '\xFF') {
-				n->message->msg[i] = buf[j];
-			} else {
-				n->message->len = strlen(n->message->msg);
-				return CONTINUE;
-			}
-		}
-	} while( msg_length < MAXMESSAGE );
+		memcpy(m->next, end + 1, msg_length);
+		m->next_len = msg_length;
+	}
+	m->msg[m->len] = '\0';
 
-	return CLOSE_UNEXPECTED;
+	return CONTINUE;
 }
 
 /**
- * This function is split into 2. We would like to support different websocket
- * standards and therefore we encode the message as both RFC6455 and Hybi-00.
+ * Encodes the header of the message. The payload is not copied: the header
+ * and m->msg are written to the socket together, so one message is shared
+ * by every client it is sent to. A Hybi-00 client gets m->msg between
+ * '\x00' and '\xFF', which needs no header at all.
  */
 ws_connection_close encodeMessage(ws_message *m) {
-	uint64_t length = m->len;
+	int i;
 
-	/**
-	 * RFC6455 message encoding
-	 */
+	m->hdr[0] = '\x81';
 	if (m->len <= 125) {
-		length += 2;
-		m->enc = (char *) malloc(sizeof(char) * length);
-		if (m->enc == NULL) {
-			printf("6: Couldn't allocate memory.\n\n");
-			fflush(stdout);
-			return CLOSE_UNEXPECTED;
-		}
-		m->enc[0] = '\x81';
-		m->enc[1] = m->len;
-		memcpy(m->enc + 2, m->msg, m->len);
+		m->hdr[1] = m->len;
+		m->hdr_len = 2;
 	} else if (m->len <= 65535) {
-		uint16_t sz16;
-		length += 4;
-		m->enc = (char *) malloc(sizeof(char) * length);
-		if (m->enc == NULL) {
-			printf("7: Couldn't allocate memory.\n\n");
-			fflush(stdout);
-			return CLOSE_UNEXPECTED;
-		}
-		m->enc[0] = '\x81';
-		m->enc[1] = 126;
-		sz16 = htons(m->len);
-		memcpy(m->enc + 2, &sz16, sizeof(uint16_t));
-		memcpy(m->enc + 4, m->msg, m->len);
+		m->hdr[1] = 126;
+		m->hdr[2] = (m->len >> 8) & 0xFF;
+		m->hdr[3] = m->len & 0xFF;
+		m->hdr_len = 4;
 	} else {
-		uint64_t sz64;
-		length += 10;
-		m->enc = (char *) malloc(sizeof(char) * length);
-		if (m->enc == NULL) {
-			printf("8: Couldn't allocate memory.\n\n");
-			fflush(stdout);
-			return CLOSE_UNEXPECTED;
+		m->hdr[1] = 127;
+		for (i = 0; i < 8; i++) {
+			m->hdr[2+i] = (m->len >> (56 - 8*i)) & 0xFF;
 		}
-		m->enc[0] = '\x81';
-		m->enc[1] = 127;
-		sz64 = ntohl64(m->len);
-		memcpy(m->enc + 2, &sz64, sizeof(uint64_t));
-		memcpy(m->enc + 10, m->msg, m->len);
+		m->hdr_len = 10;
 	}
-	m->enc_len = length;
 
-	/**
-	 * Hybi-00 message encoding
-	 */
-	m->hybi00 = malloc(m->len+2);
-	if (m->hybi00 == NULL) {
-		printf("9: Couldn't allocate memory.\n\n");
-		fflush(stdout);
-		return CLOSE_UNEXPECTED;
+	return CONTINUE;
+}
+
+/**
+ * Encodes a control frame (ping, pong) with the payload of the message. The
+ * payload of a control frame is at most 125 bytes, and it is never compressed.
+ */
+ws_connection_close encodeControl(ws_message *m, char opcode) {
+	if (m->len > 125) {
+		return CLOSE_PROTOCOL;
 	}
-	memset(m->hybi00, '\0', m->len+2);
-	m->hybi00[0] = 0;
-	m->hybi00[m->len+1] = '\xFF';
-	memcpy(m->hybi00+1, m->msg, m->len);
+
+	m->hdr[0] = opcode;
+	m->hdr[1] = m->len;
+	m->hdr_len = 2;
+	m->deflate_done = ~0u;
 
 	return CONTINUE;
 }
 
+/**
+ * Handles a control frame which came between the fragments of a data
+ * message in buffer, after which the caller goes on receiving the message.
+ * A ping is answered and a pong is handed to the keepalive right away, see
+ * ws_keepalive_control(). The frame is received into a message of its own,
+ * what came after it goes to m->next of the data message, which is
+ * n->message again afterwards.
+ *
+ * @return type(ws_connection_close) [CONTINUE, or the status to close with]
+ */
+static ws_connection_close communicateControl(ws_client *n, char *buffer, 
+		uint64_t buffer_length) {
+	ws_message *data = n->message, *m = message_new();
+	ws_connection_close status;
+
+	if (m == NULL) {
+		WS_LOG(WS_LOG_ERR, "7: Couldn't allocate memory.");
+		return CLOSE_UNEXPECTED;
+	}
+	memcpy(m->opcode, buffer, sizeof(m->opcode));
+	n->message = m;
+
+	if ( (status = parseMessage(buffer, buffer_length, n)) == CONTINUE ) {
+		if (m->len > 125) {
+			status = CLOSE_PROTOCOL;
+		} else if (m->opcode[0] == '\x88') {
+			status = (m->len > 2 && utf8_validate(UTF8_ACCEPT, m->msg + 2, 
+						m->len - 2) != UTF8_ACCEPT) ? CLOSE_UTF8 : CLOSE_NORMAL;
+		} else if (m->opcode[0] == '\x89') {
+			status = encodeControl(m, '\x8A');
+		} else if (m->opcode[0] != '\x8A') {
+			status = CLOSE_PROTOCOL;
+		}
+
+		if (status == CONTINUE && n->list != NULL) {
+			ws_keepalive_control(n->list, n);
+		}
+	}
+
+	data->next = m->next;
+	data->next_len = m->next_len;
+	m->next = NULL;
+	m->next_len = 0;
+	n->message = data;
+	message_unref(m);
+
+	return status;
+}
+
 ws_connection_close communicate(ws_client *n, char *next, uint64_t next_len) {
 	int buffer_length = 0;
-	uint64_t buf_len;
+	uint64_t buf_len, start;
 	char buffer[BUFFERSIZE];
 	ws_connection_close status;
-	n->message = message_new();
+	unsigned int utf8 = UTF8_ACCEPT;
+	int fin = 0;
 
 	if (n == NULL) {
-		printf("The client was not available anymore.");
-		fflush(stdout);
+		WS_LOG(WS_LOG_ERR, "The client was not available anymore.");
 		return CLOSE_PROTOCOL;	
 	}
+	n->message = client_message(n);
 
 	if (n->headers == NULL) {
-		printf("The header was not available anymore.");
-		fflush(stdout);
+		WS_LOG(WS_LOG_ERR, "The header was not available anymore.");
 		return CLOSE_PROTOCOL;	
 	}
 
@@ -409,31 +464,27 @@ ws_connection_close communicate(ws_client *n, char *next, uint64_t next_len) {
 	 * message receiving differently than the RFC6455 standard.
 	 **/	
 	if ( n->headers->type == HYBI00 ) {
-
-		memset(buffer, '\0', BUFFERSIZE);
-
 		/**
-		 * Receive new message.
+		 * Receive new message, unless the last one was followed by it.
 		 */
-		if ((buffer_length = recv(n->socket_id, buffer, BUFFERSIZE, 0)) <= 0) {
-			printf("Didn't receive any message from client.\n\n");
-			fflush(stdout);
-			return CLOSE_PROTOCOL;
+		if (next_len > 0) {
+			memcpy(buffer, next, next_len);
+			buf_len = next_len;
+		} else {
+			if ((buffer_length = recv(n->socket_id, buffer, BUFFERSIZE, 0)) <= 0) {
+				WS_LOG(WS_LOG_INF, "Didn't receive any message from client.");
+				return CLOSE_PROTOCOL;
+			}
+			buf_len = buffer_length;
 		}
 
-		buf_len = buffer_length;
-
 		/**
 		 * If the first byte is equal to zero, the client wished to shut down.
 		 * Else we keep on reading until the whole message is received.
 		 */
 		if (buffer[0] == '\xFF') {
-			printf("Client:\n"
-				  "\tSocket: %d\n"
-				  "\tAddress: %s\n"
-				  "reports that he is shutting down.\n\n", n->socket_id, 
-				  (char *) n->client_ip);
-			fflush(stdout);
+			WS_LOG(WS_LOG_WRN, "Client %s on socket %d reports that he is "
+				  "shutting down.", (char *) n->client_ip, n->socket_id);
 
 			return CLOSE_NORMAL;	
 		} else if (buffer[0] == '\x00') {
@@ -444,6 +495,13 @@ ws_connection_close communicate(ws_client *n, char *next, uint64_t next_len) {
 					CONTINUE ) {
 				return status; 
 			}
+
+			if (utf8_validate(UTF8_ACCEPT, n->message->msg, n->message->len) 
+					!= UTF8_ACCEPT) {
+				WS_LOG(WS_LOG_WRN, "Client %s on socket %d sent invalid UTF-8",
+						(char *) n->client_ip, n->socket_id);
+				return CLOSE_UTF8;
+			}
 			
 			/**	
 			 * Encode the message to make it ready to be send to all others.
@@ -455,29 +513,63 @@ ws_connection_close communicate(ws_client *n, char *next, uint64_t next_len) {
 	} else if ( n->headers->type == HYBI07 || n->headers->type == RFC6455 
 			|| n->headers->type == HYBI10 ) {
 		/*
-		 * Receiving and decoding the message.
+		 * Receiving and decoding the message, one frame after the other. Each
+		 * frame starts with what was left over from the one before.
 		 */
 		do {
-			memset(buffer, '\0', BUFFERSIZE);
-				
-			memcpy(buffer, next, next_len);
+			if (next_len > 0) {
+				memcpy(buffer, next, next_len);
+			}
+			buf_len = next_len;
+
+			if (n->message->next != NULL) {
+				free(n->message->next);
+				n->message->next = NULL;
+				n->message->next_len = 0;
+			}
 
 			/**
-			 * If we end in this case, we have not got enough of the frame to
-			 * do something useful to it. Therefore, do yet another read 
-			 * operation.
+			 * Read until we have the whole header of the frame.
 			 */
-			if (next_len <= 6 || ((next[1] & 0x7f) == 126 && next_len <= 8) ||
-					((next[1] & 0x7f) == 127 && next_len <= 14)) {
-				if ((buffer_length = recv(n->socket_id, (buffer+next_len), 
-								(BUFFERSIZE-next_len), 0)) <= 0) {
-					printf("Didn't receive any message from client.\n\n");
-					fflush(stdout);
+			while (buf_len < headerLength(buffer, buf_len) || 
+					headerLength(buffer, buf_len) == 0) {
+				if ((buffer_length = recv(n->socket_id, (buffer+buf_len), 
+								(BUFFERSIZE-buf_len), 0)) <= 0) {
+					WS_LOG(WS_LOG_INF, "Didn't receive any message from client.");
 					return CLOSE_PROTOCOL;	
 				}
+				buf_len += buffer_length;
 			}
 
-			buf_len = (uint64_t)(buffer_length + next_len);
+			/**
+			 * A control frame must not be fragmented, but it may come
+			 * between the fragments of a data message: it is handled right
+			 * away, and the message goes on with the next frame. A
+			 * continuation frame needs a message which was started, a new
+			 * data frame one which was finished.
+			 */
+			if (buffer[0] & 0x08) {
+				if (!(buffer[0] & 0x80)) {
+					WS_LOG(WS_LOG_WRN, "Received a fragmented control frame: "
+							"0x%x", buffer[0]);
+					return CLOSE_PROTOCOL;
+				}
+				if (n->message->opcode[0] != '\0') {
+					if ( (status = communicateControl(n, buffer, buf_len)) != 
+							CONTINUE ) {
+						return status;
+					}
+					next = n->message->next;
+					next_len = n->message->next_len;
+					continue;
+				}
+			} else if (((buffer[0] & 0x0F) == 0x00) != 
+					(n->message->opcode[0] != '\0')) {
+				WS_LOG(WS_LOG_WRN, "Received a frame out of order: 0x%x", 
+						buffer[0]);
+				return CLOSE_PROTOCOL;
+			}
+			fin = buffer[0] & 0x80;
 
 			/**
 			 * We need the opcode to conclude which type of message we 
@@ -488,64 +580,125 @@ ws_connection_close communicate(ws_client *n, char *next, uint64_t next_len) {
 			}
 
 			/**
-			 * Get the full message and remove the masking from it.
+			 * Get the frame, append it to the message and remove the masking 
+			 * from it.
 			 */
+			start = n->message->len;
 			if ( (status = parseMessage(buffer, buf_len, n)) != CONTINUE) {
 				return status;
 			}
 
-			next_len = 0;
-		} while( !(buffer[0] & 0x80) );	
+			/**
+			 * Text is checked frame by frame, so that invalid UTF-8 closes
+			 * the connection before the rest of the message is received.
+			 * Compressed text can only be checked once it is inflated.
+			 */
+			if ((n->message->opcode[0] & 0x4F) == 0x01 && 
+					(utf8 = utf8_validate(utf8, n->message->msg + start, 
+						n->message->len - start)) == UTF8_REJECT) {
+				WS_LOG(WS_LOG_WRN, "Client %s on socket %d sent invalid UTF-8",
+						(char *) n->client_ip, n->socket_id);
+				return CLOSE_UTF8;
+			}
+
+			next = n->message->next;
+			next_len = n->message->next_len;
+		} while( !fin );	
+
+		/**
+		 * RSV1 marks a message compressed with permessage-deflate. It is
+		 * only allowed on data frames, and only if it was negotiated.
+		 */
+		if (n->message->opcode[0] & 0x40) {
+			if ((n->message->opcode[0] & 0x08) || !n->headers->deflate) {
+				WS_LOG(WS_LOG_WRN, "Received RSV1 without permessage-deflate: 0x%x",
+						n->message->opcode[0]);
+				return CLOSE_PROTOCOL;
+			}
+
+			if ( (status = ws_deflate_inflateMessage(n)) != CONTINUE) {
+				return status;
+			}
+			n->message->opcode[0] &= ~0x40;
+
+			if ((n->message->opcode[0] & 0x0F) == 0x01) {
+				utf8 = utf8_validate(UTF8_ACCEPT, n->message->msg, 
+						n->message->len);
+			}
+		}
 
 		/**
 		 * Checking which type of frame the client has sent.
 		 */
-		if (n->message->opcode[0] == '\x88' || n->message->opcode[0] == '\x08') {
+		if (n->message->opcode[0] == '\x88') {
 			/**
-			 * CLOSE: client wants to close connection, so we do.
+			 * CLOSE: client wants to close connection, so we do. A reason
+			 * after the status code must be UTF-8 as well.
 			 **/
-			printf("Client:\n"
-				  "\tSocket: %d\n"
-				  "\tAddress: %s\n"
-				  "reports that he is shutting down.\n\n", n->socket_id, 
-				  (char *) n->client_ip);
-			fflush(stdout);
+			if (n->message->len > 2 && utf8_validate(UTF8_ACCEPT, 
+						n->message->msg + 2, n->message->len - 2) != UTF8_ACCEPT) {
+				return CLOSE_UTF8;
+			}
+			WS_LOG(WS_LOG_WRN, "Client %s on socket %d reports that he is "
+				  "shutting down.", (char *) n->client_ip, n->socket_id);
 			
 			return CLOSE_NORMAL;
-		} else if (n->message->opcode[0] == '\x8A' || n->message->opcode[0] == '\x0A') {
+		} else if (n->message->opcode[0] == '\x8A') {
 			/**
-			 * PONG: Client is still alive
+			 * PONG: Client is still alive. The caller hands it to the
+			 * keepalive, which measures the RTT from the payload.
 			 **/
-			printf("Pong arrived\n\n");
-			fflush(stdout);	
-			return CLOSE_TYPE;
-		} else if (n->message->opcode[0] == '\x89' || n->message->opcode[0] == '\x09') {
+			if (n->message->len > 125) {
+				return CLOSE_PROTOCOL;
+			}
+		} else if (n->message->opcode[0] == '\x89') {
 			/** 
-			 * PING: I am still alive
+			 * PING: Encode the pong, which must carry the same payload. The
+			 * caller sends it back to this client only.
 			 **/
-			printf("Ping arrived\n\n");
-			fflush(stdout);
-			return CLOSE_TYPE;
+			if (n->message->len > 125) {
+				return CLOSE_PROTOCOL;
+			}
+			if ( (status = encodeControl(n->message, '\x8A')) != CONTINUE) {
+				return status;
+			}
 		} else if (n->message->opcode[0] == '\x02' || n->message->opcode[0] == '\x82') {
 			/** 
-			 * BINARY: data. 
-			 * TODO: find out what to do here!
+			 * BINARY: a command for the server, never sent to the others.
+			 * A rejected command is dropped, the connection stays.
 			 **/
-			printf("Binary data arrived\n\n");
-			fflush(stdout);
-			return CLOSE_TYPE;
+			if (binary_handler == NULL) {
+				WS_LOG(WS_LOG_INF, "Binary data arrived");
+				return CLOSE_TYPE;
+			}
+			if (binary_handler(n->stream, n->message->msg,
+						n->message->len) < 0) {
+				WS_LOG(WS_LOG_WRN, "Client %s on socket %d sent an invalid "
+						"command", (char *) n->client_ip, n->socket_id);
+			}
+			n->message->command = WS_COMMAND_BINARY;
 		} else if (n->message->opcode[0] == '\x01' || n->message->opcode[0] == '\x81') {
-			/** 
-			 * TEXT: encode the message to make it ready to be send to all 
-			 * 		 others.
+			/**
+			 * TEXT: a subscription is for the server only. Anything else is
+			 * 		 encoded to make it ready to be send to all others. The
+			 * 		 last frame must not end within a character.
 			 **/
-			if ( (status = encodeMessage(n->message)) != CONTINUE) {
+			if (utf8 != UTF8_ACCEPT) {
+				WS_LOG(WS_LOG_WRN, "Client %s on socket %d sent invalid UTF-8",
+						(char *) n->client_ip, n->socket_id);
+				return CLOSE_UTF8;
+			}
+			if (subscribe_parse != NULL && n->message->msg != NULL &&
+					strncmp(n->message->msg, WS_SUBSCRIBE,
+						strlen(WS_SUBSCRIBE)) == 0) {
+				ws_subscribe(n, n->message->msg + strlen(WS_SUBSCRIBE));
+				n->message->command = WS_COMMAND_SUBSCRIBE;
+			} else if ( (status = encodeMessage(n->message)) != CONTINUE) {
 				return status;
 			}
 		} else {
-			printf("Something very strange happened, received opcode: 0x%x\n\n", 
+			WS_LOG(WS_LOG_WRN, "Something very strange happened, received opcode: 0x%x", 
 					n->message->opcode[0]);
-			fflush(stdout);
 			return CLOSE_UNEXPECTED;
 		}
 	}
@@ -26,5 +26,31 @@ SOFTWARE.
 #include "Datastructures.h"
 
 ws_connection_close encodeMessage(ws_message *m);
+ws_connection_close encodeControl(ws_message *m, char opcode);
 ws_connection_close communicate(ws_client *n, char *next, uint64_t next_len);
+
+/**
+ * A text message "subscribe <list>" selects the channels a client receives.
+ * The parser set here turns <list> into the bit mask of ws_client.channels,
+ * for the stream of the client, without one the command is an ordinary text
+ * message.
+ */
+#define WS_SUBSCRIBE "subscribe"
+
+void ws_subscribe_configure(uint32_t (*parse)(int stream, const char *list));
+void ws_subscribe(ws_client *n, const char *list);
+
+/**
+ * A binary message is a command to the server. The handler set here gets
+ * its payload and the stream of the client, without one a binary message
+ * closes the connection.
+ */
+void ws_binary_configure(int (*handler)(int stream, const char *data,
+		uint64_t len));
+
+/**
+ * Values of ws_message.command
+ */
+#define WS_COMMAND_SUBSCRIBE 1
+#define WS_COMMAND_BINARY 2
 #endif
@@ -21,6 +21,12 @@ SOFTWARE.
 ******************************************************************************/
 
 #include "Datastructures.h"
+#include "Deflate.h"
+#include "Keepalive.h"
+#include "Pool.h"
+#include "Admit.h"
+#include "Rate.h"
+#include "Stats.h"
 #include <sockLib.h>
 /**
  * Creates a new list structure.
@@ -33,6 +39,8 @@ ws_list *list_new (void) {
 	if (l != NULL) {
 		l->len = 0;
 		l->first = l->last = NULL;
+		l->wheel_pos = 0;
+		memset(l->wheel, '\0', sizeof(l->wheel));
 
 		pthread_mutex_init(&l->lock, NULL);	
 	} else {
@@ -62,7 +70,7 @@ void list_free (ws_list *l) {
 		client_free(n);
 
 		close(n->socket_id);
-		free(n);
+		ws_pool_put(WS_POOL_CLIENT, n);
 		n = p;
 	}
 
@@ -88,19 +96,22 @@ void list_add (ws_list *l, ws_client *n) {
 	}
 
 	l->len++;
+	n->list = l;
+	ws_keepalive_add(l, n);
+	ws_stat_claim(n);
 	
 	pthread_mutex_unlock(&l->lock);
 }
 
 /**
- * Removes a node from the list, and sends closing frame to the client.
+ * Removes a node from the list, and sends closing frame to the client, with
+ * the status in r->close.
  *
  * @param type(ws_list) l [List containing clients]
  * @param type(ws_client) r [Client]
  */
 void list_remove (ws_list *l, ws_client *r) {
-	ws_client *n, *p;
-	ws_connection_close c = CLOSE_SHUTDOWN;
+	ws_client *n, *p = NULL;
 	pthread_mutex_lock(&l->lock);
 	n = l->first;
 
@@ -121,13 +132,15 @@ void list_remove (ws_list *l, ws_client *r) {
 				l->last = p;
 			}
 
-			ws_closeframe(n, c);
+			ws_keepalive_remove(l, n);
+			ws_closeframe(n, n->close);
 			shutdown(n->socket_id, SHUT_RDWR);
+			ws_stat_release(n);
 
 			client_free(n);
 
 			close(n->socket_id);
-			free(n);
+			ws_pool_put(WS_POOL_CLIENT, n);
 
 			l->len--;
 			break;
@@ -190,8 +203,9 @@ void list_print(ws_list *l) {
 
 	do {
 		printf("Socket Id: \t\t%d\n"
-			   "Client IP: \t\t%s\n",
-			   n->socket_id, n->client_ip);
+			   "Client IP: \t\t%s\n"
+			   "RTT: \t\t\t%u us (avg %u us)\n",
+			   n->socket_id, n->client_ip, n->rtt, n->rtt_avg);
 		fflush(stdout);
 		n = n->next;
 	} while (n != NULL);
@@ -252,7 +266,8 @@ void list_multicast_one(ws_list *l, ws_client *n, ws_message *m) {
 }
 
 /**
- * Multicasts message to all client in the list.
+ * Multicasts a frame of the stream to all client in the list. A client
+ * whose socket is full skips it, see ws_send_stream().
  *
  * @param type(ws_list *) l [List containing clients]
  * @param type(ws_message *) m [Message structure, that will be sent]
@@ -268,12 +283,35 @@ void list_multicast_all(ws_list *l, ws_message *m) {
 	}
 
 	do {
-		ws_send(p, m);
+		ws_send_stream(p, m);
 		p = p->next;
 	} while (p != NULL);
 	pthread_mutex_unlock(&l->lock);
 }
 
+/**
+ * Changes the channel selection of every client which has not selected all
+ * channels, e.g. after the channels were numbered anew.
+ *
+ * @param type(ws_list *) l [List containing clients]
+ * @param type(function) map [Returns the new selection for the old one]
+ * @param type(void *) arg [Passed on to map()]
+ */
+void list_map_channels(ws_list *l,
+		uint32_t (*map)(uint32_t channels, void *arg), void *arg) {
+	ws_client *p;
+	pthread_mutex_lock(&l->lock);
+	p = l->first;
+
+	while (p != NULL) {
+		if (p->channels != WS_CHANNELS_ALL) {
+			p->channels = map(p->channels, arg);
+		}
+		p = p->next;
+	}
+	pthread_mutex_unlock(&l->lock);
+}
+
 /**
  * Returns the client that has the equivalent information as given in the 
  * parameters, if it is in the list.
@@ -305,51 +343,398 @@ ws_client *list_get(ws_list *l, char *addr, int socket) {
 }
 
 /**
- * Functions which creates the closeframe.
+ * Returns a monotonic timestamp in microseconds.
+ *
+ * @return type(uint64_t) [Microseconds since some unspecified point]
+ */
+uint64_t ws_now(void) {
+	struct timespec ts;
+#ifdef CLOCK_MONOTONIC
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+	clock_gettime(CLOCK_REALTIME, &ts);
+#endif
+	return (uint64_t) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/**
+ * The bytes around a message for a Hybi-00 client.
+ */
+static char hybi00_start[1] = { '\x00' };
+static char hybi00_end[1] = { '\xFF' };
+
+/**
+ * Writes the iovecs to the socket without waiting for room in its send
+ * buffer.
+ */
+static ssize_t ws_sendv(int sock, struct iovec *iov, int cnt) {
+	struct msghdr h;
+
+	memset(&h, '\0', sizeof(h));
+	h.msg_iov = iov;
+	h.msg_iovlen = cnt;
+	return sendmsg(sock, &h, MSG_DONTWAIT);
+}
+
+/**
+ * Drops the first len bytes from the iovecs, and moves the rest to the
+ * front of iov.
+ *
+ * @return type(int) [Iovecs left]
+ */
+static int ws_iov_advance(struct iovec *iov, int cnt, uint64_t len) {
+	int i = 0, j;
+
+	while (i < cnt && len >= iov[i].iov_len) {
+		len -= iov[i].iov_len;
+		i++;
+	}
+	if (i < cnt) {
+		iov[i].iov_base = (char *) iov[i].iov_base + len;
+		iov[i].iov_len -= len;
+	}
+	for (j = 0; i < cnt; i++, j++) {
+		iov[j] = iov[i];
+	}
+	return j;
+}
+
+/**
+ * Sends what is left of the frame that the socket could only take a part
+ * of. Called with the list locked, as every other send to the client.
+ *
+ * @return type(int) [1: nothing left, 0: the socket is still full, -1: failed]
+ */
+static int ws_flush(ws_client *n) {
+	ssize_t sent;
+
+	if (n->pend_cnt == 0) {
+		return 1;
+	}
+
+	sent = ws_sendv(n->socket_id, n->pend_iov, n->pend_cnt);
+	if (sent < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+			return 0;
+		}
+		ws_keepalive_sendError(n);
+		return -1;
+	}
+
+	n->pend_cnt = ws_iov_advance(n->pend_iov, n->pend_cnt, sent);
+	if (n->pend_cnt > 0) {
+		return 0;
+	}
+
+	ws_stat_sent(n, n->pend_len);
+	if (n->pend != NULL) {
+		message_unref(n->pend);
+		n->pend = NULL;
+	}
+	return 1;
+}
+
+static int ws_write_message(ws_client *n, ws_message *m, int skip);
+
+/**
+ * Sends what is left of the partly sent frame, and then the frame which is
+ * held behind it, see ws_writev(). Never waits for room in the socket.
+ * Called with the list locked, as every other send to the client.
+ *
+ * @return type(int) [1: nothing left, 0: the socket is still full, -1: failed]
+ */
+static int ws_flush_all(ws_client *n) {
+	ws_message *m;
+	int ret;
+
+	if ( (ret = ws_flush(n)) <= 0 || (m = n->held) == NULL ) {
+		return ret;
+	}
+	n->held = NULL;
+	ret = ws_write_message(n, m, 0);
+	message_unref(m);
+	if (ret < 0) {
+		return -1;
+	}
+	return (n->pend_cnt == 0) ? 1 : 0;
+}
+
+/**
+ * Retries the frames the socket of the client had no room for. Called by
+ * the keepalive thread on every tick, with the list locked. A frame which
+ * must go out, and is still held at the tick after the one which first saw
+ * it, means that the client doesn't read, so it is dropped.
+ *
+ * @param type(ws_client *) n [Client]
+ * @return type(int) [1: nothing left, 0: still pending, -1: failed or dropped]
+ */
+int ws_flush_pending(ws_client *n) {
+	int ret;
+
+	if (n->dead || (n->pend_cnt == 0 && n->held == NULL)) {
+		return n->dead ? -1 : 1;
+	}
+
+	if ( (ret = ws_flush_all(n)) != 0 || n->held == NULL ) {
+		return ret;
+	}
+	if (n->held_ticks++ > 0) {
+		ws_keepalive_sendError(n);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Sends one frame, given as iovecs, to the client. The socket never blocks
+ * the sender, which holds the list lock. Only a frame of the stream may be
+ * skipped, when the socket has no room for it at all, the client just gets
+ * the next one. Any other frame, e.g. a pong or a reply, is held with a
+ * reference to its message while the rest of an earlier frame is still
+ * waiting, and goes out after it, see ws_flush_pending(). A client which
+ * already holds such a frame is dropped rather than losing the next one.
+ * If the socket only takes a part, the client keeps a reference to the
+ * message the iovecs point into, and the rest goes out before the next
+ * frame, so the frames are never mixed up. A send which fails leaves the
+ * stream in an unknown state, so the client is dropped.
+ *
+ * @param type(ws_client *) n [Client]
+ * @param type(ws_message *) m [Message the iovecs point into, NULL: a single
+ * iovec of at most sizeof(n->pend_ctl) bytes, which are copied if needed,
+ * only for frames which may be skipped]
+ * @param type(struct iovec *) iov [The frame, changed by the call]
+ * @param type(int) cnt [Number of iovecs, at most 3]
+ * @param type(int) skip [1: the frame may be skipped, 0: it must go out]
+ * @return type(int) [1: sent, or the rest is pending, 0: skipped, -1: failed]
+ */
+static int ws_writev(ws_client *n, ws_message *m, struct iovec *iov, int cnt,
+		int skip) {
+	uint64_t len = 0;
+	ssize_t sent;
+	int i, ret;
+
+	if ( (ret = ws_flush_all(n)) < 0 ) {
+		return -1;
+	}
+	if (ret == 0 && skip) {
+		ws_stat_skipped(n);
+		n->rate_skipped++;
+		return 0;
+	}
+	if (ret == 0) {
+		if (n->held != NULL || m == NULL) {
+			ws_keepalive_sendError(n);
+			return -1;
+		}
+		n->held = message_ref(m);
+		n->held_ticks = 0;
+		return 1;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		len += iov[i].iov_len;
+	}
+
+	sent = ws_sendv(n->socket_id, iov, cnt);
+	if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && 
+			errno != EINTR) {
+		ws_keepalive_sendError(n);
+		return -1;
+	}
+	if (sent <= 0) {
+		if (skip) {
+			ws_stat_skipped(n);
+			n->rate_skipped++;
+			return 0;
+		}
+		sent = 0;
+	}
+	if ((uint64_t) sent == len) {
+		ws_stat_sent(n, len);
+		return 1;
+	}
+
+	cnt = ws_iov_advance(iov, cnt, sent);
+	if (m == NULL) {
+		memcpy(n->pend_ctl, iov[0].iov_base, iov[0].iov_len);
+		n->pend_iov[0].iov_base = n->pend_ctl;
+		n->pend_iov[0].iov_len = iov[0].iov_len;
+	} else {
+		memcpy(n->pend_iov, iov, cnt * sizeof(struct iovec));
+		n->pend = message_ref(m);
+	}
+	n->pend_cnt = cnt;
+	n->pend_len = len;
+	return 1;
+}
+
+/**
+ * Functions which creates the closeframe. The rest of a frame which is
+ * partly sent, and a frame held behind it, go first, otherwise the close
+ * frame would end up in the middle of them. If the socket has no room for
+ * them right away, the connection is closed without a close frame: this is
+ * called with the list locked, and the broadcasts must not wait for a slow
+ * client. The close frame itself is not waited for either, the connection
+ * is shut down right after it.
  *
  * @param type(ws_client *) n [Client]
  * @param type(ws_connection_close) s [The status of the closing]
  */
 void ws_closeframe(ws_client *n, ws_connection_close s) {
-	char frame[2];
-	(void) s;
+	char frame[4];
+	int len = 0;
 
 	if (n->headers->type == RFC6455 || n->headers->type == HYBI10 || 
 			n->headers->type == HYBI07) {
 		frame[0] = '\x88';
-		frame[1] = '\x00';
-		/**
-		 * TODO: 
-		 * 		- Use ws_connection_close
-		 */ 
-		send(n->socket_id, frame, 2, 0);
+		frame[1] = '\x02';
+		frame[2] = (s >> 8) & 0xFF;
+		frame[3] = s & 0xFF;
+		len = 4;
 	} else if (n->headers->type == HYBI00) {
 		frame[0] = '\xFF';
 		frame[1] = '\x00';
-		send(n->socket_id, frame, 2, 0);
+		len = 2;
+	}
+
+	if (len > 0 && ws_flush_all(n) == 1) {
+		send(n->socket_id, frame, len, MSG_DONTWAIT);
+	}
+
+	if (n->headers->type == HYBI00) {
 		pthread_cancel(n->thread_id);
 	}
 }
 
 /**
- * Function which do the actual sending of messages.
+ * Multicasts to every client the message for the channels it has selected.
+ * view() returns that message, it is called with the list locked and
+ * should build each message only once for clients with the same channels.
+ * A client gets nothing if view() returns NULL, or if its rate leaves this
+ * message out (see Rate.h), or if its socket is full (see ws_send_stream()).
+ *
+ * @param type(ws_list *) l [List containing clients]
+ * @param type(function) view [Returns the message for a channel selection]
+ * @param type(void *) arg [Passed on to view()]
+ */
+void list_multicast_views(ws_list *l,
+		ws_message *(*view)(uint32_t channels, void *arg), void *arg) {
+	ws_client *p;
+	ws_message *m;
+	uint64_t now = ws_now();
+	pthread_mutex_lock(&l->lock);
+	p = l->first;
+
+	while (p != NULL) {
+		if ( ws_rate_due(p, now) && (m = view(p->channels, arg)) != NULL ) {
+			ws_send_stream(p, m);
+		}
+		p = p->next;
+	}
+	pthread_mutex_unlock(&l->lock);
+}
+
+/**
+ * Function which do the actual sending of messages. Every client gets the
+ * same payload, only the few bytes in front of it depend on the client.
  *
  * @param type(ws_client *) n [Client] 
  * @param type(ws_message *) m [Message structure, that will be sent]
+ * @param type(int) skip [1: a frame of the stream, which may be skipped]
+ * @return type(int) [As ws_writev(), 0 as well if nothing was to be sent]
  */
-void ws_send(ws_client *n, ws_message *m) {
+static int ws_write_message(ws_client *n, ws_message *m, int skip) {
+	struct iovec iov[3];
+
+	/**
+	 * Clients which failed a send or stopped answering pings are being
+	 * removed by their own thread, and must not cost us any more sends.
+	 */
+	if (n->dead || m->hdr_len == 0) {
+		return 0;
+	}
+
 	if ( n->headers->type == HYBI00 ) {
 		/**
-		 * Adds 2 to the length of the message, as we have to put '\x00' and
-		 * '\xFF' in the front and end of the message.
+		 * The message goes between '\x00' and '\xFF'.
 		 */
-		send(n->socket_id, m->hybi00, m->len+2, 0);
+		iov[0].iov_base = hybi00_start;
+		iov[0].iov_len = 1;
+		iov[1].iov_base = m->msg;
+		iov[1].iov_len = m->len;
+		iov[2].iov_base = hybi00_end;
+		iov[2].iov_len = 1;
+		return ws_writev(n, m, iov, 3, skip);
 	} else if ( n->headers->type == HIXIE75 ) {
 		
 	} else if ( n->headers->type == HYBI07 || n->headers->type == RFC6455 
 			|| n->headers->type == HYBI10) {
-		send(n->socket_id, m->enc, m->enc_len, 0);
+		/**
+		 * Clients which negotiated permessage-deflate get the compressed
+		 * frame. It is only built once per message and window size, and is
+		 * then shared by every client with the same parameters.
+		 */
+		if (n->headers->deflate) {
+			int i = n->headers->deflate_window_bits - 9;
+
+			if (ws_deflate_encodeMessage(m, n->headers->deflate_window_bits) 
+					== CONTINUE && m->deflated[i] != NULL) {
+				iov[0].iov_base = m->deflated[i] + m->deflated_off[i];
+				iov[0].iov_len = m->deflated_len[i];
+				return ws_writev(n, m, iov, 1, skip);
+			}
+		}
+		iov[0].iov_base = m->hdr;
+		iov[0].iov_len = m->hdr_len;
+		iov[1].iov_base = m->msg;
+		iov[1].iov_len = m->len;
+		return ws_writev(n, m, iov, 2, skip);
 	}
+	return 0;
+}
+
+/**
+ * Sends a message to the client, which must not be lost, e.g. a reply or a
+ * pong. See ws_writev().
+ *
+ * @param type(ws_client *) n [Client] 
+ * @param type(ws_message *) m [Message structure, that will be sent]
+ */
+void ws_send(ws_client *n, ws_message *m) {
+	ws_write_message(n, m, 0);
+}
+
+/**
+ * Sends a frame of the stream to the client. It is skipped if the socket
+ * has no room for it, the next one replaces it. See ws_writev().
+ *
+ * @param type(ws_client *) n [Client] 
+ * @param type(ws_message *) m [Message structure, that will be sent]
+ */
+void ws_send_stream(ws_client *n, ws_message *m) {
+	ws_write_message(n, m, 1);
+}
+
+/**
+ * Sends a control frame, which is not part of a message, e.g. a ping. It
+ * takes its turn with the frames of ws_send(), and is skipped like a frame
+ * of the stream if the socket is full. Called with the list locked.
+ *
+ * @param type(ws_client *) n [Client]
+ * @param type(char *) frame [The whole frame]
+ * @param type(int) len [At most sizeof(n->pend_ctl)]
+ * @return type(int) [1: sent, 0: skipped as the socket is full, -1: failed]
+ */
+int ws_send_control(ws_client *n, char *frame, int len) {
+	struct iovec iov[1];
+
+	if (n->dead || len > (int) sizeof(n->pend_ctl)) {
+		return -1;
+	}
+
+	iov[0].iov_base = frame;
+	iov[0].iov_len = len;
+	return ws_writev(n, NULL, iov, 1, 1);
 }
 
 /**
@@ -360,7 +745,7 @@ void ws_send(ws_client *n, ws_message *m) {
  * @param type(ws_client *)
  */
 ws_client *client_new (int sock, char *addr) {
-	ws_client *n = (ws_client *) malloc(sizeof(ws_client));
+	ws_client *n = (ws_client *) ws_pool_get(WS_POOL_CLIENT);
 
 	if (n != NULL) {
 		n->socket_id = sock;		
@@ -369,6 +754,29 @@ ws_client *client_new (int sock, char *addr) {
 		n->thread_id = 0;
 		n->headers = NULL;		
 		n->message = NULL;
+		n->inflater = NULL;
+		n->dead = 0;
+		n->admitted = 0;
+		n->admit_addr = 0;
+		n->close = CLOSE_SHUTDOWN;
+		n->channels = WS_CHANNELS_ALL;
+		n->stream = 0;
+		n->stat_slot = -1;
+		n->missed_pongs = 0;
+		n->ping_sent = 0;
+		n->rtt = 0;
+		n->rtt_avg = 0;
+		n->wheel_slot = -1;
+		n->wheel_rounds = 0;
+		n->wheel_next = NULL;
+		n->pend = NULL;
+		n->pend_cnt = 0;
+		n->held = NULL;
+		n->held_ticks = 0;
+		n->pend_len = 0;
+		ws_rate_init(n);
+		n->spare = NULL;
+		n->list = NULL;
 		n->next = NULL;
 	}
 
@@ -381,7 +789,7 @@ ws_client *client_new (int sock, char *addr) {
  * @return type(ws_header *) [Header structure]
  */
 ws_header *header_new () {
-	ws_header *h = (ws_header *) malloc(sizeof(ws_header));
+	ws_header *h = (ws_header *) ws_pool_get(WS_POOL_HEADER);
 
 	if (h != NULL) {
 		h->host = NULL;
@@ -397,6 +805,8 @@ ws_header *header_new () {
 		h->extension = NULL;
 		h->resourcename = NULL;
 		h->protocol_string = NULL;
+		h->accept_encoding = NULL;
+		h->if_none_match = NULL;
 		h->version = 0;
 		h->host_len = 0;
 		h->protocol_len = 0;
@@ -406,36 +816,116 @@ ws_header *header_new () {
 		h->extension_len = 0;
 		h->get_len = 0;
 		h->resourcename_len = 0;		
+		h->extension_string = NULL;
+		h->extension_string_len = 0;
+		h->deflate = 0;
+		h->deflate_window_bits = 15;
 		h->type = UNKNOWN;
-		h->protocol = NONE;
+		h->protocol = ws_protocol_NONE;
 	}
 
 	return h;
 }
 
+/**
+ * Sets up an empty message structure.
+ *
+ * @param type(ws_message *) m [Message structure]
+ */
+static void message_init(ws_message *m) {
+	memset(m->opcode, '\0', 1);
+	memset(m->mask, '\0', 4);
+	m->len = 0; 
+	m->next_len = 0;
+	m->msg = NULL;
+	m->msg_cap = 0;
+	m->next = NULL;
+	m->hdr_len = 0;
+	memset(m->deflated, '\0', sizeof(m->deflated));
+	memset(m->deflated_off, '\0', sizeof(m->deflated_off));
+	memset(m->deflated_len, '\0', sizeof(m->deflated_len));
+	m->deflate_done = 0;
+	m->command = 0;
+	m->refs = 1;
+}
+
 /**
  * Creates a new message structure.
  *
  * @return type(ws_message *) [Message structure]
  */
 ws_message *message_new() {
-	ws_message *m = (ws_message *) malloc(sizeof(ws_message));
+	ws_message *m = (ws_message *) ws_pool_get(WS_POOL_MESSAGE);
 
 	if (m != NULL) {
-		memset(m->opcode, '\0', 1);
-		memset(m->mask, '\0', 4);
-		m->len = 0; 
-		m->enc_len = 0;
-		m->next_len = 0;
-		m->msg = NULL;
-		m->next = NULL;
-		m->enc = NULL;
-		m->hybi00 = NULL;
+		message_init(m);
 	}
 
 	return m;	
 }
 
+/**
+ * Returns an empty message for the next frame received by the client. It is
+ * the one the thread of the client kept from its last frame, if there is
+ * one, so receiving takes no lock. Only to be called by that thread.
+ *
+ * @param type(ws_client *) n [Client]
+ * @return type(ws_message *) [Message structure]
+ */
+ws_message *client_message(ws_client *n) {
+	ws_message *m = n->spare;
+	char *msg;
+	uint64_t cap;
+
+	if (m == NULL) {
+		return message_new();
+	}
+	n->spare = NULL;
+
+	msg = m->msg;
+	cap = m->msg_cap;
+	message_init(m);
+	m->msg = msg;
+	m->msg_cap = cap;
+	return m;
+}
+
+/**
+ * Releases n->message after it has been handled. If no one else holds a
+ * reference, e.g. a client which is still sending it, the thread of the
+ * client keeps it for client_message(). Only to be called by that thread.
+ *
+ * @param type(ws_client *) n [Client]
+ */
+void client_message_done(ws_client *n) {
+	ws_message *m = n->message;
+
+	if (m == NULL) {
+		return;
+	}
+	n->message = NULL;
+
+	if (n->spare == NULL && m->refs == 1) {
+		/**
+		 * A small buffer is kept as well, for the next frame.
+		 */
+		char *msg = m->msg;
+		uint64_t cap = m->msg_cap;
+
+		if (cap <= WS_MSG_KEEP) {
+			m->msg = NULL;
+		}
+		message_free(m);
+		if (cap <= WS_MSG_KEEP) {
+			m->msg = msg;
+			m->msg_cap = cap;
+		}
+		n->spare = m;
+	} else {
+		message_unref(m);
+	}
+}
+
 /**
  * Frees all allocations in the header structure.
  *
@@ -456,6 +946,11 @@ void header_free(ws_header *h) {
 		free(h->protocol_string);
 		h->protocol_string = NULL;
 	}
+
+	if (h->extension_string != NULL) {
+		free(h->extension_string);
+		h->extension_string = NULL;
+	}
 }
 
 /**
@@ -464,24 +959,88 @@ void header_free(ws_header *h) {
  * @param type(ws_message *) m [Message structure]
  */
 void message_free(ws_message *m) {
+	int i;
+
 	if (m->msg != NULL) {
 		free(m->msg);
 		m->msg = NULL;
 	}
+	m->msg_cap = 0;
 
 	if (m->next != NULL) {
 		free(m->next);
 		m->next = NULL;
 	}
 	
-	if (m->enc != NULL) {
-		free(m->enc);
-		m->enc = NULL;
+	m->hdr_len = 0;
+
+	for (i = 0; i < 7; i++) {
+		if (m->deflated[i] != NULL) {
+			free(m->deflated[i]);
+			m->deflated[i] = NULL;
+		}
+	}
+	m->deflate_done = 0;
+}
+
+/**
+ * Makes room for at least size bytes in m->msg, keeping what is in it. The
+ * buffer grows at least to twice its size, so a message received in many
+ * small parts is only moved a few times.
+ *
+ * @param type(ws_message *) m [Message structure]
+ * @param type(uint64_t) size [Bytes needed]
+ * @return type(int) [0: done, -1: out of memory]
+ */
+int message_reserve(ws_message *m, uint64_t size) {
+	uint64_t cap = m->msg_cap * 2;
+	char *temp;
+
+	if (size <= m->msg_cap) {
+		return 0;
 	}
 
-	if (m->hybi00 != NULL) {
-		free(m->hybi00);
-		m->hybi00 = NULL;
+	if (cap < WS_MSG_MIN) {
+		cap = WS_MSG_MIN;
+	}
+	if (cap > MAXMESSAGE + 16) {
+		cap = MAXMESSAGE + 16;
+	}
+	if (cap < size) {
+		cap = size;
+	}
+
+	temp = (char *) realloc(m->msg, cap);
+	if (temp == NULL) {
+		return -1;
+	}
+	m->msg = temp;
+	m->msg_cap = cap;
+	return 0;
+}
+
+/**
+ * Takes a reference to a message, e.g. while a client still has to send the
+ * rest of it.
+ *
+ * @param type(ws_message *) m [Message structure]
+ * @return type(ws_message *) [m]
+ */
+ws_message *message_ref(ws_message *m) {
+	__sync_fetch_and_add(&m->refs, 1);
+	return m;
+}
+
+/**
+ * Drops a reference to a message, the last one frees it and puts it back to
+ * its pool. This replaces message_free() and free() for every message.
+ *
+ * @param type(ws_message *) m [Message structure]
+ */
+void message_unref(ws_message *m) {
+	if (__sync_sub_and_fetch(&m->refs, 1) == 0) {
+		message_free(m);
+		ws_pool_put(WS_POOL_MESSAGE, m);
 	}
 }
 
@@ -504,13 +1063,38 @@ void client_free(ws_client *n) {
 
 	if (n->headers != NULL) {
 		header_free(n->headers);
-		free(n->headers);
+		ws_pool_put(WS_POOL_HEADER, n->headers);
 		n->headers = NULL;
 	}
 
 	if (n->message != NULL) {
-		message_free(n->message);
-		free(n->message);
+		message_unref(n->message);
 		n->message = NULL;
 	}
+
+	if (n->inflater != NULL) {
+		ws_deflate_free(n);
+	}
+
+	if (n->pend != NULL) {
+		message_unref(n->pend);
+		n->pend = NULL;
+	}
+	n->pend_cnt = 0;
+
+	if (n->held != NULL) {
+		message_unref(n->held);
+		n->held = NULL;
+	}
+
+	if (n->spare != NULL) {
+		message_free(n->spare);
+		ws_pool_put(WS_POOL_MESSAGE, n->spare);
+		n->spare = NULL;
+	}
+
+	if (n->admitted) {
+		ws_admit_release(n->admit_addr);
+		n->admitted = 0;
+	}
 }
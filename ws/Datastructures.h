@@ -25,6 +25,11 @@ SOFTWARE.
 
 #include "Includes.h"
 
+#define WHEEL_SLOTS 64 			/* Slots in the keepalive timer wheel */
+#define WS_CHANNELS_ALL 0xFFFFFFFF 	/* Channel selection of a new client */
+#define WS_MSG_MIN 256 				/* Smallest buffer of a received message */
+#define WS_MSG_KEEP 8192 			/* Largest buffer a client keeps for the next one */
+
 typedef enum {
 	CONTINUE,
 	CLOSE_NORMAL=1000, 		/* The connection */
@@ -67,6 +72,8 @@ typedef struct {
 	char *extension;
 	char *resourcename;
 	char *protocol_string;
+	char *accept_encoding; 		/* Only read for plain HTTP requests */
+	char *if_none_match;
 	int version;
 	int host_len;
 	int protocol_len;
@@ -76,6 +83,10 @@ typedef struct {
 	int extension_len;
 	int get_len;
 	int resourcename_len;
+	char *extension_string;
+	int extension_string_len;
+	int deflate;
+	int deflate_window_bits;
 	ws_type type;
 	ws_protocol protocol;
 } ws_header;
@@ -84,12 +95,18 @@ typedef struct {
 	char opcode[1];
 	char mask[4];
 	uint64_t len;
-	uint64_t enc_len; 
 	uint64_t next_len;
 	char *msg;
+	uint64_t msg_cap; 			/* allocated for msg, see message_reserve() */
 	char *next;
-	char *enc;
-	char *hybi00;
+	char hdr[10]; 				/* frame header sent in front of msg */
+	int hdr_len; 				/* 0: not encoded yet */
+	char *deflated[7];
+	int deflated_off[7]; 		/* the frame starts at deflated[i] + deflated_off[i] */
+	uint64_t deflated_len[7];
+	unsigned int deflate_done;
+	int command; 				/* WS_COMMAND_*, consumed by the server, not to be multicast */
+	int refs; 					/* message_unref() frees the message at 0 */
 } ws_message;
 
 typedef struct ws_client_n {
@@ -99,13 +116,45 @@ typedef struct ws_client_n {
 	pthread_t thread_id;
 	ws_header *headers;
 	ws_message *message;
+	void *inflater;
+	int dead;
+	int admitted; 				/* holds a place of ws_admit(), given back by client_free() */
+	uint32_t admit_addr; 		/* address it was admitted with */
+	ws_connection_close close; 	/* status sent in the close frame by list_remove() */
+	uint32_t channels; 			/* bit n: client receives channel n */
+	int stream; 				/* stream of the server it receives, 0: the first */
+	int stat_slot; 				/* in ws_stat.client, -1: none */
+	int missed_pongs;
+	uint64_t ping_sent;
+	uint32_t rtt;
+	uint32_t rtt_avg;
+	int wheel_slot;
+	int wheel_rounds;
+	struct ws_client_n *wheel_next;
+	ws_message *pend; 			/* frame partly sent, with a reference */
+	struct iovec pend_iov[3]; 	/* what is left of it */
+	int pend_cnt; 				/* 0: nothing left */
+	uint64_t pend_len; 			/* length of the whole frame */
+	char pend_ctl[10]; 			/* rest of a control frame, which is not shared */
+	ws_message *held; 			/* frame which must go out after pend, with a reference */
+	int held_ticks; 			/* keepalive ticks it has waited, see ws_flush_pending() */
+	int rate_div; 				/* gets every rate_div-th frame of the stream, see Rate.h */
+	int rate_count; 			/* frames of the stream left out since the last one */
+	int rate_calm; 				/* periods without backlog in a row */
+	uint32_t rate_frames; 		/* frames of the stream sent in this period */
+	uint32_t rate_skipped; 		/* frames skipped in this period, socket full */
+	uint64_t rate_since; 		/* start of the period, 0: none yet */
+	ws_message *spare; 		/* kept by its thread for the next frame received */
+	struct ws_list_n *list; 	/* list it was added to, NULL: none yet */
 	struct ws_client_n *next;
 } ws_client;
 
-typedef struct {
+typedef struct ws_list_n {
 	int len;
 	ws_client *first;
 	ws_client *last;	
+	ws_client *wheel[WHEEL_SLOTS];
+	int wheel_pos;
 	pthread_mutex_t lock;
 } ws_list;
 
@@ -122,12 +171,20 @@ void list_print(ws_list *l);
 void list_multicast(ws_list *l, ws_client *n);
 void list_multicast_one(ws_list *l, ws_client *n, ws_message *m);
 void list_multicast_all(ws_list *l, ws_message *m);
+void list_multicast_views(ws_list *l,
+		ws_message *(*view)(uint32_t channels, void *arg), void *arg);
+void list_map_channels(ws_list *l,
+		uint32_t (*map)(uint32_t channels, void *arg), void *arg);
 
 /**
  * Websocket functions.
  */
 void ws_closeframe(ws_client *n, ws_connection_close c);
 void ws_send(ws_client *n, ws_message *m);
+void ws_send_stream(ws_client *n, ws_message *m);
+int ws_send_control(ws_client *n, char *frame, int len);
+int ws_flush_pending(ws_client *n);
+uint64_t ws_now(void);
 
 /**
  * New structures.
@@ -135,11 +192,16 @@ void ws_send(ws_client *n, ws_message *m);
 ws_client *client_new(int sock, char *addr);
 ws_header *header_new();
 ws_message *message_new();
+ws_message *client_message(ws_client *n);
+void client_message_done(ws_client *n);
 
 /**
  * Free structures
  */
 void header_free(ws_header *h);
 void message_free(ws_message *m);
+int message_reserve(ws_message *m, uint64_t size);
+ws_message *message_ref(ws_message *m);
+void message_unref(ws_message *m);
 void client_free(ws_client *n);
 #endif
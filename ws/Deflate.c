@@ -0,0 +1,463 @@
+/******************************************************************************
+  Copyright (c) 2013 Morten Houmøller Nygaard - www.mortz.dk - admin@mortz.dk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "Deflate.h"
+
+#ifdef WS_DEFLATE
+#include <zlib.h>
+#endif
+
+static int deflate_enable = 1;
+static int deflate_level = DEFLATE_LEVEL;
+static int deflate_min_size = DEFLATE_MIN_SIZE;
+static ws_deflate_stats deflate_stats;
+static pthread_mutex_t deflate_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Sets the parameters used for all connections negotiated from now on. The
+ * level is handed directly to zlib, messages shorter than min_size are never
+ * compressed as the frame would not get any smaller.
+ *
+ * @param type(int) enable [0 disables the extension]
+ * @param type(int) level [zlib compression level, 1 - 9]
+ * @param type(int) min_size [Smallest payload that will be compressed]
+ */
+void ws_deflate_configure(int enable, int level, int min_size) {
+	pthread_mutex_lock(&deflate_lock);
+	deflate_enable = enable;
+	deflate_level = (level < 1 || level > 9) ? DEFLATE_LEVEL : level;
+	deflate_min_size = (min_size < 0) ? 0 : min_size;
+	pthread_mutex_unlock(&deflate_lock);
+}
+
+/**
+ * Copies the compression counters.
+ *
+ * @param type(ws_deflate_stats *) s [Destination of the counters]
+ */
+void ws_deflate_getStats(ws_deflate_stats *s) {
+	pthread_mutex_lock(&deflate_lock);
+	memcpy(s, &deflate_stats, sizeof(ws_deflate_stats));
+	pthread_mutex_unlock(&deflate_lock);
+}
+
+#ifdef WS_DEFLATE
+
+/**
+ * One raw deflate stream per supported window size (9 - 15 bits). As we
+ * always run with server_no_context_takeover, the streams are reset before
+ * each message, and can be shared by all clients.
+ */
+static z_stream deflaters[7];
+static int deflaters_level[7];
+
+/**
+ * Returns the next parameter of an extension offer. Parameters are separated
+ * by ';' and offers by ','. The parameter is copied into param, stripped for
+ * whitespace and quotes.
+ */
+static char *deflate_nextParam(char *p, char *param, int size, int *last) {
+	int i = 0;
+
+	while (*p == ' ' || *p == '\t') {
+		p++;
+	}
+
+	while (*p != '\0' && *p != ';' && *p != ',') {
+		if (*p != ' ' && *p != '\t' && *p != '"' && i < size - 1) {
+			param[i++] = *p;
+		}
+		p++;
+	}
+	param[i] = '\0';
+
+	*last = (*p != ';');
+	if (*p != '\0') {
+		p++;
+	}
+
+	return p;
+}
+
+/**
+ * Looks through the Sec-WebSocket-Extensions header for an acceptable
+ * permessage-deflate offer. The first offer we can accept is used, and the
+ * response we are going to send is stored in the header structure.
+ *
+ * @param type(ws_header *) h [Header structure]
+ * @return type(int) [1 if the extension was accepted, 0 if not]
+ */
+int ws_deflate_negotiate(ws_header *h) {
+	char param[64];
+	char response[128];
+	char *p = h->extension;
+	int last, ok = 0, window_bits, seen;
+
+	if (p == NULL || !deflate_enable) {
+		return 0;
+	}
+
+	while (*p != '\0') {
+		p = deflate_nextParam(p, param, sizeof(param), &last);
+		ok = (strcmp(param, "permessage-deflate") == 0);
+		window_bits = 0;
+		seen = 0;
+
+		/**
+		 * Go through the parameters of this offer. An unknown or repeated
+		 * parameter means that we have to decline the offer.
+		 */
+		while (!last) {
+			p = deflate_nextParam(p, param, sizeof(param), &last);
+
+			if (strcmp(param, "server_no_context_takeover") == 0) {
+				ok = ok && !(seen & 1);
+				seen |= 1;
+			} else if (strcmp(param, "client_no_context_takeover") == 0) {
+				ok = ok && !(seen & 2);
+				seen |= 2;
+			} else if (strncmp(param, "server_max_window_bits=", 23) == 0) {
+				ok = ok && !(seen & 4);
+				seen |= 4;
+				window_bits = strtol(param + 23, (char **) NULL, 10);
+
+				/**
+				 * zlib can't produce a raw stream with an 8 bit window.
+				 */
+				if (window_bits < 9 || window_bits > 15) {
+					ok = 0;
+				}
+			} else if (strncmp(param, "client_max_window_bits", 22) == 0) {
+				ok = ok && !(seen & 8);
+				seen |= 8;
+			} else {
+				ok = 0;
+			}
+		}
+
+		if (ok) {
+			break;
+		}
+	}
+
+	if (!ok) {
+		return 0;
+	}
+
+	/**
+	 * We always run without context takeover in both directions, such that
+	 * a compressed broadcast frame does not depend on what a specific client
+	 * has seen before, and we don't have to keep a window per client.
+	 */
+	if (window_bits != 0) {
+		snprintf(response, sizeof(response), "permessage-deflate; "
+				"server_no_context_takeover; client_no_context_takeover; "
+				"server_max_window_bits=%d", window_bits);
+	} else {
+		snprintf(response, sizeof(response), "permessage-deflate; "
+				"server_no_context_takeover; client_no_context_takeover");
+		window_bits = 15;
+	}
+
+	h->extension_string = (char *) malloc(strlen(response) + 1);
+	if (h->extension_string == NULL) {
+		return 0;
+	}
+	memcpy(h->extension_string, response, strlen(response) + 1);
+	h->extension_string_len = strlen(response);
+	h->deflate = 1;
+	h->deflate_window_bits = window_bits;
+
+	return 1;
+}
+
+/**
+ * Builds the compressed RFC6455 frame of the message for the given window
+ * size. This is only done once per message, every later call with the same
+ * window size just returns. If the message is too small, or the compressed
+ * frame would not be smaller, m->deflated is left NULL and the plain frame
+ * must be sent.
+ *
+ * @param type(ws_message *) m [Message structure]
+ * @param type(int) window_bits [Window size negotiated with the client]
+ */
+ws_connection_close ws_deflate_encodeMessage(ws_message *m, int window_bits) {
+	int i = window_bits - 9, ret, skip;
+	uint64_t bound, length, start;
+	unsigned char *out, *hdr;
+	z_stream *z;
+
+	if (i < 0 || i > 6 || (m->deflate_done & (1u << i))) {
+		return CONTINUE;
+	}
+
+	pthread_mutex_lock(&deflate_lock);
+
+	/**
+	 * Someone else compressed it while we were waiting.
+	 */
+	if (m->deflate_done & (1u << i)) {
+		pthread_mutex_unlock(&deflate_lock);
+		return CONTINUE;
+	}
+	m->deflate_done |= (1u << i);
+
+	if (m->msg == NULL || m->len < (uint64_t) deflate_min_size) {
+		deflate_stats.skipped++;
+		pthread_mutex_unlock(&deflate_lock);
+		return CONTINUE;
+	}
+
+	start = ws_now();
+	z = &deflaters[i];
+
+	if (deflaters_level[i] != deflate_level) {
+		if (deflaters_level[i] != 0) {
+			deflateEnd(z);
+		}
+		memset(z, '\0', sizeof(z_stream));
+		if (deflateInit2(z, deflate_level, Z_DEFLATED, -window_bits, 8,
+					Z_DEFAULT_STRATEGY) != Z_OK) {
+			deflaters_level[i] = 0;
+			pthread_mutex_unlock(&deflate_lock);
+			return CONTINUE;
+		}
+		deflaters_level[i] = deflate_level;
+	} else {
+		deflateReset(z);
+	}
+
+	/**
+	 * Room for the largest frame header in front, and for the empty block
+	 * Z_SYNC_FLUSH appends at the end.
+	 */
+	bound = deflateBound(z, m->len) + 16;
+	out = (unsigned char *) malloc(bound + 10);
+	if (out == NULL) {
+		pthread_mutex_unlock(&deflate_lock);
+		return CLOSE_UNEXPECTED;
+	}
+
+	z->next_in = (Bytef *) m->msg;
+	z->avail_in = m->len;
+	z->next_out = out + 10;
+	z->avail_out = bound;
+
+	ret = deflate(z, Z_SYNC_FLUSH);
+	length = bound - z->avail_out;
+
+	/**
+	 * RFC 7692 7.2.1: The trailing 0x00 0x00 0xff 0xff of the sync flush is
+	 * removed from the payload, the client appends it again.
+	 */
+	if (ret != Z_OK || z->avail_in != 0 || z->avail_out == 0 || length < 4 ||
+			length - 4 >= m->len) {
+		free(out);
+		deflate_stats.skipped++;
+		deflate_stats.usec += ws_now() - start;
+		pthread_mutex_unlock(&deflate_lock);
+		return CONTINUE;
+	}
+	length -= 4;
+
+	/**
+	 * FIN, RSV1 and text opcode, followed by the length of the compressed
+	 * payload. The header goes right in front of the payload, which was
+	 * compressed to out + 10 for this.
+	 */
+	if (length <= 125) {
+		skip = 2;
+	} else if (length <= 65535) {
+		skip = 4;
+	} else {
+		skip = 10;
+	}
+	hdr = out + 10 - skip;
+	hdr[0] = 0xC1;
+	if (skip == 2) {
+		hdr[1] = length;
+	} else if (skip == 4) {
+		hdr[1] = 126;
+		hdr[2] = (length >> 8) & 0xFF;
+		hdr[3] = length & 0xFF;
+	} else {
+		int j;
+		hdr[1] = 127;
+		for (j = 0; j < 8; j++) {
+			hdr[2+j] = (length >> (56 - 8*j)) & 0xFF;
+		}
+	}
+
+	m->deflated[i] = (char *) out;
+	m->deflated_off[i] = 10 - skip;
+	m->deflated_len[i] = length + skip;
+
+	deflate_stats.messages++;
+	deflate_stats.raw_bytes += m->len;
+	deflate_stats.deflated_bytes += length;
+	deflate_stats.usec += ws_now() - start;
+
+	pthread_mutex_unlock(&deflate_lock);
+	return CONTINUE;
+}
+
+/**
+ * Decompresses the message received from a client, which had RSV1 set. As the
+ * client was told client_no_context_takeover, the inflate stream is reset
+ * before every message.
+ *
+ * @param type(ws_client *) n [Client]
+ */
+ws_connection_close ws_deflate_inflateMessage(ws_client *n) {
+	ws_message *m = n->message;
+	z_stream *z = (z_stream *) n->inflater;
+	uint64_t size, length = 0;
+	char *in, *out, *temp;
+	int ret;
+
+	if (!n->headers->deflate) {
+		return CLOSE_PROTOCOL;
+	}
+
+	if (z == NULL) {
+		z = (z_stream *) malloc(sizeof(z_stream));
+		if (z == NULL) {
+			return CLOSE_UNEXPECTED;
+		}
+		memset(z, '\0', sizeof(z_stream));
+		if (inflateInit2(z, -15) != Z_OK) {
+			free(z);
+			return CLOSE_UNEXPECTED;
+		}
+		n->inflater = z;
+	} else {
+		inflateReset(z);
+	}
+
+	/**
+	 * Put the 0x00 0x00 0xff 0xff back, which the client removed.
+	 */
+	if (message_reserve(m, m->len + 4) < 0) {
+		return CLOSE_UNEXPECTED;
+	}
+	in = m->msg;
+	memcpy(in + m->len, "\x00\x00\xff\xff", 4);
+
+	size = (m->len * 4) + 256;
+	out = (char *) malloc(size);
+	if (out == NULL) {
+		return CLOSE_UNEXPECTED;
+	}
+
+	z->next_in = (Bytef *) in;
+	z->avail_in = m->len + 4;
+
+	/**
+	 * The message ends where the input is used up, or earlier with a block
+	 * which has BFINAL set (RFC 7692 7.2.3.4), then the 0x00 0x00 0xff 0xff
+	 * put back above is left over. Z_BUF_ERROR means that inflate() could
+	 * do nothing more with the input, there is always room in out.
+	 */
+	do {
+		/**
+		 * The inflated message is bigger than we expected, double the
+		 * buffer, unless we have hit the MAXMESSAGE limit.
+		 */
+		if (length == size - 1) {
+			if (size > MAXMESSAGE) {
+				free(out);
+				return CLOSE_BIG;
+			}
+			temp = (char *) realloc(out, size * 2);
+			if (temp == NULL) {
+				free(out);
+				return CLOSE_UNEXPECTED;
+			}
+			out = temp;
+			size *= 2;
+		}
+
+		z->next_out = (Bytef *) out + length;
+		z->avail_out = (size - 1) - length;
+
+		ret = inflate(z, Z_SYNC_FLUSH);
+		length = (size - 1) - z->avail_out;
+
+		if (ret != Z_OK && ret != Z_BUF_ERROR && ret != Z_STREAM_END) {
+			free(out);
+			return CLOSE_PROTOCOL;
+		}
+	} while (ret == Z_OK && (z->avail_in != 0 || z->avail_out == 0));
+
+	if (ret == Z_STREAM_END) {
+		inflateReset(z);
+	}
+
+	out[length] = '\0';
+	free(m->msg);
+	m->msg = out;
+	m->msg_cap = size;
+	m->len = length;
+
+	pthread_mutex_lock(&deflate_lock);
+	deflate_stats.inflated++;
+	pthread_mutex_unlock(&deflate_lock);
+
+	return CONTINUE;
+}
+
+/**
+ * Frees the inflate stream of the client.
+ *
+ * @param type(ws_client *) n [Client]
+ */
+void ws_deflate_free(ws_client *n) {
+	if (n->inflater != NULL) {
+		inflateEnd((z_stream *) n->inflater);
+		free(n->inflater);
+		n->inflater = NULL;
+	}
+}
+
+#else
+
+int ws_deflate_negotiate(ws_header *h) {
+	(void) h;
+	return 0;
+}
+
+ws_connection_close ws_deflate_encodeMessage(ws_message *m, int window_bits) {
+	(void) m;
+	(void) window_bits;
+	return CONTINUE;
+}
+
+ws_connection_close ws_deflate_inflateMessage(ws_client *n) {
+	(void) n;
+	return CLOSE_PROTOCOL;
+}
+
+void ws_deflate_free(ws_client *n) {
+	n->inflater = NULL;
+}
+
+#endif
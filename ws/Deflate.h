@@ -0,0 +1,51 @@
+/******************************************************************************
+  Copyright (c) 2013 Morten Houmøller Nygaard - www.mortz.dk - admin@mortz.dk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#ifndef _DEFLATE_H
+#define _DEFLATE_H
+
+#include "Datastructures.h"
+
+/**
+ * RFC 7692 permessage-deflate. The extension is only compiled in when
+ * WS_DEFLATE is defined, as it needs zlib. Without it the negotiation never
+ * accepts an offer and every client gets the plain frames.
+ */
+#define DEFLATE_LEVEL 1 		/* Default zlib compression level */
+#define DEFLATE_MIN_SIZE 64 	/* Messages smaller than this are sent plain */
+
+typedef struct {
+	uint64_t messages; 			/* Messages which were compressed */
+	uint64_t skipped; 			/* Messages too small or incompressible */
+	uint64_t raw_bytes; 		/* Payload bytes before compression */
+	uint64_t deflated_bytes; 	/* Payload bytes after compression */
+	uint64_t inflated; 			/* Compressed messages received */
+	uint64_t usec; 				/* Time spent in deflate() */
+} ws_deflate_stats;
+
+void ws_deflate_configure(int enable, int level, int min_size);
+int ws_deflate_negotiate(ws_header *h);
+ws_connection_close ws_deflate_encodeMessage(ws_message *m, int window_bits);
+ws_connection_close ws_deflate_inflateMessage(ws_client *n);
+void ws_deflate_free(ws_client *n);
+void ws_deflate_getStats(ws_deflate_stats *s);
+#endif
@@ -21,6 +21,8 @@ SOFTWARE.
 ******************************************************************************/
 
 #include "Errors.h"
+#include "Log.h"
+#include "Pool.h"
 #include <sockLib.h>
 
 /**
@@ -30,6 +32,9 @@ SOFTWARE.
 void server_error(const char *message, int server_socket, ws_list *l) {
 	shutdown(server_socket, SHUT_RD);
 
+	/**
+	 * The process exits right away, so this can't wait for the log drain.
+	 */
 	printf("\nServer experienced an error: \n\t%s\nShutting down ...\n\n", 
 			message);
 	fflush(stdout);
@@ -54,9 +59,8 @@ void server_error(const char *message, int server_socket, ws_list *l) {
  * @param type(ws_client *) n [Client]
  */
 void handshake_error(const char *message, const char *status, ws_client *n) {
-	printf("\nClient experienced an error: \n\t%s\nShutting him down ...\n\n", 
+	WS_LOG(WS_LOG_WRN, "Client experienced an error: %s. Shutting him down ...",
 			message);
-	fflush(stdout);	
 
 	send(n->socket_id, status, strlen(status), 0);
 	shutdown(n->socket_id, SHUT_RDWR);
@@ -64,7 +68,7 @@ void handshake_error(const char *message, const char *status, ws_client *n) {
 	if (n != NULL) {
 		client_free(n);
 		close(n->socket_id);
-		free(n);
+		ws_pool_put(WS_POOL_CLIENT, n);
 		n = NULL;
 	}
 }
@@ -80,9 +84,8 @@ void handshake_error(const char *message, const char *status, ws_client *n) {
  * @param type(ws_client *) n [Client] 
  */
 void client_error(const char *message, ws_connection_close c, ws_client *n) {
-	printf("\nClient experienced an error: \n\t%s\nShutting him down ...\n\n", 
+	WS_LOG(WS_LOG_WRN, "Client experienced an error: %s. Shutting him down ...",
 			message);
-	fflush(stdout);	
 	
 	ws_closeframe(n, c);
 	shutdown(n->socket_id, SHUT_RDWR);
@@ -90,7 +93,7 @@ void client_error(const char *message, ws_connection_close c, ws_client *n) {
 	if (n != NULL) {
 		client_free(n);
 		close(n->socket_id);
-		free(n);
+		ws_pool_put(WS_POOL_CLIENT, n);
 		n = NULL;
 	}
 }
@@ -25,9 +25,15 @@ SOFTWARE.
 #include "md5.h"
 #include "sha1.h"
 #include "base64.h"
+#include "Deflate.h"
+#include "Static.h"
+#include "Log.h"
 #include <sockLib.h>
 
-int isblank(int c)
+/**
+ * The VxWorks C library has no isblank(), so a local one is used everywhere.
+ */
+static int ws_isblank(int c)
 {
     return ((char)c == ' ') || ((char)c == '\t');
 }
@@ -58,7 +64,7 @@ uint32_t generateKey(char *key, int length) {
 			memset(chr, '\0', 2);
 			sprintf(chr, "%c", key[i]);
 			strcat(result, chr);
-		} else if (isblank((unsigned char) key[i]) != 0 && key[i] != '\t') {
+		} else if (ws_isblank((unsigned char) key[i]) != 0 && key[i] != '\t') {
 			spaces++;	
 		}
 	}
@@ -284,6 +290,10 @@ int parseHeaders(char *string, ws_client *n, int port){
 			} else if ( STRNCASECMP("Host: ", token, 6) == 0 ) {
 				h->host = token + 6;
 				h->host_len = strlen(h->host);
+			} else if ( STRNCASECMP("Accept-Encoding: ", token, 17) == 0 ) {
+				h->accept_encoding = token + 17;
+			} else if ( STRNCASECMP("If-None-Match: ", token, 15) == 0 ) {
+				h->if_none_match = token + 15;
 			} else if ( STRNCASECMP("WebSocket-Protocol: ", token, 20) == 0 ) {
 				h->type = HIXIE75;
 				if ( strstr(token+20, "chat") != NULL ) {
@@ -384,11 +394,14 @@ int parseHeaders(char *string, ws_client *n, int port){
 	 * We now check all the headers we recieved according to the protocol which
 	 * is used, to assure that we are talking to a valid client. If no protocol 
 	 * is selected, then we assume that the request is an ordinary HTTP 
-	 * request.
+	 * request, which is served from the static files if there are any.
 	 */
 	if (h->type == HTTP) {
-		handshake_error("Received a HTTP Request. We are not yet ready to "
-				"handle these.\n", ERROR_NOT_IMPL, n);
+		if (ws_static_enabled()) {
+			return 0;
+		}
+		handshake_error("Received a HTTP Request, but there are no files to "
+				"serve.", ERROR_NOT_IMPL, n);
 		return -1;
 	}
 
@@ -507,6 +520,11 @@ int parseHeaders(char *string, ws_client *n, int port){
 		h->accept = acceptKey;
 		h->accept_len = strlen(h->accept);
 
+		/**
+		 * Check whether the client offered an extension we support.
+		 */
+		ws_deflate_negotiate(h);
+
 	} else if ( h->type != HIXIE75 ) {
 		handshake_error("Something very wierd happened!?", ERROR_INTERNAL, n);
 		return -1; 
@@ -532,9 +550,12 @@ int sendHandshake(ws_client *n) {
 			+ ACCEPT_CONNECTION_LEN
 			+ ACCEPT_KEY_LEN + n->headers->accept_len 
 			+ (2*3);
-		if (n->headers->protocol != NONE) {
+		if (n->headers->protocol != ws_protocol_NONE) {
 			length += ACCEPT_PROTOCOL_V2_LEN + n->headers->protocol_len+2;
 		}
+		if (n->headers->extension_string != NULL) {
+			length += ACCEPT_EXTENSION_LEN + n->headers->extension_string_len+2;
+		}
 		response = getMemory("", length);
 		
 		if (response == NULL) {
@@ -557,7 +578,7 @@ int sendHandshake(ws_client *n) {
 		memcpy(response + memlen, ACCEPT_CONNECTION, ACCEPT_CONNECTION_LEN);
 		memlen += ACCEPT_CONNECTION_LEN;
 		
-		if (n->headers->protocol != NONE) {
+		if (n->headers->protocol != ws_protocol_NONE) {
 			memcpy(response + memlen, ACCEPT_PROTOCOL_V2, ACCEPT_PROTOCOL_V2_LEN);
 			memlen += ACCEPT_PROTOCOL_V2_LEN;
 
@@ -569,6 +590,18 @@ int sendHandshake(ws_client *n) {
 			memlen += 2;
 		}
 
+		if (n->headers->extension_string != NULL) {
+			memcpy(response + memlen, ACCEPT_EXTENSION, ACCEPT_EXTENSION_LEN);
+			memlen += ACCEPT_EXTENSION_LEN;
+
+			memcpy(response + memlen, n->headers->extension_string, 
+					n->headers->extension_string_len);
+			memlen += n->headers->extension_string_len;
+
+			memcpy(response + memlen, "\r\n", 2);
+			memlen += 2;
+		}
+
 		memcpy(response + memlen, ACCEPT_KEY, ACCEPT_KEY_LEN);
 		memlen += ACCEPT_KEY_LEN;
 		
@@ -578,8 +611,8 @@ int sendHandshake(ws_client *n) {
 		memcpy(response + memlen, "\r\n\r\n", 4);
 		memlen += 4;
 
-		printf("Server responds with the following headers:\n%s\n", response);
-		fflush(stdout);
+		WS_LOG_BLOCK(WS_LOG_DBG, "Server responds with the following headers:",
+				response);
 
 		if (memlen != length) {
 			free(response);
@@ -598,7 +631,7 @@ int sendHandshake(ws_client *n) {
 		if (n->headers->origin != NULL) {
 			length += ACCEPT_ORIGIN_V2_LEN + n->headers->origin_len + 2;
 		}
-		if (n->headers->protocol != NONE) {
+		if (n->headers->protocol != ws_protocol_NONE) {
 			length += ACCEPT_PROTOCOL_V2_LEN + n->headers->protocol_len + 2;
 		}
 
@@ -652,7 +685,7 @@ int sendHandshake(ws_client *n) {
 		memcpy(response + memlen, "\r\n", 2);
 		memlen += 2;
 
-		if (n->headers->protocol != NONE) {
+		if (n->headers->protocol != ws_protocol_NONE) {
 			memcpy(response + memlen, ACCEPT_PROTOCOL_V2, ACCEPT_PROTOCOL_V2_LEN);
 			memlen += ACCEPT_PROTOCOL_V2_LEN;
 
@@ -670,8 +703,8 @@ int sendHandshake(ws_client *n) {
 		memcpy(response + memlen, n->headers->accept, n->headers->accept_len);
 		memlen += n->headers->accept_len;
 
-		printf("Server responds with the following headers:\n%s\n", response);
-		fflush(stdout);
+		WS_LOG_BLOCK(WS_LOG_DBG, "Server responds with the following headers:",
+				response);
 
 		if (memlen != length) {
 			free(response);
@@ -689,7 +722,7 @@ int sendHandshake(ws_client *n) {
 		if (n->headers->origin != NULL) {
 			length += ACCEPT_ORIGIN_V1_LEN + n->headers->origin_len + 2;
 		}
-		if (n->headers->protocol != NONE) {
+		if (n->headers->protocol != ws_protocol_NONE) {
 			length += ACCEPT_PROTOCOL_V1_LEN + n->headers->protocol_len + 2;
 		}
 
@@ -743,7 +776,7 @@ int sendHandshake(ws_client *n) {
 		memcpy(response + memlen, "\r\n", 2);
 		memlen += 2;
 
-		if (n->headers->protocol != NONE) {
+		if (n->headers->protocol != ws_protocol_NONE) {
 			memcpy(response + memlen, ACCEPT_PROTOCOL_V1, 
 					ACCEPT_PROTOCOL_V1_LEN);
 			memlen += ACCEPT_PROTOCOL_V1_LEN;
@@ -759,8 +792,8 @@ int sendHandshake(ws_client *n) {
 		memcpy(response + memlen, "\r\n", 2);
 		memlen += 2;
 
-		printf("Server responds with the following headers:\n%s\n", response);
-		fflush(stdout);
+		WS_LOG_BLOCK(WS_LOG_DBG, "Server responds with the following headers:",
+				response);
 
 		if (memlen != length) {
 			free(response);
@@ -29,6 +29,9 @@ SOFTWARE.
 #define ERROR_BAD "HTTP/1.1 400 Bad Request\r\n\r\n"
 #define ERROR_NOT_IMPL "HTTP/1.1 501 Not Implemented\r\n\r\n"
 #define ERROR_FORBIDDEN "HTTP/1.1 403 Forbidden\r\n\r\n"
+#define ERROR_NOT_FOUND "HTTP/1.1 404 Not Found\r\n\r\n"
+#define ERROR_TIMEOUT "HTTP/1.1 408 Request Timeout\r\n\r\n"
+#define ERROR_UNAVAILABLE "HTTP/1.1 503 Service Unavailable\r\nRetry-After: 1\r\n\r\n"
 #define ERROR_VERSION "HTTP/1.1 426 Upgrade Required\r\nSec-WebSocket-Version: 13, 8, 7\r\n\r\n"
 
 #define ACCEPT_HEADER_V1 "HTTP/1.1 101 Web Socket Protocol Handshake\r\n"
@@ -55,6 +58,8 @@ SOFTWARE.
 #define ACCEPT_LOCATION_V1_LEN 20
 #define ACCEPT_LOCATION_V2 "Sec-WebSocket-Location: "
 #define ACCEPT_LOCATION_V2_LEN 24
+#define ACCEPT_EXTENSION "Sec-WebSocket-Extensions: "
+#define ACCEPT_EXTENSION_LEN 26
 
 int parseHeaders(char *string, ws_client *n, int port);
 int sendHandshake(ws_client *n);
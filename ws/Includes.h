@@ -38,9 +38,23 @@ SOFTWARE.
 
 #include <sys/types.h> 			/* socket, setsockopt, accept, send, recv */
 #include <sys/socket.h> 		/* socket, setsockopt, inet_ntoa, accept */
+#include <sys/uio.h> 			/* struct iovec, for sendmsg */
 #include <netinet/in.h> 		/* sockaddr_in, inet_ntoa */
 #include <arpa/inet.h> 			/* htonl, htons, inet_ntoa */
 #include <sys/stat.h> 			/* stat */
+#include <time.h> 				/* clock_gettime, nanosleep */
+
+/**
+ * The target gets these from fake_header/strings.h, a host build uses the
+ * POSIX functions.
+ */
+#ifndef STRNCASECMP
+#define STRNCASECMP(s1, s2, sz) strncasecmp((s1), (s2), (sz))
+#endif
+
+#ifndef STRCASECMP
+#define STRCASECMP(s1, s2)      strcasecmp((s1), (s2))
+#endif
 
 #define KEYSIZE 16 				/* The size of the key in Hybi-00 */
 #define BUFFERSIZE 8192 		/* Buffer size = 8KB */
@@ -0,0 +1,321 @@
+/******************************************************************************
+  Copyright (c) 2013 Morten Houmøller Nygaard - www.mortz.dk - admin@mortz.dk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "Keepalive.h"
+#include "Log.h"
+#include <sockLib.h>
+
+static int keepalive_ticks = KEEPALIVE_INTERVAL / KEEPALIVE_TICK;
+static int keepalive_missed = KEEPALIVE_MISSED;
+static ws_keepalive_stats keepalive_stats;
+static pthread_mutex_t keepalive_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Sets the ping interval and how many pings may go unanswered. An interval
+ * of 0 disables the keepalive for clients connecting from now on.
+ *
+ * @param type(int) interval [Time between pings in ms]
+ * @param type(int) max_missed [Unanswered pings before the client is dropped]
+ */
+void ws_keepalive_configure(int interval, int max_missed) {
+	pthread_mutex_lock(&keepalive_lock);
+	if (interval <= 0) {
+		keepalive_ticks = 0;
+	} else if (interval < KEEPALIVE_TICK) {
+		keepalive_ticks = 1;
+	} else {
+		keepalive_ticks = interval / KEEPALIVE_TICK;
+	}
+	keepalive_missed = (max_missed < 1) ? KEEPALIVE_MISSED : max_missed;
+	pthread_mutex_unlock(&keepalive_lock);
+}
+
+/**
+ * Copies the keepalive counters.
+ *
+ * @param type(ws_keepalive_stats *) s [Destination of the counters]
+ */
+void ws_keepalive_getStats(ws_keepalive_stats *s) {
+	pthread_mutex_lock(&keepalive_lock);
+	memcpy(s, &keepalive_stats, sizeof(ws_keepalive_stats));
+	pthread_mutex_unlock(&keepalive_lock);
+}
+
+/**
+ * Puts the client into the slot of the wheel, which is reached after one
+ * interval. Intervals longer than the wheel are handled by letting the client
+ * pass the slot a number of rounds. Must be called with the list locked.
+ */
+static void keepalive_schedule(ws_list *l, ws_client *n, int ticks) {
+	int slot = (l->wheel_pos + ticks) % WHEEL_SLOTS;
+
+	n->wheel_slot = slot;
+	n->wheel_rounds = (ticks - 1) / WHEEL_SLOTS;
+	n->wheel_next = l->wheel[slot];
+	l->wheel[slot] = n;
+}
+
+/**
+ * Starts pinging a client. Only the framed protocols know ping and pong, so
+ * Hybi-00 and Hixie-75 clients are left alone. Must be called with the list
+ * locked, which list_add does.
+ *
+ * @param type(ws_list *) l [List containing clients]
+ * @param type(ws_client *) n [Client]
+ */
+void ws_keepalive_add(ws_list *l, ws_client *n) {
+	int ticks;
+
+	if (n->headers == NULL || (n->headers->type != RFC6455 && 
+				n->headers->type != HYBI10 && n->headers->type != HYBI07)) {
+		return;
+	}
+
+	pthread_mutex_lock(&keepalive_lock);
+	ticks = keepalive_ticks;
+	pthread_mutex_unlock(&keepalive_lock);
+
+	if (ticks > 0) {
+		keepalive_schedule(l, n, ticks);
+	}
+}
+
+/**
+ * Takes the client out of the wheel. Must be called with the list locked,
+ * which list_remove does.
+ *
+ * @param type(ws_list *) l [List containing clients]
+ * @param type(ws_client *) n [Client]
+ */
+void ws_keepalive_remove(ws_list *l, ws_client *n) {
+	ws_client **p;
+
+	if (n->wheel_slot < 0) {
+		return;
+	}
+
+	for (p = &l->wheel[n->wheel_slot]; *p != NULL; p = &(*p)->wheel_next) {
+		if (*p == n) {
+			*p = n->wheel_next;
+			break;
+		}
+	}
+
+	n->wheel_slot = -1;
+	n->wheel_next = NULL;
+}
+
+/**
+ * Marks the client dead and shuts the socket down. The thread of the client
+ * then returns from recv() and removes it from the list, while every sender
+ * skips it from now on.
+ *
+ * @param type(ws_client *) n [Client]
+ */
+void ws_keepalive_sendError(ws_client *n) {
+	if (n->dead) {
+		return;
+	}
+	n->dead = 1;
+	shutdown(n->socket_id, SHUT_RDWR);
+	WS_LOG(WS_LOG_WRN, "Sending to client %s on socket %d failed, dropping it.",
+			n->client_ip, n->socket_id);
+
+	pthread_mutex_lock(&keepalive_lock);
+	keepalive_stats.send_errors++;
+	pthread_mutex_unlock(&keepalive_lock);
+}
+
+/**
+ * Sends a ping carrying the current time, so the RTT can be calculated from
+ * the pong, even if it answers an older ping. A ping skipped because the
+ * socket is full counts as missed as well, so a client which stopped
+ * reading is dropped after max_missed pings all the same.
+ */
+static void keepalive_ping(ws_client *n, uint64_t now) {
+	char frame[10];
+	int i, ret;
+
+	frame[0] = '\x89';
+	frame[1] = 8;
+	for (i = 0; i < 8; i++) {
+		frame[2+i] = (char) (now >> (56 - 8*i));
+	}
+
+	if ( (ret = ws_send_control(n, frame, sizeof(frame))) < 0 ) {
+		return;
+	}
+	n->missed_pongs++;
+	if (ret == 0) {
+		return;
+	}
+
+	n->ping_sent = now;
+
+	pthread_mutex_lock(&keepalive_lock);
+	keepalive_stats.pings++;
+	pthread_mutex_unlock(&keepalive_lock);
+}
+
+/**
+ * Advances the wheel by one slot and pings every client in it, which has no
+ * rounds left. Clients with too many unanswered pings are shut down instead.
+ */
+static void keepalive_tick(ws_list *l, int ticks, int max_missed) {
+	ws_client *n, *next;
+	uint64_t now = ws_now();
+	int slot;
+
+	l->wheel_pos = (l->wheel_pos + 1) % WHEEL_SLOTS;
+	slot = l->wheel_pos;
+	n = l->wheel[slot];
+	l->wheel[slot] = NULL;
+
+	while (n != NULL) {
+		next = n->wheel_next;
+
+		if (n->wheel_rounds > 0) {
+			n->wheel_rounds--;
+			n->wheel_next = l->wheel[slot];
+			l->wheel[slot] = n;
+		} else if (n->dead) {
+			n->wheel_slot = -1;
+			n->wheel_next = NULL;
+		} else if (n->missed_pongs >= max_missed) {
+			WS_LOG(WS_LOG_WRN, "Client %s on socket %d missed %d pongs, "
+					"dropping it.", n->client_ip, n->socket_id, n->missed_pongs);
+
+			n->dead = 1;
+			n->wheel_slot = -1;
+			n->wheel_next = NULL;
+			shutdown(n->socket_id, SHUT_RDWR);
+
+			pthread_mutex_lock(&keepalive_lock);
+			keepalive_stats.evicted++;
+			pthread_mutex_unlock(&keepalive_lock);
+		} else if (ticks > 0) {
+			keepalive_ping(n, now);
+			keepalive_schedule(l, n, ticks);
+		} else {
+			n->wheel_slot = -1;
+			n->wheel_next = NULL;
+		}
+		n = next;
+	}
+}
+
+/**
+ * Retries the frames the sockets of the clients had no room for, so that a
+ * reply doesn't wait for the next broadcast, see ws_flush_pending(). Must
+ * be called with the list locked.
+ */
+static void keepalive_flush(ws_list *l) {
+	ws_client *n;
+
+	for (n = l->first; n != NULL; n = n->next) {
+		ws_flush_pending(n);
+	}
+}
+
+/**
+ * Handles a ping or pong received from the client. A pong clears the missed
+ * pings and updates the RTT, a ping is answered with the pong that
+ * communicate() has already encoded into the message.
+ *
+ * @param type(ws_list *) l [List containing clients]
+ * @param type(ws_client *) n [Client]
+ */
+void ws_keepalive_control(ws_list *l, ws_client *n) {
+	ws_message *m = n->message;
+	uint64_t now, sent = 0;
+	int i;
+
+	if (m == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&l->lock);
+	if ((m->opcode[0] & 0x0F) == 0x0A) {
+		now = ws_now();
+
+		/**
+		 * Our own pings carry the time they were sent. Anything else is an
+		 * unsolicited pong, which still proves that the client is alive.
+		 */
+		if (m->len == 8) {
+			for (i = 0; i < 8; i++) {
+				sent = (sent << 8) | (unsigned char) m->msg[i];
+			}
+		}
+
+		if (sent != 0 && sent <= now && n->ping_sent != 0 && 
+				sent <= n->ping_sent) {
+			n->rtt = (uint32_t) (now - sent);
+			n->rtt_avg = (n->rtt_avg == 0) ? n->rtt : 
+				(7 * n->rtt_avg + n->rtt) / 8;
+		}
+		n->missed_pongs = 0;
+
+		pthread_mutex_lock(&keepalive_lock);
+		keepalive_stats.pongs++;
+		pthread_mutex_unlock(&keepalive_lock);
+	} else if ((m->opcode[0] & 0x0F) == 0x09) {
+		ws_send(n, m);
+	}
+	pthread_mutex_unlock(&l->lock);
+}
+
+/**
+ * Thread driving the timer wheels of lists, and retrying what the sockets
+ * had no room for. It never returns, and should be started once right
+ * after the lists have been created. One thread serves
+ * all lists of a server, each is locked on its own.
+ *
+ * @param type(void *) args [NULL terminated array of lists (ws_list **)]
+ */
+void *ws_keepalive_thread(void *args) {
+	ws_list **lists = args;
+	ws_list *l;
+	struct timespec ts;
+	int ticks, max_missed, i;
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = KEEPALIVE_TICK * 1000000L;
+
+	while (1) {
+		nanosleep(&ts, NULL);
+
+		pthread_mutex_lock(&keepalive_lock);
+		ticks = keepalive_ticks;
+		max_missed = keepalive_missed;
+		pthread_mutex_unlock(&keepalive_lock);
+
+		for (i = 0; (l = lists[i]) != NULL; i++) {
+			pthread_mutex_lock(&l->lock);
+			keepalive_flush(l);
+			keepalive_tick(l, ticks, max_missed);
+			pthread_mutex_unlock(&l->lock);
+		}
+	}
+
+	return NULL;
+}
@@ -0,0 +1,52 @@
+/******************************************************************************
+  Copyright (c) 2013 Morten Houmøller Nygaard - www.mortz.dk - admin@mortz.dk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#ifndef _KEEPALIVE_H
+#define _KEEPALIVE_H
+
+#include "Datastructures.h"
+
+/**
+ * Server initiated ping/pong. Every RFC6455 client sits in a timer wheel on
+ * its list, and is pinged once per interval. A client which has not answered
+ * max_missed pings in a row is considered dead, its socket is shut down and
+ * its own thread removes it from the list.
+ */
+#define KEEPALIVE_TICK 100 		/* Resolution of the timer wheel in ms */
+#define KEEPALIVE_INTERVAL 5000 /* Default time between pings in ms */
+#define KEEPALIVE_MISSED 3 		/* Default unanswered pings before eviction */
+
+typedef struct {
+	uint64_t pings; 			/* Pings sent */
+	uint64_t pongs; 			/* Pongs received */
+	uint64_t evicted; 			/* Clients dropped for missing pongs */
+	uint64_t send_errors; 		/* Clients dropped because send() failed */
+} ws_keepalive_stats;
+
+void ws_keepalive_configure(int interval, int max_missed);
+void ws_keepalive_add(ws_list *l, ws_client *n);
+void ws_keepalive_remove(ws_list *l, ws_client *n);
+void ws_keepalive_control(ws_list *l, ws_client *n);
+void ws_keepalive_sendError(ws_client *n);
+void ws_keepalive_getStats(ws_keepalive_stats *s);
+void *ws_keepalive_thread(void *args);
+#endif
@@ -0,0 +1,224 @@
+/******************************************************************************
+  Copyright (c) 2013 Morten Houmøller Nygaard - www.mortz.dk - admin@mortz.dk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "Log.h"
+#include "Datastructures.h"
+
+/**
+ * Bounded multi-producer/multi-consumer queue as described by D. Vyukov.
+ * Every cell carries a sequence number, which tells whether the cell is free
+ * for the writer at position pos (seq == pos) or holds a record for the
+ * reader at position pos (seq == pos + 1). Writers and readers only race on
+ * their own position counter, which is claimed with a CAS.
+ *
+ * The cells store seq - index, so that the all zero initial state is the
+ * initialized queue, and no init call is needed before the first WS_LOG.
+ */
+typedef struct {
+	volatile uint32_t seq;
+	ws_log_record rec;
+} ws_log_cell;
+
+volatile int ws_log_level = WS_LOG_WRN;
+
+static ws_log_cell log_cells[WS_LOG_SLOTS];
+static volatile uint32_t log_enqueue;
+static volatile uint32_t log_dequeue;
+static volatile uint32_t log_dropped;
+
+static uint32_t log_seq(ws_log_cell *c, uint32_t idx) {
+	uint32_t seq = c->seq + idx;
+	__sync_synchronize();
+	return seq;
+}
+
+static void log_setSeq(ws_log_cell *c, uint32_t idx, uint32_t seq) {
+	__sync_synchronize();
+	c->seq = seq - idx;
+}
+
+/**
+ * Sets the highest level, which is logged.
+ *
+ * @param type(int) level [WS_LOG_ERR .. WS_LOG_DBG]
+ */
+void ws_log_setLevel(int level) {
+	ws_log_level = level;
+}
+
+/**
+ * Returns the number of messages lost because the ring was full.
+ *
+ * @return type(uint32_t) [Dropped messages]
+ */
+uint32_t ws_log_dropped(void) {
+	return log_dropped;
+}
+
+/**
+ * Formats a message into the ring. Use WS_LOG instead, which skips the call
+ * if the level is disabled.
+ *
+ * @param type(int) level [Level of the message]
+ * @param type(const char *) fmt [printf style format]
+ */
+void ws_log_write(int level, const char *fmt, ...) {
+	ws_log_cell *c;
+	uint32_t pos, idx;
+	int32_t diff;
+	va_list ap;
+
+	pos = log_enqueue;
+	while (1) {
+		idx = pos & (WS_LOG_SLOTS - 1);
+		c = &log_cells[idx];
+		diff = (int32_t) (log_seq(c, idx) - pos);
+
+		if (diff == 0) {
+			if (__sync_bool_compare_and_swap(&log_enqueue, pos, pos + 1)) {
+				break;
+			}
+		} else if (diff < 0) {
+			/**
+			 * The ring is full. Losing a message is better than stalling a
+			 * client thread on the console.
+			 */
+			__sync_fetch_and_add(&log_dropped, 1);
+			return;
+		}
+		pos = log_enqueue;
+	}
+
+	c->rec.time = ws_now();
+	c->rec.level = level;
+	va_start(ap, fmt);
+	vsnprintf(c->rec.text, WS_LOG_TEXT, fmt, ap);
+	va_end(ap);
+
+	log_setSeq(c, idx, pos + 1);
+}
+
+/**
+ * Writes the title and then every non empty line of the text as a record of
+ * its own. Use WS_LOG_BLOCK instead.
+ *
+ * @param type(int) level [Level of the message]
+ * @param type(const char *) title [First line]
+ * @param type(const char *) text [Lines separated by \n or \r\n]
+ */
+void ws_log_block(int level, const char *title, const char *text) {
+	const char *end;
+	int len;
+
+	ws_log_write(level, "%s", title);
+
+	while (text != NULL && *text != '\0') {
+		end = strchr(text, '\n');
+		len = (end != NULL) ? (int) (end - text) : (int) strlen(text);
+
+		if (len > 0 && text[len-1] == '\r') {
+			len--;
+		}
+		if (len > 0) {
+			ws_log_write(level, "\t%.*s", len, text);
+		}
+
+		text = (end != NULL) ? end + 1 : NULL;
+	}
+}
+
+/**
+ * Hands up to max records to the sink, oldest first.
+ *
+ * @param type(ws_log_sink) sink [Function receiving the records]
+ * @param type(void *) arg [Passed on to the sink]
+ * @param type(int) max [Maximum number of records to drain]
+ * @return type(int) [Number of records drained]
+ */
+int ws_log_drain(ws_log_sink sink, void *arg, int max) {
+	ws_log_cell *c;
+	uint32_t pos, idx;
+	int32_t diff;
+	int n;
+
+	for (n = 0; n < max; n++) {
+		pos = log_dequeue;
+		while (1) {
+			idx = pos & (WS_LOG_SLOTS - 1);
+			c = &log_cells[idx];
+			diff = (int32_t) (log_seq(c, idx) - (pos + 1));
+
+			if (diff == 0) {
+				if (__sync_bool_compare_and_swap(&log_dequeue, pos, pos + 1)) {
+					break;
+				}
+			} else if (diff < 0) {
+				return n;
+			}
+			pos = log_dequeue;
+		}
+
+		sink(&c->rec, arg);
+		log_setSeq(c, idx, pos + WS_LOG_SLOTS);
+	}
+
+	return n;
+}
+
+/**
+ * Sink writing the records to stdout.
+ */
+void ws_log_stdout(const ws_log_record *r, void *arg) {
+	(void) arg;
+	printf("%s\n", r->text);
+}
+
+/**
+ * Thread draining the ring to stdout, used by the standalone server.
+ *
+ * @param type(void *) args [Unused]
+ */
+void *ws_log_thread(void *args) {
+	struct timespec ts;
+	uint32_t dropped = 0;
+	(void) args;
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = 20000000L;
+
+	while (1) {
+		if (ws_log_drain(ws_log_stdout, NULL, 64) > 0) {
+			fflush(stdout);
+			continue;
+		}
+
+		if (ws_log_dropped() != dropped) {
+			printf("%u log messages dropped.\n", ws_log_dropped() - dropped);
+			fflush(stdout);
+			dropped = ws_log_dropped();
+		}
+
+		nanosleep(&ts, NULL);
+	}
+
+	return NULL;
+}
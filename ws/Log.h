@@ -0,0 +1,83 @@
+/******************************************************************************
+  Copyright (c) 2013 Morten Houmøller Nygaard - www.mortz.dk - admin@mortz.dk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#ifndef _LOG_H
+#define _LOG_H
+
+#include <stdint.h>
+#include <stdarg.h>
+
+/**
+ * Asynchronous logging. WS_LOG formats the message into a slot of a bounded
+ * lock-free ring, which any number of threads may write to. A single drain
+ * (a low priority task on the module, a thread in the standalone server)
+ * hands the records to a sink. Nothing is ever written to the console from
+ * the threads serving the clients.
+ *
+ * A message is only formatted if its level is enabled, so a disabled
+ * WS_LOG costs one load and one compare. If the ring is full the message
+ * is dropped and counted, the writer never waits for the drain.
+ */
+#define WS_LOG_ERR 0 			/* Errors, always logged */
+#define WS_LOG_WRN 1 			/* Connects, disconnects, dropped clients */
+#define WS_LOG_INF 2 			/* Handshakes, pings and pongs */
+#define WS_LOG_DBG 3 			/* Complete headers */
+
+#define WS_LOG_SLOTS 256 		/* Records in the ring, must be a power of 2 */
+#define WS_LOG_TEXT 240 		/* Longer messages are truncated */
+
+typedef struct {
+	uint64_t time; 				/* ws_now() when the message was written */
+	int level;
+	char text[WS_LOG_TEXT];
+} ws_log_record;
+
+typedef void (*ws_log_sink)(const ws_log_record *r, void *arg);
+
+extern volatile int ws_log_level;
+
+#define WS_LOG(level, ...) \
+	do { \
+		if ((level) <= ws_log_level) { \
+			ws_log_write((level), __VA_ARGS__); \
+		} \
+	} while (0)
+
+/**
+ * Logs a multi line text (e.g. the headers of a handshake) as one record
+ * per line, so that it isn't cut off at WS_LOG_TEXT.
+ */
+#define WS_LOG_BLOCK(level, title, text) \
+	do { \
+		if ((level) <= ws_log_level) { \
+			ws_log_block((level), (title), (text)); \
+		} \
+	} while (0)
+
+void ws_log_setLevel(int level);
+void ws_log_write(int level, const char *fmt, ...);
+void ws_log_block(int level, const char *title, const char *text);
+int ws_log_drain(ws_log_sink sink, void *arg, int max);
+uint32_t ws_log_dropped(void);
+void ws_log_stdout(const ws_log_record *r, void *arg);
+void *ws_log_thread(void *args);
+#endif
@@ -0,0 +1,285 @@
+/******************************************************************************
+  Copyright (c) 2013 Morten Houmøller Nygaard - www.mortz.dk - admin@mortz.dk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+
+
+#include "Pool.h"
+#include "Datastructures.h"
+#include "Log.h"
+
+/**
+ * A free object holds the link to the next one.
+ */
+typedef struct ws_pool_free_n {
+	struct ws_pool_free_n *next;
+} ws_pool_free;
+
+typedef struct {
+	size_t size; 				/* Of one object */
+	char *base; 				/* Block of the objects allocated in advance */
+	char *end;
+	ws_pool_free *free;
+	ws_pool_stats stats;
+	pthread_mutex_t lock;
+} ws_pool;
+
+/**
+ * Messages a thread keeps, see pool_cache().
+ */
+typedef struct {
+	int count;
+	ws_pool_free *free;
+} ws_pool_cache;
+
+static ws_pool pools[WS_POOLS] = {
+	{ sizeof(ws_client), NULL, NULL, NULL, { 0, 0, 0, 0 }, 
+		PTHREAD_MUTEX_INITIALIZER },
+	{ sizeof(ws_header), NULL, NULL, NULL, { 0, 0, 0, 0 }, 
+		PTHREAD_MUTEX_INITIALIZER },
+	{ sizeof(ws_message), NULL, NULL, NULL, { 0, 0, 0, 0 }, 
+		PTHREAD_MUTEX_INITIALIZER }
+};
+
+static pthread_key_t pool_key;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+static int pool_key_ok = 0;
+
+/**
+ * Moves up to count messages from the cache of a thread to the free list of
+ * the pool.
+ */
+static void pool_drain(ws_pool *p, ws_pool_cache *c, int count) {
+	ws_pool_free *f;
+
+	pthread_mutex_lock(&p->lock);
+	while (count-- > 0 && (f = c->free) != NULL) {
+		c->free = f->next;
+		c->count--;
+		f->next = p->free;
+		p->free = f;
+	}
+	pthread_mutex_unlock(&p->lock);
+}
+
+/**
+ * Gives the cache of a thread back to the pools, when the thread ends.
+ */
+static void pool_cache_free(void *arg) {
+	ws_pool_cache *c = arg;
+
+	pool_drain(&pools[WS_POOL_MESSAGE], c, c->count);
+	free(c);
+}
+
+static void pool_key_init(void) {
+	pool_key_ok = (pthread_key_create(&pool_key, pool_cache_free) == 0);
+}
+
+/**
+ * Returns the message cache of the calling thread, made on its first call.
+ * The messages in it are taken and given back without a lock, it is
+ * refilled from and emptied to the free list of the pool WS_POOL_BATCH
+ * messages at a time.
+ *
+ * @param type(ws_pool_type) t [Pool]
+ * @return type(ws_pool_cache *) [Cache, NULL: the pool or the thread has none]
+ */
+static ws_pool_cache *pool_cache(ws_pool_type t) {
+	ws_pool_cache *c;
+
+	if (WS_POOL_CACHE == 0 || t != WS_POOL_MESSAGE || 
+			pthread_once(&pool_once, pool_key_init) != 0 || 
+			!pool_key_ok) {
+		return NULL;
+	}
+
+	c = (ws_pool_cache *) pthread_getspecific(pool_key);
+	if (c == NULL) {
+		c = (ws_pool_cache *) calloc(1, sizeof(ws_pool_cache));
+		if (c != NULL && pthread_setspecific(pool_key, c) != 0) {
+			free(c);
+			c = NULL;
+		}
+	}
+	return c;
+}
+
+/**
+ * Counts an object taken (1) or given back (-1).
+ */
+static void pool_used(ws_pool *p, int d) {
+	int used = __sync_add_and_fetch(&p->stats.used, d);
+	int high = p->stats.high;
+
+	while (used > high && 
+			!__sync_bool_compare_and_swap(&p->stats.high, high, used)) {
+		high = p->stats.high;
+	}
+}
+
+/**
+ * Allocates the block of a pool and links its objects. Without memory the
+ * pool stays empty, and every object comes from malloc().
+ */
+static void pool_fill(ws_pool *p, int count) {
+	size_t size = p->size;
+	int i;
+
+	/**
+	 * Every object must be aligned as the structures in it.
+	 */
+	size = (size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+
+	p->base = (char *) malloc(size * count);
+	if (p->base == NULL) {
+		WS_LOG(WS_LOG_ERR, "No memory for a pool of %d objects.", count);
+		return;
+	}
+	p->end = p->base + size * count;
+
+	for (i = count - 1; i >= 0; i--) {
+		ws_pool_free *f = (ws_pool_free *) (p->base + size * i);
+		f->next = p->free;
+		p->free = f;
+	}
+	p->stats.size = count;
+}
+
+/**
+ * Allocates the pools for the given number of clients. Only the first call
+ * does anything, the pools are never freed.
+ *
+ * @param type(int) clients [Clients connected at the same time]
+ */
+void ws_pool_configure(int clients) {
+	int i;
+
+	if (clients <= 0) {
+		clients = WS_POOL_CLIENTS;
+	}
+
+	for (i = 0; i < WS_POOLS; i++) {
+		pthread_mutex_lock(&pools[i].lock);
+		if (pools[i].base == NULL) {
+			pool_fill(&pools[i], (i == WS_POOL_MESSAGE) ? 
+					WS_POOL_MESSAGES(clients) : clients);
+		}
+		pthread_mutex_unlock(&pools[i].lock);
+	}
+}
+
+/**
+ * Takes an object from the pool, or from malloc() if the pool is empty. The
+ * object is not initialised.
+ *
+ * @param type(ws_pool_type) t [Pool]
+ * @return type(void *) [Object, NULL if out of memory]
+ */
+void *ws_pool_get(ws_pool_type t) {
+	ws_pool *p = &pools[t];
+	ws_pool_cache *c = pool_cache(t);
+	ws_pool_free *f;
+	void *o = NULL;
+	int i;
+
+	if (c != NULL && c->count == 0) {
+		pthread_mutex_lock(&p->lock);
+		for (i = 0; i < WS_POOL_BATCH && (f = p->free) != NULL; i++) {
+			p->free = f->next;
+			f->next = c->free;
+			c->free = f;
+			c->count++;
+		}
+		pthread_mutex_unlock(&p->lock);
+	}
+
+	if (c != NULL && c->count > 0) {
+		o = c->free;
+		c->free = c->free->next;
+		c->count--;
+	} else {
+		pthread_mutex_lock(&p->lock);
+		if ( (o = p->free) != NULL ) {
+			p->free = p->free->next;
+		} else if ( (o = malloc(p->size)) != NULL ) {
+			p->stats.fallback++;
+		}
+		pthread_mutex_unlock(&p->lock);
+	}
+
+	if (o != NULL) {
+		pool_used(p, 1);
+	}
+	return o;
+}
+
+/**
+ * Gives an object from ws_pool_get() back.
+ *
+ * @param type(ws_pool_type) t [Pool it came from]
+ * @param type(void *) o [Object, may be NULL]
+ */
+void ws_pool_put(ws_pool_type t, void *o) {
+	ws_pool *p = &pools[t];
+	ws_pool_cache *c;
+	ws_pool_free *f = o;
+
+	if (o == NULL) {
+		return;
+	}
+	pool_used(p, -1);
+
+	/**
+	 * The block of a pool doesn't move once it is allocated.
+	 */
+	if ((char *) o < p->base || (char *) o >= p->end) {
+		free(f);
+		return;
+	}
+
+	if ( (c = pool_cache(t)) == NULL ) {
+		pthread_mutex_lock(&p->lock);
+		f->next = p->free;
+		p->free = f;
+		pthread_mutex_unlock(&p->lock);
+		return;
+	}
+
+	if (c->count >= WS_POOL_CACHE) {
+		pool_drain(p, c, WS_POOL_BATCH);
+	}
+	f->next = c->free;
+	c->free = f;
+	c->count++;
+}
+
+/**
+ * Copies the counters of a pool.
+ *
+ * @param type(ws_pool_type) t [Pool]
+ * @param type(ws_pool_stats *) s [Destination of the counters]
+ */
+void ws_pool_getStats(ws_pool_type t, ws_pool_stats *s) {
+	pthread_mutex_lock(&pools[t].lock);
+	memcpy(s, &pools[t].stats, sizeof(ws_pool_stats));
+	pthread_mutex_unlock(&pools[t].lock);
+}
@@ -0,0 +1,114 @@
+/******************************************************************************
+  Copyright (c) 2013 Morten Houmøller Nygaard - www.mortz.dk - admin@mortz.dk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "Rate.h"
+#include "Stats.h"
+#include "Log.h"
+
+static int rate_max = WS_RATE_DIVIDER;
+static uint32_t rate_queue = WS_RATE_QUEUE;
+
+/**
+ * Sets how far the rate of a client may go down, and the backlog which
+ * makes it go down. A max_divider of 1 sends every frame to every client.
+ *
+ * @param type(int) max_divider [Largest n of "every n-th frame"]
+ * @param type(int) queue_high [Bytes in the send buffer which are too many]
+ */
+void ws_rate_configure(int max_divider, int queue_high) {
+	rate_max = (max_divider < 1) ? 1 : max_divider;
+	rate_queue = (queue_high <= 0) ? WS_RATE_QUEUE : (uint32_t) queue_high;
+}
+
+/**
+ * Starts a new client with the full rate.
+ *
+ * @param type(ws_client *) n [Client]
+ */
+void ws_rate_init(ws_client *n) {
+	n->rate_div = 1;
+	n->rate_count = 0;
+	n->rate_calm = 0;
+	n->rate_frames = 0;
+	n->rate_skipped = 0;
+	n->rate_since = 0;
+}
+
+/**
+ * Looks at the backlog of the client at the end of a period, and sets its
+ * divider for the next one. Going down is quick, coming back up is slow,
+ * so that a link which is just good enough doesn't make it swing.
+ */
+static void rate_adapt(ws_client *n, uint64_t now) {
+	uint32_t queue = ws_stat_queue(n->socket_id);
+	int div = n->rate_div;
+
+	if (n->rate_skipped > 0 || n->pend_cnt > 0 || n->held != NULL || 
+			queue > rate_queue) {
+		div *= 2;
+		n->rate_calm = 0;
+	} else if (queue < rate_queue / 4 && ++n->rate_calm >= WS_RATE_CALM) {
+		div -= (div / 4 > 1) ? div / 4 : 1;
+		n->rate_calm = 0;
+	}
+	if (div > rate_max) {
+		div = rate_max;
+	}
+	if (div < 1) {
+		div = 1;
+	}
+
+	if (div != n->rate_div) {
+		WS_LOG(WS_LOG_INF, "Client %s on socket %d gets every %d. frame, "
+				"%u bytes queued", (char *) n->client_ip, n->socket_id, div, queue);
+		n->rate_div = div;
+	}
+	ws_stat_rate(n, div, 
+			(uint32_t) (n->rate_frames * 1000000ULL / (now - n->rate_since)));
+
+	n->rate_frames = 0;
+	n->rate_skipped = 0;
+	n->rate_since = now;
+}
+
+/**
+ * Tells whether a frame of the stream goes to the client, and adapts its
+ * rate once per period. Called for every frame with the list locked.
+ *
+ * @param type(ws_client *) n [Client]
+ * @param type(uint64_t) now [ws_now() of the frame]
+ * @return type(int) [1: send the frame, 0: the client leaves it out]
+ */
+int ws_rate_due(ws_client *n, uint64_t now) {
+	if (n->rate_since == 0) {
+		n->rate_since = now;
+	} else if (now - n->rate_since >= WS_RATE_PERIOD * 1000ULL) {
+		rate_adapt(n, now);
+	}
+
+	if (++n->rate_count < n->rate_div) {
+		return 0;
+	}
+	n->rate_count = 0;
+	n->rate_frames++;
+	return 1;
+}
@@ -0,0 +1,46 @@
+/******************************************************************************
+  Copyright (c) 2013 Morten Houmøller Nygaard - www.mortz.dk - admin@mortz.dk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#ifndef _RATE_H
+#define _RATE_H
+
+#include "Datastructures.h"
+
+/**
+ * Rate of the stream per client, adapted to what its link can take. A
+ * client which falls behind gets only every n-th frame of
+ * list_multicast_views(), evenly spaced, instead of a growing delay or of
+ * frames skipped whenever its socket happens to be full. Once per period
+ * the backlog of the client is looked at: a frame skipped or partly sent,
+ * or more than queue_high bytes in its send buffer, double n up to
+ * max_divider. After WS_RATE_CALM periods in a row with less than a
+ * quarter of queue_high, n goes down by a quarter, at least by one.
+ */
+#define WS_RATE_PERIOD 100 		/* Time between two looks at the backlog in ms */
+#define WS_RATE_CALM 10 		/* Periods without backlog before a step up */
+#define WS_RATE_DIVIDER 16 		/* Default largest divider, 1: off */
+#define WS_RATE_QUEUE 16384 	/* Default bytes in the send buffer which are too many */
+
+void ws_rate_configure(int max_divider, int queue_high);
+void ws_rate_init(ws_client *n);
+int ws_rate_due(ws_client *n, uint64_t now);
+#endif
@@ -0,0 +1,392 @@
+/******************************************************************************
+  Copyright (c) 2013 Morten Houmøller Nygaard - www.mortz.dk - admin@mortz.dk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "Static.h"
+#include "Handshake.h"
+#include "Log.h"
+#include "Pool.h"
+#include <sockLib.h>
+
+#define STATIC_HEADER 512 			/* Largest header of a response */
+
+/**
+ * What a request asks for, from the ws_header of the first one or from
+ * static_parse() for the ones after it.
+ */
+typedef struct {
+	const char *path; 			/* Resource, the query included */
+	int path_len;
+	int gzip; 					/* Client accepts gzip */
+	const char *if_none_match; 	/* ETags the client has, NULL: none */
+	int close; 					/* Connection ends after the response */
+} static_request;
+
+static const ws_asset *static_assets = NULL;
+static int static_count = 0;
+static uint64_t static_idle = WS_STATIC_IDLE * 1000ULL;
+static ws_static_stats static_stats;
+static pthread_mutex_t static_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Sets the files served. The table must stay as it is while the server
+ * runs.
+ *
+ * @param type(const ws_asset *) assets [Files, NULL: plain HTTP is refused]
+ * @param type(int) count [Files in the table]
+ * @param type(int) idle [Idle time of a connection in ms]
+ */
+void ws_static_configure(const ws_asset *assets, int count, int idle) {
+	pthread_mutex_lock(&static_lock);
+	static_assets = assets;
+	static_count = (assets == NULL || count < 0) ? 0 : count;
+	static_idle = ((idle < 1) ? WS_STATIC_IDLE : (uint64_t) idle) * 1000ULL;
+	pthread_mutex_unlock(&static_lock);
+}
+
+/**
+ * Tells whether plain HTTP requests are served.
+ *
+ * @return type(int) [1: served, 0: refused with 501]
+ */
+int ws_static_enabled(void) {
+	int count;
+
+	pthread_mutex_lock(&static_lock);
+	count = static_count;
+	pthread_mutex_unlock(&static_lock);
+
+	return count > 0;
+}
+
+/**
+ * Looks for a token in a header value, without regard to case.
+ *
+ * @return type(const char *) [Where it is, NULL: not there]
+ */
+static const char *static_token(const char *value, const char *token) {
+	size_t len = strlen(token);
+
+	for (; value != NULL && *value != '\0'; value++) {
+		if (STRNCASECMP(token, value, len) == 0) {
+			return value;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Tells whether an Accept-Encoding value allows gzip, "gzip;q=0" doesn't.
+ */
+static int static_gzip(const char *value) {
+	const char *p = static_token(value, "gzip");
+
+	if (p == NULL) {
+		return 0;
+	}
+	p += 4;
+	while (*p == ' ') {
+		p++;
+	}
+	if (*p != ';') {
+		return 1;
+	}
+	p++;
+	while (*p == ' ') {
+		p++;
+	}
+	if (STRNCASECMP("q=", p, 2) != 0) {
+		return 1;
+	}
+	return strtod(p + 2, NULL) > 0.0;
+}
+
+/**
+ * Takes the request from the headers the server has parsed already.
+ */
+static void static_fromHeaders(ws_header *h, static_request *r) {
+	r->path = h->resourcename;
+	r->path_len = h->resourcename_len;
+	r->gzip = static_gzip(h->accept_encoding);
+	r->if_none_match = h->if_none_match;
+	r->close = (static_token(h->connection, "close") != NULL);
+}
+
+/**
+ * Parses a request after the first one on a connection. The lines of the
+ * headers are cut apart in place.
+ *
+ * @param type(char *) req [The request, up to the "\r\n" of its last line]
+ * @param type(static_request *) r [Destination, points into req]
+ * @return type(int) [0: ok, -1: not a GET request of HTTP/1.x]
+ */
+static int static_parse(char *req, static_request *r) {
+	char *line, *end;
+
+	memset(r, '\0', sizeof(static_request));
+	if ( (end = strstr(req, "\r\n")) == NULL ) {
+		return -1;
+	}
+	*end = '\0';
+
+	if ( STRNCASECMP("GET /", req, 5) != 0 || 
+			(line = strchr(req + 4, ' ')) == NULL ) {
+		return -1;
+	}
+	r->path = req + 4;
+	r->path_len = line - r->path;
+	if (strcmp(line, " HTTP/1.0") == 0) {
+		r->close = 1;
+	} else if (strcmp(line, " HTTP/1.1") != 0) {
+		return -1;
+	}
+
+	for (line = end + 2; (end = strstr(line, "\r\n")) != NULL; line = end + 2) {
+		*end = '\0';
+		if ( STRNCASECMP("Accept-Encoding:", line, 16) == 0 ) {
+			r->gzip = static_gzip(line + 16);
+		} else if ( STRNCASECMP("If-None-Match:", line, 14) == 0 ) {
+			r->if_none_match = line + 14;
+		} else if ( STRNCASECMP("Connection:", line, 11) == 0 ) {
+			r->close = (static_token(line + 11, "close") != NULL);
+		}
+	}
+	return 0;
+}
+
+/**
+ * Finds the file of a resource, the query left out.
+ */
+static const ws_asset *static_find(const static_request *r) {
+	const ws_asset *assets;
+	int i, count, len = 0;
+
+	while (len < r->path_len && r->path[len] != '?') {
+		len++;
+	}
+
+	pthread_mutex_lock(&static_lock);
+	assets = static_assets;
+	count = static_count;
+	pthread_mutex_unlock(&static_lock);
+
+	for (i = 0; i < count; i++) {
+		if ( (int) strlen(assets[i].path) == len && 
+				strncmp(assets[i].path, r->path, len) == 0 ) {
+			return &assets[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Sends all of the iovecs, waiting for room in the send buffer up to the
+ * send timeout of the socket.
+ *
+ * @return type(int) [0: sent, -1: failed]
+ */
+static int static_send(int sock, struct iovec *iov, int cnt) {
+	struct msghdr h;
+	ssize_t sent;
+
+	while (cnt > 0) {
+		memset(&h, '\0', sizeof(h));
+		h.msg_iov = iov;
+		h.msg_iovlen = cnt;
+		sent = sendmsg(sock, &h, 0);
+		if (sent < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+
+		while (cnt > 0 && (size_t) sent >= iov->iov_len) {
+			sent -= iov->iov_len;
+			iov++;
+			cnt--;
+		}
+		if (cnt > 0) {
+			iov->iov_base = (char *) iov->iov_base + sent;
+			iov->iov_len -= sent;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Answers one request. The file is sent from the table as it is, behind
+ * the header in the same sendmsg().
+ *
+ * @param type(ws_client *) n [Client]
+ * @param type(static_request *) r [The request]
+ * @return type(int) [0: the connection is kept, -1: it ends]
+ */
+static int static_respond(ws_client *n, const static_request *r) {
+	char header[STATIC_HEADER];
+	struct iovec iov[2];
+	const ws_asset *a = static_find(r);
+	const char *connection = r->close ? "close" : "keep-alive";
+	int len, cnt = 1, gzip = 0, not_modified = 0;
+
+	if (a == NULL) {
+		len = snprintf(header, sizeof(header), "HTTP/1.1 404 Not Found\r\n"
+				"Content-Length: 0\r\nConnection: %s\r\n\r\n", connection);
+	} else if (r->if_none_match != NULL && 
+			(strstr(r->if_none_match, a->etag) != NULL || 
+			 strchr(r->if_none_match, '*') != NULL)) {
+		not_modified = 1;
+		len = snprintf(header, sizeof(header), "HTTP/1.1 304 Not Modified\r\n"
+				"ETag: %s\r\nCache-Control: no-cache\r\n"
+				"Vary: Accept-Encoding\r\nConnection: %s\r\n\r\n", a->etag,
+				connection);
+	} else {
+		gzip = (r->gzip && a->gzip != NULL);
+		iov[1].iov_base = (char *) (gzip ? a->gzip : a->data);
+		iov[1].iov_len = gzip ? a->gzip_len : a->len;
+		cnt = 2;
+		len = snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\n"
+				"Content-Type: %s\r\nContent-Length: %u\r\n%s"
+				"ETag: %s\r\nCache-Control: no-cache\r\n"
+				"Vary: Accept-Encoding\r\nConnection: %s\r\n\r\n", a->type,
+				(unsigned int) iov[1].iov_len, 
+				gzip ? "Content-Encoding: gzip\r\n" : "", a->etag, connection);
+	}
+
+	if (len < 0 || len >= (int) sizeof(header)) {
+		return -1;
+	}
+	iov[0].iov_base = header;
+	iov[0].iov_len = len;
+	if (cnt == 2) {
+		len += iov[1].iov_len;
+	}
+
+	WS_LOG(WS_LOG_DBG, "GET %.*s: %s", r->path_len, r->path, 
+			(a == NULL) ? "404" : (not_modified ? "304" : "200"));
+
+	if (static_send(n->socket_id, iov, cnt) < 0) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&static_lock);
+	static_stats.requests++;
+	static_stats.not_found += (a == NULL);
+	static_stats.not_modified += not_modified;
+	static_stats.compressed += gzip;
+	static_stats.bytes += len;
+	pthread_mutex_unlock(&static_lock);
+
+	return r->close ? -1 : 0;
+}
+
+/**
+ * Sets the receive or send timeout of the socket.
+ */
+static void static_timeout(int sock, int opt, uint64_t us) {
+	struct timeval tv;
+
+	tv.tv_sec = us / 1000000ULL;
+	tv.tv_usec = us % 1000000ULL;
+	setsockopt(sock, SOL_SOCKET, opt, (char *) &tv, sizeof(tv));
+}
+
+/**
+ * Serves a connection which started with a plain HTTP request, given by the
+ * headers parsed by parseHeaders(), and the requests which follow on the
+ * same connection. A request must be in within the idle time, otherwise
+ * the connection is closed. Frees the client at the end.
+ *
+ * @param type(ws_client *) n [Client]
+ */
+void ws_static_session(ws_client *n) {
+	char buffer[BUFFERSIZE + 1];
+	static_request r;
+	char *end = NULL;
+	uint64_t idle, deadline, now;
+	int used = 0, len, keep;
+
+	pthread_mutex_lock(&static_lock);
+	idle = static_idle;
+	pthread_mutex_unlock(&static_lock);
+
+	static_timeout(n->socket_id, SO_SNDTIMEO, idle);
+	static_fromHeaders(n->headers, &r);
+	keep = static_respond(n, &r);
+	buffer[0] = '\0';
+
+	while (keep == 0) {
+		deadline = ws_now() + idle;
+		while ( (end = strstr(buffer, "\r\n\r\n")) == NULL ) {
+			now = ws_now();
+			if (used == BUFFERSIZE || now >= deadline) {
+				break;
+			}
+			static_timeout(n->socket_id, SO_RCVTIMEO, deadline - now);
+
+			len = recv(n->socket_id, buffer + used, BUFFERSIZE - used, 0);
+			if (len < 0 && errno == EINTR) {
+				continue;
+			}
+			if (len <= 0) {
+				break;
+			}
+			used += len;
+			buffer[used] = '\0';
+		}
+
+		if (end == NULL) {
+			if (used == BUFFERSIZE) {
+				send(n->socket_id, ERROR_BAD, strlen(ERROR_BAD), 0);
+			}
+			break;
+		}
+
+		end[2] = '\0';
+		if (static_parse(buffer, &r) < 0) {
+			send(n->socket_id, ERROR_BAD, strlen(ERROR_BAD), 0);
+			break;
+		}
+		keep = static_respond(n, &r);
+
+		/**
+		 * A request sent right behind this one stays in the buffer.
+		 */
+		used -= (end + 4) - buffer;
+		memmove(buffer, end + 4, used + 1);
+	}
+
+	shutdown(n->socket_id, SHUT_RDWR);
+	client_free(n);
+	close(n->socket_id);
+	ws_pool_put(WS_POOL_CLIENT, n);
+}
+
+/**
+ * Copies the counters of the HTTP requests.
+ *
+ * @param type(ws_static_stats *) s [Destination of the counters]
+ */
+void ws_static_getStats(ws_static_stats *s) {
+	pthread_mutex_lock(&static_lock);
+	memcpy(s, &static_stats, sizeof(ws_static_stats));
+	pthread_mutex_unlock(&static_lock);
+}
@@ -0,0 +1,61 @@
+/******************************************************************************
+  Copyright (c) 2013 Morten Houmøller Nygaard - www.mortz.dk - admin@mortz.dk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#ifndef _STATIC_H
+#define _STATIC_H
+
+#include <stdint.h>
+#include "Datastructures.h"
+
+/**
+ * Static files served to plain HTTP GET requests on the port of the
+ * websockets, e.g. the page of a display. The files are a table in memory,
+ * made at build time (see sim/asset_pack.c), with a gzip copy of each, so
+ * the bytes go straight from the table to the socket. A client which has a
+ * file already gets a 304 by its ETag. The connection is kept for further
+ * requests until the client closes it or is idle for the timeout.
+ */
+#define WS_STATIC_IDLE 5000 		/* Default idle time of a connection in ms */
+
+typedef struct {
+	const char *path; 			/* Resource, e.g. "/hello.html" */
+	const char *type; 			/* Content-Type */
+	const char *etag; 			/* ETag, quotes included */
+	const unsigned char *data; 	/* The file as it is */
+	uint32_t len;
+	const unsigned char *gzip; 	/* The file gzip compressed, NULL: none */
+	uint32_t gzip_len;
+} ws_asset;
+
+typedef struct {
+	uint64_t requests; 			/* Requests answered */
+	uint64_t not_modified; 		/* Answered with 304, the client has the file */
+	uint64_t not_found; 		/* Answered with 404 */
+	uint64_t compressed; 		/* Files sent gzip compressed */
+	uint64_t bytes; 			/* Bytes sent, headers included */
+} ws_static_stats;
+
+void ws_static_configure(const ws_asset *assets, int count, int idle);
+int ws_static_enabled(void);
+void ws_static_session(ws_client *n);
+void ws_static_getStats(ws_static_stats *s);
+#endif
@@ -0,0 +1,144 @@
+/******************************************************************************
+  Copyright (c) 2013 Morten Houmøller Nygaard - www.mortz.dk - admin@mortz.dk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+
+#include "Stats.h"
+#include <ioLib.h>
+
+ws_stats ws_stat;
+
+/**
+ * Gives the client a slot of its own. Without a free one the client is
+ * only counted in the totals.
+ *
+ * @param type(ws_client *) n [Client]
+ */
+void ws_stat_claim(ws_client *n) {
+	ws_stat_client *s;
+	int i;
+
+	for (i = 0; i < WS_STAT_CLIENTS; i++) {
+		s = &ws_stat.client[i];
+		if (s->used == 0 && __sync_bool_compare_and_swap(&s->used, 0, 1)) {
+			s->socket_id = n->socket_id;
+			s->frames = 0;
+			s->bytes = 0;
+			s->skipped = 0;
+			s->rtt = 0;
+			s->channels = n->channels;
+			s->divider = 1;
+			s->rate = 0;
+			n->stat_slot = i;
+			return;
+		}
+	}
+	n->stat_slot = -1;
+	__sync_fetch_and_add(&ws_stat.no_slot, 1);
+}
+
+/**
+ * Frees the slot of the client.
+ *
+ * @param type(ws_client *) n [Client]
+ */
+void ws_stat_release(ws_client *n) {
+	if (n->stat_slot >= 0) {
+		ws_stat.client[n->stat_slot].used = 0;
+		n->stat_slot = -1;
+	}
+}
+
+/**
+ * Counts a frame sent to the client.
+ *
+ * @param type(ws_client *) n [Client]
+ * @param type(uint64_t) len [Length of the frame]
+ */
+void ws_stat_sent(ws_client *n, uint64_t len) {
+	__sync_fetch_and_add(&ws_stat.frames, 1);
+	__sync_fetch_and_add(&ws_stat.bytes, (uint32_t) len);
+
+	if (n->stat_slot >= 0) {
+		ws_stat_client *s = &ws_stat.client[n->stat_slot];
+
+		__sync_fetch_and_add(&s->frames, 1);
+		__sync_fetch_and_add(&s->bytes, (uint32_t) len);
+		s->rtt = n->rtt_avg;
+		s->channels = n->channels;
+	}
+}
+
+/**
+ * Counts a frame which was not sent to the client, as its socket had no
+ * room for it.
+ *
+ * @param type(ws_client *) n [Client]
+ */
+void ws_stat_skipped(ws_client *n) {
+	__sync_fetch_and_add(&ws_stat.skipped, 1);
+
+	if (n->stat_slot >= 0) {
+		__sync_fetch_and_add(&ws_stat.client[n->stat_slot].skipped, 1);
+	}
+}
+
+/**
+ * Notes the rate of the stream chosen for the client.
+ *
+ * @param type(ws_client *) n [Client]
+ * @param type(int) divider [It gets every n-th frame]
+ * @param type(uint32_t) rate [Frames per second it got lately]
+ */
+void ws_stat_rate(ws_client *n, int divider, uint32_t rate) {
+	if (n->stat_slot >= 0) {
+		ws_stat.client[n->stat_slot].divider = (uint32_t) divider;
+		ws_stat.client[n->stat_slot].rate = rate;
+	}
+}
+
+/**
+ * Counts an upgrade request.
+ *
+ * @param type(int) ok [1: the client is connected, 0: it was refused]
+ */
+void ws_stat_handshake(int ok) {
+	if (ok) {
+		__sync_fetch_and_add(&ws_stat.handshakes, 1);
+	} else {
+		__sync_fetch_and_add(&ws_stat.handshakes_failed, 1);
+	}
+}
+
+/**
+ * Returns the bytes which wait in the send buffer of a socket, 0 if the
+ * network stack cannot tell.
+ *
+ * @param type(int) socket_id [Socket]
+ */
+uint32_t ws_stat_queue(int socket_id) {
+	int pending = 0;
+
+	if (socket_id < 0 || ioctl(socket_id, FIONWRITE, &pending) < 0) {
+		return 0;
+	}
+	return (uint32_t) pending;
+}
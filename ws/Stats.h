@@ -0,0 +1,70 @@
+/******************************************************************************
+  Copyright (c) 2013 Morten Houmøller Nygaard - www.mortz.dk - admin@mortz.dk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+
+#ifndef _STATS_H
+#define _STATS_H
+
+#include "Datastructures.h"
+
+/**
+ * Counters of the server, for monitoring. They are only ever incremented
+ * with atomic adds and read without a lock, so polling them costs the
+ * senders nothing. All of them wrap around, a monitor takes differences.
+ *
+ * Every client in the list has a slot in client[], claimed by list_add and
+ * freed by list_remove. All zero is the initial state, no init is needed.
+ */
+#define WS_STAT_CLIENTS 32
+
+typedef struct {
+	volatile int used; 				/* 0: slot is free */
+	volatile int socket_id; 		/* socket of the client */
+	volatile uint32_t frames; 		/* frames sent to the client */
+	volatile uint32_t bytes; 		/* bytes sent to the client */
+	volatile uint32_t skipped; 		/* frames skipped, its socket was full */
+	volatile uint32_t rtt; 			/* average round trip time in us */
+	volatile uint32_t channels; 	/* subscribed channels */
+	volatile uint32_t divider; 		/* gets every n-th frame of the stream */
+	volatile uint32_t rate; 		/* frames of the stream per second it gets */
+} ws_stat_client;
+
+typedef struct {
+	volatile uint32_t handshakes; 			/* clients connected */
+	volatile uint32_t handshakes_failed; 	/* upgrade requests refused */
+	volatile uint32_t frames; 				/* frames sent to all clients */
+	volatile uint32_t bytes; 				/* bytes sent to all clients */
+	volatile uint32_t skipped; 				/* frames skipped, socket full */
+	volatile uint32_t no_slot; 				/* clients without a slot */
+	ws_stat_client client[WS_STAT_CLIENTS];
+} ws_stats;
+
+extern ws_stats ws_stat;
+
+void ws_stat_claim(ws_client *n);
+void ws_stat_release(ws_client *n);
+void ws_stat_sent(ws_client *n, uint64_t len);
+void ws_stat_skipped(ws_client *n);
+void ws_stat_rate(ws_client *n, int divider, uint32_t rate);
+void ws_stat_handshake(int ok);
+uint32_t ws_stat_queue(int socket_id);
+#endif
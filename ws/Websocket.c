@@ -23,12 +23,16 @@ SOFTWARE.
 #include "Handshake.h"
 #include "Communicate.h"
 #include "Errors.h"
+#include "Keepalive.h"
+#include "Log.h"
+#include "Pool.h"
 #include <sockLib.h>
 #include <pthread.h>
 #include <inetLib.h>
 #define PORT 4567
 
 ws_list *l;
+ws_list *lists[2]; 		/* l, for the keepalive thread */
 int port;
 
 /**
@@ -49,13 +53,14 @@ void sigint_handler(int sig) {
 }
 
 /**
- * Shuts down a client in a safe way. This is only used for Hybi-00.
+ * Shuts down a client in a safe way. This is only used for Hybi-00. It is
+ * pushed once the client is in the list: before that, every way out of the
+ * handshake has released the client already.
  */
 void cleanup_client(void *args) {
 	ws_client *n = args;
 	if (n != NULL) {
-		printf("Shutting client down..\n\n> ");
-		fflush(stdout);
+		WS_LOG(WS_LOG_WRN, "Shutting client down..");
 		list_remove(l, n);
 	}
 }
@@ -72,7 +77,12 @@ void *cmdline(void *arg) {
 		memset(buffer, '\0', 1024);
 		printf("> ");
 		fflush(stdout);
-		fgets(buffer, 1024, stdin);
+		if (fgets(buffer, 1024, stdin) == NULL) {
+			/**
+			 * No terminal (e.g. started by the benchmark), stop reading.
+			 */
+			break;
+		}
 		
 		if (STRNCASECMP(buffer, "users", 5) == 0 ||
 		        STRNCASECMP(buffer, "online", 6) == 0 ||
@@ -181,15 +191,13 @@ void *cmdline(void *arg) {
 					temp = NULL;
 
 					if ( (status = encodeMessage(m)) != CONTINUE) {
-						message_free(m);
-						free(m);
+						message_unref(m);
 						raise(SIGINT);
 						break;;
 					}
 
 					list_multicast_all(l, m);
-					message_free(m);
-					free(m);
+					message_unref(m);
 				}
 			}
 		} else if ( STRNCASECMP(buffer, "send", 4) == 0 ||
@@ -258,15 +266,13 @@ void *cmdline(void *arg) {
 				temp = NULL;
 
 				if ( (status = encodeMessage(m)) != CONTINUE) {
-					message_free(m);
-					free(m);
+					message_unref(m);
 					raise(SIGINT);
 					break;;
 				}
 
 				list_multicast_one(l, n, m);
-				message_free(m);
-				free(m);
+				message_unref(m);
 			}
 		} else {
 			printf("To see functions available type: 'help'.\n");
@@ -282,7 +288,6 @@ void *handleClient(void *args) {
 	pthread_detach(pthread_self());
 	pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
 	pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
-	pthread_cleanup_push(&cleanup_client, args);
 
 	int buffer_length = 0, string_length = 1, reads = 1;
 
@@ -301,11 +306,9 @@ void *handleClient(void *args) {
 		pthread_exit((void *) EXIT_FAILURE);
 	}
 
-	printf("Client connected with the following information:\n"
-		   "\tSocket: %d\n"
-		   "\tAddress: %s\n\n", n->socket_id, (char *) n->client_ip);
-	printf("Checking whether client is valid ...\n\n");
-	fflush(stdout);
+	WS_LOG(WS_LOG_WRN, "Client connected on socket %d from %s", 
+			n->socket_id, (char *) n->client_ip);
+	WS_LOG(WS_LOG_INF, "Checking whether client is valid ...");
 
 	/**
 	 * Getting headers and doing reallocation if headers is bigger than our
@@ -347,8 +350,8 @@ void *handleClient(void *args) {
 			&& strncmp("\r\n\r\n", n->string + (string_length-8-5), 4) != 0
 			&& strncmp("\n\n", n->string + (string_length-8-3), 2) != 0 );
 	
-	printf("User connected with the following headers:\n%s\n\n", n->string);
-	fflush(stdout);
+	WS_LOG_BLOCK(WS_LOG_DBG, "User connected with the following headers:", 
+			n->string);
 
 	ws_header *h = header_new();
 
@@ -370,23 +373,29 @@ void *handleClient(void *args) {
 	}	
 
 	list_add(l, n);
+	pthread_cleanup_push(&cleanup_client, n);
 	pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
 
-	printf("Client has been validated and is now connected\n\n");
-	printf("> ");
-	fflush(stdout);
+	WS_LOG(WS_LOG_WRN, "Client has been validated and is now connected");
 
 	uint64_t next_len = 0;
 	char next[BUFFERSIZE];
+	ws_connection_close status;
 	memset(next, '\0', BUFFERSIZE);
 
 	while (1) {
-		if ( communicate(n, next, next_len) != CONTINUE) {
+		if ( (status = communicate(n, next, next_len)) != CONTINUE) {
+			n->close = status;
 			break;
 		}
 
 		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
-		if (n->headers->protocol == CHAT) {
+		if (n->message->opcode[0] & 0x08) {
+			/**
+			 * Ping and pong are between the server and this client only.
+			 */
+			ws_keepalive_control(l, n);
+		} else if (n->headers->protocol == CHAT) {
 			list_multicast(l, n);
 		} else if (n->headers->protocol == ECHO) {
 			list_multicast_one(l, n, n->message);
@@ -399,15 +408,11 @@ void *handleClient(void *args) {
 			memset(next, '\0', BUFFERSIZE);
 			memcpy(next, n->message->next, n->message->next_len);
 			next_len = n->message->next_len;
-			message_free(n->message);
-			free(n->message);
-			n->message = NULL;	
+			client_message_done(n);
 		}
 	}
 	
-	printf("Shutting client down..\n\n");
-	printf("> ");
-	fflush(stdout);
+	WS_LOG(WS_LOG_WRN, "Shutting client down..");
 
 	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
 	list_remove(l, n);
@@ -424,11 +429,19 @@ int main(int argc, char *argv[]) {
 	socklen_t client_length;
 	pthread_t pthread_id;
 	pthread_attr_t pthread_attr;
+	struct timeval timeout;
+
+	/**
+	 * The clients and their messages come from pools, allocated once.
+	 */
+	ws_pool_configure(WS_POOL_CLIENTS);
 
 	/**
 	 * Creating new lists, l is supposed to contain the connected users.
 	 */
 	l = list_new();
+	lists[0] = l;
+	lists[1] = NULL;
 
 	/**
 	 * Listens for CTRL-C and Segmentation faults.
@@ -441,6 +454,11 @@ int main(int argc, char *argv[]) {
 	printf("Server: \t\tStarted\n");
 	fflush(stdout);
 
+	/**
+	 * The standalone server shows everything, including the headers.
+	 */
+	ws_log_setLevel(WS_LOG_DBG);
+
 	/**
 	 * Assigning port value.
 	 */
@@ -530,6 +548,24 @@ int main(int argc, char *argv[]) {
 	 */
 	pthread_detach(pthread_id);
 
+	/**
+	 * Create the thread, which writes the log to the console.
+	 */
+	if ( (pthread_create(&pthread_id, &pthread_attr, ws_log_thread, NULL)) 
+			< 0 ){
+		server_error(strerror(errno), server_socket, l);
+	}
+	pthread_detach(pthread_id);
+
+	/**
+	 * Create the thread, which pings the clients and drops dead ones.
+	 */
+	if ( (pthread_create(&pthread_id, &pthread_attr, ws_keepalive_thread, 
+					(void *) lists)) < 0 ){
+		server_error(strerror(errno), server_socket, l);
+	}
+	pthread_detach(pthread_id);
+
 	while (1) {
 		client_length = sizeof(client_addr);
 		
@@ -542,6 +578,15 @@ int main(int argc, char *argv[]) {
 			server_error(strerror(errno), server_socket, l);
 		}
 
+		/**
+		 * A peer which stops reading must not block the broadcasts to
+		 * everybody else for longer than one ping interval.
+		 */
+		timeout.tv_sec = KEEPALIVE_INTERVAL / 1000;
+		timeout.tv_usec = (KEEPALIVE_INTERVAL % 1000) * 1000;
+		setsockopt(client_socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, 
+				sizeof(timeout));
+
 		/**
 		 * Save some information about the client, which we will
 		 * later use to identify him with.
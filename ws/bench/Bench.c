@@ -0,0 +1,738 @@
+/******************************************************************************
+  Copyright (c) 2013 Morten Houmøller Nygaard - www.mortz.dk - admin@mortz.dk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+/**
+ * Load generator for the websocket server. It opens a number of RFC6455
+ * clients, lets one extra client publish timestamped messages with a fixed
+ * rate and size on the chat protocol, and measures how long it takes until
+ * every client has received them. The result is printed and written as JSON.
+ *
+ * Usage: Bench [options]
+ * 	-x <path>	Start this server binary and measure it (default: none)
+ * 	-P <pid>	Measure an already running server with this pid
+ * 	-H <host>	Host to connect to (default: 127.0.0.1)
+ * 	-p <port>	Port to connect to (default: 4567)
+ * 	-u <path>	Resource of the upgrade request, the stream of a server
+ * 			with several of them (default: /)
+ * 	-c <n>		Number of receiving clients (default: 100)
+ * 	-r <n>		Messages per second, 0 = as fast as possible (default: 100)
+ * 	-s <n>		Payload size in bytes (default: 256)
+ * 	-f <n>		Send each message in frames of this size, 0 = one frame
+ * 			(default: 0)
+ * 	-d <n>		Duration in seconds (default: 10)
+ * 	-t <n>		Receiver threads (default: 2)
+ * 	-z		Offer permessage-deflate
+ * 	-o <file>	Write the JSON result to this file (default: bench.json)
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <zlib.h>
+
+#define STAMP_LEN 20 			/* Digits of the timestamp in the payload */
+#define MAX_EVENTS 64
+#define RECV_BUFFER 65536
+
+typedef struct {
+	int fd;
+	int closed;
+	char *buf;
+	size_t len;
+	size_t cap;
+	z_stream *inflater;
+} bench_conn;
+
+typedef struct {
+	int epoll_fd;
+	bench_conn *conns;
+	int nconns;
+	uint32_t *samples; 			/* Delivery latencies in us */
+	size_t nsamples;
+	size_t cap;
+	uint64_t received;
+	uint64_t bytes;
+	pthread_t thread;
+} bench_worker;
+
+static const char *host = "127.0.0.1";
+static int port = 4567;
+static const char *resource = "/";
+static int clients = 100;
+static int rate = 100;
+static int size = 256;
+static int fragment = 0;
+static int duration = 10;
+static int threads = 2;
+static int offer_deflate = 0;
+static const char *server_path = NULL;
+static const char *out_path = "bench.json";
+static pid_t server_pid = 0;
+static volatile int running = 1;
+
+static uint64_t now_us(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void die(const char *what) {
+	fprintf(stderr, "Bench: %s: %s\n", what, strerror(errno));
+	if (server_pid > 0) {
+		kill(server_pid, SIGKILL);
+	}
+	exit(EXIT_FAILURE);
+}
+
+/**
+ * Sends the whole buffer on a (possibly non blocking) socket.
+ */
+static int send_all(int fd, const char *buf, size_t len) {
+	ssize_t n;
+
+	while (len > 0) {
+		n = send(fd, buf, len, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EAGAIN || errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+/**
+ * Sends a masked client frame, first is its first byte: FIN and opcode.
+ */
+static int send_raw_frame(int fd, int first, const char *payload, size_t len) {
+	char *frame = malloc(len + 14);
+	size_t hdr = 2, i;
+	uint32_t r = (uint32_t) rand();
+	char mask[4];
+	int ret;
+
+	if (frame == NULL) {
+		return -1;
+	}
+
+	memcpy(mask, &r, 4);
+	frame[0] = (char) first;
+	if (len <= 125) {
+		frame[1] = (char) (0x80 | len);
+	} else if (len <= 65535) {
+		frame[1] = (char) (0x80 | 126);
+		frame[2] = (char) (len >> 8);
+		frame[3] = (char) len;
+		hdr = 4;
+	} else {
+		frame[1] = (char) (0x80 | 127);
+		for (i = 0; i < 8; i++) {
+			frame[2+i] = (char) ((uint64_t) len >> (56 - 8*i));
+		}
+		hdr = 10;
+	}
+	memcpy(frame + hdr, mask, 4);
+	for (i = 0; i < len; i++) {
+		frame[hdr + 4 + i] = payload[i] ^ mask[i % 4];
+	}
+
+	ret = send_all(fd, frame, hdr + 4 + len);
+	free(frame);
+	return ret;
+}
+
+/**
+ * Sends a masked client frame with FIN set.
+ */
+static int send_frame(int fd, int opcode, const char *payload, size_t len) {
+	return send_raw_frame(fd, 0x80 | opcode, payload, len);
+}
+
+/**
+ * Sends a message, in frames of at most fragment bytes if that is set.
+ */
+static int send_message(int fd, int opcode, const char *payload, size_t len) {
+	size_t part;
+
+	while (fragment > 0 && len > (size_t) fragment) {
+		part = (size_t) fragment;
+		if (send_raw_frame(fd, opcode, payload, part) < 0) {
+			return -1;
+		}
+		opcode = 0x0;
+		payload += part;
+		len -= part;
+	}
+	return send_raw_frame(fd, 0x80 | opcode, payload, len);
+}
+
+/**
+ * Opens a connection and does the RFC6455 handshake.
+ */
+static int bench_connect(const char *protocol, int *deflated) {
+	struct addrinfo hints, *res;
+	char req[512], resp[2048], portstr[16];
+	int fd, one = 1, len = 0, n;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	snprintf(portstr, sizeof(portstr), "%d", port);
+	if (getaddrinfo(host, portstr, &hints, &res) != 0) {
+		errno = EINVAL;
+		die("getaddrinfo");
+	}
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, res->ai_addr, res->ai_addrlen) < 0) {
+		freeaddrinfo(res);
+		return -1;
+	}
+	freeaddrinfo(res);
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	snprintf(req, sizeof(req), 
+			"GET %s HTTP/1.1\r\n"
+			"Host: %s:%d\r\n"
+			"Upgrade: websocket\r\n"
+			"Connection: Upgrade\r\n"
+			"Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+			"Sec-WebSocket-Version: 13\r\n"
+			"Sec-WebSocket-Protocol: %s\r\n"
+			"%s"
+			"\r\n", resource, host, port, protocol, offer_deflate ? 
+			"Sec-WebSocket-Extensions: permessage-deflate; "
+			"client_no_context_takeover\r\n" : "");
+
+	if (send_all(fd, req, strlen(req)) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	/**
+	 * The server never sends a frame before the handshake is complete on our
+	 * side, so everything up to the empty line is the response.
+	 */
+	while (len < (int) sizeof(resp) - 1) {
+		if ((n = recv(fd, resp + len, 1, 0)) <= 0) {
+			close(fd);
+			return -1;
+		}
+		len += n;
+		resp[len] = '\0';
+		if (len >= 4 && strcmp(resp + len - 4, "\r\n\r\n") == 0) {
+			break;
+		}
+	}
+
+	if (strncmp(resp, "HTTP/1.1 101", 12) != 0) {
+		close(fd);
+		errno = EPROTO;
+		return -1;
+	}
+
+	*deflated = strstr(resp, "permessage-deflate") != NULL;
+	return fd;
+}
+
+static void add_sample(bench_worker *w, uint32_t us) {
+	if (w->nsamples == w->cap) {
+		w->cap = w->cap ? w->cap * 2 : 65536;
+		w->samples = realloc(w->samples, w->cap * sizeof(uint32_t));
+		if (w->samples == NULL) {
+			die("realloc");
+		}
+	}
+	w->samples[w->nsamples++] = us;
+}
+
+/**
+ * Handles one complete frame from the server.
+ */
+static void handle_frame(bench_worker *w, bench_conn *c, unsigned char b0, 
+		char *payload, uint64_t len, uint64_t now) {
+	static __thread char *plain = NULL;
+	static __thread size_t plain_cap = 0;
+	char stamp[STAMP_LEN + 1];
+	uint64_t sent;
+
+	switch (b0 & 0x0F) {
+	case 0x1:
+		if ((b0 & 0x40) && c->inflater != NULL) {
+			char tail[4] = {0, 0, (char) 0xFF, (char) 0xFF};
+			size_t need = (size_t) size + 64;
+
+			if (plain_cap < need) {
+				plain = realloc(plain, need);
+				plain_cap = need;
+			}
+			inflateReset(c->inflater);
+			c->inflater->next_in = (Bytef *) payload;
+			c->inflater->avail_in = len;
+			c->inflater->next_out = (Bytef *) plain;
+			c->inflater->avail_out = plain_cap;
+			inflate(c->inflater, Z_SYNC_FLUSH);
+			c->inflater->next_in = (Bytef *) tail;
+			c->inflater->avail_in = 4;
+			inflate(c->inflater, Z_SYNC_FLUSH);
+			payload = plain;
+			len = plain_cap - c->inflater->avail_out;
+		}
+
+		if (len >= STAMP_LEN) {
+			memcpy(stamp, payload, STAMP_LEN);
+			stamp[STAMP_LEN] = '\0';
+			sent = strtoull(stamp, NULL, 10);
+			if (sent != 0 && sent <= now) {
+				add_sample(w, (uint32_t) (now - sent));
+			}
+		}
+		w->received++;
+		w->bytes += len;
+		break;
+	case 0x8:
+		c->closed = 1;
+		break;
+	case 0x9:
+		/**
+		 * Answer the keepalive of the server, else we get dropped.
+		 */
+		send_frame(c->fd, 0xA, payload, len);
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Parses as many complete frames as there are in the buffer.
+ */
+static void parse_frames(bench_worker *w, bench_conn *c) {
+	size_t pos = 0, hdr;
+	uint64_t len, now = now_us();
+	unsigned char *b;
+	int i;
+
+	while (c->len - pos >= 2) {
+		b = (unsigned char *) c->buf + pos;
+		len = b[1] & 0x7F;
+		hdr = 2;
+
+		if (len == 126) {
+			if (c->len - pos < 4) {
+				break;
+			}
+			len = ((uint64_t) b[2] << 8) | b[3];
+			hdr = 4;
+		} else if (len == 127) {
+			if (c->len - pos < 10) {
+				break;
+			}
+			for (len = 0, i = 0; i < 8; i++) {
+				len = (len << 8) | b[2+i];
+			}
+			hdr = 10;
+		}
+
+		if (c->len - pos < hdr + len) {
+			if (hdr + len > c->cap) {
+				c->cap = hdr + len;
+				c->buf = realloc(c->buf, c->cap);
+				if (c->buf == NULL) {
+					die("realloc");
+				}
+			}
+			break;
+		}
+
+		handle_frame(w, c, b[0], c->buf + pos + hdr, len, now);
+		pos += hdr + len;
+	}
+
+	memmove(c->buf, c->buf + pos, c->len - pos);
+	c->len -= pos;
+}
+
+static void *worker_main(void *args) {
+	bench_worker *w = args;
+	struct epoll_event ev[MAX_EVENTS];
+	bench_conn *c;
+	ssize_t n;
+	int i, nev;
+
+	while (running) {
+		nev = epoll_wait(w->epoll_fd, ev, MAX_EVENTS, 100);
+
+		for (i = 0; i < nev; i++) {
+			c = ev[i].data.ptr;
+
+			while (1) {
+				if (c->cap - c->len < 4096) {
+					c->cap *= 2;
+					c->buf = realloc(c->buf, c->cap);
+					if (c->buf == NULL) {
+						die("realloc");
+					}
+				}
+				n = recv(c->fd, c->buf + c->len, c->cap - c->len, 0);
+				if (n > 0) {
+					c->len += n;
+					parse_frames(w, c);
+					continue;
+				}
+				if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+					c->closed = 1;
+					epoll_ctl(w->epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+				}
+				break;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Reads utime + stime of a process in seconds.
+ */
+static double proc_cpu(pid_t pid) {
+	char path[64], buf[1024], *p;
+	unsigned long utime = 0, stime = 0;
+	FILE *f;
+
+	snprintf(path, sizeof(path), "/proc/%d/stat", (int) pid);
+	if ((f = fopen(path, "r")) == NULL) {
+		return 0;
+	}
+	if (fgets(buf, sizeof(buf), f) != NULL && (p = strrchr(buf, ')')) != NULL) {
+		sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", 
+				&utime, &stime);
+	}
+	fclose(f);
+	return (double) (utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+/**
+ * Reads a "Vm...:" line of /proc/<pid>/status in kB.
+ */
+static long proc_mem(pid_t pid, const char *key) {
+	char path[64], line[256];
+	long kb = 0;
+	FILE *f;
+
+	snprintf(path, sizeof(path), "/proc/%d/status", (int) pid);
+	if ((f = fopen(path, "r")) == NULL) {
+		return 0;
+	}
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (strncmp(line, key, strlen(key)) == 0) {
+			kb = strtol(line + strlen(key) + 1, NULL, 10);
+			break;
+		}
+	}
+	fclose(f);
+	return kb;
+}
+
+/**
+ * Starts the server with its stdout going to /dev/null. Its stdin is a pipe
+ * which is never written to, so the command line just waits.
+ */
+static pid_t start_server(const char *path) {
+	int in[2], null;
+	char portstr[16];
+	pid_t pid;
+
+	if (pipe(in) < 0) {
+		die("pipe");
+	}
+	snprintf(portstr, sizeof(portstr), "%d", port);
+
+	if ((pid = fork()) < 0) {
+		die("fork");
+	} else if (pid == 0) {
+		null = open("/dev/null", O_WRONLY);
+		dup2(in[0], STDIN_FILENO);
+		dup2(null, STDOUT_FILENO);
+		close(in[1]);
+		execl(path, path, portstr, (char *) NULL);
+		_exit(127);
+	}
+	close(in[0]);
+
+	/**
+	 * Wait until the server accepts connections.
+	 */
+	usleep(200000);
+	return pid;
+}
+
+static int cmp_u32(const void *a, const void *b) {
+	uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+	return (x > y) - (x < y);
+}
+
+static uint32_t percentile(uint32_t *s, size_t n, double p) {
+	size_t i;
+
+	if (n == 0) {
+		return 0;
+	}
+	i = (size_t) (p * (n - 1) + 0.5);
+	return s[i];
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s [-x server] [-P pid] [-H host] [-p port] "
+			"[-u path] [-c clients] [-r rate] [-s size] [-f fragment] [-d seconds] "
+			"[-t threads] [-z] [-o file]\n", name);
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+	bench_worker *workers;
+	bench_conn *conns;
+	struct epoll_event ev;
+	struct timespec ts;
+	uint64_t start, stop, next, period, sent = 0, received = 0, bytes = 0;
+	uint32_t *all;
+	size_t nall = 0;
+	double cpu_start = 0, cpu_stop = 0, elapsed;
+	long rss = 0, hwm = 0;
+	char *payload;
+	int opt, i, pub, deflated, accepted = 0;
+	FILE *out;
+
+	while ((opt = getopt(argc, argv, "x:P:H:p:u:c:r:s:f:d:t:zo:")) != -1) {
+		switch (opt) {
+		case 'x': server_path = optarg; break;
+		case 'P': server_pid = atoi(optarg); break;
+		case 'H': host = optarg; break;
+		case 'p': port = atoi(optarg); break;
+		case 'u': resource = optarg; break;
+		case 'c': clients = atoi(optarg); break;
+		case 'r': rate = atoi(optarg); break;
+		case 's': size = atoi(optarg); break;
+		case 'f': fragment = atoi(optarg); break;
+		case 'd': duration = atoi(optarg); break;
+		case 't': threads = atoi(optarg); break;
+		case 'z': offer_deflate = 1; break;
+		case 'o': out_path = optarg; break;
+		default: usage(argv[0]);
+		}
+	}
+	if (clients < 1 || threads < 1 || size < STAMP_LEN || duration < 1 || 
+			rate < 0 || fragment < 0) {
+		usage(argv[0]);
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	if (server_path != NULL) {
+		server_pid = start_server(server_path);
+	}
+
+	/**
+	 * Connect the receivers, and spread them over the worker threads.
+	 */
+	workers = calloc(threads, sizeof(bench_worker));
+	conns = calloc(clients, sizeof(bench_conn));
+	if (workers == NULL || conns == NULL) {
+		die("calloc");
+	}
+	for (i = 0; i < threads; i++) {
+		if ((workers[i].epoll_fd = epoll_create1(0)) < 0) {
+			die("epoll_create1");
+		}
+	}
+
+	for (i = 0; i < clients; i++) {
+		bench_conn *c = &conns[i];
+		bench_worker *w = &workers[i % threads];
+
+		if ((c->fd = bench_connect("chat", &deflated)) < 0) {
+			die("connect");
+		}
+		if (deflated) {
+			accepted++;
+			c->inflater = calloc(1, sizeof(z_stream));
+			if (c->inflater == NULL || inflateInit2(c->inflater, -15) != Z_OK) {
+				die("inflateInit2");
+			}
+		}
+		c->cap = RECV_BUFFER;
+		c->buf = malloc(c->cap);
+		fcntl(c->fd, F_SETFL, fcntl(c->fd, F_GETFL) | O_NONBLOCK);
+
+		ev.events = EPOLLIN;
+		ev.data.ptr = c;
+		if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, c->fd, &ev) < 0) {
+			die("epoll_ctl");
+		}
+		w->nconns++;
+	}
+
+	for (i = 0; i < threads; i++) {
+		pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+	}
+
+	if ((pub = bench_connect("chat", &deflated)) < 0) {
+		die("connect publisher");
+	}
+
+	/**
+	 * Publish for the given duration. The schedule is absolute, so a late
+	 * message does not shift the following ones.
+	 */
+	payload = malloc(size);
+	memset(payload, 'x', size);
+	period = rate > 0 ? 1000000ULL / rate : 0;
+
+	if (server_pid > 0) {
+		cpu_start = proc_cpu(server_pid);
+	}
+	start = now_us();
+	next = start;
+	stop = start + (uint64_t) duration * 1000000ULL;
+
+	while (now_us() < stop) {
+		if (period > 0) {
+			uint64_t t = now_us();
+			if (t < next) {
+				ts.tv_sec = (next - t) / 1000000;
+				ts.tv_nsec = ((next - t) % 1000000) * 1000;
+				nanosleep(&ts, NULL);
+			}
+			next += period;
+		}
+
+		snprintf(payload, STAMP_LEN + 1, "%0*llu", STAMP_LEN, 
+				(unsigned long long) now_us());
+		payload[STAMP_LEN] = ' ';
+		if (send_message(pub, 0x1, payload, size) < 0) {
+			die("send");
+		}
+		sent++;
+	}
+	elapsed = (now_us() - start) / 1e6;
+
+	if (server_pid > 0) {
+		cpu_stop = proc_cpu(server_pid);
+		rss = proc_mem(server_pid, "VmRSS");
+		hwm = proc_mem(server_pid, "VmHWM");
+	}
+
+	/**
+	 * Give the server a moment to deliver what is still queued.
+	 */
+	for (i = 0; i < 20; i++) {
+		uint64_t r = 0;
+		int j;
+
+		usleep(100000);
+		for (j = 0; j < threads; j++) {
+			r += workers[j].received;
+		}
+		if (r >= sent * clients) {
+			break;
+		}
+	}
+	running = 0;
+
+	for (i = 0; i < threads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		received += workers[i].received;
+		bytes += workers[i].bytes;
+		nall += workers[i].nsamples;
+	}
+
+	all = malloc((nall + 1) * sizeof(uint32_t));
+	for (nall = 0, i = 0; i < threads; i++) {
+		memcpy(all + nall, workers[i].samples, 
+				workers[i].nsamples * sizeof(uint32_t));
+		nall += workers[i].nsamples;
+	}
+	qsort(all, nall, sizeof(uint32_t), cmp_u32);
+
+	out = fopen(out_path, "w");
+	for (i = 0; i < 2; i++) {
+		FILE *f = i == 0 ? stdout : out;
+
+		if (f == NULL) {
+			continue;
+		}
+		fprintf(f, 
+				"{\n"
+				"  \"clients\": %d,\n"
+				"  \"rate\": %d,\n"
+				"  \"size\": %d,\n"
+				"  \"fragment\": %d,\n"
+				"  \"duration\": %.3f,\n"
+				"  \"deflate_clients\": %d,\n"
+				"  \"sent\": %llu,\n"
+				"  \"received\": %llu,\n"
+				"  \"lost\": %llu,\n"
+				"  \"msgs_per_sec\": %.1f,\n"
+				"  \"bytes_per_sec\": %.1f,\n"
+				"  \"latency_us\": {\"p50\": %u, \"p99\": %u, \"p999\": %u, "
+				"\"max\": %u},\n"
+				"  \"server\": {\"cpu_percent\": %.1f, \"rss_kb\": %ld, "
+				"\"hwm_kb\": %ld}\n"
+				"}\n",
+				clients, rate, size, fragment, elapsed, accepted, 
+				(unsigned long long) sent, (unsigned long long) received, 
+				(unsigned long long) (sent * clients > received ? 
+					sent * clients - received : 0),
+				received / elapsed, bytes / elapsed,
+				percentile(all, nall, 0.5), percentile(all, nall, 0.99),
+				percentile(all, nall, 0.999), nall ? all[nall-1] : 0,
+				100.0 * (cpu_stop - cpu_start) / elapsed, rss, hwm);
+	}
+	if (out != NULL) {
+		fclose(out);
+	}
+
+	if (server_path != NULL && server_pid > 0) {
+		kill(server_pid, SIGKILL);
+		waitpid(server_pid, NULL, 0);
+	}
+
+	return EXIT_SUCCESS;
+}
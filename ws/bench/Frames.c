@@ -0,0 +1,322 @@
+/******************************************************************************
+  Copyright (c) 2013 Morten Houmøller Nygaard - www.mortz.dk - admin@mortz.dk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+/**
+ * Checks how communicate() receives frames on the host. A thread writes a
+ * sequence of RFC 6455 frames to a socket: a masked text frame, a text
+ * message in three fragments, one of them with a 16 bit length, with a
+ * ping and a pong between them, a text frame with a 16 bit length, a binary
+ * frame with a 64 bit length, a ping and a close frame. A second sequence
+ * is in Hybi-00: two text messages between '\x00' and '\xFF', and its
+ * closing handshake. Every message must come out of communicate() whole,
+ * with its opcode and the payload which was masked, the ping between the
+ * fragments must have been answered, and the sequence must end with
+ * CLOSE_NORMAL. A fragmented ping, a continuation frame without a message
+ * and a text frame within a fragmented message must end with
+ * CLOSE_PROTOCOL.
+ *
+ * Each sequence is sent one byte at a time, over a socket which keeps the
+ * bytes of each send apart, so that every header and payload is received in
+ * as many parts as possible (recvAll()). Then all of it is sent at once,
+ * so that one recv() gets parts of the following frames, which have to be
+ * carried over in m->next. Exits with 1 if a check failed.
+ *
+ * Usage: Frames
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "../Datastructures.h"
+#include "../Communicate.h"
+#include "../Pool.h"
+
+#define FRAMES_MAX 200000 			/* Bytes of one sequence */
+#define FRAMES_PONG "\x8A\x04ping" 	/* Answer to the ping between fragments */
+
+typedef struct {
+	const char *name;
+	char opcode; 					/* Of the message, without FIN */
+	uint64_t len;
+	int frames; 					/* Fragments it is sent in */
+} frames_case;
+
+/**
+ * The RFC 6455 sequence. Payloads are made by payload().
+ */
+static const frames_case rfc_cases[] = {
+	{ "masked text", 0x01, 5, 1 },
+	{ "fragmented text", 0x01, 400, 3 },
+	{ "16 bit length", 0x01, 300, 1 },
+	{ "64 bit length", 0x02, 70000, 1 },
+	{ "ping", 0x09, 4, 1 },
+	{ "empty text", 0x01, 0, 1 }
+};
+
+static const frames_case hybi_cases[] = {
+	{ "hybi-00 text", 0x01, 11, 1 },
+	{ "hybi-00 long text", 0x01, 9000, 1 }
+};
+
+typedef struct {
+	int socket;
+	const char *data;
+	size_t len;
+	size_t chunk; 					/* Bytes of each send */
+} frames_writer;
+
+static int failed = 0;
+
+/**
+ * Printable payload of a case, which differs from case to case.
+ */
+static void payload(char *p, uint64_t len, int id) {
+	uint64_t i;
+
+	for (i = 0; i < len; i++) {
+		p[i] = 'A' + (char) ((i * 7 + id) % 26);
+	}
+}
+
+/**
+ * Appends one masked frame to out.
+ */
+static size_t frame(char *out, char first, const char *p, uint64_t len,
+		uint32_t mask) {
+	size_t h = 0;
+	uint64_t i;
+	int k;
+
+	out[h++] = first;
+	if (len <= 125) {
+		out[h++] = (char) (0x80 | len);
+	} else if (len <= 65535) {
+		out[h++] = (char) (0x80 | 126);
+		out[h++] = (char) (len >> 8);
+		out[h++] = (char) len;
+	} else {
+		out[h++] = (char) (0x80 | 127);
+		for (k = 7; k >= 0; k--) {
+			out[h++] = (char) (len >> (8 * k));
+		}
+	}
+	memcpy(out + h, &mask, 4);
+	for (i = 0; i < len; i++) {
+		out[h + 4 + i] = p[i] ^ out[h + i % 4];
+	}
+	return h + 4 + len;
+}
+
+/**
+ * Writes the sequence, chunk bytes with each send(), and then ends the
+ * connection, so that a receiver which waits for more fails instead.
+ */
+static void *writer(void *arg) {
+	frames_writer *w = arg;
+	size_t done = 0, part;
+	ssize_t sent;
+
+	while (done < w->len) {
+		part = w->len - done < w->chunk ? w->len - done : w->chunk;
+		if ( (sent = send(w->socket, w->data + done, part, 0)) <= 0 ) {
+			break;
+		}
+		done += sent;
+	}
+	shutdown(w->socket, SHUT_WR);
+	return NULL;
+}
+
+static int binary(int stream, const char *data, uint64_t len) {
+	(void) stream;
+	(void) data;
+	(void) len;
+	return 0;
+}
+
+/**
+ * Sends one sequence to communicate() and checks the messages it returns,
+ * as the thread of a client would, the status it ends with, and what was
+ * sent back to the client on the way.
+ */
+static void receive(const char *mode, int type, int socktype, size_t chunk,
+		const char *data, size_t len, const frames_case *cases, int count,
+		ws_connection_close end, const char *reply) {
+	int sv[2], i = 0, bad = 0;
+	char next[BUFFERSIZE], back[64], *expect;
+	ssize_t back_len;
+	uint64_t next_len = 0;
+	ws_connection_close status;
+	frames_writer w;
+	pthread_t thread;
+	ws_client *n;
+	ws_message *m;
+
+	if (socketpair(AF_UNIX, socktype, 0, sv) != 0) {
+		perror("socketpair");
+		exit(2);
+	}
+	n = client_new(sv[0], "frames");
+	n->headers = header_new();
+	n->headers->type = type;
+	list_add(list_new(), n);
+
+	w.socket = sv[1];
+	w.data = data;
+	w.len = len;
+	w.chunk = chunk;
+	pthread_create(&thread, NULL, writer, &w);
+
+	expect = malloc(FRAMES_MAX);
+	while ( (status = communicate(n, next, next_len)) == CONTINUE ) {
+		m = n->message;
+		if (i < count) {
+			payload(expect, cases[i].len, i);
+		}
+		if (i >= count || m->len != cases[i].len || 
+				memcmp(m->msg, expect, m->len) != 0 || m->msg[m->len] != '\0' ||
+				(type != HYBI00 && (m->opcode[0] & 0x0F) != cases[i].opcode)) {
+			printf("FAIL %s, %s: message %d, %llu bytes\n", mode, 
+					i < count ? cases[i].name : "-", i, 
+					(unsigned long long) m->len);
+			bad = 1;
+		}
+		i++;
+
+		memcpy(next, m->next, m->next_len);
+		next_len = m->next_len;
+		client_message_done(n);
+	}
+
+	close(sv[0]);
+	pthread_join(thread, NULL);
+	back_len = recv(sv[1], back, sizeof(back), MSG_DONTWAIT);
+	if (back_len < 0) {
+		back_len = 0;
+	}
+	close(sv[1]);
+
+	if (status != end || i != count || bad || 
+			(size_t) back_len != strlen(reply) || 
+			memcmp(back, reply, back_len) != 0) {
+		printf("FAIL %s: %d of %d messages, then %d, %d bytes back\n", mode, 
+				i, count, status, (int) back_len);
+		failed = 1;
+	} else {
+		printf("ok   %s: %d messages\n", mode, i);
+	}
+	free(expect);
+}
+
+int main(void) {
+	char *rfc = malloc(FRAMES_MAX), *hybi = malloc(FRAMES_MAX), *p;
+	size_t rfc_len = 0, hybi_len = 0;
+	uint64_t part;
+	int i, f;
+
+	p = malloc(FRAMES_MAX);
+	if (rfc == NULL || hybi == NULL || p == NULL) {
+		return 2;
+	}
+	ws_pool_configure(WS_POOL_CLIENTS);
+	ws_binary_configure(binary);
+
+	/**
+	 * The fragments are of different length, the first and the last one
+	 * short, the middle one with a 16 bit length.
+	 */
+	for (i = 0; i < (int) (sizeof(rfc_cases) / sizeof(rfc_cases[0])); i++) {
+		payload(p, rfc_cases[i].len, i);
+		if (rfc_cases[i].frames == 1) {
+			rfc_len += frame(rfc + rfc_len, (char) (0x80 | rfc_cases[i].opcode),
+					p, rfc_cases[i].len, 0x37fa213du + i);
+			continue;
+		}
+		part = 0;
+		for (f = 0; f < rfc_cases[i].frames; f++) {
+			uint64_t l = (f == 1) ? rfc_cases[i].len - 2 * 50 : 50;
+			char first = (f == 0) ? rfc_cases[i].opcode : 0x00;
+
+			if (f == rfc_cases[i].frames - 1) {
+				first |= (char) 0x80;
+			}
+			rfc_len += frame(rfc + rfc_len, first, p + part, l, 
+					0x01020304u * (f + 1));
+			part += l;
+
+			if (f == 0) {
+				rfc_len += frame(rfc + rfc_len, (char) 0x89, "ping", 4, 
+						0x0badf00du);
+			} else if (f == 1) {
+				rfc_len += frame(rfc + rfc_len, (char) 0x8A, 
+						"\0\0\0\0\0\0\0\1", 8, 0xfeedfaceu);
+			}
+		}
+	}
+	rfc_len += frame(rfc + rfc_len, (char) 0x88, "\x03\xE8", 2, 0xdeadbeefu);
+
+	for (i = 0; i < (int) (sizeof(hybi_cases) / sizeof(hybi_cases[0])); i++) {
+		hybi[hybi_len++] = '\x00';
+		payload(hybi + hybi_len, hybi_cases[i].len, i);
+		hybi_len += hybi_cases[i].len;
+		hybi[hybi_len++] = '\xFF';
+	}
+	hybi[hybi_len++] = '\xFF';
+	hybi[hybi_len++] = '\x00';
+
+	receive("rfc 6455 byte by byte", RFC6455, SOCK_SEQPACKET, 1, rfc, rfc_len,
+			rfc_cases, sizeof(rfc_cases) / sizeof(rfc_cases[0]), CLOSE_NORMAL, 
+			FRAMES_PONG);
+	receive("rfc 6455 at once", RFC6455, SOCK_STREAM, rfc_len, rfc, rfc_len,
+			rfc_cases, sizeof(rfc_cases) / sizeof(rfc_cases[0]), CLOSE_NORMAL,
+			FRAMES_PONG);
+	receive("hybi-00 byte by byte", HYBI00, SOCK_SEQPACKET, 1, hybi, hybi_len,
+			hybi_cases, sizeof(hybi_cases) / sizeof(hybi_cases[0]), 
+			CLOSE_NORMAL, "");
+	receive("hybi-00 at once", HYBI00, SOCK_STREAM, hybi_len, hybi, hybi_len,
+			hybi_cases, sizeof(hybi_cases) / sizeof(hybi_cases[0]), 
+			CLOSE_NORMAL, "");
+
+	/**
+	 * Frames out of order.
+	 */
+	rfc_len = frame(rfc, (char) 0x09, "ping", 4, 0x11223344u);
+	receive("fragmented ping", RFC6455, SOCK_STREAM, rfc_len, rfc, rfc_len,
+			NULL, 0, CLOSE_PROTOCOL, "");
+	rfc_len = frame(rfc, (char) 0x80, "lost", 4, 0x11223344u);
+	receive("continuation first", RFC6455, SOCK_STREAM, rfc_len, rfc, rfc_len,
+			NULL, 0, CLOSE_PROTOCOL, "");
+	rfc_len = frame(rfc, (char) 0x01, "half", 4, 0x11223344u);
+	rfc_len += frame(rfc + rfc_len, (char) 0x81, "text", 4, 0x55667788u);
+	receive("text within a message", RFC6455, SOCK_STREAM, rfc_len, rfc, 
+			rfc_len, NULL, 0, CLOSE_PROTOCOL, "");
+
+	free(rfc);
+	free(hybi);
+	free(p);
+	return failed;
+}
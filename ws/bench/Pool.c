@@ -0,0 +1,129 @@
+/******************************************************************************
+  Copyright (c) 2013 Morten Houmøller Nygaard - www.mortz.dk - admin@mortz.dk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+/**
+ * Measures ws_pool_get() and ws_pool_put() of messages on the host, with
+ * 1 up to 33 threads at the same time, as the 32 client threads of the
+ * default pool size and the control task would. Each thread takes two
+ * messages, marks them as its own, checks the marks and gives them back.
+ * Prints the time of one get and put per thread and for all threads. At
+ * the end no message may be in use or have come from malloc(), and no
+ * message may have been handed out twice at the same time. Exits with 1 if a check failed.
+ * 'make bench-pool' runs it once with the caches of the threads and once
+ * without (WS_POOL_CACHE = 0), for comparison.
+ *
+ * Usage: Pool [-n <rounds>]
+ * 	-n <n>		Rounds of each thread (default: 200000)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "../Pool.h"
+#include "../Datastructures.h"
+
+#define POOL_HOLD 2 				/* Messages a thread holds at once, the
+										   received and the kept one */
+#define POOL_MAX_THREADS 33
+
+static long rounds = 200000;
+static volatile int failed = 0;
+
+/**
+ * What Log.c needs of Datastructures.c.
+ */
+uint64_t ws_now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void *worker(void *arg) {
+	uintptr_t id = (uintptr_t) arg;
+	ws_message *m[POOL_HOLD];
+	long r;
+	int i;
+
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < POOL_HOLD; i++) {
+			m[i] = ws_pool_get(WS_POOL_MESSAGE);
+			m[i]->len = id;
+		}
+		for (i = 0; i < POOL_HOLD; i++) {
+			if (m[i]->len != id) {
+				failed = 1;
+			}
+			ws_pool_put(WS_POOL_MESSAGE, m[i]);
+		}
+	}
+	return NULL;
+}
+
+int main(int argc, char *argv[]) {
+	static const int counts[] = { 1, 2, 4, 8, 16, 33 };
+	pthread_t threads[POOL_MAX_THREADS];
+	struct timespec start, end;
+	ws_pool_stats s;
+	double ns;
+	uintptr_t t;
+	int opt;
+	size_t c;
+
+	while ( (opt = getopt(argc, argv, "n:")) != -1 ) {
+		if (opt != 'n') {
+			fprintf(stderr, "Usage: %s [-n <rounds>]\n", argv[0]);
+			return 2;
+		}
+		rounds = atol(optarg);
+	}
+
+	ws_pool_configure(WS_POOL_CLIENTS);
+	printf("cache %d: threads   ns/get+put per thread   ns/get+put all\n",
+			WS_POOL_CACHE);
+
+	for (c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (t = 0; t < (uintptr_t) counts[c]; t++) {
+			pthread_create(&threads[t], NULL, worker, (void *) (t + 1));
+		}
+		for (t = 0; t < (uintptr_t) counts[c]; t++) {
+			pthread_join(threads[t], NULL);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+		ns /= (double) rounds * POOL_HOLD;
+		printf("%16d %23.1f %16.1f\n", counts[c], ns, ns / counts[c]);
+	}
+
+	ws_pool_getStats(WS_POOL_MESSAGE, &s);
+	printf("in use %d, high %d, from malloc %u, %s\n", s.used, s.high, 
+			s.fallback, failed ? "a message was handed out twice" : "ok");
+
+	return (failed || s.used != 0 || s.fallback != 0) ? 1 : 0;
+}
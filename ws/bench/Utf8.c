@@ -0,0 +1,347 @@
+/******************************************************************************
+  Copyright (c) 2013 Morten Houmøller Nygaard - www.mortz.dk - admin@mortz.dk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+/**
+ * Checks and measures utf8_validate() on the host. The checks come first:
+ * every sequence of up to three bytes and random longer ones must give the
+ * same result as a plain check after RFC 3629, and the cases of the
+ * Autobahn test suite (6.x) must pass whole, split at every byte and byte
+ * by byte. Then the throughput is measured on ASCII, on German text with
+ * umlauts, on CJK text and on emoji. Exits with 1 if a check failed.
+ *
+ * Usage: Utf8 [-n <MB>]
+ * 	-n <n>		Size of each text in MB (default: 16)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "../utf8.h"
+
+typedef struct {
+	const char *name;
+	const char *text;
+	int valid;
+} utf8_case;
+
+/**
+ * The invalid cases must be rejected, also when they end early.
+ */
+static const utf8_case cases[] = {
+	{ "empty", "", 1 },
+	{ "ascii", "Hello-\x7F", 1 },
+	{ "umlauts", "Gr\xC3\xBC\xC3\x9F\x65 \xC3\xA4\xC3\xB6", 1 },
+	{ "kosme", "\xCE\xBA\xE1\xBD\xB9\xCF\x83\xCE\xBC\xCE\xB5", 1 },
+	{ "first 2 byte", "\xC2\x80", 1 },
+	{ "first 3 byte", "\xE0\xA0\x80", 1 },
+	{ "first 4 byte", "\xF0\x90\x80\x80", 1 },
+	{ "last 1 byte", "\x7F", 1 },
+	{ "last 2 byte", "\xDF\xBF", 1 },
+	{ "last 3 byte", "\xEF\xBF\xBF", 1 },
+	{ "last 4 byte", "\xF4\x8F\xBF\xBF", 1 },
+	{ "before surrogates", "\xED\x9F\xBF", 1 },
+	{ "after surrogates", "\xEE\x80\x80", 1 },
+	{ "replacement", "\xEF\xBF\xBD", 1 },
+	{ "noncharacter", "\xEF\xBF\xBE", 1 },
+	{ "above U+10FFFF", "\xF4\x90\x80\x80", 0 },
+	{ "5 byte", "\xF8\x88\x80\x80\x80", 0 },
+	{ "6 byte", "\xFC\x84\x80\x80\x80\x80", 0 },
+	{ "lone continuation", "\x80", 0 },
+	{ "continuation after ascii", "abc\xBF", 0 },
+	{ "two continuations", "\x80\xBF", 0 },
+	{ "lone start", "\xC0 ", 0 },
+	{ "start without end", "\xE0\x80", 0 },
+	{ "truncated 2 byte", "\xDF", 0 },
+	{ "truncated 3 byte", "\xEF\xBF", 0 },
+	{ "truncated 4 byte", "\xF4\x8F\xBF", 0 },
+	{ "FE", "\xFE", 0 },
+	{ "FF", "\xFF", 0 },
+	{ "overlong slash 2 byte", "\xC0\xAF", 0 },
+	{ "overlong slash 3 byte", "\xE0\x80\xAF", 0 },
+	{ "overlong slash 4 byte", "\xF0\x80\x80\xAF", 0 },
+	{ "overlong max 2 byte", "\xC1\xBF", 0 },
+	{ "overlong max 3 byte", "\xE0\x9F\xBF", 0 },
+	{ "overlong max 4 byte", "\xF0\x8F\xBF\xBF", 0 },
+	{ "overlong nul", "\xC0\x80", 0 },
+	{ "high surrogate", "\xED\xA0\x80", 0 },
+	{ "low surrogate", "\xED\xBF\xBF", 0 },
+	{ "surrogate pair", "\xED\xA0\x80\xED\xB0\x80", 0 },
+	{ "kosme then invalid", "\xCE\xBA\xE1\xBD\xB9\xCF\x83\xCE\xBC\xCE\xB5"
+		"\xED\xA0\x80" "edited", 0 },
+	{ NULL, NULL, 0 }
+};
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * The plain check, one character after the other, after table 3-7 of the
+ * Unicode standard.
+ */
+static int reference(const unsigned char *s, size_t len) {
+	size_t i = 0, n, k;
+	unsigned char lo, hi;
+
+	while (i < len) {
+		unsigned char c = s[i];
+
+		lo = 0x80;
+		hi = 0xBF;
+		if (c < 0x80) {
+			n = 0;
+		} else if (c >= 0xC2 && c <= 0xDF) {
+			n = 1;
+		} else if (c >= 0xE0 && c <= 0xEF) {
+			n = 2;
+			if (c == 0xE0) {
+				lo = 0xA0;
+			} else if (c == 0xED) {
+				hi = 0x9F;
+			}
+		} else if (c >= 0xF0 && c <= 0xF4) {
+			n = 3;
+			if (c == 0xF0) {
+				lo = 0x90;
+			} else if (c == 0xF4) {
+				hi = 0x8F;
+			}
+		} else {
+			return 0;
+		}
+
+		if (i + n >= len && n > 0) {
+			return 0;
+		}
+		for (k = 1; k <= n; k++) {
+			if (s[i+k] < (k == 1 ? lo : 0x80) || s[i+k] > (k == 1 ? hi : 0xBF)) {
+				return 0;
+			}
+		}
+		i += n + 1;
+	}
+	return 1;
+}
+
+/**
+ * Validates s in pieces of the given size, 0 = in one piece.
+ */
+static int validate(const char *s, size_t len, size_t piece) {
+	unsigned int state = UTF8_ACCEPT;
+	size_t i, n;
+
+	if (piece == 0) {
+		piece = len;
+	}
+	for (i = 0; i < len; i += n) {
+		n = len - i < piece ? len - i : piece;
+		state = utf8_validate(state, s + i, n);
+	}
+	return state == UTF8_ACCEPT;
+}
+
+/**
+ * Appends a random character, of 1 to 4 bytes, and returns its length.
+ */
+static size_t random_char(unsigned char *s) {
+	static const uint32_t first[] = { 0, 0x80, 0x800, 0x10000 };
+	static const uint32_t range[] = { 0x80, 0x780, 0xF800 - 0x800, 0x100000 };
+	uint32_t n = rand() % 4, c = first[n] + (uint32_t) rand() % range[n];
+
+	if (n == 2 && c >= 0xD800) {
+		c += 0x800;
+	}
+	switch (n) {
+	case 0:
+		s[0] = c;
+		break;
+	case 1:
+		s[0] = 0xC0 | (c >> 6);
+		s[1] = 0x80 | (c & 0x3F);
+		break;
+	case 2:
+		s[0] = 0xE0 | (c >> 12);
+		s[1] = 0x80 | ((c >> 6) & 0x3F);
+		s[2] = 0x80 | (c & 0x3F);
+		break;
+	default:
+		s[0] = 0xF0 | (c >> 18);
+		s[1] = 0x80 | ((c >> 12) & 0x3F);
+		s[2] = 0x80 | ((c >> 6) & 0x3F);
+		s[3] = 0x80 | (c & 0x3F);
+	}
+	return n + 1;
+}
+
+/**
+ * Every sequence of up to three bytes, random ones of up to 24 bytes made
+ * mostly of bytes above 0x7F, and random texts long enough for the block
+ * checks, with one byte changed in most of them.
+ */
+static int check_sequences(void) {
+	unsigned char s[1024];
+	uint32_t i, k, len;
+	int errors = 0;
+
+	for (len = 1; len <= 3; len++) {
+		for (i = 0; i < (1u << (8 * len)); i++) {
+			for (k = 0; k < len; k++) {
+				s[k] = (i >> (8 * k)) & 0xFF;
+			}
+			if (validate((char *) s, len, 0) != reference(s, len)) {
+				if (errors++ < 10) {
+					printf("sequence of %u bytes %06x: wrong result\n", len, i);
+				}
+			}
+		}
+	}
+
+	srand(1);
+	for (i = 0; i < 2000000; i++) {
+		len = 1 + rand() % 24;
+		for (k = 0; k < len; k++) {
+			s[k] = rand() % 8 == 0 ? rand() % 0x80 : 0x80 + rand() % 0x80;
+		}
+		if (validate((char *) s, len, 0) != reference(s, len) ||
+				validate((char *) s, len, 1 + rand() % len) != reference(s, len)) {
+			if (errors++ < 10) {
+				printf("random sequence %u: wrong result\n", i);
+			}
+		}
+	}
+
+	for (i = 0; i < 200000; i++) {
+		len = 0;
+		k = 1 + rand() % 200;
+		while (k-- > 0) {
+			len += random_char(s + len);
+		}
+		if (rand() % 4 != 0) {
+			s[rand() % len] = rand() % 256;
+		}
+		if (validate((char *) s, len, 0) != reference(s, len) ||
+				validate((char *) s, len, 1 + rand() % len) != reference(s, len)) {
+			if (errors++ < 10) {
+				printf("random text %u: wrong result\n", i);
+			}
+		}
+	}
+
+	printf("sequences: %s\n", errors ? "FAILED" : "ok");
+	return errors;
+}
+
+/**
+ * The cases, each also between ASCII long enough for the block checks.
+ */
+static int check_cases(void) {
+	char s[256];
+	size_t len, piece;
+	const utf8_case *c;
+	int ok, errors = 0;
+
+	for (c = cases; c->name != NULL; c++) {
+		ok = 1;
+		len = snprintf(s, sizeof(s), "%s", c->text);
+		for (piece = 0; piece <= len; piece++) {
+			ok &= validate(s, len, piece) == c->valid;
+		}
+		len = snprintf(s, sizeof(s), "%040d%s%040d", 0, c->text, 0);
+		for (piece = 0; piece <= len; piece++) {
+			ok &= validate(s, len, piece) == c->valid;
+		}
+		/* the invalid cases also have to be rejected by the reference */
+		ok &= reference((unsigned char *) c->text, strlen(c->text)) == c->valid;
+
+		if (!ok) {
+			printf("case \"%s\": FAILED\n", c->name);
+			errors++;
+		}
+	}
+
+	printf("cases: %s\n", errors ? "FAILED" : "ok");
+	return errors;
+}
+
+/**
+ * Fills buf with the given pieces of text, in turn, and returns its length.
+ */
+static size_t fill(char *buf, size_t size, const char *text) {
+	size_t len = strlen(text), i = 0;
+
+	while (i + len <= size) {
+		memcpy(buf + i, text, len);
+		i += len;
+	}
+	return i;
+}
+
+static void measure(const char *name, char *buf, size_t size, const char *text) {
+	size_t len = fill(buf, size, text);
+	double start, best = 0;
+	int i, ok = 1;
+
+	for (i = 0; i < 5; i++) {
+		start = now();
+		ok &= validate(buf, len, 0);
+		start = now() - start;
+		if (best == 0 || start < best) {
+			best = start;
+		}
+	}
+	printf("%-8s %8.2f GB/s%s\n", name, len / best / 1e9, ok ? "" : " (rejected!)");
+}
+
+int main(int argc, char *argv[]) {
+	size_t size = 16;
+	char *buf;
+	int opt, errors;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		if (opt != 'n' || atoi(optarg) <= 0) {
+			fprintf(stderr, "usage: %s [-n <MB>]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+		size = atoi(optarg);
+	}
+
+	errors = check_sequences() + check_cases();
+
+	size <<= 20;
+	if ((buf = malloc(size)) == NULL) {
+		perror("malloc");
+		return EXIT_FAILURE;
+	}
+	measure("ascii", buf, size, "{\"cycle\":123456,\"value\":[1024,-512,77,0]} ");
+	measure("german", buf, size, "Die Gr\xC3\xB6\xC3\x9F" "e der Wellen \xC3\xA4ndert sich st\xC3\xBC" "ndlich. ");
+	measure("cjk", buf, size, "\xE6\xB3\xA2\xE6\xB5\xAA\xE7\x9A\x84\xE9\xAB\x98\xE5\xBA\xA6");
+	measure("emoji", buf, size, "\xF0\x9F\x8C\x8A\xF0\x9F\x8C\x8A\xF0\x9F\x9A\xA4");
+	free(buf);
+
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
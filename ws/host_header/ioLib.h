@@ -0,0 +1,13 @@
+/*
+ * ioLib.h
+ *
+ * Stand-in for the VxWorks header, so that the server builds on a Linux
+ * host (make, make bench). On the host the bytes waiting in the send buffer
+ * of a socket are SIOCOUTQ, which the controller calls FIONWRITE.
+ */
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+
+#ifndef FIONWRITE
+#define FIONWRITE SIOCOUTQ
+#endif
@@ -0,0 +1,7 @@
+/*
+ * sockLib.h
+ *
+ * Empty stand-in for the VxWorks header, so that the server builds on a
+ * Linux host (make, make bench). The POSIX headers in Includes.h already
+ * declare everything needed.
+ */
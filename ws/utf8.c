@@ -11,6 +11,24 @@
 
 #include "utf8.h"
 #include <strings.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && __GNUC__ >= 5 && (defined(__x86_64__) || defined(__i386__))
+#define UTF8_SSSE3
+#include <tmmintrin.h>
+#endif
+
+#ifndef STRCASECMP
+#define STRCASECMP(s1, s2) strcasecmp((s1), (s2))
+#endif
+
+static char *xml_utf8_decode   (const XML_Char *, int, int *, const XML_Char *);
+static char *xml_utf8_encode   (const char *s, int len, int *newlen,
+                                const XML_Char *encoding);
+static void *emalloc           (size_t size);
+static void *erealloc          (void* ptr, size_t size);
 
 inline static unsigned short xml_encode_iso_8859_1 (unsigned char);
 inline static char           xml_decode_iso_8859_1 (unsigned short);
@@ -215,7 +233,7 @@ static char *xml_utf8_decode (const XML_Char *s, int len, int *newlen,
 
 char *utf8_encode (const char *str)
 {
-  char *out;
+  char *out = NULL;
   if (strlen (str)) {
     int alen, len;
     alen = strlen (str);
@@ -227,7 +245,7 @@ char *utf8_encode (const char *str)
 
 char *utf8_decode (const char *str)
 {
-  char *out;
+  char *out = NULL;
   if (strlen(str)) {
     int alen, len;
     alen = strlen(str);
@@ -243,3 +261,195 @@ void utf8_clean (void *str)
 		free (str);
 }
 
+/* Validation
+ *
+ * A DFA after Bjoern Hoehrmann: it rejects overlong forms, surrogates and
+ * everything above U+10FFFF, and it can stop and go on at any byte, e.g. at
+ * the end of a fragment. Each byte maps to one of 12 classes, each class to
+ * a row holding the next state of all 9 states, 6 bits each, at 6 * state.
+ * The state is the shift, so a byte costs one shift after the state before;
+ * the lookups only depend on the bytes. Reject is 6 and never left, accept
+ * is 0. Runs of ASCII, which is most of the text, are skipped a block at a
+ * time. Where the CPU has SSSE3, longer texts are checked 16 bytes at a
+ * time from the start of a character on, and the DFA only takes the ends.
+ */
+static const unsigned char utf8_class[256] = {
+  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+  1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 9,9,9,9,9,9,9,9,9,9,9,9,9,9,9,9,
+  7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7, 7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+  8,8,2,2,2,2,2,2,2,2,2,2,2,2,2,2, 2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
+  10,3,3,3,3,3,3,3,3,3,3,3,3,4,3,3, 11,6,6,6,5,8,8,8,8,8,8,8,8,8,8,8
+};
+
+static const uint64_t utf8_row[12] = {
+  0x0006186186186180ULL, 0x0012486306300186ULL, 0x000618618618618cULL,
+  0x0006186186186192ULL, 0x000618618618619eULL, 0x00061861861861b0ULL,
+  0x00061861861861aaULL, 0x000649218c300186ULL, 0x0006186186186186ULL,
+  0x0006492306300186ULL, 0x0006186186186198ULL, 0x00061861861861a4ULL
+};
+
+#define UTF8_BLOCK 16           /* bytes between the checks for reject */
+#define UTF8_SIMD_MIN 64        /* shortest text for utf8_ssse3() */
+
+/* Number of ASCII bytes at the start of s */
+static size_t utf8_ascii (const unsigned char *s, size_t len)
+{
+  size_t i = 0;
+  unsigned long w;
+#ifdef __SSE2__
+  __m128i a, b;
+
+  while (i + 32 <= len) {
+    a = _mm_loadu_si128 ((const __m128i *) (s + i));
+    b = _mm_loadu_si128 ((const __m128i *) (s + i + 16));
+    if (_mm_movemask_epi8 (_mm_or_si128 (a, b)))
+      break;
+    i += 32;
+  }
+#endif
+  while (i + sizeof (w) <= len) {
+    memcpy (&w, s + i, sizeof (w));
+    if (w & ((unsigned long) -1 / 0xFF * 0x80))
+      break;
+    i += sizeof (w);
+  }
+  while (i < len && s[i] < 0x80)
+    i++;
+
+  return i;
+}
+
+#ifdef UTF8_SSSE3
+/* After "Validating UTF-8 In Less Than One Instruction Per Byte" by John
+ * Keiser and Daniel Lemire: each byte is looked up by its high nibble, the
+ * byte before by both nibbles, and a bit set in all three is an error. Only
+ * the bytes which must follow a lead byte two or three bytes before may be
+ * two continuations in a row.
+ */
+#define TOO_SHORT   0x01        /* lead or ASCII after a lead */
+#define TOO_LONG    0x02        /* continuation after ASCII */
+#define OVERLONG_3  0x04
+#define TOO_LARGE   0x08        /* above U+10FFFF */
+#define SURROGATE   0x10
+#define OVERLONG_2  0x20
+#define OVERLONG_4  0x40        /* also TOO_LARGE with 1000____ */
+#define TWO_CONTS   0x80
+#define CARRY       (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+static const unsigned char utf8_prev_high[16] = {
+  TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+  TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+  TOO_SHORT | OVERLONG_2,
+  TOO_SHORT,
+  TOO_SHORT | OVERLONG_3 | SURROGATE,
+  TOO_SHORT | TOO_LARGE | OVERLONG_4
+};
+
+static const unsigned char utf8_prev_low[16] = {
+  CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+  CARRY | OVERLONG_2,
+  CARRY, CARRY,
+  CARRY | TOO_LARGE,
+  CARRY | TOO_LARGE | OVERLONG_4, CARRY | TOO_LARGE | OVERLONG_4,
+  CARRY | TOO_LARGE | OVERLONG_4, CARRY | TOO_LARGE | OVERLONG_4,
+  CARRY | TOO_LARGE | OVERLONG_4, CARRY | TOO_LARGE | OVERLONG_4,
+  CARRY | TOO_LARGE | OVERLONG_4, CARRY | TOO_LARGE | OVERLONG_4,
+  CARRY | TOO_LARGE | OVERLONG_4 | SURROGATE,
+  CARRY | TOO_LARGE | OVERLONG_4, CARRY | TOO_LARGE | OVERLONG_4
+};
+
+static const unsigned char utf8_high[16] = {
+  TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+  TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | OVERLONG_4,
+  TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+  TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+  TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+  TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+};
+
+/* Checks len bytes, a multiple of 16, which start with a character. A
+ * character at the end may go on after them. Returns 0 if they are valid.
+ */
+__attribute__ ((target ("ssse3")))
+static int utf8_ssse3 (const unsigned char *s, size_t len)
+{
+  const __m128i prev_high = _mm_loadu_si128 ((const __m128i *) utf8_prev_high);
+  const __m128i prev_low = _mm_loadu_si128 ((const __m128i *) utf8_prev_low);
+  const __m128i high = _mm_loadu_si128 ((const __m128i *) utf8_high);
+  const __m128i nibble = _mm_set1_epi8 (0x0F);
+  const __m128i third = _mm_set1_epi8 (0xE0 - 0x80);
+  const __m128i fourth = _mm_set1_epi8 (0xF0 - 0x80);
+  const __m128i cont = _mm_set1_epi8 ((char) 0x80);
+  __m128i prev = _mm_setzero_si128 (), err = _mm_setzero_si128 ();
+  __m128i in, prev1, special, must;
+  size_t i;
+
+  for (i = 0; i < len; i += 16) {
+    in = _mm_loadu_si128 ((const __m128i *) (s + i));
+    prev1 = _mm_alignr_epi8 (in, prev, 15);
+    special = _mm_and_si128 (
+        _mm_and_si128 (
+          _mm_shuffle_epi8 (prev_high, _mm_and_si128 (_mm_srli_epi16 (prev1, 4), nibble)),
+          _mm_shuffle_epi8 (prev_low, _mm_and_si128 (prev1, nibble))),
+        _mm_shuffle_epi8 (high, _mm_and_si128 (_mm_srli_epi16 (in, 4), nibble)));
+
+    /* 111_____ two bytes before or 1111____ three bytes before */
+    must = _mm_or_si128 (_mm_subs_epu8 (_mm_alignr_epi8 (in, prev, 14), third),
+                         _mm_subs_epu8 (_mm_alignr_epi8 (in, prev, 13), fourth));
+    err = _mm_or_si128 (err, _mm_xor_si128 (_mm_and_si128 (must, cont), special));
+    prev = in;
+  }
+
+  return _mm_movemask_epi8 (_mm_cmpeq_epi8 (err, _mm_setzero_si128 ())) != 0xFFFF;
+}
+#endif
+
+/* Checks the next len bytes of a text. Start with UTF8_ACCEPT and hand the
+ * result to the next call. The text is valid if UTF8_ACCEPT comes back at
+ * its end, UTF8_REJECT is returned once it is invalid.
+ */
+unsigned int utf8_validate (unsigned int state, const char *s, size_t len)
+{
+  const unsigned char *p = (const unsigned char *) s, *end = p + len;
+  uint64_t st = state;
+  size_t i, n;
+
+  while (p < end) {
+    if (st == UTF8_ACCEPT && *p < 0x80) {
+      p += utf8_ascii (p, end - p);
+      if (p == end)
+        break;
+    }
+
+#ifdef UTF8_SSSE3
+    if (st == UTF8_ACCEPT && end - p >= UTF8_SIMD_MIN &&
+        __builtin_cpu_supports ("ssse3")) {
+      n = (end - p) & ~(size_t) 15;
+      if (utf8_ssse3 (p, n))
+        return UTF8_REJECT;
+      p += n;
+
+      /* the DFA goes on with the last character, it may not be complete */
+      for (i = 1; i <= 3 && (p[-i] & 0xC0) == 0x80; i++)
+        ;
+      if (i <= 3 && p[-i] >= 0xC0)
+        p -= i;
+      continue;
+    }
+#endif
+
+    /* reject is never left, so it is enough to look after a block */
+    n = end - p < UTF8_BLOCK ? (size_t) (end - p) : UTF8_BLOCK;
+    for (i = 0; i < n; i++)
+      st = utf8_row[utf8_class[p[i]]] >> (st & 63);
+    st &= 63;
+    p += n;
+    if (st == UTF8_REJECT)
+      break;
+  }
+
+  return (unsigned int) st;
+}
@@ -5,6 +5,8 @@
  * UTF-8 encoding/decoding functions from/to ISO-8859-1 and US-ASCII.
  * The encoding/decoding functions here are taken from xml.c in PHP
  *
+ * utf8_validate() checks UTF-8 as it comes in, in pieces of any size.
+ *
  * Copyright (c) 1999 - 2009 The PHP Group. All rights reserved.
  * Copyright (c) 2009        Pontus Östlund <spam@poppa.se>
  */
@@ -26,10 +28,12 @@ typedef struct {
 char        *utf8_encode       (const char *in);
 char        *utf8_decode       (const char *in);
 void         utf8_clean        (void *str);
-static char *xml_utf8_decode   (const XML_Char *, int, int *, const XML_Char *);
-static char *xml_utf8_encode   (const char *s, int len, int *newlen,
-                                const XML_Char *encoding);
-static void *emalloc           (size_t size);
-static void *erealloc          (void* ptr, size_t size);
+
+/* States of utf8_validate(), any other state is within a character */
+#define UTF8_ACCEPT 0
+#define UTF8_REJECT 6
+
+unsigned int utf8_validate     (unsigned int state, const char *s,
+                                size_t len);
 
 #endif	/* _UTF8_H */